@@ -1,4 +1,5 @@
 #include "benchmark_utils.h"
+#include "memorysampler.h"
 #include "plannedallocator.h"
 #include "profiler.h"
 #include <fstream>
@@ -19,7 +20,12 @@ static flexnn::PlannedAllocator g_planned_allocator;
 static flexnn::PlannedAllocatorInterface g_planned_weight_allocator;
 static flexnn::PlannedAllocatorInterface g_planned_blob_allocator;
 static flexnn::PlannedAllocatorInterface g_planned_intermediate_allocator;
-static flexnn::LockedTimeProfiler g_time_profiler;
+static flexnn::BufferedTimeProfiler g_time_profiler;
+static flexnn::PerfCounterProfiler g_perf_counter_profiler(&g_time_profiler);
+static std::vector<std::string> g_layer_names; // for the trace
+static MemorySampler g_memory_sampler;
+static int g_memory_sample_interval = 0; // us, 0 to disable
+static char g_memory_sample_path[256] = "";
 
 void benchmark_gpt2(const char* comment, const char* vocabpath, const ncnn::Option& opt)
 {
@@ -78,6 +84,12 @@ void benchmark_gpt2(const char* comment, const char* vocabpath, const ncnn::Opti
     sprintf(parampath, "%s.param", comment);
     net.load_param(parampath);
 
+    g_layer_names.clear();
+    for (size_t i = 0; i < net.layers().size(); i++)
+    {
+        g_layer_names.push_back(net.layers()[i]->name);
+    }
+
     // load persistent weights if have
     g_planned_allocator.set_load_mode(0);
     ncnn::Option opt2 = opt;
@@ -140,6 +152,8 @@ void benchmark_gpt2(const char* comment, const char* vocabpath, const ncnn::Opti
         g_planned_allocator.clear();
         // infer
         std::vector<int> response;
+        std::vector<ncnn::Mat> kv_cache; // stays empty unless MultiHeadAttention has kv_cache
+        const size_t prompt_len = input_ids.size();
         int it = 0;
 
         double start = flexnn::get_current_time();
@@ -155,12 +169,14 @@ void benchmark_gpt2(const char* comment, const char* vocabpath, const ncnn::Opti
             }
             fprintf(stderr, "\n");
 
-            ncnn::Mat input_ids_mat(input_ids.size());
-            ncnn::Mat position_ids_mat(input_ids.size());
-            for (int i = 0; i < input_ids.size(); i++)
+            // with kv_cache only the tokens after the cached ones are fed
+            const int past_len = kv_cache.empty() ? 0 : kv_cache[0].h;
+            ncnn::Mat input_ids_mat(input_ids.size() - past_len);
+            ncnn::Mat position_ids_mat(input_ids.size() - past_len);
+            for (int i = past_len; i < input_ids.size(); i++)
             {
-                input_ids_mat[i] = float(input_ids[i]);
-                position_ids_mat[i] = float(i);
+                input_ids_mat[i - past_len] = float(input_ids[i]);
+                position_ids_mat[i - past_len] = float(i);
             }
 
             const std::vector<const char*>& input_names = net.input_names();
@@ -171,7 +187,9 @@ void benchmark_gpt2(const char* comment, const char* vocabpath, const ncnn::Opti
                 ncnn::Extractor ex = net.create_extractor();
                 ex.input(input_names[0], input_ids_mat);
                 ex.input(input_names[1], position_ids_mat);
+                ex.input_kv_cache(kv_cache);
                 ex.extract(output_names[0], logits);
+                ex.extract_kv_cache(kv_cache);
                 // ex.input("0", input_ids_mat);
                 // ex.input("input.3", position_ids_mat);
                 // // print input shapes
@@ -189,9 +207,15 @@ void benchmark_gpt2(const char* comment, const char* vocabpath, const ncnn::Opti
             softmax<float>(next_token_logits, next_token_logits, 13317);
             int next_token = multinomial(next_token_logits);
             if (next_token == 102) break;
-            // response.push_back(next_token);
-            // input_ids.push_back(next_token);
+
+            // only a kv_cache net decodes token by token, the others keep the fixed input shape of the planned allocation
+            if (!kv_cache.empty())
+            {
+                response.push_back(next_token);
+                input_ids.push_back(next_token);
+            }
         }
+        input_ids.resize(prompt_len);
         double end = flexnn::get_current_time();
 
         double time = end - start;
@@ -219,7 +243,53 @@ void benchmark_gpt2(const char* comment, const char* vocabpath, const ncnn::Opti
     fprintf(stderr, "%20s  min = %7.2f ms  max = %7.2f ms  avg = %7.2f ms  load = %7.2f ms\n", comment, time_min, time_max, time_avg, load_end - load_start);
 }
 
-void benchmark(const char* comment, const ncnn::Mat& _in, const ncnn::Option& opt)
+class BenchmarkStats
+{
+public:
+    std::string config;
+    std::vector<double> times; // ms, one per loop
+    double load_time;
+    double time_min;
+    double time_max;
+    double time_avg;
+    double time_stddev;
+    double time_p50;
+    double time_p90;
+    double time_p99;
+    long peak_rss;                    // kB, -1 if unknown
+    std::vector<double> layer_stalls; // ms by layer index in the last loop, empty if not profiled
+    MemorySummary memory;             // empty if not sampled
+};
+
+// per layer time the computing waited for its weights, from the computing end of the previous layer
+static void get_layer_stalls(const std::vector<flexnn::LayerTimeProfile>& profiles, std::vector<double>& stalls)
+{
+    std::vector<flexnn::LayerTimeProfile> computed;
+    for (size_t i = 0; i < profiles.size(); i++)
+    {
+        if (profiles[i].computing_begin > 0)
+            computed.push_back(profiles[i]);
+    }
+    std::sort(computed.begin(), computed.end(), [](const flexnn::LayerTimeProfile& a, const flexnn::LayerTimeProfile& b) {
+        return a.computing_begin < b.computing_begin;
+    });
+
+    stalls.clear();
+    for (size_t i = 0; i < computed.size(); i++)
+    {
+        const flexnn::LayerTimeProfile& profile = computed[i];
+        if (profile.layer_index >= (int)stalls.size())
+            stalls.resize(profile.layer_index + 1, 0);
+
+        if (i == 0 || profile.loading_end <= computed[i - 1].computing_end)
+            continue;
+
+        // loaded after the previous layer finished, computing idled until the weights arrived
+        stalls[profile.layer_index] = std::min(profile.loading_end, profile.computing_begin) - computed[i - 1].computing_end;
+    }
+}
+
+double benchmark(const char* comment, const ncnn::Mat& _in, const ncnn::Option& opt, BenchmarkStats* stats = 0)
 {
     ncnn::Mat in = _in;
     // fprintf(stderr, "Benchmark input shape: [%d,%d,%d,%d]\n", in.d, in.c, in.h, in.w);
@@ -229,6 +299,18 @@ void benchmark(const char* comment, const ncnn::Mat& _in, const ncnn::Option& op
     g_workspace_pool_allocator.clear();
     g_planned_allocator.clear();
 
+    if (stats)
+    {
+        g_time_profiler.clear();
+        reset_peak_rss();
+    }
+
+    if (g_memory_sample_interval > 0)
+    {
+        g_memory_sampler.start(g_memory_sample_interval);
+        g_memory_sampler.set_phase("load");
+    }
+
     ncnn::Net net;
 
     net.opt = opt;
@@ -239,6 +321,12 @@ void benchmark(const char* comment, const ncnn::Mat& _in, const ncnn::Option& op
     sprintf(parampath, "%s.param", comment);
     net.load_param(parampath);
 
+    g_layer_names.clear();
+    for (size_t i = 0; i < net.layers().size(); i++)
+    {
+        g_layer_names.push_back(net.layers()[i]->name);
+    }
+
     // load persistent weights if have
     g_planned_allocator.set_load_mode(0);
     ncnn::Option opt2 = opt;
@@ -300,6 +388,9 @@ void benchmark(const char* comment, const ncnn::Mat& _in, const ncnn::Option& op
 
     ncnn::Mat out;
 
+    if (g_memory_sample_interval > 0)
+        g_memory_sampler.set_phase("warmup");
+
     // warm up
     for (int i = 0; i < g_warmup_loop_count; i++)
     {
@@ -312,6 +403,10 @@ void benchmark(const char* comment, const ncnn::Mat& _in, const ncnn::Option& op
     double time_min = DBL_MAX;
     double time_max = -DBL_MAX;
     double time_avg = 0;
+    std::vector<double> times;
+
+    if (g_memory_sample_interval > 0)
+        g_memory_sampler.set_phase("infer");
 
     for (int i = 0; i < g_loop_count; i++)
     {
@@ -331,6 +426,7 @@ void benchmark(const char* comment, const ncnn::Mat& _in, const ncnn::Option& op
         time_min = std::min(time_min, time);
         time_max = std::max(time_max, time);
         time_avg += time;
+        times.push_back(time);
 
         fprintf(stderr, "%20s  loop %d\t%7.2f ms\n", comment, i, time);
     }
@@ -343,6 +439,70 @@ void benchmark(const char* comment, const ncnn::Mat& _in, const ncnn::Option& op
     time_avg /= g_loop_count;
 
     fprintf(stderr, "%20s  min = %7.2f ms  max = %7.2f ms  avg = %7.2f ms  load = %7.2f ms\n", comment, time_min, time_max, time_avg, load_end - load_start);
+
+    if (g_memory_sample_interval > 0)
+    {
+        g_memory_sampler.stop();
+        g_memory_sampler.report(comment);
+        if (stats)
+            g_memory_sampler.summarize(stats->memory);
+        if (g_memory_sample_path[0] != '\0')
+            g_memory_sampler.save(g_memory_sample_path, stats ? stats->config.c_str() : comment);
+    }
+
+    if (stats)
+    {
+        double sq = 0;
+        for (size_t i = 0; i < times.size(); i++)
+        {
+            sq += (times[i] - time_avg) * (times[i] - time_avg);
+        }
+
+        stats->times = times;
+        stats->load_time = load_end - load_start;
+        stats->time_min = time_min;
+        stats->time_max = time_max;
+        stats->time_avg = time_avg;
+        stats->time_stddev = times.size() > 1 ? sqrt(sq / (times.size() - 1)) : 0;
+        stats->time_p50 = percentile(times, 50);
+        stats->time_p90 = percentile(times, 90);
+        stats->time_p99 = percentile(times, 99);
+        stats->peak_rss = get_peak_rss();
+
+        stats->layer_stalls.clear();
+        if (opt.time_profiler)
+        {
+            std::vector<flexnn::LayerTimeProfile> time_profiles;
+            g_time_profiler.save(time_profiles);
+            get_layer_stalls(time_profiles, stats->layer_stalls);
+        }
+
+        fprintf(stderr, "%20s  p50 = %7.2f ms  p90 = %7.2f ms  p99 = %7.2f ms  stddev = %7.2f ms  peak_rss = %ld kB\n", comment, stats->time_p50, stats->time_p90, stats->time_p99, stats->time_stddev, stats->peak_rss);
+    }
+
+    return time_avg;
+}
+
+// streamed inference at 1..max_threads computing threads, the packed weights are the same for every count
+void benchmark_thread_sweep(const char* comment, const ncnn::Mat& in, const ncnn::Option& opt, int max_threads)
+{
+    std::vector<double> times;
+    for (int t = 1; t <= max_threads; t++)
+    {
+        ncnn::Option opt_t = opt;
+        opt_t.num_threads = t;
+        ncnn::set_omp_num_threads(t);
+
+        fprintf(stderr, "thread sweep num_threads=%d\n", t);
+        times.push_back(benchmark(comment, in, opt_t));
+    }
+
+    fprintf(stderr, "%8s %10s %8s %10s\n", "threads", "avg (ms)", "speedup", "efficiency");
+    for (int t = 1; t <= max_threads; t++)
+    {
+        const double speedup = times[0] / times[t - 1];
+        fprintf(stderr, "%8d %10.2f %8.2f %9.1f%%\n", t, times[t - 1], speedup, speedup / t * 100);
+    }
 }
 
 void benchmark_compare(const char* comment_a, const char* comment_b, const ncnn::Mat& _in, const ncnn::Option& opt) // compare results of 2 models, used for correctness check
@@ -405,6 +565,145 @@ void benchmark_compare(const char* comment_a, const char* comment_b, const ncnn:
     }
 }
 
+// the same model under several configs back to back, planned allocators are only used by the flexnn configs
+void benchmark_configs(const char* comment, const ncnn::Mat& in, const ncnn::Option& opt, const char* configs, const char* storage, std::vector<BenchmarkStats>& stats)
+{
+    std::string list(configs);
+    if (list == "default")
+        list = "ncnn_default,flexnn_ondemand,flexnn_parallel";
+
+    size_t begin = 0;
+    while (begin < list.size())
+    {
+        size_t end = list.find(',', begin);
+        if (end == std::string::npos)
+            end = list.size();
+        const std::string config = list.substr(begin, end - begin);
+        begin = end + 1;
+        if (config.empty())
+            continue;
+
+        ncnn::Option opt_c;
+        set_benchmark_config(opt_c, config.c_str(), opt.num_threads);
+        set_benchmark_storage(opt_c, storage);
+        opt_c.time_profiler = opt.time_profiler;
+        if (config.compare(0, 7, "flexnn_") == 0)
+        {
+            opt_c.weight_allocator = opt.weight_allocator;
+            opt_c.blob_allocator = opt.blob_allocator;
+            opt_c.workspace_allocator = opt.workspace_allocator;
+            opt_c.layer_dependencies = opt.layer_dependencies;
+        }
+
+        fprintf(stderr, "compare config=%s\n", config.c_str());
+
+        BenchmarkStats st;
+        st.config = config;
+        benchmark(comment, in, opt_c, &st);
+        stats.push_back(st);
+    }
+
+    fprintf(stderr, "%20s %9s %9s %9s %9s %9s %12s %9s\n", "config", "p50", "p90", "p99", "avg", "stddev", "peak_rss_kb", "stall");
+    for (size_t i = 0; i < stats.size(); i++)
+    {
+        const BenchmarkStats& st = stats[i];
+
+        double stall = st.layer_stalls.empty() ? -1 : 0;
+        for (size_t j = 0; j < st.layer_stalls.size(); j++)
+        {
+            stall += st.layer_stalls[j];
+        }
+
+        fprintf(stderr, "%20s %9.2f %9.2f %9.2f %9.2f %9.2f %12ld %9.2f\n", st.config.c_str(), st.time_p50, st.time_p90, st.time_p99, st.time_avg, st.time_stddev, st.peak_rss, stall);
+    }
+}
+
+// json if the path ends with .json, csv otherwise, one record per config
+static void save_benchmark_stats(const char* path, const char* model_prefix, int num_threads, const char* storage, const std::vector<BenchmarkStats>& stats)
+{
+    FILE* fp = fopen(path, "w");
+    if (!fp)
+    {
+        fprintf(stderr, "fopen %s failed\n", path);
+        return;
+    }
+
+    const size_t len = strlen(path);
+    const bool json = len >= 5 && strcmp(path + len - 5, ".json") == 0;
+
+    if (json)
+    {
+        fprintf(fp, "{\"model\":\"%s\",\"num_threads\":%d,\"storage\":\"%s\",\"cpu_isa\":\"%s\",\"results\":[", model_prefix, num_threads, storage, ncnn::get_cpu_isa_signature());
+        for (size_t i = 0; i < stats.size(); i++)
+        {
+            const BenchmarkStats& st = stats[i];
+            fprintf(fp, "%s\n{\"config\":\"%s\",\"loop_count\":%d,\"load_ms\":%f,\"min_ms\":%f,\"max_ms\":%f,\"avg_ms\":%f,\"stddev_ms\":%f,\"p50_ms\":%f,\"p90_ms\":%f,\"p99_ms\":%f,\"peak_rss_kb\":%ld", i ? "," : "", st.config.c_str(), (int)st.times.size(), st.load_time, st.time_min, st.time_max, st.time_avg, st.time_stddev, st.time_p50, st.time_p90, st.time_p99, st.peak_rss);
+
+            fprintf(fp, ",\"times_ms\":[");
+            for (size_t j = 0; j < st.times.size(); j++)
+            {
+                fprintf(fp, "%s%f", j ? "," : "", st.times[j]);
+            }
+            fprintf(fp, "]");
+
+            if (!st.layer_stalls.empty())
+            {
+                double total = 0;
+                fprintf(fp, ",\"layer_stalls_ms\":[");
+                for (size_t j = 0; j < st.layer_stalls.size(); j++)
+                {
+                    fprintf(fp, "%s%f", j ? "," : "", st.layer_stalls[j]);
+                    total += st.layer_stalls[j];
+                }
+                fprintf(fp, "],\"stall_ms\":%f", total);
+            }
+
+            if (st.memory.sample_count > 0)
+            {
+                const MemorySummary& m = st.memory;
+                fprintf(fp, ",\"memory\":{\"samples\":%d,\"peak_rss_kb\":%ld,\"peak_pss_kb\":%ld,\"peak_uss_kb\":%ld,\"peak_cgroup_kb\":%ld,\"peak_footprint_kb\":%ld,\"peak_unplanned_kb\":%ld,\"over_budget_count\":%d,\"over_budget_ms\":%f,\"max_overshoot_kb\":%ld}", m.sample_count, m.peak_rss, m.peak_pss, m.peak_uss, m.peak_cgroup, m.peak_footprint, m.peak_unplanned, m.over_budget_count, m.over_budget_time, m.max_overshoot);
+            }
+
+            fprintf(fp, "}");
+        }
+        fprintf(fp, "\n]}\n");
+    }
+    else
+    {
+        fprintf(fp, "# cpu_isa=%s\n", ncnn::get_cpu_isa_signature());
+        fprintf(fp, "model,config,num_threads,storage,loop_count,load_ms,min_ms,max_ms,avg_ms,stddev_ms,p50_ms,p90_ms,p99_ms,peak_rss_kb,stall_ms,peak_uss_kb,peak_pss_kb,peak_cgroup_kb,peak_footprint_kb,peak_unplanned_kb,over_budget_count,over_budget_ms\n");
+        for (size_t i = 0; i < stats.size(); i++)
+        {
+            const BenchmarkStats& st = stats[i];
+
+            // -1 if not profiled
+            double total = st.layer_stalls.empty() ? -1 : 0;
+            for (size_t j = 0; j < st.layer_stalls.size(); j++)
+            {
+                total += st.layer_stalls[j];
+            }
+
+            const MemorySummary& m = st.memory;
+            fprintf(fp, "%s,%s,%d,%s,%d,%f,%f,%f,%f,%f,%f,%f,%f,%ld,%f,%ld,%ld,%ld,%ld,%ld,%d,%f\n", model_prefix, st.config.c_str(), num_threads, storage, (int)st.times.size(), st.load_time, st.time_min, st.time_max, st.time_avg, st.time_stddev, st.time_p50, st.time_p90, st.time_p99, st.peak_rss, total, m.peak_uss, m.peak_pss, m.peak_cgroup, m.peak_footprint, m.peak_unplanned, m.over_budget_count, m.over_budget_time);
+        }
+    }
+
+    fclose(fp);
+    fprintf(stderr, "Saving benchmark results success.\n");
+}
+
+// the time profiler keeps the last run of each layer, so the trace shows the last loop
+static void save_trace(const char* trace_path)
+{
+    std::vector<flexnn::LayerTimeProfile> time_profiles;
+    g_time_profiler.save(time_profiles);
+
+    flexnn::TraceExporter trace;
+    trace.set_time_profiles(time_profiles);
+    trace.set_layer_names(g_layer_names);
+    trace.save(trace_path);
+}
+
 int main(int argc, char** argv)
 {
     int loop_count = g_loop_count;
@@ -424,9 +723,21 @@ int main(int argc, char** argv)
     layer_dependency_path[0] = '\0';
     char time_profile_path[256];
     time_profile_path[0] = '\0';
+    char trace_path[256];
+    trace_path[0] = '\0';
+    char output_path[256];
+    output_path[0] = '\0';
+    char compare_configs[256];
+    compare_configs[0] = '\0';
+    int stall = 0;
+    char perf_counter_path[256];
+    perf_counter_path[0] = '\0';
     char vocabpath[256];
     vocabpath[0] = '\0';
+    char storage[64];
+    sprintf(storage, "fp32");
     int memory_budget = -1;
+    int thread_sweep = 0;
     int computing_powersave = -1;
     int loading_powersave = -1;
 
@@ -446,8 +757,17 @@ int main(int argc, char** argv)
         fprintf(stderr, "  malloc_plan_path=%s\n", malloc_plan_path);
         fprintf(stderr, "  layer_dependency_path=%s\n", layer_dependency_path);
         fprintf(stderr, "  time_profile_path=%s\n", time_profile_path);
+        fprintf(stderr, "  trace_path=%s (chrome trace json, not saved if empty)\n", trace_path);
+        fprintf(stderr, "  perf_counter_path=%s (per-layer perf_event counters csv, linux only, not collected if empty)\n", perf_counter_path);
         fprintf(stderr, "  memory_budget=%d\n", memory_budget);
+        fprintf(stderr, "  thread_sweep=%d (benchmark 1..N threads if > 0)\n", thread_sweep);
+        fprintf(stderr, "  compare_configs=%s (comma separated configs run back to back, default for ncnn_default,flexnn_ondemand,flexnn_parallel)\n", compare_configs);
+        fprintf(stderr, "  output_path=%s (latency statistics, json if it ends with .json, csv otherwise)\n", output_path);
+        fprintf(stderr, "  stall=%d (profile per-layer time the computing waits for loading)\n", stall);
+        fprintf(stderr, "  memory_sample_interval=%d (us, sample rss/pss/uss in the background if > 0, linux only)\n", g_memory_sample_interval);
+        fprintf(stderr, "  memory_sample_path=%s (memory samples csv, appended, not saved if empty)\n", g_memory_sample_path);
         fprintf(stderr, "  vocab_path=%s\n", vocabpath);
+        fprintf(stderr, "  storage=%s (fp32, fp16 or bf16)\n", storage);
         fprintf(stderr, "Example: %s ~/models/flexnn/vgg19.flexnn loop_count=4 warmup_loop_count=0\n", argv[0]);
         return -1;
     }
@@ -491,14 +811,32 @@ int main(int argc, char** argv)
             strcpy(layer_dependency_path, value);
         if (strcmp(key, "time_profile_path") == 0)
             strcpy(time_profile_path, value);
+        if (strcmp(key, "trace_path") == 0)
+            strcpy(trace_path, value);
+        if (strcmp(key, "perf_counter_path") == 0)
+            strcpy(perf_counter_path, value);
         if (strcmp(key, "memory_budget") == 0)
             memory_budget = atoi(value);
+        if (strcmp(key, "thread_sweep") == 0)
+            thread_sweep = atoi(value);
+        if (strcmp(key, "compare_configs") == 0)
+            strcpy(compare_configs, value);
+        if (strcmp(key, "output_path") == 0)
+            strcpy(output_path, value);
+        if (strcmp(key, "stall") == 0)
+            stall = atoi(value);
+        if (strcmp(key, "memory_sample_interval") == 0)
+            g_memory_sample_interval = atoi(value);
+        if (strcmp(key, "memory_sample_path") == 0)
+            strcpy(g_memory_sample_path, value);
         if (strcmp(key, "computing_powersave") == 0)
             computing_powersave = atoi(value);
         if (strcmp(key, "loading_powersave") == 0)
             loading_powersave = atoi(value);
         if (strcmp(key, "vocab_path") == 0)
             strcpy(vocabpath, value);
+        if (strcmp(key, "storage") == 0)
+            strcpy(storage, value);
     }
 
     // set global variables
@@ -531,20 +869,47 @@ int main(int argc, char** argv)
         fprintf(stderr, "  layer_dependency_path=%s\n", layer_dependency_path);
     if (strcmp(time_profile_path, "") != 0)
         fprintf(stderr, "  time_profile_path=%s\n", time_profile_path);
+    if (strcmp(trace_path, "") != 0)
+        fprintf(stderr, "  trace_path=%s\n", trace_path);
+    if (strcmp(perf_counter_path, "") != 0)
+        fprintf(stderr, "  perf_counter_path=%s\n", perf_counter_path);
     if (memory_budget > 0)
         fprintf(stderr, "  memory_budget=%d\n", memory_budget);
+    if (thread_sweep > 0)
+        fprintf(stderr, "  thread_sweep=%d\n", thread_sweep);
+    if (strcmp(compare_configs, "") != 0)
+        fprintf(stderr, "  compare_configs=%s\n", compare_configs);
+    if (strcmp(output_path, "") != 0)
+        fprintf(stderr, "  output_path=%s\n", output_path);
+    if (stall)
+        fprintf(stderr, "  stall=%d\n", stall);
+    if (strcmp(g_memory_sample_path, "") != 0 && g_memory_sample_interval <= 0)
+        g_memory_sample_interval = 1000;
+    if (g_memory_sample_interval > 0)
+        fprintf(stderr, "  memory_sample_interval=%d\n", g_memory_sample_interval);
+    if (strcmp(g_memory_sample_path, "") != 0)
+        fprintf(stderr, "  memory_sample_path=%s\n", g_memory_sample_path);
     if (strcmp(vocabpath, "") != 0)
         fprintf(stderr, "  vocab_path=%s\n", vocabpath);
+    fprintf(stderr, "  storage=%s\n", storage);
+    fprintf(stderr, "  cpu_isa=%s\n", ncnn::get_cpu_isa_signature());
 
     // benchmark configs
     ncnn::Option opt;
     set_benchmark_config(opt, config, num_threads);
+    set_benchmark_storage(opt, storage);
 
     // omp settings
     ncnn::set_omp_dynamic(0);
     ncnn::set_omp_num_threads(num_threads);
     ncnn::set_cpu_powersave(g_computing_powersave);
 
+    if (g_memory_sample_interval > 0)
+    {
+        g_memory_sampler.set_baseline();
+        g_memory_sampler.set_budget(memory_budget);
+    }
+
     if (strcmp(malloc_plan_path, "") != 0)
     {
         opt.weight_allocator = &g_planned_weight_allocator;
@@ -558,6 +923,7 @@ int main(int argc, char** argv)
         g_planned_allocator.add(&g_planned_intermediate_allocator);
         g_planned_allocator.init_buffer(memory_budget);
         g_planned_allocator.load_malloc_plan(malloc_plan_path);
+        g_memory_sampler.set_planned_buffer(g_planned_allocator.get_buffer(), g_planned_allocator.get_buffer_size());
     }
 
     std::vector<int> layer_dependencies;
@@ -567,10 +933,14 @@ int main(int argc, char** argv)
         opt.layer_dependencies = &layer_dependencies;
     }
 
-    if (strcmp(time_profile_path, "") != 0)
+    if (strcmp(time_profile_path, "") != 0 || strcmp(trace_path, "") != 0 || stall)
     {
         opt.time_profiler = &g_time_profiler;
     }
+    if (strcmp(perf_counter_path, "") != 0)
+    {
+        opt.time_profiler = &g_perf_counter_profiler;
+    }
 
     if (g_enable_cooling_down)
     {
@@ -596,20 +966,51 @@ int main(int argc, char** argv)
         {
             g_time_profiler.save(time_profile_path);
         }
+        if (strcmp(trace_path, "") != 0)
+        {
+            save_trace(trace_path);
+        }
+        if (strcmp(perf_counter_path, "") != 0)
+        {
+            g_perf_counter_profiler.save(perf_counter_path);
+        }
         return 0;
     }
 
     // benchmark
     ncnn::Mat in = cstr2mat(input_shape);
-    if (strcmp(cmp_model_prefix, "") == 0)
-        benchmark(model_prefix, in, opt);
+    std::vector<BenchmarkStats> stats;
+    if (thread_sweep > 0)
+        benchmark_thread_sweep(model_prefix, in, opt, thread_sweep);
+    else if (strcmp(compare_configs, "") != 0)
+        benchmark_configs(model_prefix, in, opt, compare_configs, storage, stats);
+    else if (strcmp(cmp_model_prefix, "") == 0)
+    {
+        BenchmarkStats st;
+        st.config = config;
+        benchmark(model_prefix, in, opt, &st);
+        stats.push_back(st);
+    }
     else
         benchmark_compare(model_prefix, cmp_model_prefix, in, opt);
 
+    if (strcmp(output_path, "") != 0 && !stats.empty())
+    {
+        save_benchmark_stats(output_path, model_prefix, num_threads, storage, stats);
+    }
+
     if (strcmp(time_profile_path, "") != 0)
     {
         g_time_profiler.save(time_profile_path);
     }
+    if (strcmp(trace_path, "") != 0)
+    {
+        save_trace(trace_path);
+    }
+    if (strcmp(perf_counter_path, "") != 0)
+    {
+        g_perf_counter_profiler.save(perf_counter_path);
+    }
 
     return 0;
 }
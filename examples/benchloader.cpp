@@ -0,0 +1,806 @@
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_DEPRECATE
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ncnn public header
+#include "datareader.h"
+#include "layer.h"
+#include "modelbin.h"
+#include "net.h"
+
+#include "benchmark_utils.h"
+#include "flexnn_utils.h"
+
+// replays the per-layer weight reads of a model under different loader modes
+//   stdio   fread of every read in order, as DataReaderFromStdio does
+//   mmap    memcpy of every read from a read-only mapping of the bin
+//   pread   contiguous reads of a layer merged into ranges, split in chunks over a pool of io threads
+//   direct  the same ranges with O_DIRECT into page aligned buffers, bypassing the page cache
+
+static const size_t g_pread_chunk_size = 1 << 20;
+static const size_t g_direct_alignment = 4096;
+
+class LoaderRead
+{
+public:
+    size_t offset; // in the bin file
+    size_t size;
+};
+
+class LayerReads
+{
+public:
+    int layer_index;
+    std::vector<LoaderRead> reads;
+    std::vector<LoaderRead> ranges; // reads merged where contiguous
+    size_t bytes;                   // sum of read sizes
+    size_t buffer_size;             // destination bytes with every read 64 byte aligned, as the weight allocators do
+    double pipeline_time;           // create_pipeline after load_model, the non-io part of the profiled loading
+};
+
+// DataReaderFromStdio that records the offset and size of every read
+class DataReaderFromStdioRecorder : public ncnn::DataReader
+{
+public:
+    DataReaderFromStdioRecorder(FILE* _fp)
+        : fp(_fp), reads(0)
+    {
+    }
+
+    virtual size_t read(void* buf, size_t size) const
+    {
+        long pos = ftell(fp);
+        size_t nread = fread(buf, 1, size, fp);
+        if (reads && pos >= 0 && nread > 0)
+        {
+            LoaderRead r;
+            r.offset = (size_t)pos;
+            r.size = nread;
+            reads->push_back(r);
+        }
+        return nread;
+    }
+
+    virtual int seek(size_t offset) const
+    {
+        return (fseek(fp, offset, SEEK_CUR) == 0) ? 1 : 0;
+    }
+
+    virtual int tell(int* fd, size_t* offset) const
+    {
+        long pos = ftell(fp);
+        if (pos < 0)
+            return 0;
+
+        *fd = fileno(fp);
+        *offset = (size_t)pos;
+        return 1;
+    }
+
+public:
+    FILE* fp;
+    std::vector<LoaderRead>* reads; // reads of the layer being loaded
+};
+
+static int record_read_pattern(const char* model_prefix, const ncnn::Option& opt, std::vector<LayerReads>& layers)
+{
+    ncnn::Net net;
+    net.opt = opt;
+
+    char parampath[256];
+    sprintf(parampath, "%s.param", model_prefix);
+    if (net.load_param(parampath))
+        return -1;
+
+    char binpath[256];
+    sprintf(binpath, "%s.bin", model_prefix);
+    FILE* fp = fopen(binpath, "rb");
+    if (!fp)
+    {
+        fprintf(stderr, "fopen %s failed\n", binpath);
+        return -1;
+    }
+
+    DataReaderFromStdioRecorder dr(fp);
+
+    // layers are loaded in order from one stream, as in Net::load_model and the on-demand loading
+    for (size_t i = 0; i < net.layers().size(); i++)
+    {
+        ncnn::Layer* layer = net.layers()[i];
+
+        LayerReads lr;
+        lr.layer_index = (int)i;
+        dr.reads = &lr.reads;
+
+        ncnn::ModelBinFromDataReader mb(dr);
+        if (layer->load_model(mb, opt))
+        {
+            fprintf(stderr, "layer %d %s load_model failed\n", (int)i, layer->name.c_str());
+            fclose(fp);
+            return -1;
+        }
+
+        // weight transforms run on the loading thread too, replayed reads alone miss them
+        double start = flexnn::get_current_time();
+        int ret = layer->create_pipeline(opt);
+        lr.pipeline_time = flexnn::get_current_time() - start;
+        if (ret)
+        {
+            fprintf(stderr, "layer %d %s create_pipeline failed\n", (int)i, layer->name.c_str());
+            lr.pipeline_time = 0;
+        }
+        layer->destroy_pipeline(opt);
+        layer->release_model();
+
+        if (lr.reads.empty())
+            continue;
+
+        lr.bytes = 0;
+        lr.buffer_size = 0;
+        for (size_t j = 0; j < lr.reads.size(); j++)
+        {
+            const LoaderRead& r = lr.reads[j];
+            lr.bytes += r.size;
+            lr.buffer_size += ncnn::alignSize(r.size, 64);
+
+            if (!lr.ranges.empty() && lr.ranges.back().offset + lr.ranges.back().size == r.offset)
+                lr.ranges.back().size += r.size;
+            else
+                lr.ranges.push_back(r);
+        }
+
+        layers.push_back(lr);
+    }
+
+    fclose(fp);
+
+    return 0;
+}
+
+// pool of io threads for the pread mode, the calling thread takes part too
+class PreadPool
+{
+public:
+    PreadPool(int thread_count)
+        : fd(-1), chunks(0), dsts(0), next(0), done(0), failed(false), generation(0), quit(false)
+    {
+        for (int i = 0; i < thread_count - 1; i++)
+        {
+            threads.push_back(std::thread(&PreadPool::worker, this));
+        }
+    }
+
+    ~PreadPool()
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            quit = true;
+        }
+        cond.notify_all();
+        for (size_t i = 0; i < threads.size(); i++)
+        {
+            threads[i].join();
+        }
+    }
+
+    // returns -1 if any chunk was short read
+    int run(int _fd, const std::vector<LoaderRead>& _chunks, std::vector<unsigned char*>& _dsts)
+    {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            fd = _fd;
+            chunks = &_chunks;
+            dsts = &_dsts;
+            next = 0;
+            done = 0;
+            failed = false;
+            generation++;
+        }
+        cond.notify_all();
+
+        work();
+
+        std::unique_lock<std::mutex> guard(lock);
+        while (done < chunks->size())
+        {
+            done_cond.wait(guard);
+        }
+
+        // workers still looking for chunks must not touch the caller's vectors
+        chunks = 0;
+        dsts = 0;
+
+        return failed ? -1 : 0;
+    }
+
+private:
+    void worker()
+    {
+        int seen = 0;
+        while (1)
+        {
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                while (!quit && seen == generation)
+                {
+                    cond.wait(guard);
+                }
+                if (quit)
+                    return;
+                seen = generation;
+            }
+
+            work();
+        }
+    }
+
+    void work()
+    {
+        while (1)
+        {
+            size_t i;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                if (!chunks || next >= chunks->size())
+                    return;
+                i = next++;
+            }
+
+            const LoaderRead& chunk = (*chunks)[i];
+            ssize_t nread = pread(fd, (*dsts)[i], chunk.size, (off_t)chunk.offset);
+
+            std::unique_lock<std::mutex> guard(lock);
+            if (nread != (ssize_t)chunk.size)
+                failed = true;
+            if (++done == chunks->size())
+                done_cond.notify_all();
+        }
+    }
+
+private:
+    std::vector<std::thread> threads;
+    std::mutex lock;
+    std::condition_variable cond;
+    std::condition_variable done_cond;
+
+    int fd;
+    const std::vector<LoaderRead>* chunks;
+    std::vector<unsigned char*>* dsts;
+    size_t next;
+    size_t done;
+    bool failed;
+    int generation;
+    bool quit;
+};
+
+static int replay_stdio(const char* binpath, const std::vector<LayerReads>& layers, unsigned char* buffer, std::vector<double>& layer_times)
+{
+    FILE* fp = fopen(binpath, "rb");
+    if (!fp)
+        return -1;
+
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        const LayerReads& lr = layers[i];
+
+        double start = flexnn::get_current_time();
+
+        unsigned char* dst = buffer;
+        for (size_t j = 0; j < lr.reads.size(); j++)
+        {
+            const LoaderRead& r = lr.reads[j];
+            if (ftell(fp) != (long)r.offset)
+                fseek(fp, (long)r.offset, SEEK_SET);
+            if (fread(dst, 1, r.size, fp) != r.size)
+            {
+                fclose(fp);
+                return -1;
+            }
+            dst += ncnn::alignSize(r.size, 64);
+        }
+
+        layer_times[i] = flexnn::get_current_time() - start;
+    }
+
+    fclose(fp);
+
+    return 0;
+}
+
+static int replay_mmap(const char* binpath, const std::vector<LayerReads>& layers, unsigned char* buffer, std::vector<double>& layer_times)
+{
+    int fd = open(binpath, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    void* map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -1;
+
+    // page faults land in the copies, which is what a loader on a mapping pays
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        const LayerReads& lr = layers[i];
+
+        double start = flexnn::get_current_time();
+
+        unsigned char* dst = buffer;
+        for (size_t j = 0; j < lr.reads.size(); j++)
+        {
+            const LoaderRead& r = lr.reads[j];
+            memcpy(dst, (const unsigned char*)map + r.offset, r.size);
+            dst += ncnn::alignSize(r.size, 64);
+        }
+
+        layer_times[i] = flexnn::get_current_time() - start;
+    }
+
+    munmap(map, st.st_size);
+
+    return 0;
+}
+
+static int replay_pread(const char* binpath, const std::vector<LayerReads>& layers, unsigned char* buffer, PreadPool& pool, std::vector<double>& layer_times)
+{
+    int fd = open(binpath, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    std::vector<LoaderRead> chunks;
+    std::vector<unsigned char*> dsts;
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        const LayerReads& lr = layers[i];
+
+        double start = flexnn::get_current_time();
+
+        chunks.clear();
+        dsts.clear();
+        unsigned char* dst = buffer;
+        for (size_t j = 0; j < lr.ranges.size(); j++)
+        {
+            const LoaderRead& range = lr.ranges[j];
+            for (size_t k = 0; k < range.size; k += g_pread_chunk_size)
+            {
+                LoaderRead chunk;
+                chunk.offset = range.offset + k;
+                chunk.size = std::min(g_pread_chunk_size, range.size - k);
+                chunks.push_back(chunk);
+                dsts.push_back(dst + k);
+            }
+            dst += ncnn::alignSize(range.size, 64);
+        }
+
+        if (pool.run(fd, chunks, dsts))
+        {
+            close(fd);
+            return -1;
+        }
+
+        layer_times[i] = flexnn::get_current_time() - start;
+    }
+
+    close(fd);
+
+    return 0;
+}
+
+static int replay_direct(const char* binpath, const std::vector<LayerReads>& layers, unsigned char* buffer, std::vector<double>& layer_times)
+{
+#if defined(O_DIRECT)
+    int fd = open(binpath, O_RDONLY | O_DIRECT);
+    if (fd < 0)
+        return -1;
+
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        const LayerReads& lr = layers[i];
+
+        double start = flexnn::get_current_time();
+
+        unsigned char* dst = buffer;
+        for (size_t j = 0; j < lr.ranges.size(); j++)
+        {
+            const LoaderRead& range = lr.ranges[j];
+
+            // whole aligned blocks around the range, the weights start at range.offset - begin in dst
+            const size_t begin = range.offset / g_direct_alignment * g_direct_alignment;
+            const size_t end = ncnn::alignSize(range.offset + range.size, g_direct_alignment);
+            for (size_t k = begin; k < end; k += g_pread_chunk_size)
+            {
+                const size_t size = std::min(g_pread_chunk_size, end - k);
+                ssize_t nread = pread(fd, dst + (k - begin), size, (off_t)k);
+                // the last block may end past the end of file
+                if (nread < 0 || (k + nread < range.offset + range.size && nread != (ssize_t)size))
+                {
+                    close(fd);
+                    return -1;
+                }
+            }
+            dst += end - begin;
+        }
+
+        layer_times[i] = flexnn::get_current_time() - start;
+    }
+
+    close(fd);
+
+    return 0;
+#else
+    (void)binpath;
+    (void)layers;
+    (void)buffer;
+    (void)layer_times;
+    return -1;
+#endif
+}
+
+// evict the bin from the page cache, clean pages only
+static void drop_file_cache(const char* binpath)
+{
+    int fd = open(binpath, O_RDONLY);
+    if (fd < 0)
+        return;
+
+#if defined(POSIX_FADV_DONTNEED)
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+
+    close(fd);
+}
+
+// fraction of the bin in the page cache, -1 if unknown
+static double file_resident_ratio(const char* binpath)
+{
+    int fd = open(binpath, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    void* map = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -1;
+
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    const size_t pages = (st.st_size + page_size - 1) / page_size;
+    std::vector<unsigned char> vec(pages);
+
+    double ratio = -1;
+    if (mincore(map, st.st_size, (unsigned char*)&vec[0]) == 0)
+    {
+        size_t resident = 0;
+        for (size_t i = 0; i < pages; i++)
+        {
+            resident += vec[i] & 1;
+        }
+        ratio = (double)resident / pages;
+    }
+
+    munmap(map, st.st_size);
+
+    return ratio;
+}
+
+// replace the loading durations of a time profile with the measured ones, the rest is kept
+// durations are measured i/o plus create_pipeline
+static int write_loading_durations(const char* time_profile_path, const char* output_path, const std::map<int, double>& durations)
+{
+    FILE* fp = fopen(time_profile_path, "r");
+    if (!fp)
+    {
+        fprintf(stderr, "fopen %s failed\n", time_profile_path);
+        return -1;
+    }
+
+    FILE* out = fopen(output_path, "w");
+    if (!out)
+    {
+        fprintf(stderr, "fopen %s failed\n", output_path);
+        fclose(fp);
+        return -1;
+    }
+
+    char line[1024];
+    while (fgets(line, 1024, fp))
+    {
+        int layer_index;
+        double loading_begin, loading_end, loading_duration, computing_begin, computing_end, computing_duration;
+        char isa[64];
+        isa[0] = '\0';
+        int ret = sscanf(line, "%d,%lf,%lf,%lf,%lf,%lf,%lf,%63s", &layer_index, &loading_begin, &loading_end, &loading_duration, &computing_begin, &computing_end, &computing_duration, isa);
+        if (line[0] == '#' || ret < 7)
+        {
+            // comments and the header
+            fputs(line, out);
+            continue;
+        }
+
+        std::map<int, double>::const_iterator it = durations.find(layer_index);
+        if (it != durations.end())
+        {
+            loading_duration = it->second;
+            loading_end = loading_begin + loading_duration;
+        }
+
+        fprintf(out, "%d,%f,%f,%f,%f,%f,%f,%s\n", layer_index, loading_begin, loading_end, loading_duration, computing_begin, computing_end, computing_duration, isa);
+    }
+
+    fclose(fp);
+    fclose(out);
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    int loop_count = 3;
+    int io_threads = 4;
+    char modes[64];
+    sprintf(modes, "stdio,mmap,pread,direct");
+    char cache[64];
+    sprintf(cache, "both");
+    char config[64];
+    sprintf(config, "flexnn_ondemand");
+    char time_profile_path[256];
+    time_profile_path[0] = '\0';
+    char output_time_profile_path[256];
+    output_time_profile_path[0] = '\0';
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <model_prefix> [<key=value>...]\n", argv[0]);
+        fprintf(stderr, "  model_prefix: the model path w/o .param or .bin postfix\n");
+        fprintf(stderr, "  loop_count=%d\n", loop_count);
+        fprintf(stderr, "  modes=%s\n", modes);
+        fprintf(stderr, "  cache=%s (cold, warm or both)\n", cache);
+        fprintf(stderr, "  io_threads=%d (pread mode)\n", io_threads);
+        fprintf(stderr, "  config=%s (options the layers are loaded with)\n", config);
+        fprintf(stderr, "  time_profile_path=%s (time profile to take computing durations from)\n", time_profile_path);
+        fprintf(stderr, "  output_time_profile_path=%s (time profile with measured loading durations, needs one mode and one cache)\n", output_time_profile_path);
+        fprintf(stderr, "Example: %s ~/models/flexnn/vgg19.flexnn modes=mmap cache=cold time_profile_path=vgg19.timeprof output_time_profile_path=vgg19.mmap.timeprof\n", argv[0]);
+        return -1;
+    }
+
+    const char* model_prefix = argv[1];
+
+    for (int i = 2; i < argc; i++)
+    {
+        // key=value
+        char* kv = argv[i];
+
+        char* eqs = strchr(kv, '=');
+        if (eqs == NULL)
+        {
+            fprintf(stderr, "unrecognized arg %s\n", kv);
+            continue;
+        }
+
+        // split k v
+        eqs[0] = '\0';
+        const char* key = kv;
+        char* value = eqs + 1;
+
+        if (strcmp(key, "loop_count") == 0)
+            loop_count = atoi(value);
+        if (strcmp(key, "io_threads") == 0)
+            io_threads = atoi(value);
+        if (strcmp(key, "modes") == 0)
+            strcpy(modes, value);
+        if (strcmp(key, "cache") == 0)
+            strcpy(cache, value);
+        if (strcmp(key, "config") == 0)
+            strcpy(config, value);
+        if (strcmp(key, "time_profile_path") == 0)
+            strcpy(time_profile_path, value);
+        if (strcmp(key, "output_time_profile_path") == 0)
+            strcpy(output_time_profile_path, value);
+    }
+
+    loop_count = std::max(loop_count, 1);
+    io_threads = std::max(io_threads, 1);
+
+    std::vector<std::string> mode_list;
+    {
+        std::string s(modes);
+        size_t begin = 0;
+        while (begin <= s.size())
+        {
+            size_t end = s.find(',', begin);
+            if (end == std::string::npos)
+                end = s.size();
+            if (end > begin)
+                mode_list.push_back(s.substr(begin, end - begin));
+            begin = end + 1;
+        }
+    }
+
+    std::vector<int> cold_list;
+    if (strcmp(cache, "cold") == 0 || strcmp(cache, "both") == 0)
+        cold_list.push_back(1);
+    if (strcmp(cache, "warm") == 0 || strcmp(cache, "both") == 0)
+        cold_list.push_back(0);
+
+    if (mode_list.empty() || cold_list.empty())
+    {
+        fprintf(stderr, "no mode or cache to run\n");
+        return -1;
+    }
+
+    if (strcmp(output_time_profile_path, "") != 0 && (strcmp(time_profile_path, "") == 0 || mode_list.size() != 1 || cold_list.size() != 1))
+    {
+        fprintf(stderr, "output_time_profile_path needs time_profile_path, one mode and one cache\n");
+        return -1;
+    }
+
+    // print
+    fprintf(stderr, "  model_prefix=%s\n", model_prefix);
+    fprintf(stderr, "  loop_count=%d\n", loop_count);
+    fprintf(stderr, "  modes=%s\n", modes);
+    fprintf(stderr, "  cache=%s\n", cache);
+    fprintf(stderr, "  io_threads=%d\n", io_threads);
+    fprintf(stderr, "  config=%s\n", config);
+    if (strcmp(time_profile_path, "") != 0)
+        fprintf(stderr, "  time_profile_path=%s\n", time_profile_path);
+    if (strcmp(output_time_profile_path, "") != 0)
+        fprintf(stderr, "  output_time_profile_path=%s\n", output_time_profile_path);
+
+    ncnn::Option opt;
+    set_benchmark_config(opt, config);
+
+    std::vector<LayerReads> layers;
+    if (record_read_pattern(model_prefix, opt, layers))
+        return -1;
+
+    char binpath[256];
+    sprintf(binpath, "%s.bin", model_prefix);
+
+    size_t total_bytes = 0;
+    size_t total_reads = 0;
+    size_t max_buffer_size = 0;
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        total_bytes += layers[i].bytes;
+        total_reads += layers[i].reads.size();
+        max_buffer_size = std::max(max_buffer_size, layers[i].buffer_size);
+
+        // direct reads whole blocks around every range
+        size_t direct_size = 0;
+        for (size_t j = 0; j < layers[i].ranges.size(); j++)
+        {
+            direct_size += layers[i].ranges[j].size + 2 * g_direct_alignment;
+        }
+        max_buffer_size = std::max(max_buffer_size, direct_size);
+    }
+
+    fprintf(stderr, "%d layers with weights, %d reads, %.2f MB\n", (int)layers.size(), (int)total_reads, total_bytes / 1048576.0);
+
+    // page aligned for O_DIRECT
+    unsigned char* buffer = 0;
+    if (posix_memalign((void**)&buffer, g_direct_alignment, ncnn::alignSize(max_buffer_size, g_direct_alignment)))
+    {
+        fprintf(stderr, "allocate %zu bytes failed\n", max_buffer_size);
+        return -1;
+    }
+
+    PreadPool pool(io_threads);
+
+    std::map<int, double> output_durations;
+
+    bool cold_checked = false;
+    for (size_t m = 0; m < mode_list.size(); m++)
+    {
+        const char* mode = mode_list[m].c_str();
+
+        for (size_t c = 0; c < cold_list.size(); c++)
+        {
+            const bool cold = cold_list[c] == 1;
+
+            std::vector<double> layer_times(layers.size());
+            std::vector<std::vector<double> > layer_samples(layers.size());
+            std::vector<double> all_samples;
+            std::vector<double> pass_times;
+
+            int ret = 0;
+            for (int loop = 0; loop < loop_count + (cold ? 0 : 1) && ret == 0; loop++)
+            {
+                if (cold)
+                {
+                    drop_file_cache(binpath);
+                    if (!cold_checked)
+                    {
+                        cold_checked = true;
+                        double ratio = file_resident_ratio(binpath);
+                        if (ratio > 0.01)
+                            fprintf(stderr, "warning: %.0f%% of %s still cached after dropping, cold numbers are optimistic\n", ratio * 100, binpath);
+                    }
+                }
+
+                double start = flexnn::get_current_time();
+
+                if (strcmp(mode, "stdio") == 0)
+                    ret = replay_stdio(binpath, layers, buffer, layer_times);
+                else if (strcmp(mode, "mmap") == 0)
+                    ret = replay_mmap(binpath, layers, buffer, layer_times);
+                else if (strcmp(mode, "pread") == 0)
+                    ret = replay_pread(binpath, layers, buffer, pool, layer_times);
+                else if (strcmp(mode, "direct") == 0)
+                    ret = replay_direct(binpath, layers, buffer, layer_times);
+                else
+                    ret = -2;
+
+                double end = flexnn::get_current_time();
+
+                // the first warm pass only fills the cache
+                if (ret != 0 || (!cold && loop == 0))
+                    continue;
+
+                pass_times.push_back(end - start);
+                for (size_t i = 0; i < layers.size(); i++)
+                {
+                    layer_samples[i].push_back(layer_times[i]);
+                    all_samples.push_back(layer_times[i]);
+                }
+            }
+
+            if (ret == -2)
+            {
+                fprintf(stderr, "unknown mode %s\n", mode);
+                break;
+            }
+            if (ret != 0)
+            {
+                fprintf(stderr, "%8s %5s  unavailable\n", mode, cold ? "cold" : "warm");
+                break;
+            }
+
+            const double pass_time = percentile(pass_times, 50);
+            fprintf(stderr, "%8s %5s  %9.2f MB/s  total = %8.2f ms  layer p50 = %7.3f  p90 = %7.3f  p99 = %7.3f  max = %7.3f ms\n", mode, cold ? "cold" : "warm", pass_time > 0 ? total_bytes / 1048576.0 / (pass_time / 1000) : 0, pass_time, percentile(all_samples, 50), percentile(all_samples, 90), percentile(all_samples, 99), percentile(all_samples, 100));
+
+            for (size_t i = 0; i < layers.size(); i++)
+            {
+                output_durations[layers[i].layer_index] = percentile(layer_samples[i], 50) + layers[i].pipeline_time;
+            }
+        }
+    }
+
+    free(buffer);
+
+    if (strcmp(output_time_profile_path, "") != 0)
+    {
+        if (output_durations.empty())
+            return -1;
+
+        if (write_loading_durations(time_profile_path, output_time_profile_path, output_durations))
+            return -1;
+
+        fprintf(stderr, "Saving loading durations success.\n");
+    }
+
+    return 0;
+}
@@ -7,12 +7,13 @@
 #include <vector>
 #include <numeric>
 #include <cmath>
+#include <algorithm>
 
 #ifdef _WIN32
-#include <algorithm>
 #include <windows.h> // Sleep()
 #else
-#include <unistd.h> // sleep()
+#include <sys/resource.h> // getrusage()
+#include <unistd.h>       // sleep()
 #endif
 
 #ifdef __EMSCRIPTEN__
@@ -168,6 +169,26 @@ inline void set_benchmark_config(ncnn::Option& opt, const char* config, int num_
     }
 }
 
+// blob storage type, must be the same for profiling and planned runs
+inline void set_benchmark_storage(ncnn::Option& opt, const char* storage)
+{
+    opt.use_fp16_storage = false;
+    opt.use_bf16_storage = false;
+
+    if (strcmp(storage, "fp16") == 0)
+    {
+        opt.use_fp16_storage = true;
+    }
+    else if (strcmp(storage, "bf16") == 0)
+    {
+        opt.use_bf16_storage = true;
+    }
+    else if (strcmp(storage, "fp32") != 0)
+    {
+        fprintf(stderr, "unknown storage %s, fallback to fp32\n", storage);
+    }
+}
+
 inline void load_layer_dependency(const char* path, std::vector<int>& layer_dependency)
 {
     FILE* fp = fopen(path, "r");
@@ -190,6 +211,61 @@ inline void load_layer_dependency(const char* path, std::vector<int>& layer_depe
     fclose(fp);
 }
 
+inline double percentile(std::vector<double> values, double p) // p in [0, 100], nearest rank
+{
+    if (values.empty())
+        return 0;
+
+    std::sort(values.begin(), values.end());
+    int rank = (int)std::ceil(p / 100 * values.size()) - 1;
+    return values[std::min(std::max(rank, 0), (int)values.size() - 1)];
+}
+
+// restart the peak rss from the current rss, linux 4.0+, elsewhere the peak stays process-wide
+inline void reset_peak_rss()
+{
+#if defined(__linux__)
+    FILE* fp = fopen("/proc/self/clear_refs", "w");
+    if (fp)
+    {
+        fputs("5", fp);
+        fclose(fp);
+    }
+#endif
+}
+
+inline long get_peak_rss() // kB, -1 if unknown
+{
+#if defined(__linux__)
+    FILE* fp = fopen("/proc/self/status", "r");
+    if (fp)
+    {
+        char line[256];
+        long peak = -1;
+        while (fgets(line, 256, fp))
+        {
+            if (sscanf(line, "VmHWM: %ld kB", &peak) == 1)
+                break;
+        }
+        fclose(fp);
+        if (peak >= 0)
+            return peak;
+    }
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+#if defined(__APPLE__)
+        return usage.ru_maxrss / 1024; // bytes
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+#endif
+    return -1;
+}
+
 class DataReaderFromEmpty : public ncnn::DataReader
 {
 public:
@@ -0,0 +1,385 @@
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_DEPRECATE
+#endif
+
+// per-operator cost of a streamed layer, for every kernel path it can be pretransformed to
+//   load     load_model + create_pipeline, weights read from the page cache as in on-demand loading
+//   forward  forward
+//   release  destroy_pipeline + release_model
+// the csv is the cost table flexnnslice picks the convolution kernel paths from
+
+#include <string>
+#include <vector>
+
+#include "datareader.h"
+#include "layer.h"
+#include "modelbin.h"
+#include "net.h"
+
+#include "benchmark_utils.h"
+#include "flexnn_utils.h"
+#include "flexnnslice.h"
+
+class OpCase
+{
+public:
+    const char* type;
+    int kernel;
+    int stride;
+    int inch; // embed dim for MultiHeadAttention and LayerNorm, k for Gemm
+    int outch;
+    int h; // rows / tokens for the matrix ops, 1 for a 1-d input
+    int w;
+    int num_head;
+};
+
+// representative shapes of the layers flexnn streams
+static const OpCase g_cases[] = {
+    {"Convolution", 3, 1, 16, 32, 112, 112, 0},
+    {"Convolution", 3, 1, 64, 64, 56, 56, 0},
+    {"Convolution", 3, 1, 128, 128, 28, 28, 0},
+    {"Convolution", 3, 1, 256, 256, 14, 14, 0},
+    {"Convolution", 3, 2, 64, 128, 56, 56, 0},
+    {"Convolution", 3, 2, 128, 256, 28, 28, 0},
+    {"Convolution", 1, 1, 128, 512, 28, 28, 0},
+    {"Convolution", 1, 1, 512, 128, 14, 14, 0},
+    {"Convolution", 7, 2, 3, 64, 224, 224, 0},
+    {"ConvolutionDepthWise", 3, 1, 128, 128, 56, 56, 0},
+    {"ConvolutionDepthWise", 3, 2, 256, 256, 28, 28, 0},
+    {"ConvolutionDepthWisePointWise", 3, 1, 128, 256, 28, 28, 0},
+    {"InnerProduct", 0, 0, 2048, 1000, 1, 0, 0},
+    {"InnerProduct", 0, 0, 768, 3072, 128, 0, 0},
+    {"Gemm", 0, 0, 768, 768, 128, 0, 0},
+    {"MultiHeadAttention", 0, 0, 768, 768, 128, 0, 12},
+    {"LayerNorm", 0, 0, 768, 768, 128, 0, 0},
+};
+
+static int get_pad(const OpCase& c)
+{
+    return c.kernel / 2;
+}
+
+static int get_outh(const OpCase& c)
+{
+    return c.kernel ? (c.h + 2 * get_pad(c) - c.kernel) / c.stride + 1 : c.h;
+}
+
+static int get_outw(const OpCase& c)
+{
+    return c.kernel ? (c.w + 2 * get_pad(c) - c.kernel) / c.stride + 1 : 1;
+}
+
+// the kernel paths flexnnslice can pretransform the layer to, none keeps the origin weights
+static void get_paths(const OpCase& c, std::vector<std::string>& paths)
+{
+    paths.clear();
+    paths.push_back("none");
+
+    if (strcmp(c.type, "Convolution") != 0)
+        return;
+
+    if (c.kernel == 3 && c.stride == 1 && c.inch >= 8 && c.outch >= 8)
+    {
+        if (c.inch <= 128 && c.outch <= 128)
+            paths.push_back("winograd63");
+        paths.push_back("winograd43");
+        paths.push_back("winograd23");
+    }
+    if (c.kernel == 3 && c.stride == 2)
+        paths.push_back("3x3s2");
+    paths.push_back("im2col_gemm");
+}
+
+// Input + the layer under test
+static int write_param(const OpCase& c, const char* parampath)
+{
+    FILE* fp = fopen(parampath, "w");
+    if (!fp)
+    {
+        fprintf(stderr, "fopen %s failed\n", parampath);
+        return -1;
+    }
+
+    fprintf(fp, "7767517\n2 2\n");
+
+    const int pad = get_pad(c);
+    if (strcmp(c.type, "Convolution") == 0)
+    {
+        fprintf(fp, "Input in 0 1 in 0=%d 1=%d 2=%d\n", c.w, c.h, c.inch);
+        fprintf(fp, "Convolution op 1 1 in out 0=%d 1=%d 3=%d 4=%d 5=1 6=%d\n", c.outch, c.kernel, c.stride, pad, c.outch * c.inch * c.kernel * c.kernel);
+    }
+    else if (strcmp(c.type, "ConvolutionDepthWise") == 0)
+    {
+        fprintf(fp, "Input in 0 1 in 0=%d 1=%d 2=%d\n", c.w, c.h, c.inch);
+        fprintf(fp, "ConvolutionDepthWise op 1 1 in out 0=%d 1=%d 3=%d 4=%d 5=1 6=%d 7=%d\n", c.outch, c.kernel, c.stride, pad, c.outch * c.kernel * c.kernel, c.inch);
+    }
+    else if (strcmp(c.type, "ConvolutionDepthWisePointWise") == 0)
+    {
+        fprintf(fp, "Input in 0 1 in 0=%d 1=%d 2=%d\n", c.w, c.h, c.inch);
+        fprintf(fp, "ConvolutionDepthWisePointWise op 1 1 in out 0=%d 1=%d 3=%d 4=%d 5=1 6=%d 20=%d 21=1 22=%d\n", c.inch, c.kernel, c.stride, pad, c.inch * c.kernel * c.kernel, c.outch, c.outch * c.inch);
+    }
+    else if (strcmp(c.type, "InnerProduct") == 0)
+    {
+        if (c.h == 1)
+            fprintf(fp, "Input in 0 1 in 0=%d\n", c.inch);
+        else
+            fprintf(fp, "Input in 0 1 in 0=%d 1=%d\n", c.inch, c.h);
+        fprintf(fp, "InnerProduct op 1 1 in out 0=%d 1=1 2=%d\n", c.outch, c.outch * c.inch);
+    }
+    else if (strcmp(c.type, "Gemm") == 0)
+    {
+        fprintf(fp, "Input in 0 1 in 0=%d 1=%d\n", c.inch, c.h);
+        fprintf(fp, "Gemm op 1 1 in out 5=1 8=%d 9=%d\n", c.outch, c.inch);
+    }
+    else if (strcmp(c.type, "MultiHeadAttention") == 0)
+    {
+        fprintf(fp, "Input in 0 1 in 0=%d 1=%d\n", c.inch, c.h);
+        fprintf(fp, "MultiHeadAttention op 1 1 in out 0=%d 1=%d 2=%d\n", c.inch, c.num_head, c.inch * c.inch);
+    }
+    else if (strcmp(c.type, "LayerNorm") == 0)
+    {
+        fprintf(fp, "Input in 0 1 in 0=%d 1=%d\n", c.inch, c.h);
+        fprintf(fp, "LayerNorm op 1 1 in out 0=%d 1=0.00001 2=1\n", c.inch);
+    }
+
+    fclose(fp);
+
+    return 0;
+}
+
+static ncnn::Mat make_input(const OpCase& c)
+{
+    ncnn::Mat in;
+    if (c.kernel)
+        in.create(c.w, c.h, c.inch);
+    else if (c.h == 1)
+        in.create(c.inch);
+    else
+        in.create(c.inch, c.h);
+
+    in.fill(0.01f);
+    return in;
+}
+
+// the layer model with zero weights, pretransformed to path as flexnnslice would
+static int make_model(const OpCase& c, const char* path, const char* parampath, const char* binpath)
+{
+    if (write_param(c, parampath))
+        return -1;
+
+    FlexnnSlice slicer;
+    slicer.storage_type = 0;
+    slicer.load_param_dummy(parampath);
+
+    DataReaderFromEmpty dr;
+    slicer.load_model(dr);
+
+    if (strcmp(path, "none") != 0)
+    {
+        slicer.shape_inference();
+        if (slicer.transform_kernel_convolution_path(1, path))
+            return -1;
+    }
+
+    return slicer.save(parampath, binpath);
+}
+
+class OpTiming
+{
+public:
+    double load;
+    double forward;
+    double release;
+    long weight_bytes;
+};
+
+static int benchmark_op(const OpCase& c, const char* path, const char* parampath, const char* binpath, const ncnn::Option& opt, int warmup_loop_count, int loop_count, OpTiming& cost)
+{
+    ncnn::Net net;
+    net.opt = opt;
+    if (net.load_param(parampath))
+        return -1;
+
+    ncnn::Layer* layer = net.layers()[1];
+    const ncnn::Mat in = make_input(c);
+
+    std::vector<double> load_times;
+    std::vector<double> forward_times;
+    std::vector<double> release_times;
+    for (int i = 0; i < warmup_loop_count + loop_count; i++)
+    {
+        FILE* fp = fopen(binpath, "rb");
+        if (!fp)
+        {
+            fprintf(stderr, "fopen %s failed\n", binpath);
+            return -1;
+        }
+
+        const double t0 = flexnn::get_current_time();
+
+        ncnn::DataReaderFromStdio dr(fp);
+        ncnn::ModelBinFromDataReader mb(dr);
+        int ret = layer->load_model(mb, opt);
+        if (ret == 0)
+            ret = layer->create_pipeline(opt);
+
+        const double t1 = flexnn::get_current_time();
+
+        ncnn::Mat out;
+        if (ret == 0)
+        {
+            if (layer->one_blob_only)
+            {
+                ret = layer->forward(in, out, opt);
+            }
+            else
+            {
+                std::vector<ncnn::Mat> bottoms(1, in);
+                std::vector<ncnn::Mat> tops(1);
+                ret = layer->forward(bottoms, tops, opt);
+            }
+        }
+
+        const double t2 = flexnn::get_current_time();
+
+        layer->destroy_pipeline(opt);
+        layer->release_model();
+
+        const double t3 = flexnn::get_current_time();
+
+        cost.weight_bytes = ftell(fp);
+        fclose(fp);
+
+        if (ret)
+        {
+            fprintf(stderr, "%s %s failed %d\n", c.type, path, ret);
+            return ret;
+        }
+
+        if (i < warmup_loop_count)
+            continue;
+
+        load_times.push_back(t1 - t0);
+        forward_times.push_back(t2 - t1);
+        release_times.push_back(t3 - t2);
+    }
+
+    cost.load = percentile(load_times, 50);
+    cost.forward = percentile(forward_times, 50);
+    cost.release = percentile(release_times, 50);
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    int loop_count = 8;
+    int warmup_loop_count = 2;
+    int num_threads = 1;
+    char output_path[256];
+    sprintf(output_path, "benchops.csv");
+    char types[256];
+    types[0] = '\0';
+    char tmp_prefix[256];
+    sprintf(tmp_prefix, "benchops_tmp");
+
+    for (int i = 1; i < argc; i++)
+    {
+        char* kv = argv[i];
+
+        char* eqs = strchr(kv, '=');
+        if (eqs == NULL)
+        {
+            fprintf(stderr, "Usage: %s [<key=value>...]\n", argv[0]);
+            fprintf(stderr, "  loop_count=%d\n", loop_count);
+            fprintf(stderr, "  warmup_loop_count=%d\n", warmup_loop_count);
+            fprintf(stderr, "  num_threads=%d\n", num_threads);
+            fprintf(stderr, "  output_path=%s (op cost table csv for flexnnslice)\n", output_path);
+            fprintf(stderr, "  types=%s (comma separated layer types, all if empty)\n", types);
+            fprintf(stderr, "  tmp_prefix=%s (scratch .param and .bin of the layer under test)\n", tmp_prefix);
+            return -1;
+        }
+
+        // split k v
+        eqs[0] = '\0';
+        const char* key = kv;
+        char* value = eqs + 1;
+
+        if (strcmp(key, "loop_count") == 0)
+            loop_count = atoi(value);
+        if (strcmp(key, "warmup_loop_count") == 0)
+            warmup_loop_count = atoi(value);
+        if (strcmp(key, "num_threads") == 0)
+            num_threads = atoi(value);
+        if (strcmp(key, "output_path") == 0)
+            strcpy(output_path, value);
+        if (strcmp(key, "types") == 0)
+            strcpy(types, value);
+        if (strcmp(key, "tmp_prefix") == 0)
+            strcpy(tmp_prefix, value);
+    }
+
+    fprintf(stderr, "loop_count = %d\n", loop_count);
+    fprintf(stderr, "warmup_loop_count = %d\n", warmup_loop_count);
+    fprintf(stderr, "num_threads = %d\n", num_threads);
+    fprintf(stderr, "cpu_isa = %s\n", ncnn::get_cpu_isa_signature());
+
+    ncnn::set_omp_dynamic(0);
+    ncnn::set_omp_num_threads(num_threads);
+
+    char parampath[256];
+    char binpath[256];
+    sprintf(parampath, "%s.param", tmp_prefix);
+    sprintf(binpath, "%s.bin", tmp_prefix);
+
+    FILE* fp = fopen(output_path, "w");
+    if (!fp)
+    {
+        fprintf(stderr, "fopen %s failed\n", output_path);
+        return -1;
+    }
+
+    fprintf(fp, "# cpu_isa=%s\n", ncnn::get_cpu_isa_signature());
+    fprintf(fp, "type,path,kernel,stride,dilation,inch,outch,inh,inw,outh,outw,num_threads,weight_bytes,load_ms,forward_ms,release_ms\n");
+
+    fprintf(stderr, "%30s %12s %18s %10s %10s %10s %10s\n", "type", "path", "shape", "load", "forward", "release", "total");
+
+    const std::string type_list = std::string(",") + types + ",";
+    for (size_t i = 0; i < sizeof(g_cases) / sizeof(g_cases[0]); i++)
+    {
+        const OpCase& c = g_cases[i];
+        if (types[0] != '\0' && type_list.find(std::string(",") + c.type + ",") == std::string::npos)
+            continue;
+
+        std::vector<std::string> paths;
+        get_paths(c, paths);
+        for (size_t j = 0; j < paths.size(); j++)
+        {
+            const char* path = paths[j].c_str();
+
+            // the config the sliced model runs with, origin weights included
+            ncnn::Option opt;
+            set_benchmark_config(opt, "flexnn_ondemand", num_threads);
+
+            OpTiming cost;
+            if (make_model(c, path, parampath, binpath) || benchmark_op(c, path, parampath, binpath, opt, warmup_loop_count, loop_count, cost))
+            {
+                fprintf(stderr, "%30s %12s skipped\n", c.type, path);
+                continue;
+            }
+
+            char shape[64];
+            sprintf(shape, "%dx%dx%d>%d", c.inch, c.h, c.w, c.outch);
+            fprintf(stderr, "%30s %12s %18s %10.3f %10.3f %10.3f %10.3f\n", c.type, path, shape, cost.load, cost.forward, cost.release, cost.load + cost.forward + cost.release);
+
+            fprintf(fp, "%s,%s,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%ld,%f,%f,%f\n", c.type, path, c.kernel, c.stride, 1, c.inch, c.outch, c.h, c.w, get_outh(c), get_outw(c), num_threads, cost.weight_bytes, cost.load, cost.forward, cost.release);
+        }
+    }
+
+    fclose(fp);
+
+    remove(parampath);
+    remove(binpath);
+
+    return 0;
+}
@@ -0,0 +1,769 @@
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_DEPRECATE
+#endif
+
+// end-to-end check of the flexnn pipeline on small random-weight models
+//   slice, profile and plan each model at several memory budgets
+//   extract, extract_ondemand and extract_parallel must match the unsliced ncnn output
+//   every planned allocation must come from the plan, inside the buffer, without overlapping a live one
+//   kv_cache decoding must match the prefill of the whole sequence
+// exits non-zero on any failure
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+#include <stack>
+
+// ncnn public header
+#include "datareader.h"
+#include "modelbin.h"
+#include "layer.h"
+#include "layer_type.h"
+#include "net.h"
+#include "profiler.h"
+
+// ncnn private header
+#include "modelwriter.h"
+
+// flexnn utils
+#include "flexnn_utils.h"
+#include "dummymat.h"
+
+#include "benchmark_utils.h"
+
+#include "flexnnschedule.h"
+#include "flexnnslice.h"
+
+class ModelCase
+{
+public:
+    const char* name;
+    const char* param; // ncnn param, weights are generated
+    int w;
+    int h;
+    int c; // 0 for a 2-d input
+    int conv_mem; // slicing limits in bytes, small enough to slice
+    int fc_mem;
+};
+
+static const ModelCase g_models[] = {
+    {"cnn",
+     "7767517\n8 8\n"
+     "Input in 0 1 in 0=32 1=32 2=3\n"
+     "Convolution c1 1 1 in c1 0=16 1=3 4=1 5=1 6=432 9=1\n"
+     "Convolution c2 1 1 c1 c2 0=32 1=3 3=2 4=1 5=1 6=4608 9=1\n"
+     "ConvolutionDepthWise dw 1 1 c2 dw 0=32 1=3 4=1 5=1 6=288 7=32 9=1\n"
+     "Convolution pw 1 1 dw pw 0=64 1=1 5=1 6=2048 9=1\n"
+     "Convolution c3 1 1 pw c3 0=64 1=3 4=1 5=1 6=36864\n"
+     "Pooling gap 1 1 c3 gap 0=1 4=1\n"
+     "InnerProduct fc 1 1 gap out 0=10 1=1 2=640\n",
+     32, 32, 3, 64 * 1024, 64 * 1024},
+    {"residual",
+     "7767517\n8 9\n"
+     "Input in 0 1 in 0=16 1=16 2=32\n"
+     "Convolution c0 1 1 in c0 0=64 1=3 4=1 5=1 6=18432 9=1\n"
+     "Split sp 1 2 c0 s0 s1\n"
+     "Convolution c1 1 1 s0 c1 0=64 1=3 4=1 5=1 6=36864 9=1\n"
+     "Convolution c2 1 1 c1 c2 0=64 1=3 4=1 5=1 6=36864\n"
+     "BinaryOp add 2 1 c2 s1 sum 0=0\n"
+     "ReLU relu 1 1 sum relu\n"
+     "Convolution c3 1 1 relu out 0=32 1=1 5=1 6=2048\n",
+     16, 16, 32, 64 * 1024, 64 * 1024},
+    {"transformer",
+     "7767517\n7 8\n"
+     "Input in 0 1 in 0=128 1=16\n"
+     "Split sp 1 2 in s0 s1\n"
+     "MultiHeadAttention mha 1 1 s0 mha 0=128 1=4 2=16384\n"
+     "BinaryOp add 2 1 mha s1 sum 0=0\n"
+     "LayerNorm ln 1 1 sum ln 0=128 1=0.00001 2=1\n"
+     "InnerProduct fc1 1 1 ln fc1 0=512 1=1 2=65536 9=1\n"
+     "InnerProduct fc2 1 1 fc1 out 0=128 1=1 2=65536\n",
+     128, 16, 0, 64 * 1024, 128 * 1024},
+};
+
+// self attention with kv_cache, bottoms are the new tokens and the past key / value, tops the output and the present key / value
+static const ModelCase g_kv_cache_model = {
+    "kv_cache",
+    "7767517\n4 6\n"
+    "Input in 0 1 in 0=64 1=8\n"
+    "Input past_k 0 1 past_k\n"
+    "Input past_v 0 1 past_v\n"
+    "MultiHeadAttention mha 3 3 in past_k past_v out present_k present_v 0=64 1=4 2=4096 7=1\n",
+    64, 8, 0, 0, 0};
+
+// checks the planned allocations of one run against the schedule they were planned from
+// mats in a planned slot share their refcount with the next one placed there, so the frees say nothing about liveness,
+// the k-th allocation of a type is checked against the k-th planned one of that type instead
+class PlanChecker
+{
+public:
+    void reset(const void* buffer, size_t size, const std::map<int, MemoryProfile>& memory_schedule)
+    {
+        begin = (const unsigned char*)buffer;
+        end = begin + size;
+
+        // schedule order is the malloc plan order
+        planned_sizes.clear();
+        planned_sizes.resize(3);
+        for (std::map<int, MemoryProfile>::const_iterator it = memory_schedule.begin(); it != memory_schedule.end(); it++)
+        {
+            planned_sizes[it->second.memory_type].push_back(it->second.size);
+        }
+
+        malloc_count = 0;
+        violation_count = 0;
+        clear();
+    }
+
+    // with PlannedAllocator::clear()
+    void clear()
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            counters[i] = 0;
+        }
+    }
+
+    void on_malloc(int memory_type, void* _ptr, size_t size)
+    {
+        const unsigned char* ptr = (const unsigned char*)_ptr;
+
+        char message[256];
+        message[0] = '\0';
+
+        lock.lock();
+        malloc_count++;
+        const int index = counters[memory_type]++;
+        if (!ptr || index >= (int)planned_sizes[memory_type].size())
+        {
+            sprintf(message, "allocation %d of type %d, %d bytes, is not in the plan", index, memory_type, (int)size);
+        }
+        else if (ptr < begin || ptr + size > end)
+        {
+            sprintf(message, "allocation %d of type %d at offset %ld, %d bytes, is outside the planned buffer", index, memory_type, (long)(ptr - begin), (int)size);
+        }
+        else if ((int)size > planned_sizes[memory_type][index])
+        {
+            sprintf(message, "allocation %d of type %d at offset %ld, %d bytes, overflows its planned %d bytes", index, memory_type, (long)(ptr - begin), (int)size, planned_sizes[memory_type][index]);
+        }
+
+        if (message[0] != '\0')
+        {
+            // the first few are enough to tell what went wrong
+            if (violation_count < 8)
+                fprintf(stderr, "    %s\n", message);
+            violation_count++;
+        }
+        lock.unlock();
+    }
+
+public:
+    int malloc_count;
+    int violation_count;
+
+private:
+    const unsigned char* begin;
+    const unsigned char* end;
+    std::vector<std::vector<int> > planned_sizes; // by memory type and malloc count
+    int counters[3];
+    ncnn::Mutex lock;
+};
+
+static PlanChecker g_plan_checker;
+
+class CheckedAllocatorInterface : public flexnn::PlannedAllocatorInterface
+{
+public:
+    virtual void* fastMalloc(size_t size)
+    {
+        void* ptr = flexnn::PlannedAllocatorInterface::fastMalloc(size);
+        g_plan_checker.on_malloc(memory_type, ptr, size);
+        return ptr;
+    }
+
+    void set_memory_type(int _memory_type)
+    {
+        memory_type = _memory_type;
+        set_attributes(memory_type);
+    }
+
+private:
+    int memory_type;
+};
+
+static int g_num_threads = 1;
+static int g_loop_count = 2;
+static float g_tolerance = 1e-3f;
+static char g_tmp_prefix[256];
+
+// for infer
+static flexnn::PlannedAllocator g_planned_allocator;
+static CheckedAllocatorInterface g_planned_weight_allocator;
+static CheckedAllocatorInterface g_planned_blob_allocator;
+static CheckedAllocatorInterface g_planned_intermediate_allocator;
+
+// for profiler
+static flexnn::MemoryProfiler g_memory_profiler;
+static flexnn::MemoryProfilerInterface g_weight_interface;
+static flexnn::MemoryProfilerInterface g_blob_interface;
+static flexnn::MemoryProfilerInterface g_intermediate_interface;
+static flexnn::UnlockedTimeProfiler g_unlocked_time_profiler;
+
+static int g_check_count = 0;
+static int g_failure_count = 0;
+
+static void check(bool ok, const char* model, const char* what)
+{
+    g_check_count++;
+    if (!ok)
+        g_failure_count++;
+
+    fprintf(stderr, "%-12s %-48s %s\n", model, what, ok ? "PASS" : "FAIL");
+}
+
+static ncnn::Mat make_input(const ModelCase& m)
+{
+    ncnn::Mat in;
+    if (m.c)
+        in.create(m.w, m.h, m.c);
+    else
+        in.create(m.w, m.h);
+
+    // not constant, so that a wrong layout or slice order shows up
+    for (int q = 0; q < in.c; q++)
+    {
+        float* ptr = in.channel(q);
+        for (int i = 0; i < in.w * in.h; i++)
+        {
+            ptr[i] = sinf((float)(q * in.w * in.h + i) * 0.37f) * 0.5f;
+        }
+    }
+
+    return in;
+}
+
+// max abs difference relative to the largest reference value, -1 if the shapes differ
+static float compare(const ncnn::Mat& ref, const ncnn::Mat& out)
+{
+    if (ref.dims != out.dims || ref.w != out.w || ref.h != out.h || ref.d != out.d || ref.c != out.c || out.empty())
+        return -1.f;
+
+    float max_ref = 1e-6f;
+    float max_diff = 0.f;
+    for (int q = 0; q < ref.c; q++)
+    {
+        const float* pa = ref.channel(q);
+        const float* pb = out.channel(q);
+        for (int i = 0; i < ref.w * ref.h * ref.d; i++)
+        {
+            if (pb[i] != pb[i])
+                return -1.f;
+
+            max_ref = std::max(max_ref, fabsf(pa[i]));
+            max_diff = std::max(max_diff, fabsf(pa[i] - pb[i]));
+        }
+    }
+
+    return max_diff / max_ref;
+}
+
+static int run_extract(const char* parampath, const char* binpath, const ncnn::Option& opt, const ncnn::Mat& in, ncnn::Mat& out)
+{
+    ncnn::Net net;
+    net.opt = opt;
+    if (net.load_param(parampath) || net.load_model(binpath))
+        return -1;
+
+    ncnn::Mat feat;
+    ncnn::Extractor ex = net.create_extractor();
+    ex.input(net.input_names()[0], in);
+    int ret = ex.extract(net.output_names()[0], feat);
+
+    // off the profiled allocator, every allocation of the run is freed with the net
+    out = feat.clone();
+    return ret;
+}
+
+static int make_model(const ModelCase& m, const char* parampath, const char* binpath)
+{
+    FILE* fp = fopen(parampath, "w");
+    if (!fp)
+    {
+        fprintf(stderr, "fopen %s failed\n", parampath);
+        return -1;
+    }
+    fputs(m.param, fp);
+    fclose(fp);
+
+    ModelWriter mw;
+    mw.load_param(parampath);
+    DataReaderFromEmpty dr;
+    mw.load_model(dr);
+    mw.gen_random_weight = true;
+
+    return mw.save(parampath, binpath);
+}
+
+static int run_slice(const ModelCase& m, const char* inparam, const char* inbin, const char* outparam, const char* outbin)
+{
+    FlexnnSlice slicer;
+    slicer.storage_type = 0;
+    slicer.load_param_dummy(inparam);
+    if (slicer.load_model(inbin))
+        return -1;
+
+    slicer.shape_inference();
+
+    slicer.slice_innerproduct(m.fc_mem / 4);
+    slicer.slice_multiheadattention(m.fc_mem / 4);
+    slicer.slice_convolution(m.conv_mem / 4);
+
+    slicer.topological_sort();
+    slicer.shape_inference();
+
+    slicer.transform_kernel_convolution(m.conv_mem / 4);
+
+    return slicer.save(outparam, outbin);
+}
+
+static int run_profile(const char* parampath, const char* binpath, const ncnn::Mat& in, ncnn::Mat& out, std::vector<MemoryProfilerEvent>& memory_profiles, std::vector<LayerTimeProfile>& time_profiles)
+{
+    ncnn::Option opt;
+    set_benchmark_config(opt, "flexnn_profile", g_num_threads);
+
+    g_memory_profiler.clear();
+    g_unlocked_time_profiler.clear();
+
+    opt.blob_allocator = &g_blob_interface;
+    opt.weight_allocator = &g_weight_interface;
+    opt.workspace_allocator = &g_intermediate_interface;
+    opt.time_profiler = &g_unlocked_time_profiler;
+
+    int ret = run_extract(parampath, binpath, opt, in, out);
+
+    g_memory_profiler.save(memory_profiles);
+    g_unlocked_time_profiler.save(time_profiles);
+
+    return ret;
+}
+
+// peak of the live profiled memory over the layers, a lower bound on the budget
+// the plan packs allocations at fixed offsets, so fragmentation can make budgets at or a bit above it infeasible
+static int get_peak_memory(const FlexnnSchedule& scheduler)
+{
+    std::vector<int> layer_memory;
+    for (std::map<int, MemoryProfile>::const_iterator it = scheduler.m_memory_profiles.begin(); it != scheduler.m_memory_profiles.end(); it++)
+    {
+        const MemoryProfile& profile = it->second;
+        if ((int)layer_memory.size() <= profile.end_layer_index)
+            layer_memory.resize(profile.end_layer_index + 1, 0);
+
+        for (int i = profile.start_layer_index; i <= profile.end_layer_index; i++)
+        {
+            layer_memory[i] += profile.size;
+        }
+    }
+
+    return layer_memory.empty() ? 0 : *std::max_element(layer_memory.begin(), layer_memory.end());
+}
+
+// allocations live in the same layer must not share memory, weights are live from their loading on
+static int check_plan(const char* model, int memory_budget, const std::map<int, MemoryProfile>& memory_schedule)
+{
+    std::vector<MemoryProfile> profiles;
+    for (std::map<int, MemoryProfile>::const_iterator it = memory_schedule.begin(); it != memory_schedule.end(); it++)
+    {
+        profiles.push_back(it->second);
+    }
+
+    int conflict_count = 0;
+    for (size_t i = 0; i < profiles.size(); i++)
+    {
+        const MemoryProfile& a = profiles[i];
+        if (a.y < 0 || a.y + a.size > memory_budget)
+        {
+            if (conflict_count < 8)
+                fprintf(stderr, "    type %d malloc %d at offset %d, %d bytes, is outside the budget\n", a.memory_type, a.malloc_count, a.y, a.size);
+            conflict_count++;
+        }
+
+        for (size_t j = i + 1; j < profiles.size(); j++)
+        {
+            const MemoryProfile& b = profiles[j];
+            const bool live = std::min(a.x, a.start_layer_index) <= b.end_layer_index && std::min(b.x, b.start_layer_index) <= a.end_layer_index;
+            const bool overlap = a.y < b.y + b.size && b.y < a.y + a.size;
+            if (!live || !overlap)
+                continue;
+
+            if (conflict_count < 8)
+                fprintf(stderr, "    type %d malloc %d, layers %d-%d at offset %d, overlaps type %d malloc %d, layers %d-%d at offset %d\n", a.memory_type, a.malloc_count, std::min(a.x, a.start_layer_index), a.end_layer_index, a.y, b.memory_type, b.malloc_count, std::min(b.x, b.start_layer_index), b.end_layer_index, b.y);
+            conflict_count++;
+        }
+    }
+
+    char what[128];
+    sprintf(what, "plan budget=%d %d allocations disjoint", memory_budget, (int)profiles.size());
+    check(conflict_count == 0, model, what);
+
+    return conflict_count;
+}
+
+// run the planned config loop times, each output must match the reference
+static int run_planned(const char* model, const char* config, int memory_budget, const std::map<int, MemoryProfile>& memory_schedule, const std::vector<std::vector<int> >& malloc_offsets, const std::vector<int>& persistent_offsets, std::vector<int>& layer_dependencies, const char* parampath, const char* binpath, const ncnn::Mat& in, const ncnn::Mat& ref)
+{
+    ncnn::Option opt;
+    set_benchmark_config(opt, config, g_num_threads);
+
+    opt.weight_allocator = &g_planned_weight_allocator;
+    opt.blob_allocator = &g_planned_blob_allocator;
+    opt.workspace_allocator = &g_planned_intermediate_allocator;
+    opt.layer_dependencies = &layer_dependencies;
+
+    if (g_planned_allocator.init_buffer(memory_budget))
+        return -1;
+    g_planned_allocator.set_malloc_plan(malloc_offsets, persistent_offsets);
+    g_planned_allocator.clear();
+    g_plan_checker.reset(g_planned_allocator.get_buffer(), g_planned_allocator.get_buffer_size(), memory_schedule);
+
+    ncnn::Net net;
+    net.load_param(parampath);
+
+    // persistent weights first, as flexnndemo
+    g_planned_allocator.set_load_mode(0);
+    ncnn::Option opt2 = opt;
+    opt2.use_parallel_preloading = false;
+    opt2.use_ondemand_loading = false;
+    net.opt = opt2;
+    int ret = net.load_model(binpath);
+    net.opt = opt;
+    g_planned_allocator.set_load_mode(1);
+    g_planned_allocator.clear();
+    g_plan_checker.clear();
+    if (ret == 0)
+        ret = net.load_model(binpath);
+
+    if (ret == 0 && opt.use_parallel_preloading && opt.use_local_threads)
+        net.initialize_local_threads(2, 2);
+
+    for (int i = 0; i < g_loop_count && ret == 0; i++)
+    {
+        ncnn::Mat out;
+        g_planned_allocator.clear();
+        g_plan_checker.clear();
+        {
+            ncnn::Extractor ex = net.create_extractor();
+            ex.input(net.input_names()[0], in);
+            ret = ex.extract(net.output_names()[0], out);
+        }
+
+        const float error = ret == 0 ? compare(ref, out) : -1.f;
+
+        char what[128];
+        sprintf(what, "%s budget=%d loop %d error=%.2e", config, memory_budget, i, error);
+        check(error >= 0 && error <= g_tolerance, model, what);
+
+        out.release();
+    }
+
+    if (ret == 0 && opt.use_parallel_preloading && opt.use_local_threads)
+        net.clear_local_threads();
+
+    net.clear();
+
+    char what[128];
+    sprintf(what, "%s budget=%d %d allocations in plan", config, memory_budget, g_plan_checker.malloc_count);
+    check(ret == 0 && g_plan_checker.violation_count == 0, model, what);
+
+    g_planned_allocator.release_buffer();
+
+    return ret;
+}
+
+// runs the tokens [t0, t1) of in on top of cache, which is replaced by the present key / value
+static int run_kv_cache_step(ncnn::Net& net, const ncnn::Mat& in, int t0, int t1, std::vector<ncnn::Mat>& cache, ncnn::Mat& out)
+{
+    ncnn::Extractor ex = net.create_extractor();
+
+    int ret = ex.input_kv_cache(cache);
+    if (ret == 0)
+        ret = ex.input("in", in.row_range(t0, t1 - t0).clone());
+    if (ret == 0)
+        ret = ex.extract("out", out);
+    if (ret == 0)
+        ret = ex.extract_kv_cache(cache);
+
+    out = out.clone();
+    return ret;
+}
+
+// incremental decoding must give the prefill output and cache, whether the prompt is fed at once, token by token or in chunks
+static int check_kv_cache()
+{
+    const ModelCase& m = g_kv_cache_model;
+    fprintf(stderr, "model %s\n", m.name);
+
+    char parampath[256];
+    char binpath[256];
+    sprintf(parampath, "%s_%s.param", g_tmp_prefix, m.name);
+    sprintf(binpath, "%s_%s.bin", g_tmp_prefix, m.name);
+
+    int ret = make_model(m, parampath, binpath);
+    check(ret == 0, m.name, "write model");
+    if (ret)
+        return ret;
+
+    ncnn::Option opt;
+    set_benchmark_config(opt, "ncnn_default", g_num_threads);
+
+    ncnn::Net net;
+    net.opt = opt;
+    ret = net.load_param(parampath) || net.load_model(binpath);
+    check(ret == 0, m.name, "load model");
+
+    const ncnn::Mat in = make_input(m);
+    const int seqlen = in.h;
+
+    ncnn::Mat ref;
+    std::vector<ncnn::Mat> ref_cache;
+    if (ret == 0)
+    {
+        ret = run_kv_cache_step(net, in, 0, seqlen, ref_cache, ref);
+        check(ret == 0 && ref_cache.size() == 2 && ref_cache[0].h == seqlen, m.name, "prefill");
+    }
+
+    // token by token, then a prompt of 5 followed by 3
+    const int splits[2][9] = {{0, 1, 2, 3, 4, 5, 6, 7, 8}, {0, 5, 8}};
+    const int split_counts[2] = {9, 3};
+    const char* split_names[2] = {"decode token by token", "prefill in two chunks"};
+    for (int s = 0; s < 2 && ret == 0; s++)
+    {
+        std::vector<ncnn::Mat> cache;
+        float error = 0.f;
+        for (int i = 0; i + 1 < split_counts[s] && error >= 0; i++)
+        {
+            const int t0 = splits[s][i];
+            const int t1 = splits[s][i + 1];
+
+            ncnn::Mat out;
+            if (run_kv_cache_step(net, in, t0, t1, cache, out))
+                error = -1.f;
+            else
+                error = std::max(error, compare(ref.row_range(t0, t1 - t0).clone(), out));
+        }
+        for (size_t i = 0; i < cache.size() && error >= 0 && cache.size() == ref_cache.size(); i++)
+        {
+            error = std::max(error, compare(ref_cache[i], cache[i]));
+        }
+        if (cache.size() != ref_cache.size())
+            error = -1.f;
+
+        char what[128];
+        sprintf(what, "%s error=%.2e", split_names[s], error);
+        check(error >= 0 && error <= g_tolerance, m.name, what);
+    }
+
+    net.clear();
+
+    remove(parampath);
+    remove(binpath);
+
+    return ret;
+}
+
+static int check_model(const ModelCase& m, const std::vector<float>& budget_ratios, const std::vector<std::string>& configs)
+{
+    fprintf(stderr, "model %s\n", m.name);
+
+    char ncnnparam[256];
+    char ncnnbin[256];
+    char flexnnparam[256];
+    char flexnnbin[256];
+    sprintf(ncnnparam, "%s.%s.ncnn.param", g_tmp_prefix, m.name);
+    sprintf(ncnnbin, "%s.%s.ncnn.bin", g_tmp_prefix, m.name);
+    sprintf(flexnnparam, "%s.%s.flexnn.param", g_tmp_prefix, m.name);
+    sprintf(flexnnbin, "%s.%s.flexnn.bin", g_tmp_prefix, m.name);
+
+    const ncnn::Mat in = make_input(m);
+
+    // reference, the unsliced model
+    ncnn::Option opt;
+    set_benchmark_config(opt, "ncnn_default", g_num_threads);
+
+    ncnn::Mat ref;
+    int ret = make_model(m, ncnnparam, ncnnbin);
+    if (ret == 0)
+        ret = run_extract(ncnnparam, ncnnbin, opt, in, ref);
+    check(ret == 0, m.name, "reference extract");
+    if (ret)
+        return ret;
+
+    ret = run_slice(m, ncnnparam, ncnnbin, flexnnparam, flexnnbin);
+    check(ret == 0, m.name, "slice");
+    if (ret)
+        return ret;
+
+    char what[128];
+    {
+        // pretransformed weights are only loaded with an allocator
+        ncnn::PoolAllocator weight_allocator;
+        ncnn::Option opt2 = opt;
+        opt2.weight_allocator = &weight_allocator;
+
+        ncnn::Mat out;
+        ret = run_extract(flexnnparam, flexnnbin, opt2, in, out);
+        const float error = ret == 0 ? compare(ref, out) : -1.f;
+        sprintf(what, "sliced ncnn_default error=%.2e", error);
+        check(error >= 0 && error <= g_tolerance, m.name, what);
+    }
+
+    std::vector<MemoryProfilerEvent> memory_profiles;
+    std::vector<LayerTimeProfile> time_profiles;
+    {
+        ncnn::Mat out;
+        ret = run_profile(flexnnparam, flexnnbin, in, out, memory_profiles, time_profiles);
+        const float error = ret == 0 ? compare(ref, out) : -1.f;
+        sprintf(what, "flexnn_profile error=%.2e", error);
+        check(error >= 0 && error <= g_tolerance, m.name, what);
+        if (ret)
+            return ret;
+    }
+
+    FlexnnSchedule scheduler;
+    scheduler.set_memory_profiles(memory_profiles);
+    scheduler.set_time_profiles(time_profiles);
+    const int peak_memory = get_peak_memory(scheduler);
+
+    int planned_count = 0;
+    for (size_t i = 0; i < budget_ratios.size(); i++)
+    {
+        const int memory_budget = (int)(peak_memory * budget_ratios[i]);
+        if (scheduler.schedule_naive(memory_budget))
+        {
+            // near or below the peak the plan may not exist, that is not a failure
+            fprintf(stderr, "%-12s budget=%d (%.2fx peak) is infeasible, skipped\n", m.name, memory_budget, budget_ratios[i]);
+            continue;
+        }
+        planned_count++;
+
+        std::vector<std::vector<int> > malloc_offsets;
+        std::vector<int> persistent_offsets;
+        std::vector<int> layer_dependencies;
+        scheduler.get_malloc_plan(malloc_offsets, persistent_offsets);
+        scheduler.get_layer_dependencies(layer_dependencies);
+
+        check_plan(m.name, memory_budget, scheduler.m_memory_schedule);
+
+        for (size_t j = 0; j < configs.size(); j++)
+        {
+            run_planned(m.name, configs[j].c_str(), memory_budget, scheduler.m_memory_schedule, malloc_offsets, persistent_offsets, layer_dependencies, flexnnparam, flexnnbin, in, ref);
+        }
+    }
+
+    check(planned_count > 0, m.name, "at least one budget planned");
+
+    remove(ncnnparam);
+    remove(ncnnbin);
+    remove(flexnnparam);
+    remove(flexnnbin);
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    char models[256];
+    models[0] = '\0';
+    char configs[256];
+    sprintf(configs, "flexnn_ondemand,flexnn_parallel");
+    char budgets[256];
+    sprintf(budgets, "4,2,1.5,1.2,1");
+    sprintf(g_tmp_prefix, "flexnncheck_tmp");
+
+    for (int i = 1; i < argc; i++)
+    {
+        char* kv = argv[i];
+
+        char* eqs = strchr(kv, '=');
+        if (eqs == NULL)
+        {
+            fprintf(stderr, "Usage: %s [<key=value>...]\n", argv[0]);
+            fprintf(stderr, "  models=%s (comma separated, all if empty)\n", models);
+            fprintf(stderr, "  configs=%s (planned configs besides the plain extract)\n", configs);
+            fprintf(stderr, "  budgets=%s (memory budgets, multiples of the profiled peak)\n", budgets);
+            fprintf(stderr, "  loop_count=%d\n", g_loop_count);
+            fprintf(stderr, "  num_threads=%d\n", g_num_threads);
+            fprintf(stderr, "  tolerance=%g (max abs error relative to the largest reference value)\n", g_tolerance);
+            fprintf(stderr, "  tmp_prefix=%s\n", g_tmp_prefix);
+            return -1;
+        }
+
+        // split k v
+        eqs[0] = '\0';
+        const char* key = kv;
+        char* value = eqs + 1;
+
+        if (strcmp(key, "models") == 0)
+            strcpy(models, value);
+        if (strcmp(key, "configs") == 0)
+            strcpy(configs, value);
+        if (strcmp(key, "budgets") == 0)
+            strcpy(budgets, value);
+        if (strcmp(key, "loop_count") == 0)
+            g_loop_count = atoi(value);
+        if (strcmp(key, "num_threads") == 0)
+            g_num_threads = atoi(value);
+        if (strcmp(key, "tolerance") == 0)
+            g_tolerance = atof(value);
+        if (strcmp(key, "tmp_prefix") == 0)
+            strcpy(g_tmp_prefix, value);
+    }
+
+    std::vector<std::string> config_list;
+    for (char* p = strtok(configs, ","); p; p = strtok(NULL, ","))
+    {
+        config_list.push_back(p);
+    }
+
+    std::vector<float> budget_ratios;
+    for (char* p = strtok(budgets, ","); p; p = strtok(NULL, ","))
+    {
+        budget_ratios.push_back(atof(p));
+    }
+
+    fprintf(stderr, "cpu_isa = %s\n", ncnn::get_cpu_isa_signature());
+
+    ncnn::set_omp_dynamic(0);
+    ncnn::set_omp_num_threads(g_num_threads);
+
+    g_weight_interface.set_attributes(0, 0);
+    g_blob_interface.set_attributes(0, 1);
+    g_intermediate_interface.set_attributes(0, 2);
+    g_memory_profiler.add(&g_weight_interface);
+    g_memory_profiler.add(&g_blob_interface);
+    g_memory_profiler.add(&g_intermediate_interface);
+
+    g_planned_weight_allocator.set_memory_type(0);
+    g_planned_blob_allocator.set_memory_type(1);
+    g_planned_intermediate_allocator.set_memory_type(2);
+    g_planned_allocator.add(&g_planned_weight_allocator);
+    g_planned_allocator.add(&g_planned_blob_allocator);
+    g_planned_allocator.add(&g_planned_intermediate_allocator);
+
+    const std::string model_list = std::string(",") + models + ",";
+    for (size_t i = 0; i < sizeof(g_models) / sizeof(g_models[0]); i++)
+    {
+        const ModelCase& m = g_models[i];
+        if (models[0] != '\0' && model_list.find(std::string(",") + m.name + ",") == std::string::npos)
+            continue;
+
+        check_model(m, budget_ratios, config_list);
+    }
+
+    if (models[0] == '\0' || model_list.find(std::string(",") + g_kv_cache_model.name + ",") != std::string::npos)
+        check_kv_cache();
+
+    fprintf(stderr, "%d checks, %d failed\n", g_check_count, g_failure_count);
+
+    return g_failure_count ? 1 : 0;
+}
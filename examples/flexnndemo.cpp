@@ -24,6 +24,7 @@
 #include "dummymat.h"
 
 #include "benchmark_utils.h"
+#include "memorysampler.h"
 
 #include "flexnnschedule.h"
 #include "flexnnslice.h"
@@ -74,6 +75,10 @@ static flexnn::MemoryProfilerInterface g_intermediate_interface;
 static flexnn::UnlockedTimeProfiler g_unlocked_time_profiler;
 
 static std::vector<double> starts, ends;
+
+// resident memory during inference, sampled if a path is given
+static MemorySampler g_memory_sampler;
+static const char* g_memory_sample_path = 0;
 // todo: profiles, plans, interfaces
 
 int run_slice(int conv_mem, int fc_mem)
@@ -121,6 +126,9 @@ int run_slice(int conv_mem, int fc_mem)
     // resolve shapes again
     slicer.shape_inference();
 
+    // pruned weights, before the dense kernel pre-transform
+    slicer.sparsify_weights(0.5f);
+
     // pre-transform
     slicer.transform_kernel_convolution(max_conv_size);
 
@@ -226,6 +234,12 @@ int run_infer(int memory_budget, int loop)
     ncnn::set_omp_num_threads(g_num_threads);
     ncnn::set_cpu_powersave(g_computing_powersave);
 
+    if (g_memory_sample_path)
+    {
+        g_memory_sampler.set_baseline();
+        g_memory_sampler.set_budget(memory_budget);
+    }
+
     // fprintf(stderr, "prepare allocator\n");
     opt.weight_allocator = &g_planned_weight_allocator;
     opt.blob_allocator = &g_planned_blob_allocator;
@@ -233,6 +247,13 @@ int run_infer(int memory_budget, int loop)
     g_planned_allocator.init_buffer(memory_budget);
     g_planned_allocator.set_malloc_plan(g_malloc_offsets, g_persistent_offsets);
 
+    if (g_memory_sample_path)
+    {
+        g_memory_sampler.set_planned_buffer(g_planned_allocator.get_buffer(), g_planned_allocator.get_buffer_size());
+        g_memory_sampler.start(1000);
+        g_memory_sampler.set_phase("load");
+    }
+
     opt.layer_dependencies = &g_layer_dependencies;
 
     // flexnn::print_vector<int>(*opt.layer_dependencies);
@@ -308,6 +329,9 @@ int run_infer(int memory_budget, int loop)
 
     ncnn::Mat out;
 
+    if (g_memory_sample_path)
+        g_memory_sampler.set_phase("warmup");
+
     // warm up
     for (int i = 0; i < g_warmup_loop_count; i++)
     {
@@ -317,6 +341,9 @@ int run_infer(int memory_budget, int loop)
         ex.extract(output_names[0], out);
     }
 
+    if (g_memory_sample_path)
+        g_memory_sampler.set_phase("infer");
+
     double time_min = DBL_MAX;
     double time_max = -DBL_MAX;
     double time_avg = 0;
@@ -352,6 +379,15 @@ int run_infer(int memory_budget, int loop)
         net.clear_local_threads();
     }
 
+    if (g_memory_sample_path)
+    {
+        char comment[64];
+        sprintf(comment, "budget_%d", memory_budget);
+        g_memory_sampler.stop();
+        g_memory_sampler.report(comment);
+        g_memory_sampler.save(g_memory_sample_path, comment);
+    }
+
     out.release();
     net.clear();
     g_planned_allocator.release_buffer();
@@ -368,7 +404,7 @@ int main(int argc, char** argv)
 {
     if (argc < 6)
     {
-        fprintf(stderr, "Usage: %s <ncnn_param> <ncnn_bin> <flexnn_param> <flexnn_bin> <result_path> [<idle_duration>]\n", argv[0]);
+        fprintf(stderr, "Usage: %s <ncnn_param> <ncnn_bin> <flexnn_param> <flexnn_bin> <result_path> [<idle_duration>] [<memory_sample_path>]\n", argv[0]);
         return -1;
     }
 
@@ -390,6 +426,11 @@ int main(int argc, char** argv)
         idle_duration = atoi(argv[6]);
     }
 
+    if (argc > 7)
+    {
+        g_memory_sample_path = argv[7];
+    }
+
     // init
 
     g_weight_interface.set_attributes(0, 0);
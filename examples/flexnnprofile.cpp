@@ -35,6 +35,8 @@ static flexnn::MemoryProfilerInterface g_weight_interface;
 static flexnn::MemoryProfilerInterface g_blob_interface;
 static flexnn::MemoryProfilerInterface g_intermediate_interface;
 static flexnn::UnlockedTimeProfiler g_time_profiler;
+static flexnn::PerfCounterProfiler g_perf_counter_profiler(&g_time_profiler);
+static std::vector<std::string> g_layer_names; // for the trace
 
 void profile_gpt2(const char* comment, const char* vocabpath, const ncnn::Option& opt)
 {
@@ -114,6 +116,7 @@ void profile_gpt2(const char* comment, const char* vocabpath, const ncnn::Option
 
     // infer
     std::vector<int> response;
+    std::vector<ncnn::Mat> kv_cache; // stays empty unless MultiHeadAttention has kv_cache
     int it = 0;
     for (; it < max_len; it++)
     {
@@ -129,12 +132,14 @@ void profile_gpt2(const char* comment, const char* vocabpath, const ncnn::Option
 
         double start = flexnn::get_current_time();
 
-        ncnn::Mat input_ids_mat(input_ids.size());
-        ncnn::Mat position_ids_mat(input_ids.size());
-        for (int i = 0; i < input_ids.size(); i++)
+        // with kv_cache only the tokens after the cached ones are fed
+        const int past_len = kv_cache.empty() ? 0 : kv_cache[0].h;
+        ncnn::Mat input_ids_mat(input_ids.size() - past_len);
+        ncnn::Mat position_ids_mat(input_ids.size() - past_len);
+        for (int i = past_len; i < input_ids.size(); i++)
         {
-            input_ids_mat[i] = float(input_ids[i]);
-            position_ids_mat[i] = float(i);
+            input_ids_mat[i - past_len] = float(input_ids[i]);
+            position_ids_mat[i - past_len] = float(i);
         }
 
         const std::vector<const char*>& input_names = net.input_names();
@@ -145,7 +150,9 @@ void profile_gpt2(const char* comment, const char* vocabpath, const ncnn::Option
             ncnn::Extractor ex = net.create_extractor();
             ex.input(input_names[0], input_ids_mat);
             ex.input(input_names[1], position_ids_mat);
+            ex.input_kv_cache(kv_cache);
             ex.extract(output_names[0], logits);
+            ex.extract_kv_cache(kv_cache);
             // ex.input("0", input_ids_mat);
             // ex.input("input.3", position_ids_mat);
             // ex.extract("1673", logits);
@@ -195,6 +202,12 @@ void profile(const char* comment, const ncnn::Mat& _in, const ncnn::Option& opt)
     sprintf(parampath, "%s.param", comment);
     net.load_param(parampath);
 
+    g_layer_names.clear();
+    for (size_t i = 0; i < net.layers().size(); i++)
+    {
+        g_layer_names.push_back(net.layers()[i]->name);
+    }
+
     if (g_load_model_bin)
     {
         char binpath[256];
@@ -223,6 +236,20 @@ void profile(const char* comment, const ncnn::Mat& _in, const ncnn::Option& opt)
     double time = end - start;
 }
 
+static void save_trace(const char* trace_path)
+{
+    std::vector<flexnn::LayerTimeProfile> time_profiles;
+    std::vector<flexnn::MemoryProfilerEvent> memory_events;
+    g_time_profiler.save(time_profiles);
+    g_memory_profiler.save(memory_events);
+
+    flexnn::TraceExporter trace;
+    trace.set_time_profiles(time_profiles);
+    trace.set_memory_events(memory_events);
+    trace.set_layer_names(g_layer_names);
+    trace.save(trace_path);
+}
+
 int main(int argc, char** argv)
 {
     int num_threads = 1;
@@ -231,6 +258,12 @@ int main(int argc, char** argv)
     sprintf(input_shape, "[1,3,224,224]");
     char vocabpath[256];
     vocabpath[0] = '\0';
+    char storage[64];
+    sprintf(storage, "fp32");
+    char trace_path[256];
+    trace_path[0] = '\0';
+    char perf_counter_path[256];
+    perf_counter_path[0] = '\0';
 
     if (argc < 2)
     {
@@ -241,6 +274,9 @@ int main(int argc, char** argv)
         fprintf(stderr, "  num_threads=%d\n", num_threads);
         fprintf(stderr, "  inputshape=%s\n", input_shape);
         fprintf(stderr, "  vocab_path=%s\n", vocabpath);
+        fprintf(stderr, "  storage=%s (fp32, fp16 or bf16)\n", storage);
+        fprintf(stderr, "  trace_path=%s (chrome trace json, not saved if empty)\n", trace_path);
+        fprintf(stderr, "  perf_counter_path=%s (per-layer perf_event counters csv, linux only, not collected if empty)\n", perf_counter_path);
         fprintf(stderr, "Example: %s ~/models/flexnn/vgg19.flexnn loop_count=4 warmup_loop_count=0\n", argv[0]);
         return -1;
     }
@@ -281,6 +317,12 @@ int main(int argc, char** argv)
             strcpy(time_profile_path, value);
         if (strcmp(key, "vocab_path") == 0)
             strcpy(vocabpath, value);
+        if (strcmp(key, "storage") == 0)
+            strcpy(storage, value);
+        if (strcmp(key, "trace_path") == 0)
+            strcpy(trace_path, value);
+        if (strcmp(key, "perf_counter_path") == 0)
+            strcpy(perf_counter_path, value);
     }
 
     // g_blob_pool_allocator.set_size_compare_ratio(0.f);
@@ -302,15 +344,24 @@ int main(int argc, char** argv)
     fprintf(stderr, "  inputshape=%s\n", input_shape);
     if (strcmp(vocabpath, "") != 0)
         fprintf(stderr, "  vocab_path=%s\n", vocabpath);
+    fprintf(stderr, "  storage=%s\n", storage);
+    if (strcmp(trace_path, "") != 0)
+        fprintf(stderr, "  trace_path=%s\n", trace_path);
+    if (strcmp(perf_counter_path, "") != 0)
+        fprintf(stderr, "  perf_counter_path=%s\n", perf_counter_path);
+    fprintf(stderr, "  cpu_isa=%s\n", ncnn::get_cpu_isa_signature());
 
     // benchmark configs
     ncnn::Option opt;
     set_benchmark_config(opt, "flexnn_profile", num_threads);
+    set_benchmark_storage(opt, storage);
 
     opt.blob_allocator = &g_blob_interface;
     opt.weight_allocator = &g_weight_interface;
     opt.workspace_allocator = &g_intermediate_interface;
     opt.time_profiler = &g_time_profiler;
+    if (strcmp(perf_counter_path, "") != 0)
+        opt.time_profiler = &g_perf_counter_profiler;
 
     // omp settings
     ncnn::set_omp_dynamic(0);
@@ -323,6 +374,10 @@ int main(int argc, char** argv)
         profile_gpt2(model_prefix, vocabpath, opt);
         g_memory_profiler.save(memory_profile_path);
         g_time_profiler.save(time_profile_path);
+        if (strcmp(trace_path, "") != 0)
+            save_trace(trace_path);
+        if (strcmp(perf_counter_path, "") != 0)
+            g_perf_counter_profiler.save(perf_counter_path);
 
         double end = flexnn::get_current_time();
         double time = end - start;
@@ -336,6 +391,10 @@ int main(int argc, char** argv)
 
     g_memory_profiler.save(memory_profile_path);
     g_time_profiler.save(time_profile_path);
+    if (strcmp(trace_path, "") != 0)
+        save_trace(trace_path);
+    if (strcmp(perf_counter_path, "") != 0)
+        g_perf_counter_profiler.save(perf_counter_path);
 
     double end = flexnn::get_current_time();
     double time = end - start;
@@ -1,10 +1,45 @@
 #include "flexnnschedule.h"
 
+// compare a run with the plan's predicted timeline
+static int report(int argc, char** argv)
+{
+    if (argc < 6)
+    {
+        fprintf(stderr, "Usage: %s report <time_profile_path> <layer_dependency_path> <measured_time_profile_path> <report_path> [<skip count>]\n", argv[0]);
+        return -1;
+    }
+
+    FlexnnSchedule scheduler;
+
+    if (argc >= 7)
+    {
+        scheduler.m_skip_layer_count = atoi(argv[6]);
+    }
+
+    std::vector<LayerTimeProfile> measured_profiles;
+    std::string measured_cpu_isa;
+    if (scheduler.read_time_profile(argv[2]) || scheduler.read_layer_dependencies(argv[3]) || read_time_profile_file(argv[4], measured_profiles, measured_cpu_isa))
+        return -1;
+
+    if (!scheduler.m_cpu_isa.empty() && !measured_cpu_isa.empty() && scheduler.m_cpu_isa != measured_cpu_isa)
+    {
+        fprintf(stderr, "profiled on cpu_isa=%s but measured on cpu_isa=%s, refresh all profiles\n", scheduler.m_cpu_isa.c_str(), measured_cpu_isa.c_str());
+    }
+
+    return scheduler.write_divergence_report(measured_profiles, argv[5]);
+}
+
 int main(int argc, char** argv)
 {
+    if (argc >= 2 && strcmp(argv[1], "report") == 0)
+    {
+        return report(argc, argv);
+    }
+
     if (argc < 6)
     {
-        fprintf(stderr, "Usage: %s <memory_profile_path> <time_profile_path> <malloc_plan_path> <layer_dependency_path> <memory_budget> [<skip count> <memory_layout_path>]\n", argv[0]);
+        fprintf(stderr, "Usage: %s <memory_profile_path> <time_profile_path> <malloc_plan_path> <layer_dependency_path> <memory_budget> [<skip count> <memory_layout_path> <trace_path> <html_path>]\n", argv[0]);
+        fprintf(stderr, "       %s report <time_profile_path> <layer_dependency_path> <measured_time_profile_path> <report_path> [<skip count>]\n", argv[0]);
         return -1;
     }
 
@@ -45,6 +80,16 @@ int main(int argc, char** argv)
     }
     scheduler.print_predicted_latency();
 
+    if (argc >= 9)
+    {
+        scheduler.write_trace(argv[8]);
+    }
+
+    if (argc >= 10)
+    {
+        scheduler.write_html(argv[9]);
+    }
+
     double end = flexnn::get_current_time();
     fprintf(stderr, "total scheduling time: %.2f ms\n", end - start);
 
@@ -4,6 +4,7 @@
 #include "stdio.h"
 #include "unistd.h"
 #include "string.h"
+#include "float.h"
 #include "profiler.h"
 
 #include <vector>
@@ -19,6 +20,7 @@
 #include <iterator>
 
 #include "allocator.h"
+#include "cpu.h"
 #include "xyplane.h"
 
 class MemoryProfile
@@ -85,6 +87,7 @@ public:
     FlexnnSchedule()
     {
         m_xy_plane = 0;
+        m_cpu_isa = ncnn::get_cpu_isa_signature();
     }
     ~FlexnnSchedule()
     {
@@ -102,6 +105,7 @@ public:
     int read_profiles(const char* memory_profile_path, const char* time_profile_path);
     int read_memory_profile(const char* path);
     int read_time_profile(const char* path);
+    int read_layer_dependencies(const char* path);
     int memory_events_to_profiles();
 
     // schedule functions: inputs -> memory_schedule
@@ -110,9 +114,12 @@ public:
     // memory_schedule -> layer_dependency
     int resolve_layer_dependencies(const std::map<int, MemoryProfile>& memory_schedule, std::vector<int>& layer_dependencies);
 
-    // predictor: layer_denpendencies -> latency
+    // predictor: layer_denpendencies -> latency, per layer timeline in m_loading_begin etc.
     double predict_latency(const std::vector<int>& layer_dependencies);
 
+    // measured run vs predicted timeline: per layer csv, stalls, blocked loading and profiles to refresh
+    int write_divergence_report(const std::vector<LayerTimeProfile>& measured_profiles, const char* path);
+
     // memory_schedule -> malloc_plan
     int generate_malloc_plan(const std::map<int, MemoryProfile>& memory_schedule, std::vector<std::vector<int> >& malloc_plan);
 
@@ -120,6 +127,8 @@ public:
     int write_malloc_plan(const char* path) const;
     int write_layer_dependencies(const char* path) const;
     int write_memory_layout(const char* path) const;
+    int write_trace(const char* path) const; // profiled run as chrome trace, mallocs annotated with their planned offsets
+    int write_html(const char* path); // planned memory layout and predicted timeline as a self-contained html page
 
     int generate_write_schedule(const char* malloc_plan_path, const char* layer_dependency_path, const char* memory_layout_path = 0);
     void print_predicted_latency();
@@ -163,7 +172,7 @@ public:
     // temp
     std::map<int, MemoryProfile> m_memory_schedule; // b.first=x=time, b.second=y=memory, sorted by x, for same x sorted by type and count (index)
     std::vector<int> m_persistent_offsets;
-    std::vector<double> m_loading_begin;
+    std::vector<double> m_loading_begin; // predicted, by layer index
     std::vector<double> m_loading_end;
     std::vector<double> m_computing_begin;
     std::vector<double> m_computing_end;
@@ -175,9 +184,11 @@ public:
     int m_weight_count;
     int m_blob_count;
     int m_intermediate_count;
+    std::string m_cpu_isa; // isa signature of the cpu the time profile was taken on
 
     // const
     int m_skip_layer_count = 1;
+    int m_memory_budget = 0; // of the last successful schedule
 
     XYPlane* m_xy_plane;
 };
@@ -328,7 +339,8 @@ int FlexnnSchedule::memory_events_to_profiles()
     return 0;
 }
 
-int FlexnnSchedule::read_time_profile(const char* path)
+// time profile csv, the isa signature from the header line goes to cpu_isa
+static int read_time_profile_file(const char* path, std::vector<LayerTimeProfile>& profiles, std::string& cpu_isa)
 {
     FILE* fp = fopen(path, "r");
     if (!fp)
@@ -341,9 +353,15 @@ int FlexnnSchedule::read_time_profile(const char* path)
 
     while (fgets(line, sizeof(line), fp) != NULL)
     {
+        if (strncmp(line, "# cpu_isa=", 10) == 0)
+        {
+            line[strcspn(line, "\r\n")] = '\0';
+            cpu_isa = line + 10;
+            continue;
+        }
         if (line[0] == '#') // comment
             continue;
-        if (strcmp(line, "layer_index,loading_begin,loading_end,loading_duration,computing_begin,computing_end,computing_duration\n") == 0) // first line
+        if (strncmp(line, "layer_index,", 12) == 0) // first line, with or without the isa column
             continue;
 
         flexnn::LayerTimeProfile profile;
@@ -354,9 +372,19 @@ int FlexnnSchedule::read_time_profile(const char* path)
             break;
         }
 
-        m_time_profiles.push_back(profile);
+        profiles.push_back(profile);
     }
 
+    fclose(fp);
+
+    return 0;
+}
+
+int FlexnnSchedule::read_time_profile(const char* path)
+{
+    if (read_time_profile_file(path, m_time_profiles, m_cpu_isa))
+        return -1;
+
     fprintf(stderr, "read %d time profiles\n", (int)m_time_profiles.size());
 
     // print total loading and computing
@@ -365,8 +393,32 @@ int FlexnnSchedule::read_time_profile(const char* path)
     return 0;
 }
 
+int FlexnnSchedule::read_layer_dependencies(const char* path)
+{
+    FILE* fp = fopen(path, "r");
+    if (!fp)
+    {
+        fprintf(stderr, "fopen %s failed\n", path);
+        return -1;
+    }
+
+    m_layer_dependencies.clear();
+    int dependency_index;
+    while (fscanf(fp, "%d", &dependency_index) == 1)
+    {
+        m_layer_dependencies.push_back(dependency_index);
+    }
+
+    fclose(fp);
+
+    fprintf(stderr, "read %d layer dependencies\n", (int)m_layer_dependencies.size());
+
+    return 0;
+}
+
 int FlexnnSchedule::generate_malloc_plan(const std::map<int, MemoryProfile>& memory_schedule, std::vector<std::vector<int> >& malloc_plan)
 {
+    malloc_plan.clear();
     malloc_plan.resize(3);
 
     // schedule is sorted by x, type and count
@@ -397,7 +449,7 @@ int FlexnnSchedule::resolve_layer_dependencies(const std::map<int, MemoryProfile
     auto j = memory_schedule.begin();
 
     std::vector<int> last_layer_before_loading(get_layer_count(), -1);
-    layer_dependencies.resize(get_layer_count(), get_layer_count());
+    layer_dependencies.assign(get_layer_count(), get_layer_count());
     for (int i = 0; i < m_skip_layer_count; i++)
     {
         layer_dependencies[i] = m_skip_layer_count + 1;
@@ -479,6 +531,7 @@ int FlexnnSchedule::write_malloc_plan(const char* path) const
         return -1;
     }
 
+    fprintf(fp, "# cpu_isa=%s\n", m_cpu_isa.c_str());
     fprintf(fp, "# weight_count blob_count intermediate_count (persistent_count)\n");
     fprintf(fp, "%d %d %d", m_weight_count, m_blob_count, m_intermediate_count);
     if (!m_persistent_offsets.empty())
@@ -558,6 +611,231 @@ int FlexnnSchedule::write_memory_layout(const char* path) const
     return 0;
 }
 
+int FlexnnSchedule::write_trace(const char* path) const
+{
+    flexnn::TraceExporter trace;
+    trace.set_time_profiles(m_time_profiles);
+    trace.set_memory_events(m_memory_profiler_events);
+    trace.set_malloc_plan(m_malloc_plan);
+    trace.save(path);
+
+    return 0;
+}
+
+static const char* memory_type_name(int memory_type)
+{
+    static const char* names[3] = {"weight", "blob", "intermediate"};
+    return names[memory_type % 3];
+}
+
+static const char* memory_type_color(int memory_type)
+{
+    static const char* colors[3] = {"#4e79a7", "#59a14f", "#f28e2b"};
+    return colors[memory_type % 3];
+}
+
+int FlexnnSchedule::write_html(const char* path)
+{
+    if (m_memory_schedule.empty())
+    {
+        fprintf(stderr, "no memory schedule to draw\n");
+        return -1;
+    }
+
+    const int layer_count = get_layer_count();
+    if ((int)m_layer_dependencies.size() < layer_count)
+    {
+        fprintf(stderr, "layer dependencies of %d layers, expect %d\n", (int)m_layer_dependencies.size(), layer_count);
+        return -1;
+    }
+
+    const double predicted_latency = predict_latency(m_layer_dependencies);
+
+    FILE* fp = fopen(path, "w");
+    if (!fp)
+    {
+        fprintf(stderr, "fopen %s failed\n", path);
+        return -1;
+    }
+
+    const std::set<int> persistent_offsets(m_persistent_offsets.begin(), m_persistent_offsets.end());
+    const char* persistent_color = "#b07aa1";
+
+    // live ranges of the dynamic region per layer
+    std::vector<std::vector<std::pair<int, int> > > layer_ranges(layer_count);
+    std::vector<int> layer_used(layer_count, 0);
+    int buffer_size = m_memory_budget;
+    int dynamic_size = m_memory_budget;
+    int persistent_size = 0;
+    int preload_count = 0;
+    for (auto schedule : m_memory_schedule)
+    {
+        const MemoryProfile& profile = schedule.second;
+        buffer_size = std::max(buffer_size, profile.y + profile.size);
+        if (profile.memory_type == 0 && persistent_offsets.count(profile.y))
+        {
+            persistent_size += profile.size;
+            dynamic_size = std::min(dynamic_size, profile.y);
+            continue;
+        }
+        if (profile.memory_type == 0 && profile.x < profile.start_layer_index)
+            preload_count++;
+        for (int i = std::min(profile.x, profile.start_layer_index); i <= std::min(profile.end_layer_index, layer_count - 1); i++)
+        {
+            layer_ranges[i].push_back(std::make_pair(profile.y, profile.y + profile.size));
+            layer_used[i] += profile.size;
+        }
+    }
+    if (buffer_size <= 0)
+        buffer_size = 1;
+
+    // external fragmentation, 1 - largest free gap / total free
+    std::vector<float> fragmentation(layer_count, 0.f);
+    std::vector<int> largest_free(layer_count, 0);
+    float mean_fragmentation = 0.f;
+    int max_fragmentation_index = 0;
+    for (int i = 0; i < layer_count; i++)
+    {
+        std::sort(layer_ranges[i].begin(), layer_ranges[i].end());
+        int free_size = 0;
+        int end = 0;
+        for (auto range : layer_ranges[i])
+        {
+            if (range.first > end)
+            {
+                free_size += range.first - end;
+                largest_free[i] = std::max(largest_free[i], range.first - end);
+            }
+            end = std::max(end, range.second);
+        }
+        if (dynamic_size > end)
+        {
+            free_size += dynamic_size - end;
+            largest_free[i] = std::max(largest_free[i], dynamic_size - end);
+        }
+
+        if (free_size > 0)
+            fragmentation[i] = 1.f - (float)largest_free[i] / free_size;
+        mean_fragmentation += fragmentation[i] / layer_count;
+        if (fragmentation[i] > fragmentation[max_fragmentation_index])
+            max_fragmentation_index = i;
+    }
+
+    double timeline_end = predicted_latency;
+    double total_stall = 0;
+    for (int i = m_skip_layer_count; i < layer_count; i++)
+    {
+        timeline_end = std::max(timeline_end, m_loading_end[i]);
+        total_stall += m_computing_begin[i] - (i > m_skip_layer_count ? m_computing_end[i - 1] : 0);
+    }
+    if (timeline_end <= 0)
+        timeline_end = 1;
+
+    // plot area, scaled to the page width by the viewBox
+    const float left = 80, top = 20, width = 960, height = 360, strip = 40;
+    const float cw = width / layer_count;
+    const float oh = height / buffer_size;
+
+    fprintf(fp, "<!DOCTYPE html>\n<html><head><meta charset=\"utf-8\"><title>flexnn schedule</title>\n");
+    fprintf(fp, "<style>body{font:13px sans-serif;margin:16px}svg{width:100%%;max-width:1100px}text{font:11px sans-serif}.k{display:inline-block;width:10px;height:10px;margin:0 4px 0 12px}</style></head><body>\n");
+    fprintf(fp, "<h3>memory budget %d bytes, %d layers, %d allocations, cpu_isa %s</h3>\n", m_memory_budget, layer_count, (int)m_memory_schedule.size(), m_cpu_isa.c_str());
+    fprintf(fp, "<p>persistent %d bytes in %d weights, %d weights preloaded, fragmentation mean %.1f%% max %.1f%% at layer %d</p>\n", persistent_size, (int)m_persistent_offsets.size(), preload_count, mean_fragmentation * 100, fragmentation[max_fragmentation_index] * 100, max_fragmentation_index);
+    fprintf(fp, "<p><span class=\"k\" style=\"background:%s\"></span>weight<span class=\"k\" style=\"background:%s\"></span>blob<span class=\"k\" style=\"background:%s\"></span>intermediate<span class=\"k\" style=\"background:%s\"></span>persistent weight<span class=\"k\" style=\"background:%s;opacity:.35\"></span>preload window<span class=\"k\" style=\"background:#e15759\"></span>fragmentation / stall</p>\n", memory_type_color(0), memory_type_color(1), memory_type_color(2), persistent_color, memory_type_color(0));
+
+    // memory layout, offset x layer
+    fprintf(fp, "<svg viewBox=\"0 0 %.0f %.0f\">\n", left + width + 20, top + height + strip + 50);
+    for (int i = 0; i <= 4; i++)
+    {
+        const float y = top + height - height * i / 4;
+        fprintf(fp, "<line x1=\"%.1f\" y1=\"%.1f\" x2=\"%.1f\" y2=\"%.1f\" stroke=\"#ddd\"/><text x=\"%.1f\" y=\"%.1f\" text-anchor=\"end\">%.2f MB</text>\n", left, y, left + width, y, left - 4, y + 4, (double)buffer_size * i / 4 / 1024 / 1024);
+    }
+    const int layer_step = std::max(1, layer_count / 16);
+    for (int i = 0; i < layer_count; i += layer_step)
+    {
+        fprintf(fp, "<text x=\"%.1f\" y=\"%.1f\" text-anchor=\"middle\">%d</text>\n", left + (i + 0.5f) * cw, top + height + strip + 16, i);
+    }
+    fprintf(fp, "<text x=\"%.1f\" y=\"%.1f\" text-anchor=\"middle\">layer</text>\n", left + width / 2, top + height + strip + 32);
+
+    for (auto schedule : m_memory_schedule)
+    {
+        const MemoryProfile& profile = schedule.second;
+        const float y = top + height - (profile.y + profile.size) * oh;
+        const float h = std::max(profile.size * oh, 0.5f);
+
+        if (profile.memory_type == 0 && persistent_offsets.count(profile.y))
+        {
+            fprintf(fp, "<rect x=\"%.1f\" y=\"%.1f\" width=\"%.1f\" height=\"%.1f\" fill=\"%s\" stroke=\"#fff\" stroke-width=\"0.3\"><title>persistent weight #%d layers %d-%d offset %d size %d</title></rect>\n", left, y, width, h, persistent_color, profile.malloc_count, profile.start_layer_index, profile.end_layer_index, profile.y, profile.size);
+            continue;
+        }
+
+        if (profile.x < profile.start_layer_index)
+        {
+            fprintf(fp, "<rect x=\"%.1f\" y=\"%.1f\" width=\"%.1f\" height=\"%.1f\" fill=\"%s\" fill-opacity=\"0.35\" stroke=\"%s\" stroke-dasharray=\"2,2\" stroke-width=\"0.5\"><title>weight #%d preloaded at layer %d for layer %d</title></rect>\n", left + profile.x * cw, y, (profile.start_layer_index - profile.x) * cw, h, memory_type_color(0), memory_type_color(0), profile.malloc_count, profile.x, profile.start_layer_index);
+        }
+
+        const int begin = std::max(profile.x, profile.start_layer_index);
+        const int end = std::min(profile.end_layer_index, layer_count - 1);
+        fprintf(fp, "<rect x=\"%.1f\" y=\"%.1f\" width=\"%.1f\" height=\"%.1f\" fill=\"%s\" stroke=\"#fff\" stroke-width=\"0.3\"><title>%s #%d layers %d-%d offset %d size %d</title></rect>\n", left + begin * cw, y, (end - begin + 1) * cw, h, memory_type_color(profile.memory_type), memory_type_name(profile.memory_type), profile.malloc_count, profile.start_layer_index, profile.end_layer_index, profile.y, profile.size);
+    }
+
+    const float budget_y = top + height - m_memory_budget * oh;
+    fprintf(fp, "<line x1=\"%.1f\" y1=\"%.1f\" x2=\"%.1f\" y2=\"%.1f\" stroke=\"#e15759\"/><text x=\"%.1f\" y=\"%.1f\" text-anchor=\"end\" fill=\"#e15759\">budget</text>\n", left, budget_y, left + width, budget_y, left + width, budget_y - 3);
+    if (persistent_size > 0)
+    {
+        const float dynamic_y = top + height - dynamic_size * oh;
+        fprintf(fp, "<line x1=\"%.1f\" y1=\"%.1f\" x2=\"%.1f\" y2=\"%.1f\" stroke=\"%s\" stroke-dasharray=\"4,3\"/><text x=\"%.1f\" y=\"%.1f\" text-anchor=\"end\" fill=\"%s\">persistent</text>\n", left, dynamic_y, left + width, dynamic_y, persistent_color, left + width, dynamic_y + 12, persistent_color);
+    }
+
+    // fragmentation strip under the layout
+    const float strip_y = top + height + 4;
+    for (int i = 0; i < layer_count; i++)
+    {
+        const float h = fragmentation[i] * (strip - 8);
+        fprintf(fp, "<rect x=\"%.1f\" y=\"%.1f\" width=\"%.1f\" height=\"%.1f\" fill=\"#e15759\"><title>layer %d live %d bytes, largest free %d bytes, %.1f%% fragmented</title></rect>\n", left + i * cw, strip_y + strip - 8 - h, std::max(cw - 0.5f, 0.5f), std::max(h, 0.5f), i, layer_used[i], largest_free[i], fragmentation[i] * 100);
+    }
+    fprintf(fp, "<text x=\"%.1f\" y=\"%.1f\" text-anchor=\"end\">fragmented</text>\n", left - 4, strip_y + strip / 2);
+    fprintf(fp, "</svg>\n");
+
+    // predicted timeline, one lane per thread
+    const float lane = 28;
+    const float tw = width / timeline_end;
+    fprintf(fp, "<h3>predicted latency %.3f ms, computing stalled %.3f ms</h3>\n", predicted_latency, total_stall);
+    fprintf(fp, "<svg viewBox=\"0 0 %.0f %.0f\">\n", left + width + 20, top + lane * 2 + 50);
+    for (int i = 0; i <= 4; i++)
+    {
+        const float x = left + width * i / 4;
+        fprintf(fp, "<line x1=\"%.1f\" y1=\"%.1f\" x2=\"%.1f\" y2=\"%.1f\" stroke=\"#ddd\"/><text x=\"%.1f\" y=\"%.1f\" text-anchor=\"middle\">%.1f ms</text>\n", x, top, x, top + lane * 2 + 12, x, top + lane * 2 + 26, timeline_end * i / 4);
+    }
+    fprintf(fp, "<text x=\"%.1f\" y=\"%.1f\" text-anchor=\"end\">loading</text><text x=\"%.1f\" y=\"%.1f\" text-anchor=\"end\">computing</text>\n", left - 4, top + lane / 2 + 4, left - 4, top + lane * 1.5f + 10);
+
+    for (int i = m_skip_layer_count; i < layer_count; i++)
+    {
+        const float lx = left + m_loading_begin[i] * tw;
+        const float lw = std::max((float)((m_loading_end[i] - m_loading_begin[i]) * tw), 0.5f);
+        fprintf(fp, "<rect x=\"%.2f\" y=\"%.1f\" width=\"%.2f\" height=\"%.1f\" fill=\"%s\" stroke=\"#fff\" stroke-width=\"0.3\"><title>load layer %d %.3f-%.3f ms</title></rect>\n", lx, top, lw, lane, memory_type_color(0), i, m_loading_begin[i], m_loading_end[i]);
+
+        const double previous_end = i > m_skip_layer_count ? m_computing_end[i - 1] : 0;
+        if (m_computing_begin[i] > previous_end)
+        {
+            fprintf(fp, "<rect x=\"%.2f\" y=\"%.1f\" width=\"%.2f\" height=\"%.1f\" fill=\"#e15759\" fill-opacity=\"0.6\"><title>layer %d stalled %.3f ms waiting for its weights</title></rect>\n", left + previous_end * tw, top + lane + 6, (m_computing_begin[i] - previous_end) * tw, lane, i, m_computing_begin[i] - previous_end);
+        }
+
+        const float cx = left + m_computing_begin[i] * tw;
+        const float cwidth = std::max((float)((m_computing_end[i] - m_computing_begin[i]) * tw), 0.5f);
+        fprintf(fp, "<rect x=\"%.2f\" y=\"%.1f\" width=\"%.2f\" height=\"%.1f\" fill=\"%s\" stroke=\"#fff\" stroke-width=\"0.3\"><title>compute layer %d %.3f-%.3f ms</title></rect>\n", cx, top + lane + 6, cwidth, lane, memory_type_color(1), i, m_computing_begin[i], m_computing_end[i]);
+
+        if (lw > 14)
+            fprintf(fp, "<text x=\"%.2f\" y=\"%.1f\" text-anchor=\"middle\" fill=\"#fff\">%d</text>\n", lx + lw / 2, top + lane / 2 + 4, i);
+        if (cwidth > 14)
+            fprintf(fp, "<text x=\"%.2f\" y=\"%.1f\" text-anchor=\"middle\" fill=\"#fff\">%d</text>\n", cx + cwidth / 2, top + lane * 1.5f + 10, i);
+    }
+    fprintf(fp, "</svg>\n</body></html>\n");
+
+    fclose(fp);
+
+    return 0;
+}
+
 int FlexnnSchedule::generate_write_schedule(const char* malloc_plan_path, const char* layer_dependency_path, const char* memory_layout_path)
 {
     if (!generate_malloc_plan(m_memory_schedule, m_malloc_plan))
@@ -574,39 +852,210 @@ int FlexnnSchedule::generate_write_schedule(const char* malloc_plan_path, const
 
 double FlexnnSchedule::predict_latency(const std::vector<int>& layer_dependencies)
 {
-    std::vector<double> loading_begin(get_layer_count(), .0f);
-    std::vector<double> loading_end(get_layer_count(), .0f);
-    std::vector<double> computing_begin(get_layer_count(), .0f);
-    std::vector<double> computing_end(get_layer_count(), .0f);
+    const int layer_count = get_layer_count();
+
+    // profiles by layer index, the profile file may not start at layer 0
+    std::vector<double> loading_duration(layer_count, .0f);
+    std::vector<double> computing_duration(layer_count, .0f);
+    for (auto profile : m_time_profiles)
+    {
+        loading_duration[profile.layer_index] = profile.loading_duration;
+        computing_duration[profile.layer_index] = profile.computing_duration;
+    }
+
+    std::vector<double> loading_begin(layer_count, .0f);
+    std::vector<double> loading_end(layer_count, .0f);
+    std::vector<double> computing_begin(layer_count, .0f);
+    std::vector<double> computing_end(layer_count, .0f);
 
     // layer 0: skip (Input)
 
     double tl = .0f, tc = .0f;
     loading_begin[m_skip_layer_count] = tl;
-    tl += m_time_profiles[m_skip_layer_count].loading_duration;
+    tl += loading_duration[m_skip_layer_count];
     loading_end[m_skip_layer_count] = tl;
 
-    for (int i = m_skip_layer_count; i < get_layer_count(); i++)
+    for (int i = m_skip_layer_count; i < layer_count; i++)
     {
         tc = std::max(loading_end[i], tc);
         computing_begin[i] = tc;
-        tc += m_time_profiles[i].computing_duration;
+        tc += computing_duration[i];
         computing_end[i] = tc;
 
-        // new loading tasks
+        // new loading tasks, pushed after layer i is computed
         int start_index = layer_dependencies[i - 1];
-        int end_index = layer_dependencies[i];
+        int end_index = std::min(layer_dependencies[i], layer_count);
+        if (start_index < end_index)
+            tl = std::max(tl, tc);
         for (int j = start_index; j < end_index; j++)
         {
             loading_begin[j] = tl;
-            tl += m_time_profiles[j].loading_duration;
+            tl += loading_duration[j];
             loading_end[j] = tl;
         }
     }
 
+    m_loading_begin = loading_begin;
+    m_loading_end = loading_end;
+    m_computing_begin = computing_begin;
+    m_computing_end = computing_end;
+
     return tc;
 }
 
+int FlexnnSchedule::write_divergence_report(const std::vector<LayerTimeProfile>& measured_profiles, const char* path)
+{
+    const int layer_count = get_layer_count();
+    if ((int)m_layer_dependencies.size() < layer_count)
+    {
+        fprintf(stderr, "layer dependencies of %d layers, expect %d\n", (int)m_layer_dependencies.size(), layer_count);
+        return -1;
+    }
+
+    const double predicted_latency = predict_latency(m_layer_dependencies);
+
+    std::vector<LayerTimeProfile> profiled(layer_count);
+    std::vector<LayerTimeProfile> measured(layer_count);
+    std::vector<bool> is_measured(layer_count, false);
+    for (auto profile : m_time_profiles)
+    {
+        profiled[profile.layer_index] = profile;
+    }
+    for (auto profile : measured_profiles)
+    {
+        if (profile.layer_index >= layer_count)
+            continue;
+        measured[profile.layer_index] = profile;
+        is_measured[profile.layer_index] = true;
+    }
+
+    // the measured run starts at the first loading, like the prediction
+    double t0 = DBL_MAX;
+    for (int i = m_skip_layer_count; i < layer_count; i++)
+    {
+        if (!is_measured[i])
+            continue;
+        if (measured[i].loading_begin > 0)
+            t0 = std::min(t0, measured[i].loading_begin);
+        if (measured[i].computing_begin > 0)
+            t0 = std::min(t0, measured[i].computing_begin);
+    }
+    if (t0 == DBL_MAX)
+    {
+        fprintf(stderr, "no measured layer\n");
+        return -1;
+    }
+
+    FILE* fp = fopen(path, "w");
+    if (!fp)
+    {
+        fprintf(stderr, "fopen %s failed\n", path);
+        return -1;
+    }
+
+    fprintf(fp, "layer_index,predicted_loading_begin,predicted_loading_end,predicted_computing_begin,predicted_computing_end,loading_begin,loading_end,computing_begin,computing_end,predicted_stall,stall,blocked,blocked_by,loading_duration_error,computing_duration_error,refresh\n");
+
+    // a profile is stale if the measured duration is off by more than 25% and 0.1 ms
+    const double refresh_ratio = 0.25;
+    const double refresh_min = 0.1;
+
+    double measured_latency = 0;
+    double total_predicted_stall = 0;
+    double total_stall = 0;
+    double total_blocked = 0;
+    std::vector<std::pair<double, int> > stalls;  // (stall, layer)
+    std::vector<std::pair<double, int> > blocked; // (blocked, layer)
+    std::vector<int> refresh;
+    int previous = -1; // previous measured layer
+    for (int i = m_skip_layer_count; i < layer_count; i++)
+    {
+        if (!is_measured[i])
+            continue;
+
+        const double lb = measured[i].loading_begin - t0;
+        const double le = measured[i].loading_end - t0;
+        const double cb = measured[i].computing_begin - t0;
+        const double ce = measured[i].computing_end - t0;
+        measured_latency = std::max(measured_latency, ce);
+
+        // computing waited for the layer's weights after the previous layer was done
+        double predicted_stall = 0;
+        double stall = 0;
+        if (i > m_skip_layer_count && m_loading_end[i] > m_computing_end[i - 1])
+            predicted_stall = m_computing_begin[i] - m_computing_end[i - 1];
+        if (previous >= 0 && le > measured[previous].computing_end - t0)
+            stall = std::max(std::min(le, cb) - (measured[previous].computing_end - t0), 0.0);
+
+        // loader idled before this layer until the computing that frees its memory was done
+        double block = 0;
+        int blocked_by = -1;
+        if (previous >= 0 && lb > measured[previous].loading_end - t0)
+        {
+            for (int k = m_skip_layer_count; k < layer_count; k++)
+            {
+                if (m_layer_dependencies[k - 1] > i || i >= m_layer_dependencies[k])
+                    continue;
+
+                if (is_measured[k] && measured[k].computing_end - t0 > measured[previous].loading_end - t0)
+                {
+                    block = std::min(lb, measured[k].computing_end - t0) - (measured[previous].loading_end - t0);
+                    blocked_by = k;
+                }
+                break;
+            }
+        }
+
+        const double loading_error = measured[i].loading_duration - profiled[i].loading_duration;
+        const double computing_error = measured[i].computing_duration - profiled[i].computing_duration;
+        const bool stale = (fabs(loading_error) > std::max(refresh_ratio * profiled[i].loading_duration, refresh_min))
+                           || (fabs(computing_error) > std::max(refresh_ratio * profiled[i].computing_duration, refresh_min));
+
+        fprintf(fp, "%d,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%d,%f,%f,%d\n", i, m_loading_begin[i], m_loading_end[i], m_computing_begin[i], m_computing_end[i], lb, le, cb, ce, predicted_stall, stall, block, blocked_by, loading_error, computing_error, stale ? 1 : 0);
+
+        total_predicted_stall += predicted_stall;
+        total_stall += stall;
+        total_blocked += block;
+        if (stall > 0)
+            stalls.push_back(std::make_pair(stall, i));
+        if (block > 0)
+            blocked.push_back(std::make_pair(block, i));
+        if (stale)
+            refresh.push_back(i);
+
+        previous = i;
+    }
+
+    fclose(fp);
+
+    fprintf(stderr, "latency: predicted %.3f ms, measured %.3f ms (%+.1f%%)\n", predicted_latency, measured_latency, predicted_latency > 0 ? (measured_latency / predicted_latency - 1) * 100 : 0);
+    fprintf(stderr, "computing stalled on loading: predicted %.3f ms, measured %.3f ms\n", total_predicted_stall, total_stall);
+    fprintf(stderr, "loading blocked by dependencies: %.3f ms\n", total_blocked);
+
+    const int top = 5;
+    std::sort(stalls.rbegin(), stalls.rend());
+    for (int i = 0; i < std::min((int)stalls.size(), top); i++)
+    {
+        fprintf(stderr, "  layer %d stalled %.3f ms waiting for its weights\n", stalls[i].second, stalls[i].first);
+    }
+    std::sort(blocked.rbegin(), blocked.rend());
+    for (int i = 0; i < std::min((int)blocked.size(), top); i++)
+    {
+        fprintf(stderr, "  layer %d loading blocked %.3f ms\n", blocked[i].second, blocked[i].first);
+    }
+
+    if (!refresh.empty())
+    {
+        fprintf(stderr, "refresh the profiles of %d layers:", (int)refresh.size());
+        for (size_t i = 0; i < refresh.size(); i++)
+        {
+            fprintf(stderr, " %d", refresh[i]);
+        }
+        fprintf(stderr, "\n");
+    }
+
+    return 0;
+}
+
 int FlexnnSchedule::schedule_naive(int memory_budget)
 {
     auto memory_profiles(m_memory_profiles);
@@ -786,6 +1235,7 @@ int FlexnnSchedule::schedule_naive(int memory_budget)
         // fprintf(stderr, "schedule layer %d.\n", i);
         is_success = true;
         m_xy_plane->backup();
+        auto memory_schedule_backup = memory_schedule;
         int weight_count_backup = weight_count;
         int intermediate_count_backup = intermediate_count;
         auto weight_it_backup = weight_it;
@@ -869,6 +1319,7 @@ int FlexnnSchedule::schedule_naive(int memory_budget)
             // re-schedule this layer
             fprintf(stderr, "re-schedule layer %d.\n", i);
             m_xy_plane->restore();
+            memory_schedule = memory_schedule_backup; // drop the failed preloads
             is_success = true;
             weight_count = weight_count_backup;
             intermediate_count = intermediate_count_backup;
@@ -968,6 +1419,7 @@ int FlexnnSchedule::schedule_naive(int memory_budget)
 
     // copy the schedule
     m_memory_schedule = memory_schedule;
+    m_memory_budget = memory_budget;
     // offsets are persistent weights' offsets (values)
     m_persistent_offsets.clear();
     for (auto weight : persistent_weights)
@@ -18,7 +18,7 @@ int main(int argc, char** argv)
 {
     if (argc < 6)
     {
-        fprintf(stderr, "usage: %s <inparam> <inbin> <outparam> <outbin> <flag> [<conv_sz> <fc_sz>]\n", argv[0]);
+        fprintf(stderr, "usage: %s <inparam> <inbin> <outparam> <outbin> <flag> [<conv_sz> <fc_sz> <sparse_ratio> <op_cost_path>]\n", argv[0]);
         return -1;
     }
 
@@ -34,6 +34,7 @@ int main(int argc, char** argv)
 
     int max_fc_size = 5e7;
     int max_conv_size = 5e7;
+    float min_zero_block_ratio = 0.5f;
 
     if (argc >= 7)
     {
@@ -43,6 +44,10 @@ int main(int argc, char** argv)
     {
         max_fc_size = atoi(argv[7]) / 4;
     }
+    if (argc >= 9)
+    {
+        min_zero_block_ratio = atof(argv[8]);
+    }
 
     FlexnnSlice slicer;
 
@@ -81,7 +86,14 @@ int main(int argc, char** argv)
     slicer.shape_inference();
 
     // graph modification
+    slicer.eliminate_noop();
+    slicer.fuse_convolution_batchnorm();
+    slicer.fuse_convolution_scale();
+    slicer.fuse_convolution_activation();
+    slicer.fuse_convolutiondepthwise_pointwise(max_conv_size);
+    slicer.fuse_memorydata_gather();
     slicer.slice_innerproduct(max_fc_size);
+    slicer.slice_multiheadattention(max_fc_size);
     slicer.slice_convolution(max_conv_size);
 
     // topological sort
@@ -90,7 +102,14 @@ int main(int argc, char** argv)
     // resolve shapes again
     slicer.shape_inference();
 
-    // pre-transform
+    // pruned weights, before the dense kernel pre-transform
+    slicer.sparsify_weights(min_zero_block_ratio);
+
+    // pre-transform, kernel paths from the benchops cost table if given
+    if (argc >= 10)
+    {
+        slicer.load_op_costs(argv[9]);
+    }
     slicer.transform_kernel_convolution(max_conv_size);
 
     slicer.save(outparam, outbin);
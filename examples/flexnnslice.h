@@ -10,6 +10,8 @@
 #include <vector>
 #include <stack>
 #include <queue>
+#include <string>
+#include <cmath>
 
 // ncnn public header
 #include "datareader.h"
@@ -26,6 +28,26 @@
 #include "transformutils.h"
 
 #include "layer/convolution.h"
+#include "layer/convolutiondepthwisepointwise.h"
+#include "layer/blocksparse.h"
+
+// one row of the benchops cost table, ms per phase of a streamed layer
+class OpCost
+{
+public:
+    std::string type;
+    std::string path; // kernel path, none for the origin weights
+    int kernel;
+    int stride;
+    int dilation;
+    int inch;
+    int outch;
+    int outh;
+    int outw;
+    double load;    // load_model + create_pipeline
+    double forward;
+    double release; // destroy_pipeline + release_model
+};
 
 class FlexnnSlice : public ModelWriter
 {
@@ -33,13 +55,24 @@ public:
     FlexnnSlice();
 
     // main logic
+    int fuse_memorydata_gather();
+    int fuse_convolution_batchnorm();
+    int fuse_convolution_scale();
+    int fuse_convolution_activation();
+    int fuse_convolutiondepthwise_pointwise(int max_data_size); // max_mem_size = max_data_size * element_size
+    int eliminate_noop();
     int slice_innerproduct(int max_data_size); // max_mem_size = max_data_size * element_size
     int slice_convolution(int max_data_size);  // max_mem_size = max_data_size * element_size
+    int slice_multiheadattention(int max_data_size); // max_mem_size = max_data_size * element_size
     int transform_kernel_convolution(int max_data_size);
+    int sparsify_weights(float min_zero_block_ratio); // convert pruned weights with at least this ratio of zero 1x4 blocks
     int slice_gemm();
 
     // layer operations
     int slice_innerproduct_outsz(int layer_index, int max_size); // max_size = max_outsz_per_slice
+    int slice_innerproduct_insz(int layer_index, int max_size);  // max_size = max_insz_per_slice
+
+    int slice_multiheadattention_head(int layer_index, int max_size); // max_size = max_head_per_slice
 
     int slice_convolution_outch(int layer_index, int max_size); // max_size = max_outsz_per_slice
 
@@ -59,6 +92,23 @@ public:
 
     int transform_kernel_convolution_3x3s2(int layer_index);
 
+    // dispatch by kernel path name: none, im2col_gemm, winograd63, winograd43, winograd23 or 3x3s2
+    int transform_kernel_convolution_path(int layer_index, const char* path);
+
+    // measured costs from benchops, preferred over the transform heuristics when loaded
+    int load_op_costs(const char* path);
+    int rank_convolution_paths(int layer_index, std::vector<std::string>& paths) const;
+    bool is_convolution_always_transformed(int layer_index) const;
+
+    // dense [rows][cols] weight to bitmap + nonzero 1x4 blocks, returns the block count or 0 if not sparse enough
+    int sparsify_weight(const ncnn::Mat& weight, int rows, int cols, float min_zero_block_ratio, ncnn::Mat& bitmap, ncnn::Mat& values) const;
+
+    // fusion helpers
+    template<typename T>
+    int fuse_channel_affine(T* op, const float* a, const float* b); // y = a * op(x) + b, per output channel
+    int fuse_into_producer(int layer_index, int fused_index);
+    int fuse_affine_layers(const char* type);
+
     // graph
     int topological_sort();
     int shape_inference();
@@ -66,7 +116,11 @@ public:
 public:
     int get_size_convolution(int layer_index, const char* type, int nT = 1) const;
     int get_slice_outch_convolution(int layer_index, const char* type, int max_size, int nT = 1) const;
+    int get_slice_outch_convolution_int8(int layer_index, int max_size) const;
     // int get_size_convolution_winograd63(int layer_index, int nT = 1) const;
+
+public:
+    std::vector<OpCost> op_costs;
 };
 
 int FlexnnSlice::get_slice_outch_convolution(int layer_index, const char* type, int max_size, int nT) const
@@ -139,6 +193,40 @@ int FlexnnSlice::get_slice_outch_convolution(int layer_index, const char* type,
     return -1;
 }
 
+int FlexnnSlice::get_slice_outch_convolution_int8(int layer_index, int max_size) const
+{
+    const ncnn::Layer* layer = layers[layer_index];
+    if (layer->type != "Convolution")
+    {
+        fprintf(stderr, "Error: layer %d %s is not convolution\n", layer_index, layers[layer_index]->name.c_str());
+        return -1;
+    }
+
+    const ncnn::Convolution* convolution = (const ncnn::Convolution*)layer;
+
+    const flexnn::DummyMat in = blobs[layer->bottoms[0]].dummy_shape;
+    const flexnn::DummyMat out = blobs[layer->tops[0]].dummy_shape;
+
+    const int maxk = convolution->kernel_w * convolution->kernel_h;
+    const int inch = in.c;
+    const int outch = out.c;
+
+    // sizes in bytes, the fp32 input is quantized into an int8 copy
+    // max_size * 4 = in * 5 + outch * (inch * maxk + 4 + 4) + out
+    const long long budget = (long long)max_size * 4 - (long long)in.total() * 5 - (long long)out.total() * 4;
+    if (budget <= 0)
+        return -1;
+
+    // int8 weights and per channel bias and scale
+    const long long per_ch = (long long)inch * maxk + 8;
+
+    if (per_ch * outch <= budget)
+        return outch;
+
+    // align to 4 for the packed int8 output, 0 if not even 4 channels fit
+    return (int)(budget / per_ch) / 4 * 4;
+}
+
 int FlexnnSlice::get_size_convolution(int layer_index, const char* type, int nT) const
 {
     const ncnn::Layer* layer = layers[layer_index];
@@ -516,188 +604,772 @@ int FlexnnSlice::shape_inference()
     return 0;
 }
 
-int FlexnnSlice::slice_innerproduct(int max_data_size)
+int FlexnnSlice::fuse_memorydata_gather()
 {
     const size_t layer_count = layers.size();
 
-    fprintf(stderr, "slice_innerproduct\n");
+    fprintf(stderr, "fuse_memorydata_gather\n");
 
     for (size_t i = 0; i < layer_count; i++)
     {
-        if (layers[i]->type != "InnerProduct")
+        if (layers[i]->type != "MemoryData")
             continue;
 
-        // decide slice size
-        ncnn::InnerProduct* innerproduct = (ncnn::InnerProduct*)layers[i];
-        int outsz = innerproduct->num_output;
-        int insz = innerproduct->weight_data_size / outsz;
+        // MemoryData - Gather
+        ncnn::MemoryData* memorydata = (ncnn::MemoryData*)layers[i];
+        if (memorydata->h == 0 || memorydata->c != 0 || memorydata->d != 0)
+            continue;
 
-        int max_size = (max_data_size - insz) / (1 + insz); // max_data_size = max_size * (1 + insz) + insz
+        int top_blob_index = memorydata->tops[0];
+        int j = blobs[top_blob_index].consumer;
+        if (j < 0 || layers[j]->type != "Gather")
+            continue;
 
-        int ret = slice_innerproduct_outsz(i, max_size);
-        if (ret)
+        ncnn::Layer* gather = layers[j];
+        if (gather->bottoms.size() != 2 || gather->bottoms[0] != top_blob_index)
+            continue;
+
+        //  MemoryData -> Gather
+        //  (fused)       LazyGather
+        ncnn::LazyGather* lazygather = (ncnn::LazyGather*)ncnn::create_layer("LazyGather");
+        lazygather->type = "LazyGather";
+        lazygather->name = gather->name;
+        lazygather->bottoms.resize(1, gather->bottoms[1]);
+        lazygather->tops = gather->tops;
+
+        ncnn::ParamDict pd;
+        lazygather->load_param(pd);
+        lazygather->n_embd = memorydata->w;
+        lazygather->n_rows = memorydata->h;
+        lazygather->weight_data = memorydata->data;
+
+        fprintf(stderr, "fuse_memorydata_gather %s %s\n", memorydata->name.c_str(), gather->name.c_str());
+
+        blobs[top_blob_index].producer = -1;
+        blobs[top_blob_index].consumer = -1;
+        memorydata->type = "ncnnfused";
+        memorydata->tops.clear();
+
+        layers[j] = lazygather;
+        delete gather;
+    }
+
+    return 0;
+}
+
+template<typename T>
+int FlexnnSlice::fuse_channel_affine(T* op, const float* a, const float* b)
+{
+    const int channels = op->num_output;
+    const int weight_per_outch = op->weight_data_size / channels;
+
+    float* weight = op->weight_data;
+    for (int i = 0; i < channels; i++)
+    {
+        float* conv_weight_outch = weight + weight_per_outch * i;
+        for (int j = 0; j < weight_per_outch; j++)
         {
-            fprintf(stderr, "layer %ld %s slice innerproduct failed.", i, layers[i]->name.c_str());
-            return -1;
+            conv_weight_outch[j] *= a[i];
         }
     }
+
+    if (op->bias_term == 0)
+    {
+        // init bias as zero
+        op->bias_term = 1;
+        op->bias_data = ncnn::Mat(channels);
+        op->bias_data.fill(0.f);
+    }
+
+    float* bias = op->bias_data;
+    for (int i = 0; i < channels; i++)
+    {
+        bias[i] = bias[i] * a[i] + b[i];
+    }
+
     return 0;
 }
 
-int FlexnnSlice::slice_convolution(int max_data_size)
+int FlexnnSlice::fuse_into_producer(int layer_index, int fused_index)
+{
+    ncnn::Layer* layer = layers[layer_index];
+    ncnn::Layer* fused = layers[fused_index];
+
+    //  op -> fused -> ...
+    //  op ----------> ...    (fused)
+    int top_blob_index = layer->tops[0];
+    int top_blob_index_final = fused->tops[0];
+
+    layer->tops[0] = top_blob_index_final;
+    blobs[top_blob_index_final].producer = layer_index;
+    blobs[top_blob_index].producer = -1;
+    blobs[top_blob_index].consumer = -1;
+
+    fused->type = "ncnnfused";
+    fused->bottoms.clear();
+    fused->tops.clear();
+
+    return 0;
+}
+
+int FlexnnSlice::fuse_affine_layers(const char* type)
 {
     const size_t layer_count = layers.size();
+
     for (size_t i = 0; i < layer_count; i++)
     {
-        if (layers[i]->type != "Convolution")
+        const std::string& op_type = layers[i]->type;
+        if (op_type != "Convolution" && op_type != "ConvolutionDepthWise" && op_type != "InnerProduct")
             continue;
-        // fprintf(stderr, "slice_convolution %ld %s\n", i, layers[i]->name.c_str());
-
-        // decide slice size
-        ncnn::Convolution* convolution = (ncnn::Convolution*)layers[i];
-
-        int kernel_w = convolution->kernel_w;
-        int kernel_h = convolution->kernel_h;
-        int dilation_w = convolution->dilation_w;
-        int dilation_h = convolution->dilation_h;
-        int stride_w = convolution->stride_w;
-        int stride_h = convolution->stride_h;
 
+        // op - BatchNorm / Scale
         int top_blob_index = layers[i]->tops[0];
-        int bottom_blob_index = layers[i]->bottoms[0];
+        int j = blobs[top_blob_index].consumer;
+        if (j < 0 || layers[j]->type != type)
+            continue;
 
-        const flexnn::DummyMat in = blobs[bottom_blob_index].dummy_shape;
-        const flexnn::DummyMat out = blobs[top_blob_index].dummy_shape;
-        // int max_size = (max_data_size - insz) / (1 + insz); // max_data_size = max_size * (1 + insz) + insz
-        // if use winograd: slice by outch
-        if (kernel_w == 3 && kernel_h == 3 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1 && in.c >= 8 && out.c >= 8)
+        if (layers[j]->bottoms.size() != 1 || layers[j]->bottoms[0] != top_blob_index)
+            continue;
+
+        // per-channel a and b
+        ncnn::Mat a;
+        ncnn::Mat b;
+        if (layers[j]->type == "BatchNorm")
         {
-            if (in.c < 8 || out.c < 8)
-            {
-                // fallback to gemm
+            ncnn::BatchNorm* batchnorm = (ncnn::BatchNorm*)layers[j];
+            a = batchnorm->b_data;
+            b = batchnorm->a_data;
+        }
+        else
+        {
+            ncnn::Scale* scale = (ncnn::Scale*)layers[j];
+            if (scale->scale_data_size == -233)
                 continue;
-            }
-            int winograd63_size = -1, winograd43_size = -1;
-            // winograd43
-            if (in.c > 128 || out.c > 128)
+
+            a = scale->scale_data;
+            if (scale->bias_term)
             {
-                winograd43_size = get_size_convolution(i, "winograd43");
-                if (winograd43_size >= max_data_size)
-                {
-                    int max_ch = get_slice_outch_convolution(i, "winograd43", max_data_size);
-                    if (max_ch < 8) continue;
-                    if (max_ch > 128)
-                    {
-                        int ret = slice_convolution_outch(i, max_ch);
-                        if (ret)
-                        {
-                            fprintf(stderr, "layer %ld %s slice convolution failed.", i, layers[i]->name.c_str());
-                            return -1;
-                        }
-                    }
-                }
-                continue;
+                b = scale->bias_data;
             }
-
-            // winograd63
-            winograd63_size = get_size_convolution(i, "winograd63");
-            if (winograd63_size >= max_data_size)
+            else
             {
-                int max_ch = get_slice_outch_convolution(i, "winograd63", max_data_size);
-                if (max_ch < 8) continue;
-                int ret = slice_convolution_outch(i, max_ch);
-                if (ret)
-                {
-                    fprintf(stderr, "layer %ld %s slice convolution failed.", i, layers[i]->name.c_str());
-                    return -1;
-                }
+                b = ncnn::Mat(scale->scale_data_size);
+                b.fill(0.f);
             }
-            continue;
         }
-    }
 
-    // if 3x3s2?
+        int ret = 0;
+        if (op_type == "Convolution")
+        {
+            ncnn::Convolution* convolution = (ncnn::Convolution*)layers[i];
+            if (convolution->activation_type != 0 || convolution->dynamic_weight || convolution->weight_data_type != 0 || convolution->weight_data.elemsize != 4u || a.w != convolution->num_output)
+                continue;
 
-    // if use gemm: pass
+            ret = fuse_channel_affine(convolution, (const float*)a, (const float*)b);
+        }
+        else if (op_type == "ConvolutionDepthWise")
+        {
+            ncnn::ConvolutionDepthWise* convolutiondepthwise = (ncnn::ConvolutionDepthWise*)layers[i];
+            if (convolutiondepthwise->activation_type != 0 || convolutiondepthwise->dynamic_weight || convolutiondepthwise->weight_data.elemsize != 4u || a.w != convolutiondepthwise->num_output)
+                continue;
+
+            ret = fuse_channel_affine(convolutiondepthwise, (const float*)a, (const float*)b);
+        }
+        else
+        {
+            ncnn::InnerProduct* innerproduct = (ncnn::InnerProduct*)layers[i];
+            if (innerproduct->activation_type != 0 || innerproduct->weight_data.elemsize != 4u || a.w != innerproduct->num_output)
+                continue;
+
+            ret = fuse_channel_affine(innerproduct, (const float*)a, (const float*)b);
+        }
+        if (ret)
+            return ret;
+
+        fprintf(stderr, "fuse %s %s %s\n", type, layers[i]->name.c_str(), layers[j]->name.c_str());
+
+        fuse_into_producer(i, j);
+    }
 
     return 0;
 }
 
-int FlexnnSlice::slice_innerproduct_outsz(int layer_index, int max_size)
+int FlexnnSlice::fuse_convolution_batchnorm()
+{
+    fprintf(stderr, "fuse_convolution_batchnorm\n");
+
+    return fuse_affine_layers("BatchNorm");
+}
+
+int FlexnnSlice::fuse_convolution_scale()
+{
+    fprintf(stderr, "fuse_convolution_scale\n");
+
+    return fuse_affine_layers("Scale");
+}
+
+int FlexnnSlice::fuse_convolution_activation()
 {
     const size_t layer_count = layers.size();
-    const size_t blob_count = blobs.size();
 
-    if (layers[layer_index]->type != "InnerProduct")
+    fprintf(stderr, "fuse_convolution_activation\n");
+
+    for (size_t i = 0; i < layer_count; i++)
     {
-        fprintf(stderr, "Error: layer %d %s is not innerproduct\n", layer_index, layers[layer_index]->name.c_str());
-        return -1;
-    }
+        const std::string& op_type = layers[i]->type;
+        if (op_type != "Convolution" && op_type != "ConvolutionDepthWise" && op_type != "InnerProduct")
+            continue;
 
-    int top_blob_index = layers[layer_index]->tops[0];
-    int bottom_blob_index = layers[layer_index]->bottoms[0];
+        // op - activation
+        int top_blob_index = layers[i]->tops[0];
+        int j = blobs[top_blob_index].consumer;
+        if (j < 0)
+            continue;
 
-    ncnn::InnerProduct* innerproduct = (ncnn::InnerProduct*)layers[layer_index];
-    int outsz = innerproduct->num_output;
+        const ncnn::Layer* activation = layers[j];
+        if (activation->bottoms.size() != 1 || activation->bottoms[0] != top_blob_index)
+            continue;
 
-    // no need to slice
-    if (outsz <= max_size)
-    {
-        // fprintf(stderr, "  slice_innerproduct_outsz: skip layer %d %s\n", layer_index, layers[layer_index]->name.c_str());
-        return 0;
-    }
+        int activation_type = 0;
+        ncnn::Mat activation_params;
+        if (activation->type == "ReLU")
+        {
+            const ncnn::ReLU* relu = (const ncnn::ReLU*)activation;
+            if (relu->slope == 0.f)
+            {
+                activation_type = 1;
+            }
+            else
+            {
+                activation_type = 2;
+                activation_params = ncnn::Mat(1);
+                activation_params[0] = relu->slope;
+            }
+        }
+        else if (activation->type == "Clip")
+        {
+            const ncnn::Clip* clip = (const ncnn::Clip*)activation;
+            activation_type = 3;
+            activation_params = ncnn::Mat(2);
+            activation_params[0] = clip->min;
+            activation_params[1] = clip->max;
+        }
+        else if (activation->type == "Sigmoid")
+        {
+            activation_type = 4;
+        }
+        else if (activation->type == "Mish")
+        {
+            activation_type = 5;
+        }
+        else if (activation->type == "HardSwish")
+        {
+            const ncnn::HardSwish* hardswish = (const ncnn::HardSwish*)activation;
+            activation_type = 6;
+            activation_params = ncnn::Mat(2);
+            activation_params[0] = hardswish->alpha;
+            activation_params[1] = hardswish->beta;
+        }
+        else
+        {
+            continue;
+        }
 
-    // fprintf(stderr, "  slice_innerproduct_outsz: slice layer %d %s\n", layer_index, layers[layer_index]->name.c_str());
+        if (op_type == "Convolution")
+        {
+            ncnn::Convolution* convolution = (ncnn::Convolution*)layers[i];
+            if (convolution->activation_type != 0)
+                continue;
 
-    //  InnerProduct -> ...
-    //  Split        -> ... -> Innerproducts -> Concat
-    //  (replace)               (append at the end)
+            convolution->activation_type = activation_type;
+            convolution->activation_params = activation_params;
+        }
+        else if (op_type == "ConvolutionDepthWise")
+        {
+            ncnn::ConvolutionDepthWise* convolutiondepthwise = (ncnn::ConvolutionDepthWise*)layers[i];
+            if (convolutiondepthwise->activation_type != 0)
+                continue;
 
-    // get number of slice
-    int num_slice = outsz / max_size;
-    int remain_size = outsz % max_size;
-    if (remain_size)
-    {
-        num_slice++;
-    }
+            convolutiondepthwise->activation_type = activation_type;
+            convolutiondepthwise->activation_params = activation_params;
+        }
+        else
+        {
+            ncnn::InnerProduct* innerproduct = (ncnn::InnerProduct*)layers[i];
+            if (innerproduct->activation_type != 0)
+                continue;
 
-    // new blobs
-    std::vector<ncnn::Blob> slice_bottom_blobs, slice_top_blobs;
-    slice_bottom_blobs.resize(num_slice);
-    slice_top_blobs.resize(num_slice);
-    for (size_t i = 0; i < num_slice; i++)
-    {
-        slice_bottom_blobs[i].producer = layer_index;     // split
-        slice_bottom_blobs[i].consumer = layer_count + i; // ip
-        slice_bottom_blobs[i].name = innerproduct->name + "_slice_" + std::to_string(i) + "_bottom";
-        slice_top_blobs[i].producer = layer_count + i;         // ip
-        slice_top_blobs[i].consumer = layer_count + num_slice; // concat
-        slice_top_blobs[i].name = innerproduct->name + "_slice_" + std::to_string(i) + "_top";
-    }
-    blobs.insert(blobs.end(), slice_bottom_blobs.begin(), slice_bottom_blobs.end());
-    blobs.insert(blobs.end(), slice_top_blobs.begin(), slice_top_blobs.end());
+            innerproduct->activation_type = activation_type;
+            innerproduct->activation_params = activation_params;
+        }
 
-    // split
-    ncnn::Split* split = (ncnn::Split*)ncnn::create_layer("Split");
-    split->type = "Split";
-    split->name = innerproduct->name + "_split";
-    split->bottoms = innerproduct->bottoms;
-    split->tops.resize(num_slice);
-    for (size_t i = 0; i < num_slice; i++)
-    {
-        split->tops[i] = blob_count + i;
-    }
+        fprintf(stderr, "fuse_convolution_activation %s %s\n", layers[i]->name.c_str(), activation->name.c_str());
 
-    // innerproduct
-    std::vector<ncnn::InnerProduct*> innerproducts;
-    innerproducts.resize(num_slice);
-    for (size_t i = 0; i < innerproducts.size(); i++)
-    {
-        innerproducts[i] = (ncnn::InnerProduct*)ncnn::create_layer("InnerProduct");
-        innerproducts[i]->type = "InnerProduct";
-        innerproducts[i]->name = innerproduct->name + "_slice_" + std::to_string(i);
-        innerproducts[i]->bottoms.resize(1, blob_count + i);
-        innerproducts[i]->tops.resize(1, blob_count + num_slice + i);
+        fuse_into_producer(i, j);
+    }
+
+    return 0;
+}
+
+int FlexnnSlice::fuse_convolutiondepthwise_pointwise(int max_data_size)
+{
+    const size_t layer_count = layers.size();
+
+    fprintf(stderr, "fuse_convolutiondepthwise_pointwise\n");
+
+    for (size_t i = 0; i < layer_count; i++)
+    {
+        if (layers[i]->type != "ConvolutionDepthWise")
+            continue;
+
+        // pure depth-wise with zero padding and fp32 weights
+        ncnn::ConvolutionDepthWise* convolutiondepthwise = (ncnn::ConvolutionDepthWise*)layers[i];
+        if (convolutiondepthwise->group != convolutiondepthwise->num_output || convolutiondepthwise->dynamic_weight || convolutiondepthwise->int8_scale_term || convolutiondepthwise->weight_data.elemsize != 4u || convolutiondepthwise->pad_value != 0.f)
+            continue;
+
+        int bottom_blob_index = convolutiondepthwise->bottoms[0];
+        int top_blob_index = convolutiondepthwise->tops[0];
+
+        const flexnn::DummyMat& in = blobs[bottom_blob_index].dummy_shape;
+        if (in.dims != 3 || in.c != convolutiondepthwise->group)
+            continue;
+
+        // ConvolutionDepthWise - Convolution 1x1
+        int j = blobs[top_blob_index].consumer;
+        if (j < 0 || layers[j]->type != "Convolution")
+            continue;
+
+        ncnn::Convolution* convolution = (ncnn::Convolution*)layers[j];
+        if (convolution->bottoms.size() != 1 || convolution->bottoms[0] != top_blob_index)
+            continue;
+
+        if (convolution->kernel_w != 1 || convolution->kernel_h != 1 || convolution->stride_w != 1 || convolution->stride_h != 1 || convolution->dilation_w != 1 || convolution->dilation_h != 1)
+            continue;
+
+        if (convolution->pad_left != 0 || convolution->pad_right != 0 || convolution->pad_top != 0 || convolution->pad_bottom != 0)
+            continue;
+
+        if (convolution->dynamic_weight || convolution->weight_data_type != 0 || convolution->int8_scale_term || convolution->weight_data.elemsize != 4u || convolution->sparse_block_count)
+            continue;
+
+        // both weights are loaded at once
+        if (convolutiondepthwise->weight_data_size + convolution->weight_data_size > max_data_size)
+            continue;
+
+        // resolve SAME padding against the known input shape
+        int pad_left = convolutiondepthwise->pad_left;
+        int pad_right = convolutiondepthwise->pad_right;
+        int pad_top = convolutiondepthwise->pad_top;
+        int pad_bottom = convolutiondepthwise->pad_bottom;
+        if (pad_left == -233 || pad_left == -234)
+        {
+            const int kernel_extent_w = convolutiondepthwise->dilation_w * (convolutiondepthwise->kernel_w - 1) + 1;
+            const int kernel_extent_h = convolutiondepthwise->dilation_h * (convolutiondepthwise->kernel_h - 1) + 1;
+            const int wpad = std::max(kernel_extent_w + (in.w - 1) / convolutiondepthwise->stride_w * convolutiondepthwise->stride_w - in.w, 0);
+            const int hpad = std::max(kernel_extent_h + (in.h - 1) / convolutiondepthwise->stride_h * convolutiondepthwise->stride_h - in.h, 0);
+            const bool upper = pad_left == -233;
+
+            pad_left = upper ? wpad / 2 : wpad - wpad / 2;
+            pad_right = wpad - pad_left;
+            pad_top = upper ? hpad / 2 : hpad - hpad / 2;
+            pad_bottom = hpad - pad_top;
+        }
+        if (pad_left < 0 || pad_right < 0 || pad_top < 0 || pad_bottom < 0)
+            continue;
+
+        //  ConvolutionDepthWise -> Convolution
+        //  (fused)                 ConvolutionDepthWisePointWise
+        ncnn::ConvolutionDepthWisePointWise* fused = (ncnn::ConvolutionDepthWisePointWise*)ncnn::create_layer("ConvolutionDepthWisePointWise");
+        fused->type = "ConvolutionDepthWisePointWise";
+        fused->name = convolution->name;
+        fused->bottoms = convolutiondepthwise->bottoms;
+        fused->tops = convolution->tops;
+
+        ncnn::ParamDict pd;
+        fused->load_param(pd);
+        fused->channels = convolutiondepthwise->num_output;
+        fused->kernel_w = convolutiondepthwise->kernel_w;
+        fused->kernel_h = convolutiondepthwise->kernel_h;
+        fused->dilation_w = convolutiondepthwise->dilation_w;
+        fused->dilation_h = convolutiondepthwise->dilation_h;
+        fused->stride_w = convolutiondepthwise->stride_w;
+        fused->stride_h = convolutiondepthwise->stride_h;
+        fused->pad_left = pad_left;
+        fused->pad_right = pad_right;
+        fused->pad_top = pad_top;
+        fused->pad_bottom = pad_bottom;
+        fused->dw_bias_term = convolutiondepthwise->bias_term;
+        fused->dw_weight_data_size = convolutiondepthwise->weight_data_size;
+        fused->dw_activation_type = convolutiondepthwise->activation_type;
+        fused->dw_activation_params = convolutiondepthwise->activation_params;
+        fused->dw_weight_data = convolutiondepthwise->weight_data;
+        fused->dw_bias_data = convolutiondepthwise->bias_data;
+        fused->num_output = convolution->num_output;
+        fused->bias_term = convolution->bias_term;
+        fused->weight_data_size = convolution->weight_data_size;
+        fused->activation_type = convolution->activation_type;
+        fused->activation_params = convolution->activation_params;
+        fused->weight_data = convolution->weight_data;
+        fused->bias_data = convolution->bias_data;
+
+        fprintf(stderr, "fuse_convolutiondepthwise_pointwise %s %s\n", convolutiondepthwise->name.c_str(), convolution->name.c_str());
+
+        blobs[bottom_blob_index].consumer = j;
+        blobs[top_blob_index].producer = -1;
+        blobs[top_blob_index].consumer = -1;
+        convolutiondepthwise->type = "ncnnfused";
+        convolutiondepthwise->bottoms.clear();
+        convolutiondepthwise->tops.clear();
+
+        layers[j] = fused;
+        delete convolution;
+    }
+
+    return 0;
+}
+
+int FlexnnSlice::eliminate_noop()
+{
+    const size_t layer_count = layers.size();
+
+    fprintf(stderr, "eliminate_noop\n");
+
+    for (size_t i = 0; i < layer_count; i++)
+    {
+        ncnn::Layer* layer = layers[i];
+
+        // single-output Split, identity Dropout and Noop just forward their bottom
+        bool is_noop = false;
+        if (layer->type == "Split" || layer->type == "Noop")
+        {
+            is_noop = true;
+        }
+        else if (layer->type == "Dropout")
+        {
+            const ncnn::Dropout* dropout = (const ncnn::Dropout*)layer;
+            is_noop = dropout->scale == 1.f;
+        }
+
+        if (!is_noop || layer->bottoms.size() != 1 || layer->tops.size() != 1)
+            continue;
+
+        int bottom_blob_index = layer->bottoms[0];
+        int top_blob_index = layer->tops[0];
+
+        int j = blobs[top_blob_index].consumer;
+        if (j >= 0)
+        {
+            //  ... -> noop -> next
+            //  ... ---------> next    (fused)
+            std::vector<int>& bottoms = layers[j]->bottoms;
+            std::replace(bottoms.begin(), bottoms.end(), top_blob_index, bottom_blob_index);
+            blobs[bottom_blob_index].consumer = j;
+        }
+        else
+        {
+            //  prev -> noop -> (output)
+            //  prev ---------> (output)    (fused)
+            int k = blobs[bottom_blob_index].producer;
+            if (k < 0 || layers[k]->type == "Input")
+                continue;
+
+            std::vector<int>& tops = layers[k]->tops;
+            std::replace(tops.begin(), tops.end(), bottom_blob_index, top_blob_index);
+            blobs[top_blob_index].producer = k;
+            blobs[bottom_blob_index].producer = -1;
+        }
+
+        fprintf(stderr, "eliminate_noop %s %s\n", layer->type.c_str(), layer->name.c_str());
+
+        if (j >= 0)
+        {
+            blobs[top_blob_index].producer = -1;
+            blobs[top_blob_index].consumer = -1;
+        }
+        else
+        {
+            blobs[bottom_blob_index].consumer = -1;
+        }
+
+        layer->type = "ncnnfused";
+        layer->bottoms.clear();
+        layer->tops.clear();
+    }
+
+    return 0;
+}
+
+int FlexnnSlice::slice_innerproduct(int max_data_size)
+{
+    const size_t layer_count = layers.size();
+
+    fprintf(stderr, "slice_innerproduct\n");
+
+    for (size_t i = 0; i < layer_count; i++)
+    {
+        if (layers[i]->type != "InnerProduct")
+            continue;
+
+        // decide slice size
+        ncnn::InnerProduct* innerproduct = (ncnn::InnerProduct*)layers[i];
+        if (innerproduct->sparse_block_count)
+            continue;
+
+        int outsz = innerproduct->num_output;
+        int insz = innerproduct->weight_data_size / outsz;
+
+        // budget in fp32 elements, int8 weights take a quarter of that
+        // max_data_size * 4 = max_size * (insz * weight_elemsize + 4) + insz * 4
+        const int weight_elemsize = (int)innerproduct->weight_data.elemsize;
+        int max_size = (int)(((long long)max_data_size - insz) * 4 / ((long long)insz * weight_elemsize + 4));
+
+        // wide input and narrow output, slice along input and accumulate partial sums
+        // int8 scales are per output channel and per input, the insz slices do not carry them
+        if (outsz > max_size && insz > outsz && innerproduct->weight_data.elemsize == 4u && !innerproduct->int8_scale_term)
+        {
+            int max_insz = (max_data_size - outsz) / (1 + outsz); // max_data_size = max_insz * (1 + outsz) + outsz
+            if (max_insz > 0)
+            {
+                int ret = slice_innerproduct_insz(i, max_insz);
+                if (ret)
+                {
+                    fprintf(stderr, "layer %ld %s slice innerproduct failed.", i, layers[i]->name.c_str());
+                    return -1;
+                }
+                continue;
+            }
+        }
+
+        int ret = slice_innerproduct_outsz(i, max_size);
+        if (ret)
+        {
+            fprintf(stderr, "layer %ld %s slice innerproduct failed.", i, layers[i]->name.c_str());
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int FlexnnSlice::slice_convolution(int max_data_size)
+{
+    const size_t layer_count = layers.size();
+    for (size_t i = 0; i < layer_count; i++)
+    {
+        if (layers[i]->type != "Convolution")
+            continue;
+        // fprintf(stderr, "slice_convolution %ld %s\n", i, layers[i]->name.c_str());
+
+        // decide slice size
+        ncnn::Convolution* convolution = (ncnn::Convolution*)layers[i];
+        if (convolution->sparse_block_count)
+            continue;
+
+        int kernel_w = convolution->kernel_w;
+        int kernel_h = convolution->kernel_h;
+        int dilation_w = convolution->dilation_w;
+        int dilation_h = convolution->dilation_h;
+        int stride_w = convolution->stride_w;
+        int stride_h = convolution->stride_h;
+
+        int top_blob_index = layers[i]->tops[0];
+        int bottom_blob_index = layers[i]->bottoms[0];
+
+        const flexnn::DummyMat in = blobs[bottom_blob_index].dummy_shape;
+        const flexnn::DummyMat out = blobs[top_blob_index].dummy_shape;
+
+        // int8 weights run through the int8 kernels, budget the raw weights at 1 byte per element
+        if (convolution->weight_data.elemsize == 1u)
+        {
+            int max_ch = get_slice_outch_convolution_int8(i, max_data_size);
+            if (max_ch < 0)
+            {
+                fprintf(stderr, "layer %ld %s int8 input and output exceed max_data_size.\n", i, layers[i]->name.c_str());
+                continue;
+            }
+            if (max_ch == 0)
+            {
+                fprintf(stderr, "layer %ld %s 4 int8 output channels exceed max_data_size.\n", i, layers[i]->name.c_str());
+                return -1;
+            }
+            int ret = slice_convolution_outch(i, max_ch);
+            if (ret)
+            {
+                fprintf(stderr, "layer %ld %s slice convolution failed.", i, layers[i]->name.c_str());
+                return -1;
+            }
+            continue;
+        }
+
+        // int max_size = (max_data_size - insz) / (1 + insz); // max_data_size = max_size * (1 + insz) + insz
+        // if use winograd: slice by outch
+        if (kernel_w == 3 && kernel_h == 3 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1 && in.c >= 8 && out.c >= 8)
+        {
+            if (in.c < 8 || out.c < 8)
+            {
+                // fallback to gemm
+                continue;
+            }
+            int winograd63_size = -1, winograd43_size = -1;
+            // winograd43
+            if (in.c > 128 || out.c > 128)
+            {
+                winograd43_size = get_size_convolution(i, "winograd43");
+                if (winograd43_size >= max_data_size)
+                {
+                    int max_ch = get_slice_outch_convolution(i, "winograd43", max_data_size);
+                    if (max_ch < 8) continue;
+                    if (max_ch > 128)
+                    {
+                        int ret = slice_convolution_outch(i, max_ch);
+                        if (ret)
+                        {
+                            fprintf(stderr, "layer %ld %s slice convolution failed.", i, layers[i]->name.c_str());
+                            return -1;
+                        }
+                    }
+                }
+                continue;
+            }
+
+            // winograd63
+            winograd63_size = get_size_convolution(i, "winograd63");
+            if (winograd63_size >= max_data_size)
+            {
+                int max_ch = get_slice_outch_convolution(i, "winograd63", max_data_size);
+                if (max_ch < 8) continue;
+                int ret = slice_convolution_outch(i, max_ch);
+                if (ret)
+                {
+                    fprintf(stderr, "layer %ld %s slice convolution failed.", i, layers[i]->name.c_str());
+                    return -1;
+                }
+            }
+            continue;
+        }
+    }
+
+    // if 3x3s2?
+
+    // if use gemm: pass
+
+    return 0;
+}
+
+int FlexnnSlice::slice_multiheadattention(int max_data_size)
+{
+    const size_t layer_count = layers.size();
+
+    fprintf(stderr, "slice_multiheadattention\n");
+
+    for (size_t i = 0; i < layer_count; i++)
+    {
+        if (layers[i]->type != "MultiHeadAttention")
+            continue;
+
+        // decide slice size
+        ncnn::MultiHeadAttention* attention = (ncnn::MultiHeadAttention*)layers[i];
+        if (attention->kv_cache)
+        {
+            // head-group slices would need their own past / present blobs
+            fprintf(stderr, "skip slicing layer %ld %s with kv_cache.\n", i, layers[i]->name.c_str());
+            continue;
+        }
+
+        int embed_dim_per_head = attention->embed_dim / attention->num_head;
+        int qdim = attention->qdim;
+
+        // q/k/v weights and biases, plus the out projection columns of one head
+        int head_size = embed_dim_per_head * (qdim + attention->kdim + attention->vdim + qdim) + embed_dim_per_head * 3;
+
+        int max_size = (max_data_size - qdim) / head_size; // max_data_size = max_size * head_size + qdim (out bias)
+        if (max_size < 1)
+            max_size = 1;
+
+        int ret = slice_multiheadattention_head(i, max_size);
+        if (ret)
+        {
+            fprintf(stderr, "layer %ld %s slice multiheadattention failed.", i, layers[i]->name.c_str());
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int FlexnnSlice::slice_innerproduct_outsz(int layer_index, int max_size)
+{
+    const size_t layer_count = layers.size();
+    const size_t blob_count = blobs.size();
+
+    if (layers[layer_index]->type != "InnerProduct")
+    {
+        fprintf(stderr, "Error: layer %d %s is not innerproduct\n", layer_index, layers[layer_index]->name.c_str());
+        return -1;
+    }
+
+    int top_blob_index = layers[layer_index]->tops[0];
+    int bottom_blob_index = layers[layer_index]->bottoms[0];
+
+    ncnn::InnerProduct* innerproduct = (ncnn::InnerProduct*)layers[layer_index];
+    int outsz = innerproduct->num_output;
+
+    // no need to slice
+    if (outsz <= max_size)
+    {
+        // fprintf(stderr, "  slice_innerproduct_outsz: skip layer %d %s\n", layer_index, layers[layer_index]->name.c_str());
+        return 0;
+    }
+
+    // fprintf(stderr, "  slice_innerproduct_outsz: slice layer %d %s\n", layer_index, layers[layer_index]->name.c_str());
+
+    //  InnerProduct -> ...
+    //  Split        -> ... -> Innerproducts -> Concat
+    //  (replace)               (append at the end)
+
+    // get number of slice
+    int num_slice = outsz / max_size;
+    int remain_size = outsz % max_size;
+    if (remain_size)
+    {
+        num_slice++;
+    }
+
+    // new blobs
+    std::vector<ncnn::Blob> slice_bottom_blobs, slice_top_blobs;
+    slice_bottom_blobs.resize(num_slice);
+    slice_top_blobs.resize(num_slice);
+    for (size_t i = 0; i < num_slice; i++)
+    {
+        slice_bottom_blobs[i].producer = layer_index;     // split
+        slice_bottom_blobs[i].consumer = layer_count + i; // ip
+        slice_bottom_blobs[i].name = innerproduct->name + "_slice_" + std::to_string(i) + "_bottom";
+        slice_top_blobs[i].producer = layer_count + i;         // ip
+        slice_top_blobs[i].consumer = layer_count + num_slice; // concat
+        slice_top_blobs[i].name = innerproduct->name + "_slice_" + std::to_string(i) + "_top";
+    }
+    blobs.insert(blobs.end(), slice_bottom_blobs.begin(), slice_bottom_blobs.end());
+    blobs.insert(blobs.end(), slice_top_blobs.begin(), slice_top_blobs.end());
+
+    // split
+    ncnn::Split* split = (ncnn::Split*)ncnn::create_layer("Split");
+    split->type = "Split";
+    split->name = innerproduct->name + "_split";
+    split->bottoms = innerproduct->bottoms;
+    split->tops.resize(num_slice);
+    for (size_t i = 0; i < num_slice; i++)
+    {
+        split->tops[i] = blob_count + i;
+    }
+
+    // innerproduct
+    std::vector<ncnn::InnerProduct*> innerproducts;
+    innerproducts.resize(num_slice);
+    for (size_t i = 0; i < innerproducts.size(); i++)
+    {
+        innerproducts[i] = (ncnn::InnerProduct*)ncnn::create_layer("InnerProduct");
+        innerproducts[i]->type = "InnerProduct";
+        innerproducts[i]->name = innerproduct->name + "_slice_" + std::to_string(i);
+        innerproducts[i]->bottoms.resize(1, blob_count + i);
+        innerproducts[i]->tops.resize(1, blob_count + num_slice + i);
     }
 
     // concat
@@ -708,51 +1380,486 @@ int FlexnnSlice::slice_innerproduct_outsz(int layer_index, int max_size)
     concat->bottoms.resize(num_slice);
     for (size_t i = 0; i < num_slice; i++)
     {
-        concat->bottoms[i] = blob_count + num_slice + i;
+        concat->bottoms[i] = blob_count + num_slice + i;
+    }
+    // gpt2
+    if (blobs[bottom_blob_index].dummy_shape.dims == 1)
+    {
+        concat->axis = 0;
+    }
+    else
+    {
+        concat->axis = 1;
+    }
+
+    // assign params and weights
+    ncnn::ParamDict pd;
+    for (size_t i = 0; i < innerproducts.size(); i++)
+    {
+        // params
+        innerproducts[i]->load_param(pd);
+        int size = max_size;
+        if (i == innerproducts.size() - 1 && remain_size > 0)
+        {
+            size = remain_size;
+        }
+
+        innerproducts[i]->num_output = size;
+        innerproducts[i]->bias_term = innerproduct->bias_term;
+        innerproducts[i]->weight_data_size = innerproduct->weight_data_size / outsz * size;
+        innerproducts[i]->int8_scale_term = innerproduct->int8_scale_term;
+        innerproducts[i]->activation_type = innerproduct->activation_type;
+        innerproducts[i]->activation_params = innerproduct->activation_params;
+
+        // weights
+        innerproducts[i]->weight_data = innerproduct->weight_data.range(innerproduct->weight_data_size / outsz * max_size * i, innerproduct->weight_data_size / outsz * size).clone();
+        innerproducts[i]->bias_data = innerproduct->bias_data.range(max_size * i, size).clone();
+#if NCNN_INT8
+        if (innerproduct->int8_scale_term)
+        {
+            innerproducts[i]->weight_data_int8_scales = innerproduct->weight_data_int8_scales.range(max_size * i, size).clone();
+            innerproducts[i]->bottom_blob_int8_scales = innerproduct->bottom_blob_int8_scales.clone();
+        }
+#endif
+    }
+
+    // insert layers
+    layers[layer_index] = split;
+    layers.insert(layers.end(), innerproducts.begin(), innerproducts.end());
+    layers.push_back(concat);
+    delete innerproduct;
+
+    return 0;
+}
+
+int FlexnnSlice::slice_innerproduct_insz(int layer_index, int max_size)
+{
+    const size_t layer_count = layers.size();
+    const size_t blob_count = blobs.size();
+
+    if (layers[layer_index]->type != "InnerProduct")
+    {
+        fprintf(stderr, "Error: layer %d %s is not innerproduct\n", layer_index, layers[layer_index]->name.c_str());
+        return -1;
+    }
+
+    int top_blob_index = layers[layer_index]->tops[0];
+    int bottom_blob_index = layers[layer_index]->bottoms[0];
+
+    ncnn::InnerProduct* innerproduct = (ncnn::InnerProduct*)layers[layer_index];
+    int outsz = innerproduct->num_output;
+    int insz = innerproduct->weight_data_size / outsz;
+
+    // no need to slice
+    if (insz <= max_size)
+    {
+        return 0;
+    }
+
+    //  InnerProduct -> ...
+    //  Slice        -> ... -> Innerproducts -> Eltwise (-> Activation)
+    //  (replace)               (append at the end)
+    //  partial sums are accumulated by eltwise, bias is added by the first slice only
+
+    const flexnn::DummyMat in = blobs[bottom_blob_index].dummy_shape;
+
+    // gpt2: 2-dim input is sliced along w row by row, otherwise flatten first
+    int axis = 0;
+    int flatten_count = 0;
+    if (in.dims == 2 && in.w == insz)
+    {
+        axis = 1;
+    }
+    else if (in.dims != 1)
+    {
+        flatten_count = 1;
+    }
+
+    int activation_count = innerproduct->activation_type ? 1 : 0;
+
+    // get number of slice
+    int num_slice = insz / max_size;
+    int remain_size = insz % max_size;
+    if (remain_size)
+    {
+        num_slice++;
+    }
+
+    // layer indexes
+    const int slice_layer_index = flatten_count ? (int)layer_count : layer_index;
+    const int ip_layer_index = (int)layer_count + flatten_count;
+    const int eltwise_layer_index = ip_layer_index + num_slice;
+
+    // blob indexes
+    const int flatten_blob_index = (int)blob_count;
+    const int slice_bottom_blob_index = (int)blob_count + flatten_count;
+    const int slice_top_blob_index = slice_bottom_blob_index + num_slice;
+    const int sum_blob_index = slice_top_blob_index + num_slice;
+
+    // new blobs
+    if (flatten_count)
+    {
+        ncnn::Blob flatten_blob;
+        flatten_blob.producer = layer_index;
+        flatten_blob.consumer = slice_layer_index;
+        flatten_blob.name = innerproduct->name + "_flatten";
+        blobs.push_back(flatten_blob);
+    }
+    std::vector<ncnn::Blob> slice_bottom_blobs, slice_top_blobs;
+    slice_bottom_blobs.resize(num_slice);
+    slice_top_blobs.resize(num_slice);
+    for (size_t i = 0; i < num_slice; i++)
+    {
+        slice_bottom_blobs[i].producer = slice_layer_index; // slice
+        slice_bottom_blobs[i].consumer = ip_layer_index + i; // ip
+        slice_bottom_blobs[i].name = innerproduct->name + "_slice_" + std::to_string(i) + "_bottom";
+        slice_top_blobs[i].producer = ip_layer_index + i;        // ip
+        slice_top_blobs[i].consumer = eltwise_layer_index;       // eltwise
+        slice_top_blobs[i].name = innerproduct->name + "_slice_" + std::to_string(i) + "_top";
+    }
+    blobs.insert(blobs.end(), slice_bottom_blobs.begin(), slice_bottom_blobs.end());
+    blobs.insert(blobs.end(), slice_top_blobs.begin(), slice_top_blobs.end());
+    if (activation_count)
+    {
+        ncnn::Blob sum_blob;
+        sum_blob.producer = eltwise_layer_index;
+        sum_blob.consumer = eltwise_layer_index + 1;
+        sum_blob.name = innerproduct->name + "_sum";
+        blobs.push_back(sum_blob);
+    }
+    blobs[top_blob_index].producer = eltwise_layer_index + activation_count;
+
+    ncnn::ParamDict pd;
+
+    // flatten
+    ncnn::Layer* flatten = 0;
+    if (flatten_count)
+    {
+        flatten = ncnn::create_layer("Flatten");
+        flatten->type = "Flatten";
+        flatten->name = innerproduct->name + "_flatten";
+        flatten->bottoms = innerproduct->bottoms;
+        flatten->tops.resize(1, flatten_blob_index);
+        flatten->load_param(pd);
+    }
+
+    // slice
+    ncnn::Slice* slice = (ncnn::Slice*)ncnn::create_layer("Slice");
+    slice->type = "Slice";
+    slice->name = innerproduct->name + "_slice";
+    slice->load_param(pd);
+    slice->bottoms.resize(1, flatten_count ? flatten_blob_index : bottom_blob_index);
+    slice->tops.resize(num_slice);
+    slice->slices.create(num_slice);
+    for (size_t i = 0; i < num_slice; i++)
+    {
+        slice->tops[i] = slice_bottom_blob_index + i;
+        ((int*)slice->slices)[i] = (i == num_slice - 1 && remain_size > 0) ? remain_size : max_size;
+    }
+    slice->axis = axis;
+
+    // innerproduct
+    std::vector<ncnn::InnerProduct*> innerproducts;
+    innerproducts.resize(num_slice);
+    for (size_t i = 0; i < innerproducts.size(); i++)
+    {
+        innerproducts[i] = (ncnn::InnerProduct*)ncnn::create_layer("InnerProduct");
+        innerproducts[i]->type = "InnerProduct";
+        innerproducts[i]->name = innerproduct->name + "_slice_" + std::to_string(i);
+        innerproducts[i]->bottoms.resize(1, slice_bottom_blob_index + i);
+        innerproducts[i]->tops.resize(1, slice_top_blob_index + i);
+    }
+
+    // eltwise sum
+    ncnn::Eltwise* eltwise = (ncnn::Eltwise*)ncnn::create_layer("Eltwise");
+    eltwise->type = "Eltwise";
+    eltwise->name = innerproduct->name + "_sum";
+    eltwise->load_param(pd);
+    eltwise->op_type = ncnn::Eltwise::Operation_SUM;
+    eltwise->bottoms.resize(num_slice);
+    for (size_t i = 0; i < num_slice; i++)
+    {
+        eltwise->bottoms[i] = slice_top_blob_index + i;
+    }
+    eltwise->tops = innerproduct->tops;
+
+    // activation can only be applied to the full sum
+    ncnn::Layer* activation = 0;
+    if (activation_count)
+    {
+        const int activation_type = innerproduct->activation_type;
+        const ncnn::Mat& activation_params = innerproduct->activation_params;
+
+        ncnn::ParamDict activation_pd;
+        const char* activation_name = 0;
+        if (activation_type == 1 || activation_type == 2)
+        {
+            activation_name = "ReLU";
+            if (activation_type == 2)
+                activation_pd.set(0, activation_params[0]); // slope
+        }
+        else if (activation_type == 3)
+        {
+            activation_name = "Clip";
+            activation_pd.set(0, activation_params[0]); // min
+            activation_pd.set(1, activation_params[1]); // max
+        }
+        else if (activation_type == 4)
+        {
+            activation_name = "Sigmoid";
+        }
+        else if (activation_type == 5)
+        {
+            activation_name = "Mish";
+        }
+        else if (activation_type == 6)
+        {
+            activation_name = "HardSwish";
+            activation_pd.set(0, activation_params[0]); // alpha
+            activation_pd.set(1, activation_params[1]); // beta
+        }
+        else
+        {
+            fprintf(stderr, "Error: layer %d %s activation type %d not supported\n", layer_index, innerproduct->name.c_str(), activation_type);
+            return -1;
+        }
+
+        activation = ncnn::create_layer(activation_name);
+        activation->type = activation_name;
+        activation->name = innerproduct->name + "_" + activation_name;
+        activation->load_param(activation_pd);
+        activation->bottoms.resize(1, sum_blob_index);
+        activation->tops = innerproduct->tops;
+        eltwise->tops[0] = sum_blob_index;
+    }
+
+    // assign params and weights
+    const float* weight = innerproduct->weight_data;
+    for (size_t i = 0; i < innerproducts.size(); i++)
+    {
+        // params
+        innerproducts[i]->load_param(pd);
+        int size = max_size;
+        if (i == innerproducts.size() - 1 && remain_size > 0)
+        {
+            size = remain_size;
+        }
+
+        innerproducts[i]->num_output = outsz;
+        innerproducts[i]->bias_term = i == 0 ? innerproduct->bias_term : 0;
+        innerproducts[i]->weight_data_size = outsz * size;
+        innerproducts[i]->int8_scale_term = innerproduct->int8_scale_term;
+
+        // weights, columns [max_size * i, max_size * i + size) of each output row
+        innerproducts[i]->weight_data.create(outsz * size);
+        float* outptr = innerproducts[i]->weight_data;
+        for (int k = 0; k < outsz; k++)
+        {
+            memcpy(outptr + k * size, weight + k * insz + max_size * i, size * sizeof(float));
+        }
+
+        // bias, only added once by the first slice
+        if (innerproducts[i]->bias_term)
+        {
+            innerproducts[i]->bias_data = innerproduct->bias_data.clone();
+        }
+    }
+
+    // insert layers
+    if (flatten_count)
+    {
+        layers[layer_index] = flatten;
+        layers.push_back(slice);
+    }
+    else
+    {
+        layers[layer_index] = slice;
+    }
+    layers.insert(layers.end(), innerproducts.begin(), innerproducts.end());
+    layers.push_back(eltwise);
+    if (activation_count)
+    {
+        layers.push_back(activation);
+    }
+    delete innerproduct;
+
+    return 0;
+}
+
+int FlexnnSlice::slice_multiheadattention_head(int layer_index, int max_size)
+{
+    const size_t layer_count = layers.size();
+    const size_t blob_count = blobs.size();
+
+    if (layers[layer_index]->type != "MultiHeadAttention")
+    {
+        fprintf(stderr, "Error: layer %d %s is not multiheadattention\n", layer_index, layers[layer_index]->name.c_str());
+        return -1;
     }
-    // gpt2
-    if (blobs[bottom_blob_index].dummy_shape.dims == 1)
+
+    ncnn::MultiHeadAttention* attention = (ncnn::MultiHeadAttention*)layers[layer_index];
+    int num_head = attention->num_head;
+    int embed_dim_per_head = attention->embed_dim / num_head;
+    int qdim = attention->qdim;
+    int kdim = attention->kdim;
+    int vdim = attention->vdim;
+
+    // no need to slice
+    if (num_head <= max_size)
     {
-        concat->axis = 0;
+        return 0;
     }
-    else
+
+    //  MultiHeadAttention -> ...
+    //  Split(s)           -> ... -> MultiHeadAttentions -> Eltwise(sum)
+    //  (replace)                   (append at the end)
+    //
+    //  each slice owns the q/k/v projection rows of its heads and the matching
+    //  columns of the out projection, so the partial outputs add up to the original.
+
+    // get number of slice
+    int num_slice = num_head / max_size;
+    int remain_size = num_head % max_size;
+    if (remain_size)
     {
-        concat->axis = 1;
+        num_slice++;
+    }
+
+    // one split per distinct bottom, q/k/v may share the same blob
+    const int num_bottom = attention->bottoms.size();
+
+    // new blobs
+    std::vector<ncnn::Blob> slice_bottom_blobs, slice_top_blobs;
+    slice_bottom_blobs.resize(num_bottom * num_slice);
+    slice_top_blobs.resize(num_slice);
+    for (int j = 0; j < num_bottom; j++)
+    {
+        int split_index = j == 0 ? layer_index : layer_count + num_slice + 1 + j - 1;
+        for (int i = 0; i < num_slice; i++)
+        {
+            slice_bottom_blobs[j * num_slice + i].producer = split_index;   // split
+            slice_bottom_blobs[j * num_slice + i].consumer = layer_count + i; // mha
+            slice_bottom_blobs[j * num_slice + i].name = attention->name + "_slice_" + std::to_string(i) + "_bottom_" + std::to_string(j);
+        }
+    }
+    for (int i = 0; i < num_slice; i++)
+    {
+        slice_top_blobs[i].producer = layer_count + i;         // mha
+        slice_top_blobs[i].consumer = layer_count + num_slice; // eltwise
+        slice_top_blobs[i].name = attention->name + "_slice_" + std::to_string(i) + "_top";
+    }
+    blobs.insert(blobs.end(), slice_bottom_blobs.begin(), slice_bottom_blobs.end());
+    blobs.insert(blobs.end(), slice_top_blobs.begin(), slice_top_blobs.end());
+
+    // split
+    std::vector<ncnn::Split*> splits;
+    splits.resize(num_bottom);
+    for (int j = 0; j < num_bottom; j++)
+    {
+        splits[j] = (ncnn::Split*)ncnn::create_layer("Split");
+        splits[j]->type = "Split";
+        splits[j]->name = attention->name + "_split" + (j == 0 ? std::string() : "_" + std::to_string(j));
+        splits[j]->bottoms.resize(1, attention->bottoms[j]);
+        splits[j]->tops.resize(num_slice);
+        for (int i = 0; i < num_slice; i++)
+        {
+            splits[j]->tops[i] = blob_count + j * num_slice + i;
+        }
+
+        // the extra splits are appended after the eltwise
+        if (j > 0)
+        {
+            blobs[attention->bottoms[j]].consumer = layer_count + num_slice + 1 + j - 1;
+        }
+    }
+
+    // multiheadattention
+    std::vector<ncnn::MultiHeadAttention*> attentions;
+    attentions.resize(num_slice);
+    for (int i = 0; i < num_slice; i++)
+    {
+        attentions[i] = (ncnn::MultiHeadAttention*)ncnn::create_layer("MultiHeadAttention");
+        attentions[i]->type = "MultiHeadAttention";
+        attentions[i]->name = attention->name + "_slice_" + std::to_string(i);
+        attentions[i]->bottoms.resize(num_bottom);
+        for (int j = 0; j < num_bottom; j++)
+        {
+            attentions[i]->bottoms[j] = blob_count + j * num_slice + i;
+        }
+        attentions[i]->tops.resize(1, blob_count + num_bottom * num_slice + i);
+    }
+
+    // eltwise
+    ncnn::Eltwise* eltwise = (ncnn::Eltwise*)ncnn::create_layer("Eltwise");
+    eltwise->type = "Eltwise";
+    eltwise->name = attention->name + "_sum";
+    eltwise->tops = attention->tops;
+    eltwise->bottoms.resize(num_slice);
+    for (int i = 0; i < num_slice; i++)
+    {
+        eltwise->bottoms[i] = blob_count + num_bottom * num_slice + i;
     }
 
     // assign params and weights
     ncnn::ParamDict pd;
-    for (size_t i = 0; i < innerproducts.size(); i++)
+    eltwise->load_param(pd);
+    eltwise->op_type = ncnn::Eltwise::Operation_SUM;
+
+    for (int i = 0; i < num_slice; i++)
     {
         // params
-        innerproducts[i]->load_param(pd);
+        attentions[i]->load_param(pd);
         int size = max_size;
-        if (i == innerproducts.size() - 1 && remain_size > 0)
+        if (i == num_slice - 1 && remain_size > 0)
         {
             size = remain_size;
         }
 
-        innerproducts[i]->num_output = size;
-        innerproducts[i]->bias_term = innerproduct->bias_term;
-        innerproducts[i]->weight_data_size = innerproduct->weight_data_size / outsz * size;
-        innerproducts[i]->int8_scale_term = innerproduct->int8_scale_term;
-        innerproducts[i]->activation_type = innerproduct->activation_type;
-        innerproducts[i]->activation_params = innerproduct->activation_params;
+        const int head_offset = max_size * i * embed_dim_per_head;
+        const int slice_embed_dim = size * embed_dim_per_head;
+
+        attentions[i]->embed_dim = slice_embed_dim;
+        attentions[i]->num_head = size;
+        attentions[i]->weight_data_size = slice_embed_dim * qdim;
+        attentions[i]->kdim = kdim;
+        attentions[i]->vdim = vdim;
+        attentions[i]->qdim = qdim;
+
+        // q/k/v weights, rows of the heads
+        attentions[i]->q_weight_data = attention->q_weight_data.range(head_offset * qdim, slice_embed_dim * qdim).clone();
+        attentions[i]->q_bias_data = attention->q_bias_data.range(head_offset, slice_embed_dim).clone();
+        attentions[i]->k_weight_data = attention->k_weight_data.range(head_offset * kdim, slice_embed_dim * kdim).clone();
+        attentions[i]->k_bias_data = attention->k_bias_data.range(head_offset, slice_embed_dim).clone();
+        attentions[i]->v_weight_data = attention->v_weight_data.range(head_offset * vdim, slice_embed_dim * vdim).clone();
+        attentions[i]->v_bias_data = attention->v_bias_data.range(head_offset, slice_embed_dim).clone();
+
+        // out weight, columns of the heads
+        attentions[i]->out_weight_data.create(slice_embed_dim * qdim);
+        for (int k = 0; k < qdim; k++)
+        {
+            const float* ptr = (const float*)attention->out_weight_data + k * attention->embed_dim + head_offset;
+            float* outptr = (float*)attentions[i]->out_weight_data + k * slice_embed_dim;
+            memcpy(outptr, ptr, slice_embed_dim * sizeof(float));
+        }
 
-        // weights
-        innerproducts[i]->weight_data = innerproduct->weight_data.range(innerproduct->weight_data_size / outsz * max_size * i, innerproduct->weight_data_size / outsz * size).clone();
-        innerproducts[i]->bias_data = innerproduct->bias_data.range(max_size * i, size).clone();
-        // #if NCNN_INT8
-        //         innerproduct->weight_data_int8_scales = convolution->weight_data_int8_scales;
-        //         innerproduct->bottom_blob_int8_scales = convolution->bottom_blob_int8_scales;
-        // #endif
+        // out bias, only added once by the first slice
+        if (i == 0)
+        {
+            attentions[i]->out_bias_data = attention->out_bias_data.clone();
+        }
+        else
+        {
+            attentions[i]->out_bias_data.create(qdim);
+            attentions[i]->out_bias_data.fill(0.f);
+        }
     }
 
     // insert layers
-    layers[layer_index] = split;
-    layers.insert(layers.end(), innerproducts.begin(), innerproducts.end());
-    layers.push_back(concat);
-    delete innerproduct;
+    layers[layer_index] = splits[0];
+    layers.insert(layers.end(), attentions.begin(), attentions.end());
+    layers.push_back(eltwise);
+    layers.insert(layers.end(), splits.begin() + 1, splits.end());
+    delete attention;
 
     return 0;
 }
@@ -887,10 +1994,14 @@ int FlexnnSlice::slice_convolution_outch(int layer_index, int max_size)
         // weights
         convolutions[i]->weight_data = convolution->weight_data.range(convolution->weight_data_size / out.c * max_size * i, convolution->weight_data_size / out.c * size).clone();
         convolutions[i]->bias_data = convolution->bias_data.range(max_size * i, size).clone();
-        // #if NCNN_INT8
-        //         convolution->weight_data_int8_scales = convolution->weight_data_int8_scales;
-        //         convolution->bottom_blob_int8_scales = convolution->bottom_blob_int8_scales;
-        // #endif
+#if NCNN_INT8
+        if (convolution->int8_scale_term)
+        {
+            convolutions[i]->weight_data_int8_scales = convolution->weight_data_int8_scales.range(max_size * i, size).clone();
+            convolutions[i]->bottom_blob_int8_scales = convolution->bottom_blob_int8_scales.clone();
+            convolutions[i]->top_blob_int8_scales = convolution->top_blob_int8_scales.clone();
+        }
+#endif
     }
 
     // insert layers
@@ -902,6 +2013,135 @@ int FlexnnSlice::slice_convolution_outch(int layer_index, int max_size)
     return 0;
 }
 
+int FlexnnSlice::sparsify_weight(const ncnn::Mat& weight, int rows, int cols, float min_zero_block_ratio, ncnn::Mat& bitmap, ncnn::Mat& values) const
+{
+    const int blocks = (cols + 3) / 4;
+    const int words = blocksparse_words(cols);
+
+    bitmap.create(rows * words);
+    bitmap.fill(0);
+
+    unsigned int* bits = (unsigned int*)bitmap.data;
+    const float* ptr = weight;
+
+    int count = 0;
+    for (int p = 0; p < rows; p++)
+    {
+        for (int b = 0; b < blocks; b++)
+        {
+            const float* kptr = ptr + p * cols + b * 4;
+            const int n = std::min(4, cols - b * 4);
+
+            bool zero = true;
+            for (int k = 0; k < n; k++)
+            {
+                if (kptr[k] != 0.f)
+                    zero = false;
+            }
+
+            if (!zero)
+            {
+                bits[p * words + b / 32] |= 1u << (b % 32);
+                count++;
+            }
+        }
+    }
+
+    // an all-zero weight stays dense, sparse_block_count 0 means dense
+    if (count == 0 || (float)(rows * blocks - count) < min_zero_block_ratio * rows * blocks)
+    {
+        bitmap.release();
+        return 0;
+    }
+
+    values.create(count * 4);
+
+    float* vptr = values;
+    for (int p = 0; p < rows; p++)
+    {
+        for (int b = 0; b < blocks; b++)
+        {
+            if (!(bits[p * words + b / 32] & (1u << (b % 32))))
+                continue;
+
+            const float* kptr = ptr + p * cols + b * 4;
+            const int n = std::min(4, cols - b * 4);
+            for (int k = 0; k < 4; k++)
+            {
+                vptr[k] = k < n ? kptr[k] : 0.f;
+            }
+            vptr += 4;
+        }
+    }
+
+    return count;
+}
+
+int FlexnnSlice::sparsify_weights(float min_zero_block_ratio)
+{
+    const size_t layer_count = layers.size();
+
+    fprintf(stderr, "sparsify_weights\n");
+
+    // random weights are generated at save time, nothing is pruned
+    if (gen_random_weight)
+        return 0;
+
+    int sparse_count = 0;
+    for (size_t i = 0; i < layer_count; i++)
+    {
+        if (layers[i]->type == "InnerProduct")
+        {
+            ncnn::InnerProduct* innerproduct = (ncnn::InnerProduct*)layers[i];
+            if (innerproduct->int8_scale_term || innerproduct->weight_data.elemsize != 4u || innerproduct->sparse_block_count)
+                continue;
+
+            const int num_output = innerproduct->num_output;
+            const int num_input = innerproduct->weight_data_size / num_output;
+
+            ncnn::Mat bitmap;
+            ncnn::Mat values;
+            int count = sparsify_weight(innerproduct->weight_data, num_output, num_input, min_zero_block_ratio, bitmap, values);
+            if (count == 0)
+                continue;
+
+            innerproduct->sparse_block_count = count;
+            innerproduct->weight_sparse_bitmap = bitmap;
+            innerproduct->weight_data = values;
+            sparse_count++;
+        }
+        else if (layers[i]->type == "Convolution")
+        {
+            // the sparse kernel is a plain 1x1 stride 1
+            ncnn::Convolution* convolution = (ncnn::Convolution*)layers[i];
+            if (convolution->kernel_w != 1 || convolution->kernel_h != 1 || convolution->stride_w != 1 || convolution->stride_h != 1
+                    || convolution->pad_left != 0 || convolution->pad_right != 0 || convolution->pad_top != 0 || convolution->pad_bottom != 0)
+                continue;
+
+            if (convolution->dynamic_weight || convolution->int8_scale_term || convolution->weight_data_type != 0 || convolution->weight_data.elemsize != 4u || convolution->sparse_block_count)
+                continue;
+
+            const int num_output = convolution->num_output;
+            const int num_input = convolution->weight_data_size / num_output;
+
+            ncnn::Mat bitmap;
+            ncnn::Mat values;
+            int count = sparsify_weight(convolution->weight_data, num_output, num_input, min_zero_block_ratio, bitmap, values);
+            if (count == 0)
+                continue;
+
+            convolution->sparse_block_count = count;
+            convolution->weight_sparse_bitmap = bitmap;
+            convolution->weight_data = values;
+            sparse_count++;
+        }
+    }
+
+    fprintf(stderr, "sparsify_weights: %d layers converted to 1x4 block sparse\n", sparse_count);
+
+    return 0;
+}
+
 int FlexnnSlice::transform_kernel_convolution(int max_data_size)
 {
     const size_t layer_count = layers.size();
@@ -915,6 +2155,14 @@ int FlexnnSlice::transform_kernel_convolution(int max_data_size)
         // decide slice size
         ncnn::Convolution* convolution = (ncnn::Convolution*)layers[i];
 
+        // int8 kernels pick their packed layout from the runtime elempack, keep the raw int8 weights
+        if (convolution->weight_data.elemsize == 1u)
+            continue;
+
+        // block sparse weights keep their own layout
+        if (convolution->sparse_block_count)
+            continue;
+
         int kernel_w = convolution->kernel_w;
         int kernel_h = convolution->kernel_h;
         int dilation_w = convolution->dilation_w;
@@ -928,6 +2176,26 @@ int FlexnnSlice::transform_kernel_convolution(int max_data_size)
         const flexnn::DummyMat in = blobs[bottom_blob_index].dummy_shape;
         const flexnn::DummyMat out = blobs[top_blob_index].dummy_shape;
 
+        // cheapest measured path that fits, the heuristics below are the fallback
+        if (!op_costs.empty())
+        {
+            std::vector<std::string> paths;
+            rank_convolution_paths(i, paths);
+
+            bool transformed = false;
+            for (size_t j = 0; j < paths.size() && !transformed; j++)
+            {
+                if (get_size_convolution(i, paths[j].c_str()) >= max_data_size)
+                    continue;
+
+                transformed = transform_kernel_convolution_path(i, paths[j].c_str()) == 0;
+                if (transformed)
+                    fprintf(stderr, "layer %ld %s transform kernel %s by cost table.\n", i, layers[i]->name.c_str(), paths[j].c_str());
+            }
+            if (transformed)
+                continue;
+        }
+
         // first try winograd
         if (kernel_w == 3 && kernel_h == 3 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1)
         {
@@ -1015,6 +2283,18 @@ int FlexnnSlice::transform_kernel_convolution(int max_data_size)
     return 0;
 }
 
+// layout tag of the kernels packed on this host, see Convolution::weight_layout
+static int transform_kernel_layout()
+{
+#if __aarch64__
+    return 3;
+#elif __ARM_NEON
+    return 2;
+#else
+    return 1;
+#endif
+}
+
 int FlexnnSlice::transform_kernel_convolution_im2col_gemm(int layer_index)
 {
     const size_t layer_count = layers.size();
@@ -1050,6 +2330,13 @@ int FlexnnSlice::transform_kernel_convolution_im2col_gemm(int layer_index)
     convolution->weight_w = weight_sgemm_data.w;
     convolution->weight_h = weight_sgemm_data.h;
     convolution->weight_c = weight_sgemm_data.c;
+    convolution->weight_d = 1;
+
+    int TILE_M, TILE_N, TILE_K;
+    ncnn::convolution_im2col_gemm_get_optimal_tile_mnk(convolution->num_output, 0, in.c * convolution->kernel_w * convolution->kernel_h, TILE_M, TILE_N, TILE_K, opt.num_threads);
+    convolution->weight_layout = transform_kernel_layout();
+    convolution->weight_tile_m = TILE_M;
+    convolution->weight_tile_k = TILE_K;
 
     return 0;
 }
@@ -1113,6 +2400,13 @@ int FlexnnSlice::transform_kernel_convolution_winograd63(int layer_index)
     convolution->weight_w = weight_winograd63_data.w;
     convolution->weight_h = weight_winograd63_data.h;
     convolution->weight_c = weight_winograd63_data.c;
+    convolution->weight_d = weight_winograd63_data.d;
+
+    int TILE_M, TILE_N, TILE_K;
+    ncnn::conv3x3s1_winograd_get_optimal_tile_mnk(convolution->num_output, 0, in.c, 64, TILE_M, TILE_N, TILE_K, opt.num_threads);
+    convolution->weight_layout = transform_kernel_layout();
+    convolution->weight_tile_m = TILE_M;
+    convolution->weight_tile_k = TILE_K;
 
     return 0;
 }
@@ -1170,6 +2464,13 @@ int FlexnnSlice::transform_kernel_convolution_winograd43(int layer_index)
     convolution->weight_w = weight_winograd43_data.w;
     convolution->weight_h = weight_winograd43_data.h;
     convolution->weight_c = weight_winograd43_data.c;
+    convolution->weight_d = weight_winograd43_data.d;
+
+    int TILE_M, TILE_N, TILE_K;
+    ncnn::conv3x3s1_winograd_get_optimal_tile_mnk(convolution->num_output, 0, in.c, 36, TILE_M, TILE_N, TILE_K, opt.num_threads);
+    convolution->weight_layout = transform_kernel_layout();
+    convolution->weight_tile_m = TILE_M;
+    convolution->weight_tile_k = TILE_K;
 
     return 0;
 }
@@ -1221,10 +2522,214 @@ int FlexnnSlice::transform_kernel_convolution_3x3s2(int layer_index)
     convolution->weight_w = weight_3x3s2_data.w;
     convolution->weight_h = weight_3x3s2_data.h;
     convolution->weight_c = weight_3x3s2_data.c;
+    convolution->weight_d = 1;
+
+    // groups of 8 output channels by 9 taps, the same on every host
+    convolution->weight_layout = transform_kernel_layout();
+    convolution->weight_tile_m = 8;
+    convolution->weight_tile_k = 9;
+
+    return 0;
+}
+
+int FlexnnSlice::transform_kernel_convolution_winograd23(int layer_index)
+{
+    if (layers[layer_index]->type != "Convolution")
+    {
+        fprintf(stderr, "Error: layer %d %s is not convolution\n", layer_index, layers[layer_index]->name.c_str());
+        return -1;
+    }
+
+    int top_blob_index = layers[layer_index]->tops[0];
+    int bottom_blob_index = layers[layer_index]->bottoms[0];
+
+    ncnn::Convolution* convolution = (ncnn::Convolution*)layers[layer_index];
+    int kernel_w = convolution->kernel_w;
+    int kernel_h = convolution->kernel_h;
+    int dilation_w = convolution->dilation_w;
+    int dilation_h = convolution->dilation_h;
+    int stride_w = convolution->stride_w;
+    int stride_h = convolution->stride_h;
+
+    if (!(kernel_w == 3 && kernel_h == 3 && dilation_w == 1 && dilation_h == 1 && stride_w == 1 && stride_h == 1))
+    {
+        return -1;
+    }
+
+    const flexnn::DummyMat in = blobs[bottom_blob_index].dummy_shape;
+    const flexnn::DummyMat out = blobs[top_blob_index].dummy_shape;
+
+    if (in.c < 8 || out.c < 8)
+    {
+        return -1;
+    }
+
+    ncnn::Mat weight_winograd23_data;
+    ncnn::Option opt;
+
+    ncnn::conv3x3s1_winograd23_transform_kernel(convolution->weight_data, weight_winograd23_data, in.c, convolution->num_output, opt);
+
+    convolution->weight_data_type = 5;
+    convolution->weight_data = weight_winograd23_data; // replace with transformed one
+    if (convolution->weight_data.empty())
+    {
+        fprintf(stderr, "Error: winograd23 layer %d %s weight data is empty\n", layer_index, layers[layer_index]->name.c_str());
+        return -1;
+    }
+    convolution->weight_w = weight_winograd23_data.w;
+    convolution->weight_h = weight_winograd23_data.h;
+    convolution->weight_c = weight_winograd23_data.c;
+    convolution->weight_d = weight_winograd23_data.d;
+
+    int TILE_M, TILE_N, TILE_K;
+    ncnn::conv3x3s1_winograd_get_optimal_tile_mnk(convolution->num_output, 0, in.c, 16, TILE_M, TILE_N, TILE_K, opt.num_threads);
+    convolution->weight_layout = transform_kernel_layout();
+    convolution->weight_tile_m = TILE_M;
+    convolution->weight_tile_k = TILE_K;
+
+    return 0;
+}
+
+int FlexnnSlice::transform_kernel_convolution_path(int layer_index, const char* path)
+{
+    if (strcmp(path, "none") == 0)
+        return 0;
+    if (strcmp(path, "im2col_gemm") == 0)
+        return transform_kernel_convolution_im2col_gemm(layer_index);
+    if (strcmp(path, "winograd63") == 0)
+        return transform_kernel_convolution_winograd63(layer_index);
+    if (strcmp(path, "winograd43") == 0)
+        return transform_kernel_convolution_winograd43(layer_index);
+    if (strcmp(path, "winograd23") == 0)
+        return transform_kernel_convolution_winograd23(layer_index);
+    if (strcmp(path, "3x3s2") == 0)
+        return transform_kernel_convolution_3x3s2(layer_index);
+
+    fprintf(stderr, "unknown kernel path %s\n", path);
+    return -1;
+}
+
+int FlexnnSlice::load_op_costs(const char* path)
+{
+    FILE* fp = fopen(path, "r");
+    if (!fp)
+    {
+        fprintf(stderr, "fopen %s failed\n", path);
+        return -1;
+    }
+
+    char line[512];
+    while (fgets(line, sizeof(line), fp) != NULL)
+    {
+        char cpu_isa[256];
+        if (sscanf(line, "# cpu_isa=%255s", cpu_isa) == 1 && strcmp(cpu_isa, ncnn::get_cpu_isa_signature()) != 0)
+            fprintf(stderr, "warning: op costs measured on %s, this cpu is %s, the path ranking may not hold on the target\n", cpu_isa, ncnn::get_cpu_isa_signature());
+        if (line[0] == '#') // comment
+            continue;
+        if (strncmp(line, "type,", 5) == 0) // first line
+            continue;
+
+        // type,path,kernel,stride,dilation,inch,outch,inh,inw,outh,outw,num_threads,weight_bytes,load_ms,forward_ms,release_ms
+        char type[64];
+        char kernel_path[64];
+        int inh, inw, num_threads;
+        long weight_bytes;
+        OpCost cost;
+        int ret = sscanf(line, "%63[^,],%63[^,],%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%ld,%lf,%lf,%lf", type, kernel_path, &cost.kernel, &cost.stride, &cost.dilation, &cost.inch, &cost.outch, &inh, &inw, &cost.outh, &cost.outw, &num_threads, &weight_bytes, &cost.load, &cost.forward, &cost.release);
+        if (ret != 16)
+        {
+            fprintf(stderr, "parse op cost failed: %s", line);
+            continue;
+        }
+
+        cost.type = type;
+        cost.path = kernel_path;
+        op_costs.push_back(cost);
+    }
+
+    fclose(fp);
+
+    fprintf(stderr, "read %d op costs\n", (int)op_costs.size());
+
+    return 0;
+}
+
+int FlexnnSlice::rank_convolution_paths(int layer_index, std::vector<std::string>& paths) const
+{
+    paths.clear();
+
+    const ncnn::Convolution* convolution = (const ncnn::Convolution*)layers[layer_index];
+    const flexnn::DummyMat in = blobs[layers[layer_index]->bottoms[0]].dummy_shape;
+    const flexnn::DummyMat out = blobs[layers[layer_index]->tops[0]].dummy_shape;
+
+    const double macs = (double)in.c * out.c * out.w * out.h * convolution->kernel_w * convolution->kernel_h;
+    const double weight_size = (double)in.c * out.c * convolution->kernel_w * convolution->kernel_h;
+
+    // the flexnn runtime only runs origin weights for the shapes the heuristics leave untransformed
+    const bool keep_origin = !is_convolution_always_transformed(layer_index);
+
+    // per path, the nearest measured shape of the same kernel
+    // load and release scaled by the weight size, forward by the mac count
+    std::map<std::string, std::pair<double, double> > nearest; // path -> (distance, estimated ms)
+    for (size_t i = 0; i < op_costs.size(); i++)
+    {
+        const OpCost& cost = op_costs[i];
+        if (cost.type != "Convolution" || cost.kernel != convolution->kernel_w || convolution->kernel_h != convolution->kernel_w
+                || cost.stride != convolution->stride_w || convolution->stride_h != convolution->stride_w
+                || cost.dilation != convolution->dilation_w || convolution->dilation_h != convolution->dilation_w)
+            continue;
+        if (cost.path == "none" && !keep_origin)
+            continue;
+
+        const double distance = fabs(log((double)in.c / cost.inch)) + fabs(log((double)out.c / cost.outch)) + fabs(log((double)out.w * out.h / (cost.outw * cost.outh)));
+        const double cost_weight_size = (double)cost.inch * cost.outch * cost.kernel * cost.kernel;
+        const double cost_macs = cost_weight_size * cost.outw * cost.outh;
+        const double estimate = (cost.load + cost.release) * weight_size / cost_weight_size + cost.forward * macs / cost_macs;
+
+        std::map<std::string, std::pair<double, double> >::iterator it = nearest.find(cost.path);
+        if (it == nearest.end() || distance < it->second.first)
+            nearest[cost.path] = std::make_pair(distance, estimate);
+    }
+
+    std::vector<std::pair<double, std::string> > ranked;
+    for (std::map<std::string, std::pair<double, double> >::iterator it = nearest.begin(); it != nearest.end(); it++)
+    {
+        ranked.push_back(std::make_pair(it->second.second, it->first));
+    }
+    std::sort(ranked.begin(), ranked.end());
+
+    for (size_t i = 0; i < ranked.size(); i++)
+    {
+        paths.push_back(ranked[i].second);
+    }
 
     return 0;
 }
 
+// mirrors the heuristics of transform_kernel, winograd 3x3s1, 3x3s2, 1x1 and the sgemm preferred shapes
+bool FlexnnSlice::is_convolution_always_transformed(int layer_index) const
+{
+    const ncnn::Convolution* convolution = (const ncnn::Convolution*)layers[layer_index];
+    const flexnn::DummyMat in = blobs[layers[layer_index]->bottoms[0]].dummy_shape;
+    const flexnn::DummyMat out = blobs[layers[layer_index]->tops[0]].dummy_shape;
+
+    const int kernel_w = convolution->kernel_w;
+    const int kernel_h = convolution->kernel_h;
+    const int dilation_w = convolution->dilation_w;
+    const int dilation_h = convolution->dilation_h;
+    const int stride_w = convolution->stride_w;
+    const int stride_h = convolution->stride_h;
+
+    if (kernel_w == 3 && kernel_h == 3 && dilation_w == 1 && dilation_h == 1 && ((stride_w == 1 && stride_h == 1) || (stride_w == 2 && stride_h == 2)))
+        return true;
+
+    if (kernel_w == 1 && kernel_h == 1)
+        return true;
+
+    int l2_cache_size_fp32 = ncnn::get_cpu_level2_cache_size() / sizeof(float);
+    return in.c * out.c * kernel_w * kernel_h * dilation_w * dilation_h * stride_w * stride_h * 2 > l2_cache_size_fp32 || (in.c > 16 || out.c > 16);
+}
+
 FlexnnSlice::FlexnnSlice()
     : ModelWriter()
 {
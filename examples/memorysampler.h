@@ -0,0 +1,383 @@
+#ifndef MEMORY_SAMPLER_H
+#define MEMORY_SAMPLER_H
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h> // Sleep()
+#endif
+
+#if defined(__linux__)
+#include <sys/mman.h> // mincore()
+#include <unistd.h>
+#endif
+
+// ncnn public header
+#include "platform.h"
+
+#include "flexnn_utils.h"
+
+// one reading of the process memory, kB, -1 if unknown
+class MemorySample
+{
+public:
+    double time; // ms
+    int phase;   // index into MemorySampler::phases
+    long rss;
+    long pss;
+    long uss;     // private clean + private dirty
+    long cgroup;  // memory usage of the cgroup, includes page cache
+    long planned; // resident part of the planned buffer
+};
+
+class MemorySummary
+{
+public:
+    MemorySummary()
+        : sample_count(0), peak_rss(-1), peak_pss(-1), peak_uss(-1), peak_cgroup(-1), peak_footprint(-1), peak_unplanned(-1), over_budget_count(0), over_budget_time(0), max_overshoot(0)
+    {
+    }
+
+    int sample_count;
+    long peak_rss;
+    long peak_pss;
+    long peak_uss;
+    long peak_cgroup;
+    long peak_footprint; // peak uss (rss if unknown) above the baseline
+    long peak_unplanned; // peak footprint outside the planned buffer
+    int over_budget_count;
+    double over_budget_time; // ms
+    long max_overshoot;
+};
+
+// samples /proc/self/smaps_rollup and the cgroup memory usage on a background thread, linux only
+// the footprint is measured from the baseline, resident pages outside the planned buffer are unplanned
+class MemorySampler
+{
+public:
+    MemorySampler()
+        : budget(-1), slack(1024), planned_buffer(0), planned_buffer_size(0), interval_us(0), running(false), phase(0), worker(0)
+    {
+        baseline.rss = -1;
+        baseline.uss = -1;
+#if defined(__linux__)
+        FILE* fp = fopen("/proc/self/cgroup", "r");
+        if (fp)
+        {
+            char line[512];
+            while (fgets(line, 512, fp) && cgroup_path.empty())
+            {
+                line[strcspn(line, "\n")] = '\0';
+
+                // "0::/path" for cgroup v2, "N:memory:/path" for the v1 memory controller
+                const char* v1 = strstr(line, ":memory:");
+                if (strncmp(line, "0::", 3) == 0)
+                    cgroup_path = std::string("/sys/fs/cgroup") + (line + 3) + "/memory.current";
+                else if (v1)
+                    cgroup_path = std::string("/sys/fs/cgroup/memory") + (v1 + 8) + "/memory.usage_in_bytes";
+
+                if (!cgroup_path.empty() && access(cgroup_path.c_str(), R_OK) != 0)
+                    cgroup_path.clear();
+            }
+            fclose(fp);
+        }
+#endif
+    }
+
+    ~MemorySampler()
+    {
+        stop();
+    }
+
+    // call before the net and the planned buffer are allocated
+    void set_baseline()
+    {
+        read(baseline);
+    }
+
+    void set_budget(long bytes)
+    {
+        budget = bytes;
+    }
+
+    // unplanned memory above slack kB is reported as escaped from the planned allocator
+    void set_slack(long kb)
+    {
+        slack = kb;
+    }
+
+    void set_planned_buffer(const void* ptr, size_t size)
+    {
+        planned_buffer = ptr;
+        planned_buffer_size = size;
+    }
+
+    int start(int _interval_us)
+    {
+        stop();
+
+        samples.clear();
+        phases.clear();
+        phases.push_back("start");
+        phase = 0;
+
+        interval_us = _interval_us;
+        running = true;
+        worker = new ncnn::Thread(sampler_worker, (void*)this);
+        return 0;
+    }
+
+    void stop()
+    {
+        if (!worker)
+            return;
+
+        lock.lock();
+        running = false;
+        lock.unlock();
+
+        worker->join();
+        delete worker;
+        worker = 0;
+    }
+
+    // tag the following samples, e.g. load and infer
+    void set_phase(const char* name)
+    {
+        // phases is only read by the sampling thread through the index
+        phases.push_back(name);
+
+        lock.lock();
+        phase = (int)phases.size() - 1;
+        lock.unlock();
+    }
+
+    void summarize(MemorySummary& summary) const
+    {
+        summary = MemorySummary();
+        summary.sample_count = (int)samples.size();
+
+        bool over = false;
+        for (size_t i = 0; i < samples.size(); i++)
+        {
+            const MemorySample& s = samples[i];
+            summary.peak_rss = std::max(summary.peak_rss, s.rss);
+            summary.peak_pss = std::max(summary.peak_pss, s.pss);
+            summary.peak_uss = std::max(summary.peak_uss, s.uss);
+            summary.peak_cgroup = std::max(summary.peak_cgroup, s.cgroup);
+
+            const long footprint = get_footprint(s);
+            summary.peak_footprint = std::max(summary.peak_footprint, footprint);
+            if (s.planned >= 0)
+                summary.peak_unplanned = std::max(summary.peak_unplanned, footprint - s.planned);
+
+            if (budget <= 0 || footprint < 0)
+                continue;
+
+            // contiguous samples over the budget are one excursion, lasting until the next sample under it
+            const long overshoot = footprint - budget / 1024;
+            if (overshoot > 0)
+            {
+                if (!over)
+                    summary.over_budget_count++;
+                summary.max_overshoot = std::max(summary.max_overshoot, overshoot);
+            }
+            if (over && i > 0)
+                summary.over_budget_time += s.time - samples[i - 1].time;
+            over = overshoot > 0;
+        }
+    }
+
+    void report(const char* comment) const
+    {
+        MemorySummary summary;
+        summarize(summary);
+
+        fprintf(stderr, "%20s  samples = %d  peak rss = %ld kB  pss = %ld kB  uss = %ld kB  cgroup = %ld kB  footprint = %ld kB  unplanned = %ld kB\n", comment, summary.sample_count, summary.peak_rss, summary.peak_pss, summary.peak_uss, summary.peak_cgroup, summary.peak_footprint, summary.peak_unplanned);
+
+        if (budget > 0)
+        {
+            fprintf(stderr, "%20s  budget = %ld kB  over budget %d times for %.2f ms, max overshoot = %ld kB\n", comment, budget / 1024, summary.over_budget_count, summary.over_budget_time, summary.max_overshoot);
+        }
+
+        if (planned_buffer && summary.peak_unplanned > slack)
+        {
+            // the phase where the unplanned memory peaked
+            const MemorySample* peak = 0;
+            for (size_t i = 0; i < samples.size(); i++)
+            {
+                if (samples[i].planned >= 0 && (!peak || get_footprint(samples[i]) - samples[i].planned > get_footprint(*peak) - peak->planned))
+                    peak = &samples[i];
+            }
+
+            fprintf(stderr, "%20s  warning: %ld kB resident outside the planned buffer, peaked during %s\n", comment, summary.peak_unplanned, phases[peak->phase].c_str());
+        }
+    }
+
+    // append the samples as csv, with a header if the file is new
+    int save(const char* path, const char* comment) const
+    {
+        FILE* fp = fopen(path, "a");
+        if (!fp)
+        {
+            fprintf(stderr, "fopen %s failed\n", path);
+            return -1;
+        }
+
+        fseek(fp, 0, SEEK_END);
+        if (ftell(fp) == 0)
+            fprintf(fp, "comment,phase,time_ms,rss_kb,pss_kb,uss_kb,cgroup_kb,planned_kb,footprint_kb\n");
+
+        const double t0 = samples.empty() ? 0 : samples[0].time;
+        for (size_t i = 0; i < samples.size(); i++)
+        {
+            const MemorySample& s = samples[i];
+            fprintf(fp, "%s,%s,%.3f,%ld,%ld,%ld,%ld,%ld,%ld\n", comment, phases[s.phase].c_str(), s.time - t0, s.rss, s.pss, s.uss, s.cgroup, s.planned, get_footprint(s));
+        }
+
+        fclose(fp);
+        return 0;
+    }
+
+public:
+    std::vector<MemorySample> samples;
+    std::vector<std::string> phases;
+
+private:
+    long get_footprint(const MemorySample& s) const
+    {
+        if (s.uss >= 0 && baseline.uss >= 0)
+            return s.uss - baseline.uss;
+        if (s.rss >= 0 && baseline.rss >= 0)
+            return s.rss - baseline.rss;
+        return -1;
+    }
+
+    static void* sampler_worker(void* args)
+    {
+        MemorySampler* sampler = (MemorySampler*)args;
+
+        while (true)
+        {
+            sampler->lock.lock();
+            const bool keep_running = sampler->running;
+            sampler->lock.unlock();
+            if (!keep_running)
+                break;
+
+            MemorySample s;
+            sampler->read(s);
+            sampler->samples.push_back(s);
+
+#ifdef _WIN32
+            Sleep(sampler->interval_us / 1000);
+#else
+            struct timespec ts;
+            ts.tv_sec = sampler->interval_us / 1000000;
+            ts.tv_nsec = (sampler->interval_us % 1000000) * 1000;
+            nanosleep(&ts, &ts);
+#endif
+        }
+
+        return 0;
+    }
+
+    void read(MemorySample& s) const
+    {
+        s.time = flexnn::get_current_time();
+        lock.lock();
+        s.phase = phase;
+        lock.unlock();
+        s.rss = -1;
+        s.pss = -1;
+        s.uss = -1;
+        s.cgroup = -1;
+        s.planned = -1;
+
+#if defined(__linux__)
+        FILE* fp = fopen("/proc/self/smaps_rollup", "r");
+        if (fp)
+        {
+            long private_clean = -1;
+            long private_dirty = -1;
+            char line[256];
+            while (fgets(line, 256, fp))
+            {
+                sscanf(line, "Rss: %ld kB", &s.rss);
+                sscanf(line, "Pss: %ld kB", &s.pss);
+                sscanf(line, "Private_Clean: %ld kB", &private_clean);
+                sscanf(line, "Private_Dirty: %ld kB", &private_dirty);
+            }
+            fclose(fp);
+
+            if (private_clean >= 0 && private_dirty >= 0)
+                s.uss = private_clean + private_dirty;
+        }
+        else
+        {
+            // before linux 4.14, rss only
+            fp = fopen("/proc/self/statm", "r");
+            if (fp)
+            {
+                long size = 0;
+                long resident = 0;
+                if (fscanf(fp, "%ld %ld", &size, &resident) == 2)
+                    s.rss = resident * (sysconf(_SC_PAGESIZE) / 1024);
+                fclose(fp);
+            }
+        }
+
+        if (!cgroup_path.empty())
+        {
+            fp = fopen(cgroup_path.c_str(), "r");
+            if (fp)
+            {
+                long long bytes = 0;
+                if (fscanf(fp, "%lld", &bytes) == 1)
+                    s.cgroup = (long)(bytes / 1024);
+                fclose(fp);
+            }
+        }
+
+        if (planned_buffer && planned_buffer_size > 0)
+        {
+            const size_t page_size = sysconf(_SC_PAGESIZE);
+            const size_t begin = (size_t)planned_buffer / page_size * page_size;
+            const size_t end = (size_t)planned_buffer + planned_buffer_size;
+            const size_t pages = (end - begin + page_size - 1) / page_size;
+
+            std::vector<unsigned char> residency(pages);
+            if (mincore((void*)begin, end - begin, residency.data()) == 0)
+            {
+                size_t resident = 0;
+                for (size_t i = 0; i < pages; i++)
+                {
+                    resident += residency[i] & 1;
+                }
+                s.planned = (long)(resident * (page_size / 1024));
+            }
+        }
+#endif
+    }
+
+private:
+    MemorySample baseline;
+    long budget; // bytes
+    long slack;  // kB
+    const void* planned_buffer;
+    size_t planned_buffer_size;
+    std::string cgroup_path;
+
+    int interval_us;
+    bool running; // guarded by lock
+    int phase;    // guarded by lock
+    mutable ncnn::Mutex lock;
+    ncnn::Thread* worker;
+};
+
+#endif // MEMORY_SAMPLER_H
@@ -41,6 +41,7 @@
 #include "layer/convolution1d.h"
 #include "layer/convolution3d.h"
 #include "layer/convolutiondepthwise.h"
+#include "layer/convolutiondepthwisepointwise.h"
 #include "layer/convolutiondepthwise1d.h"
 #include "layer/convolutiondepthwise3d.h"
 #include "layer/copyto.h"
@@ -75,6 +76,7 @@
 #include "layer/instancenorm.h"
 #include "layer/interp.h"
 #include "layer/layernorm.h"
+#include "layer/lazygather.h"
 #include "layer/log.h"
 #include "layer/lrn.h"
 #include "layer/lstm.h"
@@ -254,6 +256,7 @@ public:
     int fwrite_weight_tag_data_no_flatten(const ncnn::Mat& data, FILE* bp, float a = -1.2f, float b = 1.2f);
     int fwrite_weight_data(const ncnn::Mat& data, FILE* bp, float a = -1.2f, float b = 1.2f);
     int fwrite_weight_data_no_flatten(const ncnn::Mat& data, FILE* bp, float a = -1.2f, float b = 1.2f);
+    int fwrite_weight_bits(const ncnn::Mat& data, FILE* bp);
 
     int save(const char* parampath, const char* binpath);
 };
@@ -779,6 +782,14 @@ int ModelWriter::fwrite_weight_data_no_flatten(const ncnn::Mat& data, FILE* bp,
     return 0;
 }
 
+// raw 32-bit words such as the block sparse bitmap, never randomized or denormal flushed
+int ModelWriter::fwrite_weight_bits(const ncnn::Mat& data, FILE* bp)
+{
+    fwrite(data.data, 4, data.total() * data.elemsize / 4, bp);
+
+    return 0;
+}
+
 int ModelWriter::save(const char* parampath, const char* binpath)
 {
     uint64_t mac = 0;
@@ -979,6 +990,7 @@ int ModelWriter::save(const char* parampath, const char* binpath)
                 if (!op->activation_params.empty()) fprintf_param_float_array(10, op->activation_params, pp);
             }
             fprintf_param_value(" 19=%d", dynamic_weight)
+                fprintf_param_value(" 20=%d", sparse_block_count)
             {
                 if (op->weight_data_type != op_default->weight_data_type)
                 {
@@ -986,11 +998,24 @@ int ModelWriter::save(const char* parampath, const char* binpath)
                     fprintf(pp, " 26=%d", op->weight_w);
                     fprintf(pp, " 27=%d", op->weight_h);
                     fprintf(pp, " 28=%d", op->weight_c);
+                    if (op->weight_d != 1)
+                        fprintf(pp, " 29=%d", op->weight_d);
+                }
+                if (op->weight_layout != op_default->weight_layout)
+                {
+                    fprintf(pp, " 30=%d", op->weight_layout);
+                    fprintf(pp, " -%d=2,%d,%d", 23300 + 31, op->weight_tile_m, op->weight_tile_k);
                 }
             }
 
             {
-                if (op->weight_data_type == 0)
+                if (op->sparse_block_count)
+                {
+                    fwrite_weight_bits(op->weight_sparse_bitmap, bp);
+                    fwrite_weight_tag_data(op->weight_data, bp);
+                    fwrite_weight_data(op->bias_data, bp);
+                }
+                else if (op->weight_data_type == 0)
                 {
                     fwrite_weight_tag_data(op->weight_data, bp);
                     fwrite_weight_data(op->bias_data, bp);
@@ -1831,6 +1856,13 @@ int ModelWriter::save(const char* parampath, const char* binpath)
                                                                         fprintf_param_value(" 20=%d", constant_TILE_M)
                                                                             fprintf_param_value(" 21=%d", constant_TILE_N)
                                                                                 fprintf_param_value(" 22=%d", constant_TILE_K)
+
+            if (op->constantA == 1)
+                fwrite_weight_tag_data(op->A_data, bp);
+            if (op->constantB == 1)
+                fwrite_weight_tag_data(op->B_data, bp);
+            if (op->constantC == 1 && op->constant_broadcast_type_C != -1)
+                fwrite_weight_tag_data(op->C_data, bp);
         }
         else if (layer->type == "GLU")
         {
@@ -1903,7 +1935,10 @@ int ModelWriter::save(const char* parampath, const char* binpath)
             {
                 if (!op->activation_params.empty()) fprintf_param_float_array(10, op->activation_params, pp);
             }
+            fprintf_param_value(" 20=%d", sparse_block_count)
 
+            if (op->sparse_block_count)
+                fwrite_weight_bits(op->weight_sparse_bitmap, bp);
             fwrite_weight_tag_data(op->weight_data, bp);
             fwrite_weight_data(op->bias_data, bp);
 
@@ -2018,6 +2053,71 @@ int ModelWriter::save(const char* parampath, const char* binpath)
 
             fprintf_param_value(" 0=%d", transB)
         }
+        else if (layer->type == "ConvolutionDepthWisePointWise")
+        {
+            ncnn::ConvolutionDepthWisePointWise* op = (ncnn::ConvolutionDepthWisePointWise*)layer;
+            ncnn::ConvolutionDepthWisePointWise* op_default = (ncnn::ConvolutionDepthWisePointWise*)layer_default;
+
+            fprintf_param_value(" 0=%d", channels)
+                fprintf_param_value(" 1=%d", kernel_w)
+            {
+                if (op->kernel_h != op->kernel_w) fprintf(pp, " 11=%d", op->kernel_h);
+            }
+            fprintf_param_value(" 2=%d", dilation_w)
+            {
+                if (op->dilation_h != op->dilation_w) fprintf(pp, " 12=%d", op->dilation_h);
+            }
+            fprintf_param_value(" 3=%d", stride_w)
+            {
+                if (op->stride_h != op->stride_w) fprintf(pp, " 13=%d", op->stride_h);
+            }
+            fprintf_param_value(" 4=%d", pad_left)
+            {
+                if (op->pad_top != op->pad_left) fprintf(pp, " 14=%d", op->pad_top);
+            }
+            {
+                if (op->pad_right != op->pad_left) fprintf(pp, " 15=%d", op->pad_right);
+            }
+            {
+                if (op->pad_bottom != op->pad_top) fprintf(pp, " 16=%d", op->pad_bottom);
+            }
+            fprintf_param_value(" 5=%d", dw_bias_term)
+                fprintf_param_value(" 6=%d", dw_weight_data_size)
+                    fprintf_param_value(" 9=%d", dw_activation_type)
+            {
+                if (!op->dw_activation_params.empty()) fprintf_param_float_array(10, op->dw_activation_params, pp);
+            }
+            fprintf_param_value(" 20=%d", num_output)
+                fprintf_param_value(" 21=%d", bias_term)
+                    fprintf_param_value(" 22=%d", weight_data_size)
+                        fprintf_param_value(" 23=%d", activation_type)
+            {
+                if (!op->activation_params.empty()) fprintf_param_float_array(24, op->activation_params, pp);
+            }
+
+            fwrite_weight_tag_data(op->dw_weight_data, bp);
+            fwrite_weight_data(op->dw_bias_data, bp);
+            fwrite_weight_tag_data(op->weight_data, bp);
+            fwrite_weight_data(op->bias_data, bp);
+
+            if (shape_ready)
+            {
+                int outw = blobs[layer->tops[0]].shape.w;
+                int outh = blobs[layer->tops[0]].shape.h;
+                int outc = blobs[layer->tops[0]].shape.c;
+
+                mac += (uint64_t)(op->kernel_h * op->kernel_w + outc) * outw * outh * op->channels;
+            }
+        }
+        else if (layer->type == "LazyGather")
+        {
+            ncnn::LazyGather* op = (ncnn::LazyGather*)layer;
+            ncnn::LazyGather* op_default = (ncnn::LazyGather*)layer_default;
+
+            fprintf_param_value(" 0=%d", n_embd)
+                fprintf_param_value(" 1=%d", n_rows)
+                    fwrite_weight_data(op->weight_data, bp);
+        }
         else if (layer->type == "MemoryData")
         {
             ncnn::MemoryData* op = (ncnn::MemoryData*)layer;
@@ -2039,8 +2139,9 @@ int ModelWriter::save(const char* parampath, const char* binpath)
                     fprintf_param_value(" 2=%d", weight_data_size)
                         fprintf_param_value(" 3=%d", kdim)
                             fprintf_param_value(" 4=%d", vdim)
+                                fprintf_param_value(" 7=%d", kv_cache)
 
-                                fwrite_weight_tag_data(op->q_weight_data, bp);
+                                    fwrite_weight_tag_data(op->q_weight_data, bp);
             fwrite_weight_data(op->q_bias_data, bp);
             fwrite_weight_tag_data(op->k_weight_data, bp);
             fwrite_weight_data(op->k_bias_data, bp);
@@ -1198,6 +1198,82 @@ int cpu_riscv_vlenb()
 #endif
 }
 
+static char g_cpu_isa_signature[256] = {0};
+
+static void append_cpu_isa(const char* isa)
+{
+    if (g_cpu_isa_signature[0] != '\0')
+        strcat(g_cpu_isa_signature, ",");
+    strcat(g_cpu_isa_signature, isa);
+}
+
+static int init_cpu_isa_signature()
+{
+    // baseline of the build
+#if __aarch64__
+    append_cpu_isa("asimd");
+#elif __ARM_NEON
+    append_cpu_isa("neon");
+#elif __SSE2__
+    append_cpu_isa("sse2");
+#elif __riscv
+    append_cpu_isa("riscv");
+#else
+    append_cpu_isa("generic");
+#endif
+
+    // runtime dispatched variants, same order as the layer registries and the arm *_isa.cpp sources
+#if NCNN_AVX
+    if (cpu_support_x86_avx())
+        append_cpu_isa("avx");
+#endif
+#if NCNN_FMA
+    if (cpu_support_x86_fma())
+        append_cpu_isa("fma");
+#endif
+#if NCNN_AVX512
+    if (cpu_support_x86_avx512())
+        append_cpu_isa("avx512");
+#endif
+#if NCNN_VFPV4
+    if (cpu_support_arm_vfpv4())
+        append_cpu_isa("vfpv4");
+#endif
+#if NCNN_ARM82
+    if (cpu_support_arm_asimdhp())
+        append_cpu_isa("asimdhp");
+#endif
+#if NCNN_ARM82DOT
+    if (cpu_support_arm_asimddp())
+        append_cpu_isa("asimddp");
+#endif
+#if NCNN_ARM82FP16FML
+    if (cpu_support_arm_asimdfhm())
+        append_cpu_isa("asimdfhm");
+#endif
+#if NCNN_ARM84BF16
+    if (cpu_support_arm_bf16())
+        append_cpu_isa("bf16");
+#endif
+#if NCNN_ARM84I8MM
+    if (cpu_support_arm_i8mm())
+        append_cpu_isa("i8mm");
+#endif
+#if NCNN_RVV
+    if (cpu_support_riscv_v())
+        append_cpu_isa("rvv");
+#endif
+
+    return 0;
+}
+
+static int g_cpu_isa_signature_initialized = init_cpu_isa_signature();
+
+const char* get_cpu_isa_signature()
+{
+    return g_cpu_isa_signature;
+}
+
 static int get_cpucount()
 {
     int count = 0;
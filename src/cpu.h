@@ -117,6 +117,10 @@ NCNN_EXPORT int cpu_support_riscv_zfh();
 // vlenb = riscv vector length in bytes
 NCNN_EXPORT int cpu_riscv_vlenb();
 
+// comma separated isa variants this binary can dispatch to on the current cpu
+// e.g. "asimd,asimdhp,asimddp" or "sse2,avx,fma,avx512"
+NCNN_EXPORT const char* get_cpu_isa_signature();
+
 // cpu info
 NCNN_EXPORT int get_cpu_count();
 NCNN_EXPORT int get_little_cpu_count();
@@ -48,6 +48,11 @@ int DataReader::seek(size_t /*offset*/) const
     return 0;
 }
 
+int DataReader::tell(int* /*fd*/, size_t* /*offset*/) const
+{
+    return 0;
+}
+
 #if NCNN_STDIO
 class DataReaderFromStdioPrivate
 {
@@ -105,6 +110,21 @@ int DataReaderFromStdio::seek(size_t offset) const
     // return ret;
     return (fseek(d->fp, offset, SEEK_CUR) == 0) ? 1 : 0;
 }
+
+int DataReaderFromStdio::tell(int* fd, size_t* offset) const
+{
+#if defined(__unix__) || defined(__APPLE__)
+    long pos = ftell(d->fp);
+    if (pos < 0)
+        return 0;
+
+    *fd = fileno(d->fp);
+    *offset = (size_t)pos;
+    return 1;
+#else
+    return 0;
+#endif
+}
 #endif // NCNN_STDIO
 
 class DataReaderFromMemoryPrivate
@@ -52,6 +52,10 @@ public:
     // set stream to current + offset
     // return 1 if success
     virtual int seek(size_t offset) const;
+
+    // get file descriptor and current stream offset for positioned reads
+    // return 1 if success
+    virtual int tell(int* fd, size_t* offset) const;
 };
 
 #if NCNN_STDIO
@@ -67,6 +71,7 @@ public:
 #endif // NCNN_STRING
     virtual size_t read(void* buf, size_t size) const;
     virtual int seek(size_t offset) const;
+    virtual int tell(int* fd, size_t* offset) const;
 
 private:
     DataReaderFromStdio(const DataReaderFromStdio&);
@@ -371,4 +371,16 @@ void copy_make_border(const flexnn::DummyMat& src, DummyMat& dst, int top, int b
     delete padding;
 }
 
-} // namespace flexnn
\ No newline at end of file
+void cast_storage(const DummyMat& src, DummyMat& dst, size_t elemsize, const ncnn::Option& opt)
+{
+    if (src.dims == 1)
+        dst.create(src.w, elemsize, opt.blob_allocator);
+    else if (src.dims == 2)
+        dst.create(src.w, src.h, elemsize, opt.blob_allocator);
+    else if (src.dims == 3)
+        dst.create(src.w, src.h, src.c, elemsize, opt.blob_allocator);
+    else if (src.dims == 4)
+        dst.create(src.w, src.h, src.d, src.c, elemsize, opt.blob_allocator);
+}
+
+} // namespace flexnn
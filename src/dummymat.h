@@ -68,6 +68,9 @@ public:
 
 void copy_make_border(const flexnn::DummyMat& src, DummyMat& dst, int top, int bottom, int left, int right, int type, float v, const ncnn::Option& opt);
 
+// storage type conversion, e.g. fp32 <-> fp16/bf16, only the element size changes
+void cast_storage(const DummyMat& src, DummyMat& dst, size_t elemsize, const ncnn::Option& opt);
+
 } // namespace flexnn
 
 #endif // DUMMY_MAT_H
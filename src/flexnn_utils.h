@@ -10,6 +10,7 @@
 #include <windows.h>
 #else // _WIN32
 #include <sys/time.h>
+#include <time.h>
 #endif // _WIN32
 
 namespace flexnn {
@@ -34,7 +35,17 @@ static double get_current_time()
     QueryPerformanceCounter(&pc);
 
     return pc.QuadPart * 1000.0 / freq.QuadPart;
-#else  // _WIN32
+#elif defined(CLOCK_MONOTONIC_RAW) || defined(CLOCK_MONOTONIC)
+    // monotonic with ns resolution, not slewed by ntp, only differences are meaningful
+    struct timespec ts;
+#if defined(CLOCK_MONOTONIC_RAW)
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+#else
     struct timeval tv;
     gettimeofday(&tv, NULL);
 
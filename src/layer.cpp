@@ -37,6 +37,68 @@
 
 namespace ncnn {
 
+WeightChunks::WeightChunks()
+{
+    chunk_count = 0;
+    chunk_ready = 0;
+    chunk_failed = false;
+}
+
+void WeightChunks::begin(int count)
+{
+    lock.lock();
+    chunk_count = count;
+    chunk_ready = 0;
+    chunk_failed = false;
+    lock.unlock();
+}
+
+void WeightChunks::publish(int ready)
+{
+    lock.lock();
+    chunk_ready = ready;
+    condition.broadcast();
+    lock.unlock();
+}
+
+void WeightChunks::fail()
+{
+    lock.lock();
+    chunk_failed = true;
+    condition.broadcast();
+    lock.unlock();
+}
+
+int WeightChunks::wait(int i) const
+{
+    lock.lock();
+    while (chunk_count > 0 && chunk_ready <= i && !chunk_failed)
+    {
+        condition.wait(lock);
+    }
+    int ret = chunk_failed ? -1 : 0;
+    lock.unlock();
+    return ret;
+}
+
+int WeightChunks::count() const
+{
+    lock.lock();
+    int count = chunk_count;
+    lock.unlock();
+    return count;
+}
+
+void WeightChunks::reset()
+{
+    lock.lock();
+    chunk_count = 0;
+    chunk_ready = 0;
+    chunk_failed = false;
+    condition.broadcast();
+    lock.unlock();
+}
+
 Layer::Layer()
 {
     one_blob_only = false;
@@ -50,6 +112,8 @@ Layer::Layer()
     support_image_storage = false;
     support_tensor_storage = false;
 
+    support_weight_chunks = false;
+
     support_reserved_00 = false;
 
     typeindex = -1;
@@ -80,6 +144,19 @@ int Layer::load_model(const ModelBin& /*mb*/, const Option& /*opt*/)
     return 0;
 }
 
+int Layer::load_model_chunked_begin(const ModelBin& mb, const Option& opt)
+{
+    if (load_model(mb, opt) != 0)
+        return -1;
+
+    return 0;
+}
+
+int Layer::load_model_chunk(const ModelBin& /*mb*/, int /*i*/, const Option& /*opt*/)
+{
+    return 0;
+}
+
 int Layer::release_model()
 {
     return 0;
@@ -337,4 +414,103 @@ Layer* create_layer(int index)
     return layer;
 }
 
+#if NCNN_RUNTIME_CPU && (NCNN_AVX512 || NCNN_FMA || NCNN_AVX)
+// the registry of a tier has its own creator only for layers with an arch variant
+static bool has_layer_variant(const layer_registry_entry* registry, int index)
+{
+    if (index < 0 || index >= layer_registry_entry_count)
+        return false;
+
+    return registry[index].creator != layer_registry[index].creator;
+}
+#endif
+
+const char* get_layer_isa(const Layer* layer, const Option& opt)
+{
+    // clang-format off
+    // *INDENT-OFF*
+
+    // x86 picks one layer registry for the whole net, see create_layer
+    // layers without a variant run the base code from every registry
+#if NCNN_RUNTIME_CPU && NCNN_AVX512
+    if (ncnn::cpu_support_x86_avx512())
+    {
+        if (has_layer_variant(layer_registry_avx512, layer->typeindex))
+            return "avx512";
+    }
+    else
+#endif
+#if NCNN_RUNTIME_CPU && NCNN_FMA
+    if (ncnn::cpu_support_x86_fma())
+    {
+        if (has_layer_variant(layer_registry_fma, layer->typeindex))
+            return "fma";
+    }
+    else
+#endif
+#if NCNN_RUNTIME_CPU && NCNN_AVX
+    if (ncnn::cpu_support_x86_avx())
+    {
+        if (has_layer_variant(layer_registry_avx, layer->typeindex))
+            return "avx";
+    }
+    else
+#endif
+    {
+    }
+
+    // arm dispatches inside the layer by storage type, mirror the conditions of the arm layers
+#if __ARM_NEON
+#if NCNN_INT8
+    if (opt.use_int8_inference && layer->support_int8_storage)
+    {
+#if NCNN_ARM84I8MM
+        if (ncnn::cpu_support_arm_i8mm())
+            return "i8mm";
+#endif
+#if NCNN_ARM82DOT
+        if (ncnn::cpu_support_arm_asimddp())
+            return "asimddp";
+#endif
+    }
+#endif // NCNN_INT8
+#if NCNN_ARM82
+    if (opt.use_fp16_storage && layer->support_fp16_storage && ncnn::cpu_support_arm_asimdhp())
+    {
+#if NCNN_ARM82FP16FML
+        if (!opt.use_fp16_arithmetic && ncnn::cpu_support_arm_asimdfhm())
+            return "asimdfhm";
+#endif
+        return "asimdhp";
+    }
+#endif
+#if NCNN_BF16
+    if (opt.use_bf16_storage && layer->support_bf16_storage)
+    {
+#if NCNN_ARM84BF16
+        if (ncnn::cpu_support_arm_bf16())
+            return "bf16";
+#endif
+        return "bf16s";
+    }
+#endif
+#else
+    (void)layer;
+    (void)opt;
+#endif // __ARM_NEON
+
+    // *INDENT-ON*
+    // clang-format on
+
+#if __aarch64__
+    return "asimd";
+#elif __ARM_NEON
+    return "neon";
+#elif __SSE2__
+    return "sse2";
+#else
+    return "generic";
+#endif
+}
+
 } // namespace ncnn
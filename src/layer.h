@@ -34,6 +34,36 @@
 
 namespace ncnn {
 
+// readiness of the weight chunks of a layer that is still being loaded
+// the loader publishes chunks in order while forward waits for the ones it needs
+class NCNN_EXPORT WeightChunks
+{
+public:
+    WeightChunks();
+
+    // start a new round of count chunks, none of them ready
+    void begin(int count);
+    // mark chunks [0, ready) as loaded, ready == count + 1 includes the tail
+    void publish(int ready);
+    // loading failed, wake up the waiters
+    void fail();
+    // block until chunk i is loaded, i == count waits for the tail
+    // return immediately if the layer is not loading in chunks
+    // return 0 if success, -1 if loading failed
+    int wait(int i) const;
+    // number of chunks of the current round, 0 if the layer is fully loaded
+    int count() const;
+    // back to fully loaded state
+    void reset();
+
+private:
+    mutable Mutex lock;
+    mutable ConditionVariable condition;
+    int chunk_count;
+    int chunk_ready;
+    bool chunk_failed;
+};
+
 class NCNN_EXPORT Layer
 {
 public:
@@ -54,6 +84,14 @@ public:
     // return 0 if success
     virtual int load_model(const ModelBin& mb, const Option& opt);
 
+    // begin loading weight data in chunks so that forward can overlap with loading
+    // return the number of chunks still to be loaded by load_model_chunk, 0 if already complete, negative on error
+    virtual int load_model_chunked_begin(const ModelBin& mb, const Option& opt);
+
+    // load chunk i in order, i == chunk count loads the remaining tail weights
+    // return 0 if success
+    virtual int load_model_chunk(const ModelBin& mb, int i, const Option& opt);
+
     // release layer specific weight data
     // return 0 if success
     virtual int release_model();
@@ -94,6 +132,9 @@ public:
     // shader tensor storage
     bool support_tensor_storage;
 
+    // forward can run while weights are loaded in chunks, see weight_chunks
+    bool support_weight_chunks;
+
     bool support_reserved_00;
 
     bool support_reserved_0;
@@ -183,6 +224,8 @@ public:
     // shape hint with dummy
     std::vector<flexnn::DummyMat> bottom_dummy_shapes;
     std::vector<flexnn::DummyMat> top_dummy_shapes;
+    // chunk readiness while loading with load_model_chunked_begin
+    WeightChunks weight_chunks;
 };
 
 // layer factory function
@@ -220,6 +263,9 @@ NCNN_EXPORT Layer* create_layer(const char* type);
 // create layer from layer type
 NCNN_EXPORT Layer* create_layer(int index);
 
+// isa variant the runtime cpu dispatch runs this layer with under opt, e.g. "asimdhp" or "avx512"
+NCNN_EXPORT const char* get_layer_isa(const Layer* layer, const Option& opt);
+
 #define DEFINE_LAYER_CREATOR(name)                          \
     ::ncnn::Layer* name##_layer_creator(void* /*userdata*/) \
     {                                                       \
@@ -40,6 +40,33 @@ Convolution1D_arm::Convolution1D_arm()
 #endif
 }
 
+int Convolution1D_arm::release_model()
+{
+    if (!weight_data_packed.empty())
+    {
+        weight_data_packed.release();
+    }
+
+    if (!weight_data_fp16.empty())
+    {
+        weight_data_fp16.release();
+    }
+
+    if (!bias_data_fp16.empty())
+    {
+        bias_data_fp16.release();
+    }
+
+#if NCNN_BF16
+    if (!weight_data_bf16.empty())
+    {
+        weight_data_bf16.release();
+    }
+#endif
+
+    return Convolution1D::release_model();
+}
+
 int Convolution1D_arm::create_pipeline(const Option& opt)
 {
     if (dynamic_weight)
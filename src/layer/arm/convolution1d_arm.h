@@ -24,6 +24,8 @@ class Convolution1D_arm : virtual public Convolution1D
 public:
     Convolution1D_arm();
 
+    virtual int release_model();
+
     virtual int create_pipeline(const Option& opt);
     virtual int destroy_pipeline(const Option& opt);
 
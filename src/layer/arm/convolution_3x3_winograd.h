@@ -3302,6 +3302,8 @@ static void conv3x3s1_winograd_gemm_transB_packed_tile(const Mat& AT_tile, const
 
 static void conv3x3s1_winograd_get_optimal_tile_mnk(int M, int N, int K, int B, int& TILE_M, int& TILE_N, int& TILE_K, int nT)
 {
+    (void)nT;
+
     // resolve optimal tile size from cache size
     const int l2_cache_size_fp32 = (int)(get_cpu_level2_cache_size() / sizeof(float));
 
@@ -3349,7 +3351,10 @@ static void conv3x3s1_winograd_get_optimal_tile_mnk(int M, int N, int K, int B,
     }
 
     {
-        TILE_M *= std::min(nT, get_physical_cpu_count());
+        // the packed weights follow TILE_M and TILE_K, size them for all physical cores instead of nT
+        // so that weights packed once stay valid for any num_threads
+        const int layout_nT = get_physical_cpu_count();
+        TILE_M *= layout_nT;
 
         int nn_M = (M + TILE_M - 1) / TILE_M;
 #if __aarch64__
@@ -3360,14 +3365,14 @@ static void conv3x3s1_winograd_get_optimal_tile_mnk(int M, int N, int K, int B,
         TILE_M = std::min(TILE_M, ((M + nn_M - 1) / nn_M + 1) / 2 * 2);
 #endif
 
-        if (nT > 1)
+        if (layout_nT > 1)
         {
 #if __aarch64__
-            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / nT) + 7) / 8 * 8);
+            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / layout_nT) + 7) / 8 * 8);
 #elif __ARM_NEON
-            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / nT) + 3) / 4 * 4);
+            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / layout_nT) + 3) / 4 * 4);
 #else
-            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / nT) + 1) / 2 * 2);
+            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / layout_nT) + 1) / 2 * 2);
 #endif
         }
 
@@ -1693,6 +1693,8 @@ static void conv3x3s1_winograd_gemm_transB_packed_tile_fp16sa(const Mat& AT_tile
 
 static void conv3x3s1_winograd_get_optimal_tile_mnk_fp16(int M, int N, int K, int B, int& TILE_M, int& TILE_N, int& TILE_K, int nT)
 {
+    (void)nT;
+
     // resolve optimal tile size from cache size
     const int l2_cache_size_fp16 = (int)(get_cpu_level2_cache_size() / sizeof(unsigned short));
 
@@ -1716,14 +1718,16 @@ static void conv3x3s1_winograd_get_optimal_tile_mnk_fp16(int M, int N, int K, in
     }
 
     {
-        TILE_M *= std::min(nT, get_physical_cpu_count());
+        // packed layout, independent of nT
+        const int layout_nT = get_physical_cpu_count();
+        TILE_M *= layout_nT;
 
         int nn_M = (M + TILE_M - 1) / TILE_M;
         TILE_M = std::min(TILE_M, ((M + nn_M - 1) / nn_M + 7) / 8 * 8);
 
-        if (nT > 1)
+        if (layout_nT > 1)
         {
-            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / nT) + 7) / 8 * 8);
+            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / layout_nT) + 7) / 8 * 8);
         }
     }
 
@@ -23,6 +23,7 @@
 #endif // __ARM_NEON
 
 #include "arm_activation.h"
+#include "../blocksparse.h"
 #include "arm_usability.h"
 
 namespace ncnn {
@@ -105,7 +106,6 @@ Convolution_arm::Convolution_arm()
 #endif
 
     activation = 0;
-    nT = 0;
     convolution_dilation1 = 0;
 }
 
@@ -151,7 +151,10 @@ int Convolution_arm::create_pipeline(const Option& opt)
         return 0;
 
     activation = create_activation_layer(activation_type, activation_params, opt);
-    nT = opt.num_threads;
+
+    // block sparse weights stay in the flexnnslice layout
+    if (sparse_block_count)
+        return 0;
 
 #if NCNN_INT8
     if (opt.use_int8_inference && weight_data.elemsize == (size_t)1u)
@@ -168,7 +171,7 @@ int Convolution_arm::create_pipeline(const Option& opt)
 #endif
 
 #if NCNN_BF16
-    if (opt.use_bf16_storage)
+    if (support_bf16_storage && opt.use_bf16_storage)
     {
         return create_pipeline_bf16s(opt);
     }
@@ -232,6 +235,20 @@ int Convolution_arm::create_pipeline(const Option& opt)
     // if pre-transformed, then just ref the weight data
     if (opt.use_pretransform && weight_data_type >= 2)
     {
+        // gemm and winograd panels differ between armv7, aarch64 and generic builds, 3x3s2 is the same everywhere
+#if __aarch64__
+        const int host_weight_layout = 3;
+#elif __ARM_NEON
+        const int host_weight_layout = 2;
+#else
+        const int host_weight_layout = 1;
+#endif
+        if (weight_layout != 0 && weight_layout != host_weight_layout && weight_data_type != 6)
+        {
+            NCNN_LOGE("weight layout %d does not match this build %d, re-run flexnnslice on the target", weight_layout, host_weight_layout);
+            return -1;
+        }
+
         if (weight_data_type == 2)
             weight_sgemm_data = weight_data;
         else if (weight_data_type == 3)
@@ -394,6 +411,9 @@ int Convolution_arm::release_model()
 
 int Convolution_arm::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
 {
+    if (sparse_block_count)
+        return convolution1x1_blocksparse(bottom_blob, top_blob, weight_sparse_bitmap, weight_data, bias_data, num_output, activation_type, activation_params, opt);
+
 #if NCNN_INT8
     if (opt.use_int8_inference && int8_scale_term)
     {
@@ -454,7 +474,7 @@ int Convolution_arm::forward(const Mat& bottom_blob, Mat& top_blob, const Option
 #endif
 
 #if NCNN_BF16
-    if (opt.use_bf16_storage && elembits == 16)
+    if (support_bf16_storage && opt.use_bf16_storage && elembits == 16)
         return forward_bf16s(bottom_blob, top_blob, opt);
 #endif
 
@@ -545,13 +565,7 @@ int Convolution_arm::forward(const Mat& bottom_blob, Mat& top_blob, const Option
         }
         // NCNN_LOGE("prefer_winograd %d %d %d", prefer_winograd23, prefer_winograd43, prefer_winograd63);
 
-        int _nT = nT ? nT : opt.num_threads;
-        if (nT != 0 && opt.num_threads != nT)
-        {
-            // force num_threads the same as in create_pipeline
-            // so we could use pre-packed A/B from the same tile config
-            NCNN_LOGE("opt.num_threads %d changed, convolution winograd will use load-time value %d", opt.num_threads, nT);
-        }
+        const int _nT = opt.num_threads;
 
         if (opt.use_pretransform)
         {
@@ -645,13 +659,7 @@ int Convolution_arm::forward(const Mat& bottom_blob, Mat& top_blob, const Option
 
     if ((opt.use_sgemm_convolution && prefer_sgemm) || (kernel_w == 1 && kernel_h == 1))
     {
-        int _nT = nT ? nT : opt.num_threads;
-        if (nT != 0 && opt.num_threads != nT)
-        {
-            // force num_threads the same as in create_pipeline
-            // so we could use pre-packed A/B from the same tile config
-            NCNN_LOGE("opt.num_threads %d changed, convolution gemm will use load-time value %d", opt.num_threads, nT);
-        }
+        const int _nT = opt.num_threads;
 
         // NCNN_LOGE("prefer_sgemm");
         // convolution_im2col_gemm(bottom_blob_bordered, top_blob, weight_sgemm_data, bias_data, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, _nT, opt);
@@ -1157,13 +1165,7 @@ int Convolution_arm::forward_bf16s(const Mat& bottom_blob, Mat& top_blob, const
         }
         // NCNN_LOGE("prefer_winograd %d %d %d", prefer_winograd23, prefer_winograd43, prefer_winograd63);
 
-        int _nT = nT ? nT : opt.num_threads;
-        if (nT != 0 && opt.num_threads != nT)
-        {
-            // force num_threads the same as in create_pipeline
-            // so we could use pre-packed A/B from the same tile config
-            NCNN_LOGE("opt.num_threads %d changed, convolution winograd will use load-time value %d", opt.num_threads, nT);
-        }
+        const int _nT = opt.num_threads;
 
         if (prefer_winograd23)
         {
@@ -1226,13 +1228,7 @@ int Convolution_arm::forward_bf16s(const Mat& bottom_blob, Mat& top_blob, const
 
     if ((opt.use_sgemm_convolution && prefer_sgemm) || (kernel_w == 1 && kernel_h == 1))
     {
-        int _nT = nT ? nT : opt.num_threads;
-        if (nT != 0 && opt.num_threads != nT)
-        {
-            // force num_threads the same as in create_pipeline
-            // so we could use pre-packed A/B from the same tile config
-            NCNN_LOGE("opt.num_threads %d changed, convolution gemm will use load-time value %d", opt.num_threads, nT);
-        }
+        const int _nT = opt.num_threads;
 
         convolution_im2col_gemm_bf16s(bottom_blob_bordered, top_blob, weight_sgemm_data, bias_data, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, _nT, opt);
 
@@ -52,8 +52,6 @@ protected:
 public:
     Layer* activation;
 
-    int nT;
-
     Mat weight_data_tm;
     Mat weight_3x3s2_data;
 
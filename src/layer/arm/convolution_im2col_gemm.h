@@ -190,7 +190,9 @@ static void convolution_gemm_transB_packed_tile(const Mat& AT_tile, const Mat& B
 {
     // NCNN_LOGE("convolution_gemm_transB_packed_tile %d %d %d %d %d %d", i, max_ii, j, max_jj, k, max_kk);
 
+#if __ARM_NEON
     const int out_elempack = top_blob.elempack;
+#endif
     const int out_hstep = (int)top_blob.cstep;
 
     const float* pAT = AT_tile;
@@ -4356,6 +4358,8 @@ static void convolution_gemm_transB_packed_tile(const Mat& AT_tile, const Mat& B
 
 static void convolution_im2col_gemm_get_minimal_tile_mnk(int M, int N, int K, int& TILE_M, int& TILE_N, int& TILE_K, int nT)
 {
+    (void)nT;
+
     // resolve optimal tile size from cache size
     const int l2_cache_size_fp32 = (int)(get_cpu_level2_cache_size() / sizeof(float));
 
@@ -4408,7 +4412,9 @@ static void convolution_im2col_gemm_get_minimal_tile_mnk(int M, int N, int K, in
     }
 
     {
-        TILE_M *= std::min(nT, get_physical_cpu_count());
+        // same as convolution_im2col_gemm_get_optimal_tile_mnk, independent of nT
+        const int layout_nT = get_physical_cpu_count();
+        TILE_M *= layout_nT;
 
         int nn_M = (M + TILE_M - 1) / TILE_M;
 #if __aarch64__
@@ -4419,14 +4425,14 @@ static void convolution_im2col_gemm_get_minimal_tile_mnk(int M, int N, int K, in
         TILE_M = std::min(TILE_M, ((M + nn_M - 1) / nn_M + 1) / 2 * 2);
 #endif
 
-        if (nT > 1)
+        if (layout_nT > 1)
         {
 #if __aarch64__
-            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / nT) + 7) / 8 * 8);
+            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / layout_nT) + 7) / 8 * 8);
 #elif __ARM_NEON
-            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / nT) + 3) / 4 * 4);
+            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / layout_nT) + 3) / 4 * 4);
 #else
-            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / nT) + 1) / 2 * 2);
+            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / layout_nT) + 1) / 2 * 2);
 #endif
         }
     }
@@ -4476,6 +4482,8 @@ static void convolution_im2col_gemm_get_minimal_tile_mnk(int M, int N, int K, in
 
 static void convolution_im2col_gemm_get_optimal_tile_mnk(int M, int N, int K, int& TILE_M, int& TILE_N, int& TILE_K, int nT)
 {
+    (void)nT;
+
     // resolve optimal tile size from cache size
     const int l2_cache_size_fp32 = (int)(get_cpu_level2_cache_size() / sizeof(float));
 
@@ -4528,7 +4536,10 @@ static void convolution_im2col_gemm_get_optimal_tile_mnk(int M, int N, int K, in
     }
 
     {
-        TILE_M *= std::min(nT, get_physical_cpu_count());
+        // the packed weights follow TILE_M and TILE_K, size them for all physical cores instead of nT
+        // so that weights packed once stay valid for any num_threads
+        const int layout_nT = get_physical_cpu_count();
+        TILE_M *= layout_nT;
 
         int nn_M = (M + TILE_M - 1) / TILE_M;
 #if __aarch64__
@@ -4539,14 +4550,14 @@ static void convolution_im2col_gemm_get_optimal_tile_mnk(int M, int N, int K, in
         TILE_M = std::min(TILE_M, ((M + nn_M - 1) / nn_M + 1) / 2 * 2);
 #endif
 
-        if (nT > 1)
+        if (layout_nT > 1)
         {
 #if __aarch64__
-            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / nT) + 7) / 8 * 8);
+            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / layout_nT) + 7) / 8 * 8);
 #elif __ARM_NEON
-            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / nT) + 3) / 4 * 4);
+            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / layout_nT) + 3) / 4 * 4);
 #else
-            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / nT) + 1) / 2 * 2);
+            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / layout_nT) + 1) / 2 * 2);
 #endif
         }
     }
@@ -4427,6 +4427,8 @@ static void convolution_gemm_transB_packed_tile_bf16s(const Mat& AT_tile, const
 
 static void convolution_im2col_gemm_get_optimal_tile_mnk_bf16s(int M, int N, int K, int& TILE_M, int& TILE_N, int& TILE_K, int nT)
 {
+    (void)nT;
+
     // resolve optimal tile size from cache size
     const int l2_cache_size_bf16 = (int)(get_cpu_level2_cache_size() / sizeof(unsigned short));
 
@@ -4479,7 +4481,9 @@ static void convolution_im2col_gemm_get_optimal_tile_mnk_bf16s(int M, int N, int
     }
 
     {
-        TILE_M *= std::min(nT, get_physical_cpu_count());
+        // packed layout, independent of nT
+        const int layout_nT = get_physical_cpu_count();
+        TILE_M *= layout_nT;
 
         int nn_M = (M + TILE_M - 1) / TILE_M;
 #if __aarch64__
@@ -4490,14 +4494,14 @@ static void convolution_im2col_gemm_get_optimal_tile_mnk_bf16s(int M, int N, int
         TILE_M = std::min(TILE_M, ((M + nn_M - 1) / nn_M + 1) / 2 * 2);
 #endif
 
-        if (nT > 1)
+        if (layout_nT > 1)
         {
 #if __aarch64__
-            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / nT) + 7) / 8 * 8);
+            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / layout_nT) + 7) / 8 * 8);
 #elif __ARM_NEON
-            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / nT) + 3) / 4 * 4);
+            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / layout_nT) + 3) / 4 * 4);
 #else
-            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / nT) + 1) / 2 * 2);
+            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / layout_nT) + 1) / 2 * 2);
 #endif
         }
     }
@@ -2497,6 +2497,8 @@ static void convolution_gemm_transB_packed_tile_fp16sa(const Mat& AT_tile, const
 
 static void convolution_im2col_gemm_get_optimal_tile_mnk_fp16sa(int M, int N, int K, int& TILE_M, int& TILE_N, int& TILE_K, int nT)
 {
+    (void)nT;
+
     // resolve optimal tile size from cache size
     const int l2_cache_size_fp16 = (int)(get_cpu_level2_cache_size() / sizeof(unsigned short));
 
@@ -2519,14 +2521,16 @@ static void convolution_im2col_gemm_get_optimal_tile_mnk_fp16sa(int M, int N, in
     }
 
     {
-        TILE_M *= std::min(nT, get_physical_cpu_count());
+        // packed layout, independent of nT
+        const int layout_nT = get_physical_cpu_count();
+        TILE_M *= layout_nT;
 
         int nn_M = (M + TILE_M - 1) / TILE_M;
         TILE_M = std::min(TILE_M, ((M + nn_M - 1) / nn_M + 7) / 8 * 8);
 
-        if (nT > 1)
+        if (layout_nT > 1)
         {
-            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / nT) + 7) / 8 * 8);
+            TILE_M = std::min(TILE_M, (std::max(1, TILE_M / layout_nT) + 7) / 8 * 8);
         }
     }
 
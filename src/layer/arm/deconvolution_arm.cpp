@@ -47,6 +47,21 @@ Deconvolution_arm::Deconvolution_arm()
     gemm = 0;
 }
 
+int Deconvolution_arm::release_model()
+{
+    if (!weight_data_tm.empty())
+    {
+        weight_data_tm.release();
+    }
+
+    if (!bias_data_fp16.empty())
+    {
+        bias_data_fp16.release();
+    }
+
+    return Deconvolution::release_model();
+}
+
 int Deconvolution_arm::create_pipeline(const Option& opt)
 {
     activation = create_activation_layer(activation_type, activation_params, opt);
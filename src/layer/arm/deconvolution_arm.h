@@ -24,6 +24,8 @@ class Deconvolution_arm : virtual public Deconvolution
 public:
     Deconvolution_arm();
 
+    virtual int release_model();
+
     virtual int create_pipeline(const Option& opt);
     virtual int destroy_pipeline(const Option& opt);
 
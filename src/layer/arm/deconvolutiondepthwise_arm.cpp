@@ -41,6 +41,21 @@ DeconvolutionDepthWise_arm::DeconvolutionDepthWise_arm()
 #endif
 }
 
+int DeconvolutionDepthWise_arm::release_model()
+{
+    if (!weight_data_tm.empty())
+    {
+        weight_data_tm.release();
+    }
+
+    if (!bias_data_fp16.empty())
+    {
+        bias_data_fp16.release();
+    }
+
+    return DeconvolutionDepthWise::release_model();
+}
+
 int DeconvolutionDepthWise_arm::create_pipeline(const Option& opt)
 {
 #if NCNN_ARM82
@@ -24,6 +24,8 @@ class DeconvolutionDepthWise_arm : virtual public DeconvolutionDepthWise
 public:
     DeconvolutionDepthWise_arm();
 
+    virtual int release_model();
+
     virtual int create_pipeline(const Option& opt);
     virtual int destroy_pipeline(const Option& opt);
 
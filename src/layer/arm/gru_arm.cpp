@@ -40,6 +40,26 @@ GRU_arm::GRU_arm()
 #endif
 }
 
+int GRU_arm::release_model()
+{
+    if (!weight_xc_data_packed.empty())
+    {
+        weight_xc_data_packed.release();
+    }
+
+    if (!bias_c_data_packed.empty())
+    {
+        bias_c_data_packed.release();
+    }
+
+    if (!weight_hc_data_packed.empty())
+    {
+        weight_hc_data_packed.release();
+    }
+
+    return GRU::release_model();
+}
+
 int GRU_arm::create_pipeline(const Option& opt)
 {
 #if NCNN_ARM82
@@ -24,6 +24,8 @@ class GRU_arm : virtual public GRU
 public:
     GRU_arm();
 
+    virtual int release_model();
+
     virtual int create_pipeline(const Option& opt);
     virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
     virtual int forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const;
@@ -21,10 +21,13 @@
 #endif // __ARM_NEON
 
 #include "arm_activation.h"
+#include "../blocksparse.h"
 #include "arm_usability.h"
 
 #include "cpu.h"
 
+#include <algorithm>
+
 namespace ncnn {
 
 #if (NCNN_VFPV4 && __ARM_NEON) || __aarch64__
@@ -45,9 +48,20 @@ InnerProduct_arm::InnerProduct_arm()
     support_bf16_storage = true;
 #endif
 
+    support_weight_chunks = true;
+
     flatten = 0;
 }
 
+int InnerProduct_arm::load_model_chunked_begin(const ModelBin& mb, const Option& opt)
+{
+    // the fp16 / bf16 / int8 pipelines convert the whole weight in create_pipeline
+    if (opt.use_fp16_storage || opt.use_bf16_storage || int8_scale_term)
+        return Layer::load_model_chunked_begin(mb, opt);
+
+    return InnerProduct::load_model_chunked_begin(mb, opt);
+}
+
 int InnerProduct_arm::create_pipeline(const Option& opt)
 {
     {
@@ -60,6 +74,16 @@ int InnerProduct_arm::create_pipeline(const Option& opt)
         flatten->create_pipeline(opt);
     }
 
+    // block sparse weights stay in the flexnnslice layout
+    if (sparse_block_count)
+        return 0;
+
+    if (weight_chunks.count() > 0)
+    {
+        // weights are still loading, forward_chunked reads weight_data in place
+        return 0;
+    }
+
 #if NCNN_INT8
     if (opt.use_int8_inference && weight_data.elemsize == (size_t)1u)
     {
@@ -156,6 +180,12 @@ int InnerProduct_arm::release_model()
 
 int InnerProduct_arm::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
 {
+    if (sparse_block_count)
+        return innerproduct_blocksparse(bottom_blob, top_blob, weight_sparse_bitmap, weight_data, bias_data, num_output, weight_data_size / num_output, activation_type, activation_params, opt);
+
+    if (weight_chunks.count() > 0)
+        return forward_chunked(bottom_blob, top_blob, opt);
+
 #if NCNN_INT8
     if (opt.use_int8_inference && int8_scale_term)
     {
@@ -855,6 +885,126 @@ int InnerProduct_arm::forward(const Mat& bottom_blob, Mat& top_blob, const Optio
     return 0;
 }
 
+static float innerproduct_dot(const float* a, const float* b, int n)
+{
+    int i = 0;
+    float sum = 0.f;
+#if __ARM_NEON
+    float32x4_t _sum0 = vdupq_n_f32(0.f);
+    float32x4_t _sum1 = vdupq_n_f32(0.f);
+    for (; i + 7 < n; i += 8)
+    {
+        _sum0 = vmlaq_f32(_sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+        _sum1 = vmlaq_f32(_sum1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    for (; i + 3 < n; i += 4)
+    {
+        _sum0 = vmlaq_f32(_sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+    }
+    _sum0 = vaddq_f32(_sum0, _sum1);
+#if __aarch64__
+    sum = vaddvq_f32(_sum0);
+#else
+    float32x2_t _ss = vadd_f32(vget_low_f32(_sum0), vget_high_f32(_sum0));
+    _ss = vpadd_f32(_ss, _ss);
+    sum = vget_lane_f32(_ss, 0);
+#endif
+#endif // __ARM_NEON
+    for (; i < n; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+int InnerProduct_arm::forward_chunked(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    const int chunk_count = weight_chunks.count();
+    const int num_input = weight_data_size / num_output;
+
+    Mat bottom_blob_unpacked = bottom_blob;
+    if (bottom_blob.elempack != 1)
+    {
+        Option opt_pack1 = opt;
+        opt_pack1.blob_allocator = opt.workspace_allocator;
+
+        convert_packing(bottom_blob, bottom_blob_unpacked, 1, opt_pack1);
+        if (bottom_blob_unpacked.empty())
+            return -100;
+    }
+
+    const int w = bottom_blob_unpacked.w;
+    const int h = bottom_blob_unpacked.h;
+    const int channels = bottom_blob_unpacked.c;
+    const int size = w * h;
+
+    const bool gemm = bottom_blob_unpacked.dims == 2 && w == num_input && h > 1;
+
+    // output stays unpacked, the next layer repacks as it likes
+    if (gemm)
+        top_blob.create(num_output, h, 4u, opt.blob_allocator);
+    else
+        top_blob.create(num_output, 4u, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    // consume the weight rows chunk by chunk as the loader publishes them
+    for (int i = 0; i < chunk_count; i++)
+    {
+        if (weight_chunks.wait(i))
+            return -100;
+
+        const int p0 = i * weight_chunk_rows;
+        const int p1 = std::min(p0 + weight_chunk_rows, num_output);
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int p = p0; p < p1; p++)
+        {
+            const float* kptr = (const float*)weight_data + (size_t)num_input * p;
+
+            if (gemm)
+            {
+                for (int j = 0; j < h; j++)
+                {
+                    top_blob.row(j)[p] = innerproduct_dot(bottom_blob_unpacked.row(j), kptr, w);
+                }
+            }
+            else
+            {
+                float sum = 0.f;
+                for (int q = 0; q < channels; q++)
+                {
+                    sum += innerproduct_dot(bottom_blob_unpacked.channel(q), kptr + size * q, size);
+                }
+                top_blob[p] = sum;
+            }
+        }
+    }
+
+    // bias is in the tail
+    if (weight_chunks.wait(chunk_count))
+        return -100;
+
+    const int outh = gemm ? h : 1;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int j = 0; j < outh; j++)
+    {
+        float* outptr = top_blob.row(j);
+
+        for (int p = 0; p < num_output; p++)
+        {
+            float sum = outptr[p];
+            if (bias_term)
+                sum += bias_data[p];
+
+            outptr[p] = activation_ss(sum, activation_type, activation_params);
+        }
+    }
+
+    return 0;
+}
+
 #if (NCNN_VFPV4 && __ARM_NEON) || __aarch64__
 int InnerProduct_arm::create_pipeline_fp16s(const Option& opt)
 {
@@ -26,6 +26,8 @@ class InnerProduct_arm : virtual public InnerProduct
 public:
     InnerProduct_arm();
 
+    virtual int load_model_chunked_begin(const ModelBin& mb, const Option& opt);
+
     virtual int create_pipeline(const Option& opt);
     virtual int destroy_pipeline(const Option& opt);
 
@@ -34,6 +36,8 @@ public:
     virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
 
 protected:
+    int forward_chunked(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
+
 #if (NCNN_VFPV4 && __ARM_NEON) || __aarch64__
     int create_pipeline_fp16s(const Option& opt);
     int forward_fp16s(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
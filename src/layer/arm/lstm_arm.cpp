@@ -40,6 +40,26 @@ LSTM_arm::LSTM_arm()
 #endif
 }
 
+int LSTM_arm::release_model()
+{
+    if (!weight_xc_data_packed.empty())
+    {
+        weight_xc_data_packed.release();
+    }
+
+    if (!bias_c_data_packed.empty())
+    {
+        bias_c_data_packed.release();
+    }
+
+    if (!weight_hc_data_packed.empty())
+    {
+        weight_hc_data_packed.release();
+    }
+
+    return LSTM::release_model();
+}
+
 int LSTM_arm::create_pipeline(const Option& opt)
 {
 #if NCNN_ARM82
@@ -43,6 +43,10 @@ MultiHeadAttention_arm::MultiHeadAttention_arm()
 
 int MultiHeadAttention_arm::create_pipeline(const Option& opt)
 {
+    // incremental decoding runs the fp32 reference path, its storage flags are cleared in load_param
+    if (kv_cache)
+        return 0;
+
     Option optn = opt;
     optn.use_bf16_storage = false;
     optn.weight_allocator = opt.workspace_allocator; // intermediate data
@@ -86,7 +90,7 @@ int MultiHeadAttention_arm::create_pipeline(const Option& opt)
             pd.set(6, 1);         // constantC
             pd.set(7, embed_dim); // M
             pd.set(8, 0);         // N
-            pd.set(9, embed_dim); // K
+            pd.set(9, qdim);      // K
             pd.set(10, 1);        // constant_broadcast_type_C
             pd.set(11, 0);        // output_N1M
             pd.set(12, 1);        // output_elempack
@@ -172,7 +176,7 @@ int MultiHeadAttention_arm::create_pipeline(const Option& opt)
             pd.set(5, 1);         // constantB
             pd.set(6, 1);         // constantC
             pd.set(7, 0);         // M = outch
-            pd.set(8, embed_dim); // N = size
+            pd.set(8, qdim);      // N = size
             pd.set(9, embed_dim); // K = maxk*inch
             pd.set(10, 4);        // constant_broadcast_type_C = null
             pd.set(11, 0);        // output_N1M
@@ -258,7 +262,7 @@ int MultiHeadAttention_arm::create_pipeline(const Option& opt)
         pd.set(6, 1);         // constantC
         pd.set(7, embed_dim); // M
         pd.set(8, 0);         // N
-        pd.set(9, embed_dim); // K
+        pd.set(9, qdim);      // K
         pd.set(10, 1);        // constant_broadcast_type_C
         pd.set(11, 0);        // output_N1M
         pd.set(12, 1);        // output_elempack
@@ -344,7 +348,7 @@ int MultiHeadAttention_arm::create_pipeline(const Option& opt)
         pd.set(5, 1);         // constantB
         pd.set(6, 1);         // constantC
         pd.set(7, 0);         // M = outch
-        pd.set(8, embed_dim); // N = size
+        pd.set(8, qdim);      // N = size
         pd.set(9, embed_dim); // K = maxk*inch
         pd.set(10, 4);        // constant_broadcast_type_C = null
         pd.set(11, 0);        // output_N1M
@@ -534,6 +538,9 @@ int MultiHeadAttention_arm::destroy_pipeline(const Option& opt)
 
 int MultiHeadAttention_arm::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
 {
+    if (kv_cache)
+        return MultiHeadAttention::forward(bottom_blobs, top_blobs, opt);
+
     const Mat& q_blob = bottom_blobs[0];
     const Mat& k_blob = bottom_blobs.size() == 1 ? q_blob : bottom_blobs[1];
     const Mat& v_blob = bottom_blobs.size() == 1 ? q_blob : bottom_blobs.size() == 2 ? k_blob : bottom_blobs[2];
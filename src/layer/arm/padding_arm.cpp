@@ -45,6 +45,23 @@ Padding_arm::Padding_arm()
 #endif
 }
 
+int Padding_arm::release_model()
+{
+#if NCNN_BF16
+    if (!per_channel_pad_data_bf16.empty())
+    {
+        per_channel_pad_data_bf16.release();
+    }
+#endif
+
+    if (!per_channel_pad_data_fp16.empty())
+    {
+        per_channel_pad_data_fp16.release();
+    }
+
+    return Padding::release_model();
+}
+
 int Padding_arm::create_pipeline(const Option& opt)
 {
 #if NCNN_ARM82
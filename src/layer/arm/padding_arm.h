@@ -24,6 +24,8 @@ class Padding_arm : virtual public Padding
 public:
     Padding_arm();
 
+    virtual int release_model();
+
     virtual int create_pipeline(const Option& opt);
     virtual int destroy_pipeline(const Option& opt);
 
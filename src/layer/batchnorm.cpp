@@ -69,6 +69,60 @@ int BatchNorm::load_model(const ModelBin& mb)
     return 0;
 }
 
+int BatchNorm::load_model(const ModelBin& mb, const Option& opt)
+{
+    slope_data = mb.load(channels, 1, opt.weight_allocator);
+    if (slope_data.empty())
+        return -100;
+
+    mean_data = mb.load(channels, 1, opt.weight_allocator);
+    if (mean_data.empty())
+        return -100;
+
+    var_data = mb.load(channels, 1, opt.weight_allocator);
+    if (var_data.empty())
+        return -100;
+
+    bias_data = mb.load(channels, 1, opt.weight_allocator);
+    if (bias_data.empty())
+        return -100;
+
+    a_data.create(channels, 4u, opt.weight_allocator);
+    if (a_data.empty())
+        return -100;
+    b_data.create(channels, 4u, opt.weight_allocator);
+    if (b_data.empty())
+        return -100;
+
+    for (int i = 0; i < channels; i++)
+    {
+        float sqrt_var = static_cast<float>(sqrt(var_data[i] + eps));
+        if (sqrt_var == 0.f)
+            sqrt_var = 0.0001f; // sanitize divide by zero
+        a_data[i] = bias_data[i] - slope_data[i] * mean_data[i] / sqrt_var;
+        b_data[i] = slope_data[i] / sqrt_var;
+    }
+
+    return 0;
+}
+
+int BatchNorm::release_model()
+{
+    if (!slope_data.empty())
+        slope_data.release();
+    if (!mean_data.empty())
+        mean_data.release();
+    if (!var_data.empty())
+        var_data.release();
+    if (!bias_data.empty())
+        bias_data.release();
+    if (!a_data.empty())
+        a_data.release();
+    if (!b_data.empty())
+        b_data.release();
+    return 0;
+}
+
 int BatchNorm::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
 {
     // a = bias - slope * mean / sqrt(var)
@@ -38,6 +38,22 @@ int Bias::load_model(const ModelBin& mb)
     return 0;
 }
 
+int Bias::load_model(const ModelBin& mb, const Option& opt)
+{
+    bias_data = mb.load(bias_data_size, 1, opt.weight_allocator);
+    if (bias_data.empty())
+        return -100;
+
+    return 0;
+}
+
+int Bias::release_model()
+{
+    if (!bias_data.empty())
+        bias_data.release();
+    return 0;
+}
+
 int Bias::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
 {
     int w = bottom_top_blob.w;
@@ -0,0 +1,364 @@
+#ifndef LAYER_BLOCKSPARSE_H
+#define LAYER_BLOCKSPARSE_H
+
+#include "fused_activation.h"
+
+#include <algorithm>
+
+#if __ARM_NEON
+#include <arm_neon.h>
+#endif
+#if __SSE2__
+#include <emmintrin.h>
+#if __AVX__
+#include <immintrin.h>
+#endif
+#endif
+
+// 1x4 block sparse weight, written by flexnnslice for pruned InnerProduct and Convolution 1x1
+// each row of the dense [rows][cols] weight is split into blocks of 4 columns, the last block is zero padded
+// bitmap holds one bit per block, blocksparse_words(cols) 32-bit words per row, stored as raw bits in a float mat
+// values holds the 4 weights of every set block, row by row
+// all helpers are static so that the per-isa translation units of a layer each get their own sse/avx/fma or neon copy
+
+static inline int blocksparse_words(int cols)
+{
+    return (cols + 127) / 128;
+}
+
+// offsets[p] = index of the first block of row p in values, offsets[rows] = total block count
+static inline void blocksparse_row_offsets(const ncnn::Mat& bitmap, int rows, int cols, int* offsets)
+{
+    const int words = blocksparse_words(cols);
+    const unsigned int* bits = (const unsigned int*)bitmap.data;
+
+    int count = 0;
+    for (int p = 0; p < rows; p++)
+    {
+        offsets[p] = count;
+        for (int k = 0; k < words; k++)
+        {
+            unsigned int v = bits[p * words + k];
+            while (v)
+            {
+                v &= v - 1;
+                count++;
+            }
+        }
+    }
+    offsets[rows] = count;
+}
+
+#if __SSE2__
+static NCNN_FORCEINLINE __m128 blocksparse_fmadd_ps(const __m128& a, const __m128& b, const __m128& c)
+{
+#if __FMA__
+    return _mm_fmadd_ps(a, b, c);
+#else
+    return _mm_add_ps(_mm_mul_ps(a, b), c);
+#endif
+}
+#if __AVX__
+static NCNN_FORCEINLINE __m256 blocksparse_fmadd_ps(const __m256& a, const __m256& b, const __m256& c)
+{
+#if __FMA__
+    return _mm256_fmadd_ps(a, b, c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+#endif // __AVX__
+#endif // __SSE2__
+
+#if __ARM_NEON
+static NCNN_FORCEINLINE float32x4_t blocksparse_fmadd_f32(const float32x4_t& a, const float32x4_t& b, const float32x4_t& c)
+{
+#if __aarch64__
+    return vfmaq_f32(c, a, b);
+#else
+    return vmlaq_f32(c, a, b);
+#endif
+}
+#endif // __ARM_NEON
+
+// sum(row p of the weight * x), x has cols elements
+static NCNN_FORCEINLINE float blocksparse_dot(const unsigned int* bits, const float* values, const float* x, int cols)
+{
+    const int blocks = (cols + 3) / 4;
+
+    float sum = 0.f;
+#if __SSE2__
+    __m128 _sum = _mm_setzero_ps();
+#if __AVX__
+    // values of consecutive set blocks are contiguous, pair them into one 8-wide fma
+    __m256 _sum8 = _mm256_setzero_ps();
+    const float* pending_x = 0;
+    const float* pending_values = 0;
+#endif
+#elif __ARM_NEON
+    float32x4_t _sum = vdupq_n_f32(0.f);
+#else
+    float sum1 = 0.f;
+    float sum2 = 0.f;
+    float sum3 = 0.f;
+#endif
+    for (int b0 = 0; b0 < blocks; b0 += 32)
+    {
+        unsigned int v = bits[b0 / 32];
+        for (int b = b0; v; b++, v >>= 1)
+        {
+            if (!(v & 1))
+                continue;
+
+            const float* xptr = x + b * 4;
+            if (b * 4 + 4 <= cols)
+            {
+#if __SSE2__
+#if __AVX__
+                if (!pending_x)
+                {
+                    pending_x = xptr;
+                    pending_values = values;
+                }
+                else
+                {
+                    __m256 _x = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(pending_x)), _mm_loadu_ps(xptr), 1);
+                    _sum8 = blocksparse_fmadd_ps(_mm256_loadu_ps(pending_values), _x, _sum8);
+                    pending_x = 0;
+                }
+#else
+                _sum = blocksparse_fmadd_ps(_mm_loadu_ps(values), _mm_loadu_ps(xptr), _sum);
+#endif
+#elif __ARM_NEON
+                _sum = blocksparse_fmadd_f32(vld1q_f32(values), vld1q_f32(xptr), _sum);
+#else
+                sum += values[0] * xptr[0];
+                sum1 += values[1] * xptr[1];
+                sum2 += values[2] * xptr[2];
+                sum3 += values[3] * xptr[3];
+#endif
+            }
+            else
+            {
+                // zero padded tail block
+                for (int k = 0; k < cols - b * 4; k++)
+                {
+                    sum += values[k] * xptr[k];
+                }
+            }
+            values += 4;
+        }
+    }
+
+#if __SSE2__
+#if __AVX__
+    if (pending_x)
+    {
+        _sum = blocksparse_fmadd_ps(_mm_loadu_ps(pending_values), _mm_loadu_ps(pending_x), _sum);
+    }
+    _sum = _mm_add_ps(_sum, _mm_add_ps(_mm256_castps256_ps128(_sum8), _mm256_extractf128_ps(_sum8, 1)));
+#endif
+    __m128 _hi = _mm_movehl_ps(_sum, _sum);
+    _sum = _mm_add_ps(_sum, _hi);
+    _sum = _mm_add_ss(_sum, _mm_shuffle_ps(_sum, _sum, 1));
+    sum += _mm_cvtss_f32(_sum);
+#elif __ARM_NEON
+#if __aarch64__
+    sum += vaddvq_f32(_sum);
+#else
+    float32x2_t _s2 = vadd_f32(vget_low_f32(_sum), vget_high_f32(_sum));
+    _s2 = vpadd_f32(_s2, _s2);
+    sum += vget_lane_f32(_s2, 0);
+#endif
+#else
+    sum += sum1 + sum2 + sum3;
+#endif
+
+    return sum;
+}
+
+// top_blob = activation(weight * bottom_blob + bias), for 1-d input or 2-d gemm input of num_input columns
+static inline int innerproduct_blocksparse(const ncnn::Mat& bottom_blob, ncnn::Mat& top_blob, const ncnn::Mat& bitmap, const ncnn::Mat& values, const ncnn::Mat& bias_data, int num_output, int num_input, int activation_type, const ncnn::Mat& activation_params, const ncnn::Option& opt)
+{
+    const bool gemm = bottom_blob.dims == 2 && bottom_blob.w == num_input && bottom_blob.h > 1;
+
+    // the dense path walks channels, the sparse blocks need the flattened input
+    ncnn::Mat bottom_blob_flattened = bottom_blob;
+    if (!gemm && bottom_blob.dims != 1)
+    {
+        bottom_blob_flattened = bottom_blob.reshape(num_input, opt.workspace_allocator);
+        if (bottom_blob_flattened.empty())
+            return -100;
+    }
+
+    const int rows = gemm ? bottom_blob.h : 1;
+
+    if (gemm)
+        top_blob.create(num_output, rows, 4u, opt.blob_allocator);
+    else
+        top_blob.create(num_output, 4u, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    ncnn::Mat offsets(num_output + 1, 4u, opt.workspace_allocator);
+    if (offsets.empty())
+        return -100;
+
+    blocksparse_row_offsets(bitmap, num_output, num_input, (int*)offsets.data);
+
+    const int words = blocksparse_words(num_input);
+    const unsigned int* bits = (const unsigned int*)bitmap.data;
+    const int* ofs = (const int*)offsets.data;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int p = 0; p < num_output; p++)
+    {
+        const float* kptr = (const float*)values + ofs[p] * 4;
+        const float bias = bias_data.empty() ? 0.f : bias_data[p];
+
+        for (int j = 0; j < rows; j++)
+        {
+            const float* x = gemm ? (const float*)bottom_blob_flattened.row(j) : (const float*)bottom_blob_flattened;
+
+            float sum = bias + blocksparse_dot(bits + p * words, kptr, x, num_input);
+
+            top_blob.row(j)[p] = activation_ss(sum, activation_type, activation_params);
+        }
+    }
+
+    return 0;
+}
+
+// top_blob = activation(conv1x1(bottom_blob) + bias), stride 1 without padding
+static inline int convolution1x1_blocksparse(const ncnn::Mat& bottom_blob, ncnn::Mat& top_blob, const ncnn::Mat& bitmap, const ncnn::Mat& values, const ncnn::Mat& bias_data, int num_output, int activation_type, const ncnn::Mat& activation_params, const ncnn::Option& opt)
+{
+    // flattened blob, same as innerproduct
+    if (bottom_blob.dims == 1)
+        return innerproduct_blocksparse(bottom_blob, top_blob, bitmap, values, bias_data, num_output, bottom_blob.w, activation_type, activation_params, opt);
+
+    const int w = bottom_blob.w;
+    const int h = bottom_blob.h;
+    const int inch = bottom_blob.c;
+    const int size = w * h;
+
+    top_blob.create(w, h, num_output, 4u, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    ncnn::Mat offsets(num_output + 1, 4u, opt.workspace_allocator);
+    if (offsets.empty())
+        return -100;
+
+    blocksparse_row_offsets(bitmap, num_output, inch, (int*)offsets.data);
+
+    const int words = blocksparse_words(inch);
+    const int blocks = (inch + 3) / 4;
+    const unsigned int* bits = (const unsigned int*)bitmap.data;
+    const int* ofs = (const int*)offsets.data;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int p = 0; p < num_output; p++)
+    {
+        float* outptr = top_blob.channel(p);
+        const float* kptr = (const float*)values + ofs[p] * 4;
+        const float bias = bias_data.empty() ? 0.f : bias_data[p];
+
+        for (int i = 0; i < size; i++)
+        {
+            outptr[i] = bias;
+        }
+
+        // outptr += w * input channel, for the 4 channels of every set block
+        const unsigned int* pbits = bits + p * words;
+        for (int b = 0; b < blocks; b++)
+        {
+            if (!(pbits[b / 32] & (1u << (b % 32))))
+                continue;
+
+            const int q0 = b * 4;
+            const int qn = std::min(4, inch - q0);
+            if (qn == 4)
+            {
+                const float* s0 = bottom_blob.channel(q0);
+                const float* s1 = bottom_blob.channel(q0 + 1);
+                const float* s2 = bottom_blob.channel(q0 + 2);
+                const float* s3 = bottom_blob.channel(q0 + 3);
+
+                int i = 0;
+#if __SSE2__
+#if __AVX__
+                __m256 _w0_8 = _mm256_set1_ps(kptr[0]);
+                __m256 _w1_8 = _mm256_set1_ps(kptr[1]);
+                __m256 _w2_8 = _mm256_set1_ps(kptr[2]);
+                __m256 _w3_8 = _mm256_set1_ps(kptr[3]);
+                for (; i + 7 < size; i += 8)
+                {
+                    __m256 _out = _mm256_loadu_ps(outptr + i);
+                    _out = blocksparse_fmadd_ps(_mm256_loadu_ps(s0 + i), _w0_8, _out);
+                    _out = blocksparse_fmadd_ps(_mm256_loadu_ps(s1 + i), _w1_8, _out);
+                    _out = blocksparse_fmadd_ps(_mm256_loadu_ps(s2 + i), _w2_8, _out);
+                    _out = blocksparse_fmadd_ps(_mm256_loadu_ps(s3 + i), _w3_8, _out);
+                    _mm256_storeu_ps(outptr + i, _out);
+                }
+#endif // __AVX__
+                __m128 _w0 = _mm_set1_ps(kptr[0]);
+                __m128 _w1 = _mm_set1_ps(kptr[1]);
+                __m128 _w2 = _mm_set1_ps(kptr[2]);
+                __m128 _w3 = _mm_set1_ps(kptr[3]);
+                for (; i + 3 < size; i += 4)
+                {
+                    __m128 _out = _mm_loadu_ps(outptr + i);
+                    _out = blocksparse_fmadd_ps(_mm_loadu_ps(s0 + i), _w0, _out);
+                    _out = blocksparse_fmadd_ps(_mm_loadu_ps(s1 + i), _w1, _out);
+                    _out = blocksparse_fmadd_ps(_mm_loadu_ps(s2 + i), _w2, _out);
+                    _out = blocksparse_fmadd_ps(_mm_loadu_ps(s3 + i), _w3, _out);
+                    _mm_storeu_ps(outptr + i, _out);
+                }
+#elif __ARM_NEON
+                float32x4_t _w0 = vdupq_n_f32(kptr[0]);
+                float32x4_t _w1 = vdupq_n_f32(kptr[1]);
+                float32x4_t _w2 = vdupq_n_f32(kptr[2]);
+                float32x4_t _w3 = vdupq_n_f32(kptr[3]);
+                for (; i + 3 < size; i += 4)
+                {
+                    float32x4_t _out = vld1q_f32(outptr + i);
+                    _out = blocksparse_fmadd_f32(vld1q_f32(s0 + i), _w0, _out);
+                    _out = blocksparse_fmadd_f32(vld1q_f32(s1 + i), _w1, _out);
+                    _out = blocksparse_fmadd_f32(vld1q_f32(s2 + i), _w2, _out);
+                    _out = blocksparse_fmadd_f32(vld1q_f32(s3 + i), _w3, _out);
+                    vst1q_f32(outptr + i, _out);
+                }
+#endif
+                for (; i < size; i++)
+                {
+                    outptr[i] += s0[i] * kptr[0] + s1[i] * kptr[1] + s2[i] * kptr[2] + s3[i] * kptr[3];
+                }
+                kptr += 4;
+                continue;
+            }
+
+            for (int k = 0; k < qn; k++)
+            {
+                const float* sptr = bottom_blob.channel(q0 + k);
+                const float wk = kptr[k];
+                for (int i = 0; i < size; i++)
+                {
+                    outptr[i] += sptr[i] * wk;
+                }
+            }
+            kptr += 4;
+        }
+
+        if (activation_type)
+        {
+            for (int i = 0; i < size; i++)
+            {
+                outptr[i] = activation_ss(outptr[i], activation_type, activation_params);
+            }
+        }
+    }
+
+    return 0;
+}
+
+#endif // LAYER_BLOCKSPARSE_H
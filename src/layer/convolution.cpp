@@ -18,6 +18,8 @@
 
 #include "fused_activation.h"
 
+#include "blocksparse.h"
+
 namespace ncnn {
 
 Convolution::Convolution()
@@ -52,12 +54,44 @@ int Convolution::load_param(const ParamDict& pd)
     weight_w = pd.get(26, 0);
     weight_h = pd.get(27, 0);
     weight_c = pd.get(28, 0);
+    weight_d = pd.get(29, 1);
+    weight_layout = pd.get(30, 0);
+
+    {
+        Mat weight_tiles = pd.get(31, Mat());
+        weight_tile_m = weight_tiles.w == 2 ? ((const int*)weight_tiles)[0] : 0;
+        weight_tile_k = weight_tiles.w == 2 ? ((const int*)weight_tiles)[1] : 0;
+    }
+
+    sparse_block_count = pd.get(20, 0);
 
     if (dynamic_weight)
     {
         one_blob_only = false;
     }
 
+    if (sparse_block_count)
+    {
+        if (kernel_w != 1 || kernel_h != 1 || stride_w != 1 || stride_h != 1 || pad_left != 0 || pad_right != 0 || pad_top != 0 || pad_bottom != 0)
+        {
+            NCNN_LOGE("block sparse weight is only supported for 1x1 stride 1 convolution without padding");
+            return -1;
+        }
+
+        // the sparse kernel is fp32 elempack 1 only
+        support_packing = false;
+        support_fp16_storage = false;
+        support_bf16_storage = false;
+    }
+
+    if (weight_data_type >= 2)
+    {
+        // pretransformed kernels are fp32 panels, the net casts half precision blobs back for this layer
+        // decided here so that shape inference and planning see the same storage as the run
+        support_fp16_storage = false;
+        support_bf16_storage = false;
+    }
+
     if (int8_scale_term)
     {
 #if NCNN_INT8
@@ -76,7 +110,17 @@ int Convolution::load_model(const ModelBin& mb)
     if (dynamic_weight)
         return 0;
 
-    if (weight_data_type == 0)
+    if (sparse_block_count)
+    {
+        weight_sparse_bitmap = mb.load(num_output * blocksparse_words(weight_data_size / num_output), 1);
+        if (weight_sparse_bitmap.empty())
+            return -100;
+
+        weight_data = mb.load(sparse_block_count * 4, 0);
+        if (weight_data.empty())
+            return -100;
+    }
+    else if (weight_data_type == 0)
     {
         weight_data = mb.load(weight_data_size, 0);
         if (weight_data.empty())
@@ -115,7 +159,17 @@ int Convolution::load_model(const ModelBin& mb, const Option& opt)
     if (dynamic_weight)
         return 0;
 
-    if (weight_data_type == 0)
+    if (sparse_block_count)
+    {
+        weight_sparse_bitmap = mb.load(num_output * blocksparse_words(weight_data_size / num_output), 1, opt.weight_allocator);
+        if (weight_sparse_bitmap.empty())
+            return -100;
+
+        weight_data = mb.load(sparse_block_count * 4, 0, opt.weight_allocator);
+        if (weight_data.empty())
+            return -100;
+    }
+    else if (weight_data_type == 0)
     {
         weight_data = mb.load(weight_data_size, 0, opt.weight_allocator);
         if (weight_data.empty())
@@ -124,9 +178,13 @@ int Convolution::load_model(const ModelBin& mb, const Option& opt)
     else
     {
         // weight_data = mb.load(weight_w, weight_h, weight_c, 0, opt.weight_allocator);
-        weight_data = ((ModelBinFromDataReader*)&mb)->load_no_reshape(weight_w, weight_h, weight_c, 0, opt.weight_allocator);
+        weight_data = ((ModelBinFromDataReader*)&mb)->load_no_reshape(weight_w, weight_h * weight_d, weight_c, 0, opt.weight_allocator);
         if (weight_data.empty())
             return -100;
+
+        // same cstep as the 4-d mat that was written, so this is only a new header
+        if (weight_d > 1)
+            weight_data = weight_data.reshape(weight_w, weight_h, weight_d, weight_c, opt.weight_allocator);
     }
 
     if (bias_term)
@@ -157,6 +215,8 @@ int Convolution::release_model()
         weight_data.release();
     if (!bias_data.empty())
         bias_data.release();
+    if (!weight_sparse_bitmap.empty())
+        weight_sparse_bitmap.release();
     if (!weight_data_int8_scales.empty())
         weight_data_int8_scales.release();
     if (!bottom_blob_int8_scales.empty())
@@ -273,6 +333,11 @@ static int convolution(const Mat& bottom_blob, Mat& top_blob, const Mat& weight_
 
 int Convolution::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
 {
+    if (sparse_block_count)
+    {
+        return convolution1x1_blocksparse(bottom_blob, top_blob, weight_sparse_bitmap, weight_data, bias_data, num_output, activation_type, activation_params, opt);
+    }
+
 #if NCNN_INT8
     if (opt.use_int8_inference && weight_data.elemsize == (size_t)1u)
     {
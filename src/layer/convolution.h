@@ -95,6 +95,20 @@ public:
     int weight_w;
     int weight_h;
     int weight_c;
+    // depth of the transformed weight, winograd kernels are 4-d (tile, batch, k tiles, m tiles).
+    int weight_d;
+
+    // layout tag of the transformed weight, written by flexnnslice.
+    // 0 = untagged, 1 = generic 2-row panels (built on x86 or any non-neon host), 2 = armv7 neon, 3 = aarch64 neon.
+    // tile m/k are the gemm tiles the weight was packed with, so that the consumer never recomputes them from its own cache size.
+    int weight_layout;
+    int weight_tile_m;
+    int weight_tile_k;
+
+    // number of nonzero 1x4 blocks of a block sparse 1x1 weight, 0 for dense
+    // weight_data then holds the nonzero blocks and weight_sparse_bitmap marks them, see blocksparse.h
+    int sparse_block_count;
+    Mat weight_sparse_bitmap;
 };
 
 } // namespace ncnn
@@ -67,6 +67,34 @@ int Convolution1D::load_model(const ModelBin& mb)
     return 0;
 }
 
+int Convolution1D::load_model(const ModelBin& mb, const Option& opt)
+{
+    if (dynamic_weight)
+        return 0;
+
+    weight_data = mb.load(weight_data_size, 0, opt.weight_allocator);
+    if (weight_data.empty())
+        return -100;
+
+    if (bias_term)
+    {
+        bias_data = mb.load(num_output, 1, opt.weight_allocator);
+        if (bias_data.empty())
+            return -100;
+    }
+
+    return 0;
+}
+
+int Convolution1D::release_model()
+{
+    if (!weight_data.empty())
+        weight_data.release();
+    if (!bias_data.empty())
+        bias_data.release();
+    return 0;
+}
+
 int Convolution1D::create_pipeline(const Option&)
 {
     if (dynamic_weight)
@@ -28,6 +28,10 @@ public:
 
     virtual int load_model(const ModelBin& mb);
 
+    virtual int load_model(const ModelBin& mb, const Option& opt);
+
+    virtual int release_model();
+
     virtual int create_pipeline(const Option& opt);
 
     virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
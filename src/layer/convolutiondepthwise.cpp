@@ -143,6 +143,43 @@ int ConvolutionDepthWise::load_model(const ModelBin& mb, const Option& opt)
             return -100;
     }
 
+#if NCNN_INT8
+    // scales are read through the weight allocator, the per-group copies are tiny and live on the heap
+    if (int8_scale_term == 1 || int8_scale_term == 101)
+    {
+        weight_data_int8_scales = mb.load(group, 1, opt.weight_allocator);
+        Mat bottom_scale = mb.load(1, 1, opt.weight_allocator);
+        if (weight_data_int8_scales.empty() || bottom_scale.empty())
+            return -100;
+
+        bottom_blob_int8_scales = Mat(group);
+        bottom_blob_int8_scales.fill(bottom_scale[0]);
+    }
+    else if (int8_scale_term == 2 || int8_scale_term == 102)
+    {
+        Mat weight_scale = mb.load(1, 1, opt.weight_allocator);
+        Mat bottom_scale = mb.load(1, 1, opt.weight_allocator);
+        if (weight_scale.empty() || bottom_scale.empty())
+            return -100;
+
+        weight_data_int8_scales = Mat(group);
+        weight_data_int8_scales.fill(weight_scale[0]);
+
+        bottom_blob_int8_scales = Mat(group);
+        bottom_blob_int8_scales.fill(bottom_scale[0]);
+    }
+
+    if (int8_scale_term > 100)
+    {
+        Mat top_scale = mb.load(1, 1, opt.weight_allocator);
+        if (top_scale.empty())
+            return -100;
+
+        top_blob_int8_scales = Mat(group);
+        top_blob_int8_scales.fill(top_scale[0]);
+    }
+#endif // NCNN_INT8
+
     return 0;
 }
 
@@ -152,6 +189,14 @@ int ConvolutionDepthWise::release_model()
         weight_data.release();
     if (!bias_data.empty())
         bias_data.release();
+#if NCNN_INT8
+    if (!weight_data_int8_scales.empty())
+        weight_data_int8_scales.release();
+    if (!bottom_blob_int8_scales.empty())
+        bottom_blob_int8_scales.release();
+    if (!top_blob_int8_scales.empty())
+        top_blob_int8_scales.release();
+#endif // NCNN_INT8
     return 0;
 }
 
@@ -0,0 +1,264 @@
+#include "convolutiondepthwisepointwise.h"
+
+#include "cpu.h"
+
+#include "fused_activation.h"
+
+#include <algorithm>
+
+namespace ncnn {
+
+ConvolutionDepthWisePointWise::ConvolutionDepthWisePointWise()
+{
+    one_blob_only = true;
+    support_inplace = false;
+}
+
+int ConvolutionDepthWisePointWise::load_param(const ParamDict& pd)
+{
+    channels = pd.get(0, 0);
+    kernel_w = pd.get(1, 0);
+    kernel_h = pd.get(11, kernel_w);
+    dilation_w = pd.get(2, 1);
+    dilation_h = pd.get(12, dilation_w);
+    stride_w = pd.get(3, 1);
+    stride_h = pd.get(13, stride_w);
+    pad_left = pd.get(4, 0);
+    pad_right = pd.get(15, pad_left);
+    pad_top = pd.get(14, pad_left);
+    pad_bottom = pd.get(16, pad_top);
+    dw_bias_term = pd.get(5, 0);
+    dw_weight_data_size = pd.get(6, 0);
+    dw_activation_type = pd.get(9, 0);
+    dw_activation_params = pd.get(10, Mat());
+
+    num_output = pd.get(20, 0);
+    bias_term = pd.get(21, 0);
+    weight_data_size = pd.get(22, 0);
+    activation_type = pd.get(23, 0);
+    activation_params = pd.get(24, Mat());
+
+    if (pad_left < 0 || pad_right < 0 || pad_top < 0 || pad_bottom < 0)
+    {
+        // SAME padding is resolved by flexnnslice before fusing
+        return -100;
+    }
+
+    return 0;
+}
+
+int ConvolutionDepthWisePointWise::load_model(const ModelBin& mb)
+{
+    dw_weight_data = mb.load(dw_weight_data_size, 0);
+    if (dw_weight_data.empty())
+        return -100;
+
+    if (dw_bias_term)
+    {
+        dw_bias_data = mb.load(channels, 1);
+        if (dw_bias_data.empty())
+            return -100;
+    }
+
+    weight_data = mb.load(weight_data_size, 0);
+    if (weight_data.empty())
+        return -100;
+
+    if (bias_term)
+    {
+        bias_data = mb.load(num_output, 1);
+        if (bias_data.empty())
+            return -100;
+    }
+
+    return 0;
+}
+
+int ConvolutionDepthWisePointWise::load_model(const ModelBin& mb, const Option& opt)
+{
+    dw_weight_data = mb.load(dw_weight_data_size, 0, opt.weight_allocator);
+    if (dw_weight_data.empty())
+        return -100;
+
+    if (dw_bias_term)
+    {
+        dw_bias_data = mb.load(channels, 1, opt.weight_allocator);
+        if (dw_bias_data.empty())
+            return -100;
+    }
+
+    weight_data = mb.load(weight_data_size, 0, opt.weight_allocator);
+    if (weight_data.empty())
+        return -100;
+
+    if (bias_term)
+    {
+        bias_data = mb.load(num_output, 1, opt.weight_allocator);
+        if (bias_data.empty())
+            return -100;
+    }
+
+    return 0;
+}
+
+int ConvolutionDepthWisePointWise::release_model()
+{
+    if (!dw_weight_data.empty())
+        dw_weight_data.release();
+    if (!dw_bias_data.empty())
+        dw_bias_data.release();
+    if (!weight_data.empty())
+        weight_data.release();
+    if (!bias_data.empty())
+        bias_data.release();
+    return 0;
+}
+
+int ConvolutionDepthWisePointWise::get_tile_rows(int _channels, int outw, int outh) const
+{
+    int l2_cache_size = get_cpu_level2_cache_size();
+    if (l2_cache_size <= 0)
+        l2_cache_size = 256 * 1024;
+
+    int tile_rows = (l2_cache_size / 2) / std::max(_channels * outw * (int)sizeof(float), 1);
+
+    return std::min(std::max(tile_rows, 1), outh);
+}
+
+int ConvolutionDepthWisePointWise::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    const int w = bottom_blob.w;
+    const int h = bottom_blob.h;
+
+    const int kernel_extent_w = dilation_w * (kernel_w - 1) + 1;
+    const int kernel_extent_h = dilation_h * (kernel_h - 1) + 1;
+
+    const int outw = (w + pad_left + pad_right - kernel_extent_w) / stride_w + 1;
+    const int outh = (h + pad_top + pad_bottom - kernel_extent_h) / stride_h + 1;
+
+    top_blob.create(outw, outh, num_output, 4u, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    const int maxk = kernel_w * kernel_h;
+
+    const int tile_rows = get_tile_rows(channels, outw, outh);
+
+    // one row per channel, outw * tile_rows depth-wise outputs each
+    Mat dw_tile(outw * tile_rows, channels, 4u, opt.workspace_allocator);
+    if (dw_tile.empty())
+        return -100;
+
+    for (int y0 = 0; y0 < outh; y0 += tile_rows)
+    {
+        const int y1 = std::min(y0 + tile_rows, outh);
+        const int size = (y1 - y0) * outw;
+
+        // depth-wise rows [y0, y1), out of bound taps are the zero padding and skipped
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int g = 0; g < channels; g++)
+        {
+            float* outptr = dw_tile.row(g);
+            const Mat m = bottom_blob.channel(g);
+            const float* kptr = (const float*)dw_weight_data + maxk * g;
+
+            const float bias = dw_bias_term ? dw_bias_data[g] : 0.f;
+
+            for (int i = y0; i < y1; i++)
+            {
+                for (int j = 0; j < outw; j++)
+                {
+                    outptr[j] = bias;
+                }
+
+                for (int y = 0; y < kernel_h; y++)
+                {
+                    const int sy = i * stride_h + y * dilation_h - pad_top;
+                    if (sy < 0 || sy >= h)
+                        continue;
+
+                    const float* sptr = m.row(sy);
+
+                    for (int x = 0; x < kernel_w; x++)
+                    {
+                        // j * stride_w + sx0 in [0, w)
+                        const int sx0 = x * dilation_w - pad_left;
+                        const int j0 = sx0 < 0 ? (-sx0 + stride_w - 1) / stride_w : 0;
+                        const int j1 = sx0 < w ? std::min((w - 1 - sx0) / stride_w + 1, outw) : 0;
+
+                        const float k = kptr[y * kernel_w + x];
+                        for (int j = j0; j < j1; j++)
+                        {
+                            outptr[j] += sptr[j * stride_w + sx0] * k;
+                        }
+                    }
+                }
+
+                if (dw_activation_type)
+                {
+                    for (int j = 0; j < outw; j++)
+                    {
+                        outptr[j] = activation_ss(outptr[j], dw_activation_type, dw_activation_params);
+                    }
+                }
+
+                outptr += outw;
+            }
+        }
+
+        // point-wise over the tile while it is still in cache
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int p = 0; p < num_output; p++)
+        {
+            float* outptr = top_blob.channel(p).row(y0);
+            const float* kptr = (const float*)weight_data + channels * p;
+
+            const float bias = bias_term ? bias_data[p] : 0.f;
+
+            for (int j = 0; j < size; j++)
+            {
+                outptr[j] = bias;
+            }
+
+            for (int q = 0; q < channels; q++)
+            {
+                const float* sptr = dw_tile.row(q);
+                const float k = kptr[q];
+                for (int j = 0; j < size; j++)
+                {
+                    outptr[j] += sptr[j] * k;
+                }
+            }
+
+            if (activation_type)
+            {
+                for (int j = 0; j < size; j++)
+                {
+                    outptr[j] = activation_ss(outptr[j], activation_type, activation_params);
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+int ConvolutionDepthWisePointWise::forward(const flexnn::DummyMat& bottom_blob, flexnn::DummyMat& top_blob, const Option& opt) const
+{
+    const int w = bottom_blob.w;
+    const int h = bottom_blob.h;
+
+    const int kernel_extent_w = dilation_w * (kernel_w - 1) + 1;
+    const int kernel_extent_h = dilation_h * (kernel_h - 1) + 1;
+
+    const int outw = (w + pad_left + pad_right - kernel_extent_w) / stride_w + 1;
+    const int outh = (h + pad_top + pad_bottom - kernel_extent_h) / stride_h + 1;
+
+    top_blob.create(outw, outh, num_output, 4u, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,65 @@
+#ifndef LAYER_CONVOLUTIONDEPTHWISEPOINTWISE_H
+#define LAYER_CONVOLUTIONDEPTHWISEPOINTWISE_H
+
+#include "layer.h"
+
+namespace ncnn {
+
+// fused ConvolutionDepthWise + Convolution 1x1, written by flexnnslice
+// the depth-wise output is computed in row tiles that stay in cache and is never stored as a blob
+class ConvolutionDepthWisePointWise : public Layer
+{
+public:
+    ConvolutionDepthWisePointWise();
+
+    virtual int load_param(const ParamDict& pd);
+
+    virtual int load_model(const ModelBin& mb);
+
+    virtual int load_model(const ModelBin& mb, const Option& opt);
+
+    virtual int release_model();
+
+    virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
+
+    virtual int forward(const flexnn::DummyMat& bottom_blob, flexnn::DummyMat& top_blob, const Option& opt) const;
+
+protected:
+    // depth-wise output rows per tile, so that one tile of all channels fits in half of the l2 cache
+    int get_tile_rows(int channels, int outw, int outh) const;
+
+public:
+    // param, depth-wise
+    int channels;
+    int kernel_w;
+    int kernel_h;
+    int dilation_w;
+    int dilation_h;
+    int stride_w;
+    int stride_h;
+    int pad_left; // zero padding only
+    int pad_right;
+    int pad_top;
+    int pad_bottom;
+    int dw_bias_term;
+    int dw_weight_data_size;
+    int dw_activation_type;
+    Mat dw_activation_params;
+
+    // param, point-wise
+    int num_output;
+    int bias_term;
+    int weight_data_size;
+    int activation_type;
+    Mat activation_params;
+
+    // model
+    Mat dw_weight_data;
+    Mat dw_bias_data;
+    Mat weight_data;
+    Mat bias_data;
+};
+
+} // namespace ncnn
+
+#endif // LAYER_CONVOLUTIONDEPTHWISEPOINTWISE_H
@@ -28,6 +28,10 @@ public:
 
     virtual int load_model(const ModelBin& mb);
 
+    virtual int load_model(const ModelBin& mb, const Option& opt);
+
+    virtual int release_model();
+
     virtual int forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const;
 
 public:
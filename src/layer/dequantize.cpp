@@ -46,6 +46,31 @@ int Dequantize::load_model(const ModelBin& mb)
     return 0;
 }
 
+int Dequantize::load_model(const ModelBin& mb, const Option& opt)
+{
+    scale_data = mb.load(scale_data_size, 1, opt.weight_allocator);
+    if (scale_data.empty())
+        return -100;
+
+    if (bias_data_size)
+    {
+        bias_data = mb.load(bias_data_size, 1, opt.weight_allocator);
+        if (bias_data.empty())
+            return -100;
+    }
+
+    return 0;
+}
+
+int Dequantize::release_model()
+{
+    if (!scale_data.empty())
+        scale_data.release();
+    if (!bias_data.empty())
+        bias_data.release();
+    return 0;
+}
+
 int Dequantize::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
 {
     int dims = bottom_blob.dims;
@@ -186,4 +186,16 @@ int Eltwise::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top
     return 0;
 }
 
+int Eltwise::forward(const std::vector<flexnn::DummyMat>& bottom_blobs, std::vector<flexnn::DummyMat>& top_blobs, const Option& opt) const
+{
+    const flexnn::DummyMat& bottom_blob = bottom_blobs[0];
+
+    flexnn::DummyMat& top_blob = top_blobs[0];
+    top_blob.create_like(bottom_blob, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    return 0;
+}
+
 } // namespace ncnn
@@ -28,6 +28,8 @@ public:
 
     virtual int forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const;
 
+    virtual int forward(const std::vector<flexnn::DummyMat>& bottom_blobs, std::vector<flexnn::DummyMat>& top_blobs, const Option& opt) const;
+
     enum OperationType
     {
         Operation_PROD = 0,
@@ -50,6 +50,31 @@ int Embed::load_model(const ModelBin& mb)
     return 0;
 }
 
+int Embed::load_model(const ModelBin& mb, const Option& opt)
+{
+    weight_data = mb.load(weight_data_size, 0, opt.weight_allocator);
+    if (weight_data.empty())
+        return -100;
+
+    if (bias_term)
+    {
+        bias_data = mb.load(num_output, 1, opt.weight_allocator);
+        if (bias_data.empty())
+            return -100;
+    }
+
+    return 0;
+}
+
+int Embed::release_model()
+{
+    if (!weight_data.empty())
+        weight_data.release();
+    if (!bias_data.empty())
+        bias_data.release();
+    return 0;
+}
+
 int Embed::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
 {
     int words = static_cast<int>(bottom_blob.total());
@@ -39,8 +39,9 @@ int Gather::forward(const std::vector<flexnn::DummyMat>& bottom_blobs, std::vect
     int w = bottom_blobs[1].w;
     int n_embd = bottom_blobs[0].w;
 
+    // rows are copied from the table, the output keeps its storage
     flexnn::DummyMat& top_blob = top_blobs[0];
-    top_blob.create(n_embd, w, 4u, opt.blob_allocator);
+    top_blob.create(n_embd, w, bottom_blobs[0].elemsize, opt.blob_allocator);
     if (top_blob.empty())
         return -100;
     return 0;
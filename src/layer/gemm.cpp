@@ -14,12 +14,16 @@
 
 #include "gemm.h"
 
+#include <algorithm>
+
 namespace ncnn {
 
 Gemm::Gemm()
 {
     one_blob_only = false;
     support_inplace = false;
+
+    B_chunk_rows = 0;
 }
 
 int Gemm::load_param(const ParamDict& pd)
@@ -136,6 +140,11 @@ int Gemm::load_model(const ModelBin& mb, const Option& opt)
             return -100;
     }
 
+    return load_model_C(mb, opt);
+}
+
+int Gemm::load_model_C(const ModelBin& mb, const Option& opt)
+{
     if (constantC == 1 && constant_broadcast_type_C != -1)
     {
         if (constant_broadcast_type_C == 0)
@@ -155,6 +164,64 @@ int Gemm::load_model(const ModelBin& mb, const Option& opt)
     return 0;
 }
 
+int Gemm::load_model_chunked_begin(const ModelBin& mb, const Option& opt)
+{
+    B_chunk_rows = 0;
+
+    if (constantB == 0 || output_transpose)
+        return Layer::load_model_chunked_begin(mb, opt);
+
+    if (constantA == 1)
+    {
+        if (transA == 0)
+            A_data = mb.load(constantK, constantM, 0, opt.weight_allocator);
+        else
+            A_data = mb.load(constantM, constantK, 0, opt.weight_allocator);
+        if (A_data.empty())
+            return -100;
+    }
+
+    // transB == 0 chunks along K and accumulates, transB == 1 chunks along N
+    const int B_w = transB == 0 ? constantN : constantK;
+    const int B_h = transB == 0 ? constantK : constantN;
+
+    int ret = mb.load_chunked_begin(B_w * B_h, B_data, opt.weight_allocator);
+    if (ret < 0)
+        return -100;
+
+    B_data = B_data.reshape(B_w, B_h);
+
+    if (ret == 0)
+    {
+        // B_data is complete, only C remains
+        return load_model_C(mb, opt);
+    }
+
+    B_chunk_rows = std::max(1, (int)(opt.weight_chunk_size / (B_w * sizeof(float))));
+
+    return (B_h + B_chunk_rows - 1) / B_chunk_rows;
+}
+
+int Gemm::load_model_chunk(const ModelBin& mb, int i, const Option& opt)
+{
+    const int B_h = B_data.h;
+    const int chunk_count = (B_h + B_chunk_rows - 1) / B_chunk_rows;
+
+    if (i < chunk_count)
+    {
+        const int r0 = i * B_chunk_rows;
+        const int rows = std::min(B_chunk_rows, B_h - r0);
+
+        if (mb.load_chunk(B_data.row(r0), (size_t)rows * B_data.w * sizeof(float)) != 0)
+            return -100;
+
+        return 0;
+    }
+
+    // tail
+    return load_model_C(mb, opt);
+}
+
 int Gemm::release_model()
 {
     if (!A_data.empty())
@@ -30,6 +30,10 @@ public:
 
     virtual int load_model(const ModelBin& mb, const Option& opt);
 
+    virtual int load_model_chunked_begin(const ModelBin& mb, const Option& opt);
+
+    virtual int load_model_chunk(const ModelBin& mb, int i, const Option& opt);
+
     virtual int release_model();
 
     virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
@@ -40,6 +44,9 @@ public:
 
     virtual int forward(const std::vector<flexnn::DummyMat>& bottom_blobs, std::vector<flexnn::DummyMat>& top_blobs, const Option& opt) const;
 
+protected:
+    int load_model_C(const ModelBin& mb, const Option& opt);
+
 public:
     float alpha;
     float beta;
@@ -66,6 +73,9 @@ public:
     Mat A_data;
     Mat B_data;
     Mat C_data;
+
+    // rows of B_data per weight chunk, 0 if not loaded in chunks
+    int B_chunk_rows;
 };
 
 } // namespace ncnn
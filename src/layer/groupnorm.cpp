@@ -50,6 +50,31 @@ int GroupNorm::load_model(const ModelBin& mb)
     return 0;
 }
 
+int GroupNorm::load_model(const ModelBin& mb, const Option& opt)
+{
+    if (affine == 0)
+        return 0;
+
+    gamma_data = mb.load(channels, 1, opt.weight_allocator);
+    if (gamma_data.empty())
+        return -100;
+
+    beta_data = mb.load(channels, 1, opt.weight_allocator);
+    if (beta_data.empty())
+        return -100;
+
+    return 0;
+}
+
+int GroupNorm::release_model()
+{
+    if (!gamma_data.empty())
+        gamma_data.release();
+    if (!beta_data.empty())
+        beta_data.release();
+    return 0;
+}
+
 int GroupNorm::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
 {
     const int dims = bottom_top_blob.dims;
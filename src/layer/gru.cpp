@@ -54,6 +54,39 @@ int GRU::load_model(const ModelBin& mb)
     return 0;
 }
 
+int GRU::load_model(const ModelBin& mb, const Option& opt)
+{
+    int num_directions = direction == 2 ? 2 : 1;
+
+    int size = weight_data_size / num_directions / num_output / 3;
+
+    // raw weight data
+    weight_xc_data = mb.load(size, num_output * 3, num_directions, 0, opt.weight_allocator);
+    if (weight_xc_data.empty())
+        return -100;
+
+    bias_c_data = mb.load(num_output, 4, num_directions, 0, opt.weight_allocator);
+    if (bias_c_data.empty())
+        return -100;
+
+    weight_hc_data = mb.load(num_output, num_output * 3, num_directions, 0, opt.weight_allocator);
+    if (weight_hc_data.empty())
+        return -100;
+
+    return 0;
+}
+
+int GRU::release_model()
+{
+    if (!weight_xc_data.empty())
+        weight_xc_data.release();
+    if (!bias_c_data.empty())
+        bias_c_data.release();
+    if (!weight_hc_data.empty())
+        weight_hc_data.release();
+    return 0;
+}
+
 static int gru(const Mat& bottom_blob, Mat& top_blob, int reverse, const Mat& weight_xc, const Mat& bias_c, const Mat& weight_hc, Mat& hidden_state, const Option& opt)
 {
     int size = bottom_blob.w;
@@ -18,12 +18,18 @@
 
 #include "fused_activation.h"
 
+#include "blocksparse.h"
+
+#include <algorithm>
+
 namespace ncnn {
 
 InnerProduct::InnerProduct()
 {
     one_blob_only = true;
     support_inplace = false;
+
+    weight_chunk_rows = 0;
 }
 
 int InnerProduct::load_param(const ParamDict& pd)
@@ -34,6 +40,16 @@ int InnerProduct::load_param(const ParamDict& pd)
     int8_scale_term = pd.get(8, 0);
     activation_type = pd.get(9, 0);
     activation_params = pd.get(10, Mat());
+    sparse_block_count = pd.get(20, 0);
+
+    if (sparse_block_count)
+    {
+        // the sparse kernels are fp32 elempack 1 only, and the bitmap is needed before any block
+        support_packing = false;
+        support_fp16_storage = false;
+        support_bf16_storage = false;
+        support_weight_chunks = false;
+    }
 
     if (int8_scale_term)
     {
@@ -50,7 +66,15 @@ int InnerProduct::load_param(const ParamDict& pd)
 
 int InnerProduct::load_model(const ModelBin& mb)
 {
-    weight_data = mb.load(weight_data_size, 0);
+    if (sparse_block_count)
+    {
+        const int num_input = weight_data_size / num_output;
+        weight_sparse_bitmap = mb.load(num_output * blocksparse_words(num_input), 1);
+        if (weight_sparse_bitmap.empty())
+            return -100;
+    }
+
+    weight_data = mb.load(sparse_block_count ? sparse_block_count * 4 : weight_data_size, 0);
     if (weight_data.empty())
         return -100;
 
@@ -74,7 +98,15 @@ int InnerProduct::load_model(const ModelBin& mb)
 
 int InnerProduct::load_model(const ModelBin& mb, const Option& opt)
 {
-    weight_data = mb.load(weight_data_size, 0, opt.weight_allocator);
+    if (sparse_block_count)
+    {
+        const int num_input = weight_data_size / num_output;
+        weight_sparse_bitmap = mb.load(num_output * blocksparse_words(num_input), 1, opt.weight_allocator);
+        if (weight_sparse_bitmap.empty())
+            return -100;
+    }
+
+    weight_data = mb.load(sparse_block_count ? sparse_block_count * 4 : weight_data_size, 0, opt.weight_allocator);
     if (weight_data.empty())
         return -100;
 
@@ -85,6 +117,66 @@ int InnerProduct::load_model(const ModelBin& mb, const Option& opt)
             return -100;
     }
 
+#if NCNN_INT8
+    if (int8_scale_term)
+    {
+        weight_data_int8_scales = mb.load(num_output, 1, opt.weight_allocator);
+        bottom_blob_int8_scales = mb.load(1, 1, opt.weight_allocator);
+    }
+#endif // NCNN_INT8
+
+    return 0;
+}
+
+int InnerProduct::load_model_chunked_begin(const ModelBin& mb, const Option& opt)
+{
+    weight_chunk_rows = 0;
+
+    if (int8_scale_term || sparse_block_count)
+        return Layer::load_model_chunked_begin(mb, opt);
+
+    int ret = mb.load_chunked_begin(weight_data_size, weight_data, opt.weight_allocator);
+    if (ret < 0)
+        return -100;
+
+    if (ret == 0)
+    {
+        // weight_data is complete, only bias remains
+        return load_model_chunk(mb, 0, opt);
+    }
+
+    // chunk along output rows
+    const int num_input = weight_data_size / num_output;
+    weight_chunk_rows = std::max(1, (int)(opt.weight_chunk_size / (num_input * sizeof(float))));
+
+    return (num_output + weight_chunk_rows - 1) / weight_chunk_rows;
+}
+
+int InnerProduct::load_model_chunk(const ModelBin& mb, int i, const Option& opt)
+{
+    const int num_input = weight_data_size / num_output;
+    const int chunk_count = weight_chunk_rows ? (num_output + weight_chunk_rows - 1) / weight_chunk_rows : 0;
+
+    if (i < chunk_count)
+    {
+        const int p0 = i * weight_chunk_rows;
+        const int rows = std::min(weight_chunk_rows, num_output - p0);
+
+        float* ptr = (float*)weight_data + (size_t)p0 * num_input;
+        if (mb.load_chunk(ptr, (size_t)rows * num_input * sizeof(float)) != 0)
+            return -100;
+
+        return 0;
+    }
+
+    // tail
+    if (bias_term)
+    {
+        bias_data = mb.load(num_output, 1, opt.weight_allocator);
+        if (bias_data.empty())
+            return -100;
+    }
+
     return 0;
 }
 
@@ -94,6 +186,8 @@ int InnerProduct::release_model()
         weight_data.release();
     if (!bias_data.empty())
         bias_data.release();
+    if (!weight_sparse_bitmap.empty())
+        weight_sparse_bitmap.release();
     if (!weight_data_int8_scales.empty())
         weight_data_int8_scales.release();
     if (!bottom_blob_int8_scales.empty())
@@ -129,6 +223,11 @@ int InnerProduct::create_pipeline(const Option& opt)
 
 int InnerProduct::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
 {
+    if (sparse_block_count)
+    {
+        return innerproduct_blocksparse(bottom_blob, top_blob, weight_sparse_bitmap, weight_data, bias_data, num_output, weight_data_size / num_output, activation_type, activation_params, opt);
+    }
+
 #if NCNN_INT8
     if (opt.use_int8_inference && weight_data.elemsize == (size_t)1u)
     {
@@ -30,6 +30,10 @@ public:
 
     virtual int load_model(const ModelBin& mb, const Option& opt);
 
+    virtual int load_model_chunked_begin(const ModelBin& mb, const Option& opt);
+
+    virtual int load_model_chunk(const ModelBin& mb, int i, const Option& opt);
+
     virtual int release_model();
 
     virtual int create_pipeline(const Option& opt);
@@ -56,9 +60,16 @@ public:
     int activation_type;
     Mat activation_params;
 
-    // model
+    // number of nonzero 1x4 blocks of a block sparse weight, 0 for dense
+    int sparse_block_count;
+
+    // model, weight_data holds the nonzero blocks of a block sparse weight
     Mat weight_data;
     Mat bias_data;
+    Mat weight_sparse_bitmap;
+
+    // output rows per weight chunk, 0 if not loaded in chunks
+    int weight_chunk_rows;
 
 #if NCNN_INT8
     Mat weight_data_int8_scales;
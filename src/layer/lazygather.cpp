@@ -0,0 +1,132 @@
+#include "lazygather.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+namespace ncnn {
+
+LazyGather::LazyGather()
+{
+    one_blob_only = true;
+    support_inplace = false;
+
+    fd = -1;
+    offset = 0;
+}
+
+int LazyGather::load_param(const ParamDict& pd)
+{
+    n_embd = pd.get(0, 0);
+    n_rows = pd.get(1, 0);
+
+    return 0;
+}
+
+int LazyGather::load_model(const ModelBin& mb)
+{
+    weight_data = mb.load(n_embd, n_rows, 1);
+    if (weight_data.empty())
+        return -100;
+
+    return 0;
+}
+
+int LazyGather::load_model(const ModelBin& mb, const Option& opt)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    // streamed layers are loaded and computed within one extract, so the model file stays open
+    if (opt.use_ondemand_loading || opt.use_parallel_preloading)
+    {
+        if (mb.locate(n_embd * n_rows, &fd, &offset) == 0)
+            return 0;
+    }
+#endif
+
+    weight_data = mb.load(n_embd, n_rows, 1, opt.weight_allocator);
+    if (weight_data.empty())
+        return -100;
+
+    return 0;
+}
+
+int LazyGather::release_model()
+{
+    if (!weight_data.empty())
+        weight_data.release();
+
+    fd = -1;
+    offset = 0;
+
+    return 0;
+}
+
+int LazyGather::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    int w = bottom_blob.w;
+
+    top_blob.create(n_embd, w, 4u, 1, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    const float* in = bottom_blob;
+    const size_t row_size = n_embd * sizeof(float);
+
+    if (!weight_data.empty())
+    {
+        const float* weight = weight_data;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int i = 0; i < w; i++)
+        {
+            int idx = std::min(std::max((int)std::round(in[i]), 0), n_rows - 1);
+            memcpy(top_blob.row(i), weight + (size_t)idx * n_embd, row_size);
+        }
+
+        return 0;
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+    if (fd < 0)
+    {
+        NCNN_LOGE("LazyGather table not located");
+        return -100;
+    }
+
+    int ret = 0;
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int i = 0; i < w; i++)
+    {
+        int idx = std::min(std::max((int)std::round(in[i]), 0), n_rows - 1);
+        ssize_t nread = pread(fd, top_blob.row(i), row_size, (off_t)(offset + (size_t)idx * row_size));
+        if (nread != (ssize_t)row_size)
+        {
+            NCNN_LOGE("LazyGather read row %d failed %zd", idx, nread);
+            #pragma omp atomic write
+            ret = -100;
+        }
+    }
+
+    return ret;
+#else
+    return -100;
+#endif
+}
+
+int LazyGather::forward(const flexnn::DummyMat& bottom_blob, flexnn::DummyMat& top_blob, const Option& opt) const
+{
+    int w = bottom_blob.w;
+
+    // no fp16 / bf16 storage, the bottom is cast to fp32 like the table
+    top_blob.create(n_embd, w, bottom_blob.elemsize, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,41 @@
+#ifndef LAZY_GATHER_H
+#define LAZY_GATHER_H
+
+#include "layer.h"
+
+namespace ncnn {
+
+// fused MemoryData + Gather, reads only the indexed rows of the table
+class LazyGather : public Layer
+{
+public:
+    LazyGather();
+
+    virtual int load_param(const ParamDict& pd);
+
+    virtual int load_model(const ModelBin& mb);
+
+    virtual int load_model(const ModelBin& mb, const Option& opt);
+
+    virtual int release_model();
+
+    virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
+
+    virtual int forward(const flexnn::DummyMat& bottom_blob, flexnn::DummyMat& top_blob, const Option& opt) const;
+
+public:
+    // param
+    int n_embd;
+    int n_rows;
+
+    // model, empty if rows are read on demand
+    Mat weight_data;
+
+    // table location in the model file for positioned reads
+    int fd;
+    size_t offset;
+};
+
+} // namespace ncnn
+
+#endif // LAZY_GATHER_H
@@ -62,6 +62,48 @@ int LSTM::load_model(const ModelBin& mb)
     return 0;
 }
 
+int LSTM::load_model(const ModelBin& mb, const Option& opt)
+{
+    int num_directions = direction == 2 ? 2 : 1;
+
+    int size = weight_data_size / num_directions / hidden_size / 4;
+
+    // raw weight data
+    weight_xc_data = mb.load(size, hidden_size * 4, num_directions, 0, opt.weight_allocator);
+    if (weight_xc_data.empty())
+        return -100;
+
+    bias_c_data = mb.load(hidden_size, 4, num_directions, 0, opt.weight_allocator);
+    if (bias_c_data.empty())
+        return -100;
+
+    weight_hc_data = mb.load(num_output, hidden_size * 4, num_directions, 0, opt.weight_allocator);
+    if (weight_hc_data.empty())
+        return -100;
+
+    if (num_output != hidden_size)
+    {
+        weight_hr_data = mb.load(hidden_size, num_output, num_directions, 0, opt.weight_allocator);
+        if (weight_hr_data.empty())
+            return -100;
+    }
+
+    return 0;
+}
+
+int LSTM::release_model()
+{
+    if (!weight_xc_data.empty())
+        weight_xc_data.release();
+    if (!bias_c_data.empty())
+        bias_c_data.release();
+    if (!weight_hc_data.empty())
+        weight_hc_data.release();
+    if (!weight_hr_data.empty())
+        weight_hr_data.release();
+    return 0;
+}
+
 static int lstm(const Mat& bottom_blob, Mat& top_blob, int reverse, const Mat& weight_xc, const Mat& bias_c, const Mat& weight_hc, const Mat& weight_hr, Mat& hidden_state, Mat& cell_state, const Option& opt)
 {
     int size = bottom_blob.w;
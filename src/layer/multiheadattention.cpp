@@ -15,6 +15,7 @@
 #include "multiheadattention.h"
 
 #include <float.h>
+#include <string.h>
 
 namespace ncnn {
 
@@ -29,6 +30,19 @@ int MultiHeadAttention::load_param(const ParamDict& pd)
     weight_data_size = pd.get(2, 0);
     kdim = pd.get(3, embed_dim);
     vdim = pd.get(4, embed_dim);
+    kv_cache = pd.get(7, 0);
+
+    // q input and out projection output width, differs from embed_dim for head-group slices
+    qdim = embed_dim > 0 ? weight_data_size / embed_dim : 0;
+
+    if (kv_cache)
+    {
+        // incremental decoding runs the fp32 reference path on unpacked blobs
+        // decided here so that shape inference and planning see the same storage as the run
+        support_packing = false;
+        support_fp16_storage = false;
+        support_bf16_storage = false;
+    }
 
     return 0;
 }
@@ -63,7 +77,7 @@ int MultiHeadAttention::load_model(const ModelBin& mb)
     if (out_weight_data.empty())
         return -100;
 
-    out_bias_data = mb.load(embed_dim, 1);
+    out_bias_data = mb.load(qdim, 1);
     if (out_bias_data.empty())
         return -100;
 
@@ -100,7 +114,7 @@ int MultiHeadAttention::load_model(const ModelBin& mb, const Option& opt)
     if (out_weight_data.empty())
         return -100;
 
-    out_bias_data = mb.load(embed_dim, 1, opt.weight_allocator);
+    out_bias_data = mb.load(qdim, 1, opt.weight_allocator);
     if (out_bias_data.empty())
         return -100;
 
@@ -131,6 +145,9 @@ int MultiHeadAttention::release_model()
 // refers to https://pytorch.org/docs/stable/generated/torch.nn.MultiheadAttention.html
 int MultiHeadAttention::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
 {
+    if (kv_cache)
+        return forward_kv_cache(bottom_blobs, top_blobs, opt);
+
     const Mat& q_blob = bottom_blobs[0];
     const Mat& k_blob = bottom_blobs.size() == 1 ? q_blob : bottom_blobs[1];
     const Mat& v_blob = bottom_blobs.size() == 1 ? q_blob : bottom_blobs.size() == 2 ? k_blob : bottom_blobs[2];
@@ -142,7 +159,7 @@ int MultiHeadAttention::forward(const std::vector<Mat>& bottom_blobs, std::vecto
     // assert k_blob.h == v_blob.h
 
     Mat& top_blob = top_blobs[0];
-    top_blob.create(embed_dim, src_seqlen, 4u, opt.blob_allocator);
+    top_blob.create(qdim, src_seqlen, 4u, opt.blob_allocator);
     if (top_blob.empty())
         return -1;
 
@@ -170,10 +187,10 @@ int MultiHeadAttention::forward(const std::vector<Mat>& bottom_blobs, std::vecto
                 for (int j = 0; j < embed_dim_per_head; j++)
                 {
                     const float* ptr = q_blob.row(i);
-                    const float* kptr = (const float*)q_weight_data + embed_dim * (q * embed_dim_per_head + j);
+                    const float* kptr = (const float*)q_weight_data + qdim * (q * embed_dim_per_head + j);
 
                     float sum = q_bias_data[q * embed_dim_per_head + j];
-                    for (int k = 0; k < embed_dim; k++)
+                    for (int k = 0; k < qdim; k++)
                     {
                         sum += *ptr++ * *kptr++;
                     }
@@ -324,7 +341,7 @@ int MultiHeadAttention::forward(const std::vector<Mat>& bottom_blobs, std::vecto
     {
         float* outptr = top_blob.row(i);
 
-        for (int j = 0; j < embed_dim; j++)
+        for (int j = 0; j < qdim; j++)
         {
             const float* ptr = xqkv.channel(i);
             const float* kptr = (const float*)out_weight_data + embed_dim * j;
@@ -342,6 +359,205 @@ int MultiHeadAttention::forward(const std::vector<Mat>& bottom_blobs, std::vecto
     return 0;
 }
 
+// incremental decoding, the new key / value projections are appended to the past ones
+// and only the new queries are computed, so the projection cost does not grow with the sequence
+int MultiHeadAttention::forward_kv_cache(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    const int input_count = (int)bottom_blobs.size() - 2;
+
+    const Mat& q_blob = bottom_blobs[0];
+    const Mat& k_blob = input_count == 1 ? q_blob : bottom_blobs[1];
+    const Mat& v_blob = input_count == 1 ? q_blob : input_count == 2 ? k_blob : bottom_blobs[2];
+    const Mat& past_k_blob = bottom_blobs[input_count];
+    const Mat& past_v_blob = bottom_blobs[input_count + 1];
+
+    // empty past on the first step
+    const int past_seqlen = past_k_blob.empty() ? 0 : past_k_blob.h;
+    const int src_seqlen = q_blob.h;
+    const int new_seqlen = k_blob.h;
+    const int dst_seqlen = past_seqlen + new_seqlen;
+    const int embed_dim_per_head = embed_dim / num_head;
+
+    if (past_seqlen > 0 && (past_k_blob.w != embed_dim || past_v_blob.w != embed_dim || past_v_blob.h != past_seqlen))
+    {
+        NCNN_LOGE("MultiHeadAttention kv_cache shape mismatch");
+        return -1;
+    }
+
+    Mat& top_blob = top_blobs[0];
+    top_blob.create(qdim, src_seqlen, 4u, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    Mat& present_k_blob = top_blobs[1];
+    Mat& present_v_blob = top_blobs[2];
+    present_k_blob.create(embed_dim, dst_seqlen, 4u, opt.blob_allocator);
+    present_v_blob.create(embed_dim, dst_seqlen, 4u, opt.blob_allocator);
+    if (present_k_blob.empty() || present_v_blob.empty())
+        return -100;
+
+    if (past_seqlen > 0)
+    {
+        memcpy(present_k_blob, past_k_blob, (size_t)past_seqlen * embed_dim * sizeof(float));
+        memcpy(present_v_blob, past_v_blob, (size_t)past_seqlen * embed_dim * sizeof(float));
+    }
+
+    // present = past ++ affine(new)
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int i = 0; i < new_seqlen; i++)
+    {
+        float* koutptr = present_k_blob.row(past_seqlen + i);
+        float* voutptr = present_v_blob.row(past_seqlen + i);
+
+        for (int j = 0; j < embed_dim; j++)
+        {
+            const float* ptr = k_blob.row(i);
+            const float* kptr = (const float*)k_weight_data + kdim * j;
+
+            float sum = k_bias_data[j];
+            for (int k = 0; k < kdim; k++)
+            {
+                sum += *ptr++ * *kptr++;
+            }
+
+            koutptr[j] = sum;
+        }
+
+        for (int j = 0; j < embed_dim; j++)
+        {
+            const float* ptr = v_blob.row(i);
+            const float* kptr = (const float*)v_weight_data + vdim * j;
+
+            float sum = v_bias_data[j];
+            for (int k = 0; k < vdim; k++)
+            {
+                sum += *ptr++ * *kptr++;
+            }
+
+            voutptr[j] = sum;
+        }
+    }
+
+    Mat xq(embed_dim, src_seqlen, 4u, opt.workspace_allocator);
+    Mat xqk(dst_seqlen, src_seqlen, num_head, 4u, opt.workspace_allocator);
+    Mat xqkv(embed_dim, src_seqlen, 4u, opt.workspace_allocator);
+    if (xq.empty() || xqk.empty() || xqkv.empty())
+        return -100;
+
+    const float inv_sqrt_embed_dim_per_head = 1.f / sqrt(embed_dim_per_head);
+
+    // xq = affine(q) * inv_sqrt_embed_dim_per_head
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int i = 0; i < src_seqlen; i++)
+    {
+        float* outptr = xq.row(i);
+
+        for (int j = 0; j < embed_dim; j++)
+        {
+            const float* ptr = q_blob.row(i);
+            const float* kptr = (const float*)q_weight_data + qdim * j;
+
+            float sum = q_bias_data[j];
+            for (int k = 0; k < qdim; k++)
+            {
+                sum += *ptr++ * *kptr++;
+            }
+
+            outptr[j] = sum * inv_sqrt_embed_dim_per_head;
+        }
+    }
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q = 0; q < num_head; q++)
+    {
+        Mat outm = xqk.channel(q);
+
+        for (int i = 0; i < src_seqlen; i++)
+        {
+            float* outptr = outm.row(i);
+
+            // causal over the new tokens, so that a prompt gives the same cache fed at once or token by token
+            const int valid_seqlen = src_seqlen > 1 ? std::min(dst_seqlen, past_seqlen + i + 1) : dst_seqlen;
+
+            // xqk = xq * present_k
+            for (int j = 0; j < valid_seqlen; j++)
+            {
+                const float* qptr = xq.row(i) + q * embed_dim_per_head;
+                const float* kptr = present_k_blob.row(j) + q * embed_dim_per_head;
+
+                float sum = 0.f;
+                for (int k = 0; k < embed_dim_per_head; k++)
+                {
+                    sum += *qptr++ * *kptr++;
+                }
+
+                outptr[j] = sum;
+            }
+
+            // softmax(xqk)
+            float max = -FLT_MAX;
+            for (int j = 0; j < valid_seqlen; j++)
+            {
+                max = std::max(max, outptr[j]);
+            }
+
+            float sum = 0.f;
+            for (int j = 0; j < valid_seqlen; j++)
+            {
+                outptr[j] = (float)(exp(outptr[j] - max));
+                sum += outptr[j];
+            }
+
+            for (int j = 0; j < valid_seqlen; j++)
+            {
+                outptr[j] /= sum;
+            }
+
+            // xqkv = xqk * present_v
+            float* xqkvptr = xqkv.row(i) + q * embed_dim_per_head;
+
+            for (int k = 0; k < embed_dim_per_head; k++)
+            {
+                xqkvptr[k] = 0.f;
+            }
+
+            for (int j = 0; j < valid_seqlen; j++)
+            {
+                const float* vptr = present_v_blob.row(j) + q * embed_dim_per_head;
+                const float w = outptr[j];
+
+                for (int k = 0; k < embed_dim_per_head; k++)
+                {
+                    xqkvptr[k] += w * vptr[k];
+                }
+            }
+        }
+    }
+
+    // out = affine(xqkv)
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int i = 0; i < src_seqlen; i++)
+    {
+        float* outptr = top_blob.row(i);
+
+        for (int j = 0; j < qdim; j++)
+        {
+            const float* ptr = xqkv.row(i);
+            const float* kptr = (const float*)out_weight_data + embed_dim * j;
+
+            float sum = out_bias_data[j];
+            for (int k = 0; k < embed_dim; k++)
+            {
+                sum += *ptr++ * *kptr++;
+            }
+
+            outptr[j] = sum;
+        }
+    }
+
+    return 0;
+}
+
 // refers to https://pytorch.org/docs/stable/generated/torch.nn.MultiheadAttention.html
 int MultiHeadAttention::forward(const std::vector<flexnn::DummyMat>& bottom_blobs, std::vector<flexnn::DummyMat>& top_blobs, const Option& opt) const
 {
@@ -350,13 +566,39 @@ int MultiHeadAttention::forward(const std::vector<flexnn::DummyMat>& bottom_blob
     // const flexnn::DummyMat& v_blob = bottom_blobs.size() == 1 ? q_blob : bottom_blobs.size() == 2 ? k_blob : bottom_blobs[2];
 
     const int src_seqlen = q_blob.h;
-    const int dst_seqlen = k_blob.h;
     const int embed_dim_per_head = embed_dim / num_head;
 
+    if (kv_cache)
+    {
+        const int input_count = (int)bottom_blobs.size() - 2;
+        const flexnn::DummyMat& new_k_blob = input_count == 1 ? q_blob : bottom_blobs[1];
+        const flexnn::DummyMat& past_k_blob = bottom_blobs[input_count];
+
+        const int past_seqlen = past_k_blob.empty() ? 0 : past_k_blob.h;
+        const int dst_seqlen = past_seqlen + new_k_blob.h;
+
+        // fp32 only, the storage flags are cleared in load_param, same elemsize as the run
+        flexnn::DummyMat& top_blob = top_blobs[0];
+        top_blob.create(qdim, src_seqlen, q_blob.elemsize, opt.blob_allocator);
+        top_blobs[1].create(embed_dim, dst_seqlen, q_blob.elemsize, opt.blob_allocator);
+        top_blobs[2].create(embed_dim, dst_seqlen, q_blob.elemsize, opt.blob_allocator);
+        if (top_blob.empty() || top_blobs[1].empty() || top_blobs[2].empty())
+            return -100;
+
+        flexnn::DummyMat xq(embed_dim, src_seqlen, 4u, opt.workspace_allocator);
+        flexnn::DummyMat xqk(dst_seqlen, src_seqlen, num_head, 4u, opt.workspace_allocator);
+        flexnn::DummyMat xqkv(embed_dim, src_seqlen, 4u, opt.workspace_allocator);
+
+        return 0;
+    }
+
+    const int dst_seqlen = k_blob.h;
+
     // assert k_blob.h == v_blob.h
 
+    // half precision storage is kept on the output
     flexnn::DummyMat& top_blob = top_blobs[0];
-    top_blob.create(embed_dim, src_seqlen, 4u, opt.blob_allocator);
+    top_blob.create(qdim, src_seqlen, q_blob.elemsize, opt.blob_allocator);
     if (top_blob.empty())
         return -1;
 
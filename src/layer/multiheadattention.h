@@ -36,12 +36,20 @@ public:
 
     virtual int forward(const std::vector<flexnn::DummyMat>& bottom_blobs, std::vector<flexnn::DummyMat>& top_blobs, const Option& opt) const;
 
+protected:
+    int forward_kv_cache(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const;
+
 public:
     int embed_dim;
     int num_head;
     int weight_data_size;
     int kdim;
     int vdim;
+    int qdim;
+
+    // 1 = take past key / value (embed_dim, past_seqlen) as the last two bottoms,
+    //     produce present key / value (embed_dim, past_seqlen + seqlen) as the last two tops
+    int kv_cache;
 
     Mat q_weight_data;
     Mat q_bias_data;
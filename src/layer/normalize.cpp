@@ -45,6 +45,22 @@ int Normalize::load_model(const ModelBin& mb)
     return 0;
 }
 
+int Normalize::load_model(const ModelBin& mb, const Option& opt)
+{
+    scale_data = mb.load(scale_data_size, 1, opt.weight_allocator);
+    if (scale_data.empty())
+        return -100;
+
+    return 0;
+}
+
+int Normalize::release_model()
+{
+    if (!scale_data.empty())
+        scale_data.release();
+    return 0;
+}
+
 int Normalize::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
 {
     int w = bottom_top_blob.w;
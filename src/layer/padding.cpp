@@ -47,6 +47,23 @@ int Padding::load_model(const ModelBin& mb)
     return 0;
 }
 
+int Padding::load_model(const ModelBin& mb, const Option& opt)
+{
+    if (per_channel_pad_data_size)
+    {
+        per_channel_pad_data = mb.load(per_channel_pad_data_size, 1, opt.weight_allocator);
+    }
+
+    return 0;
+}
+
+int Padding::release_model()
+{
+    if (!per_channel_pad_data.empty())
+        per_channel_pad_data.release();
+    return 0;
+}
+
 template<typename T>
 static void copy_make_border_image(const Mat& src, Mat& dst, int top, int left, int type, T v)
 {
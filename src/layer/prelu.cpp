@@ -38,6 +38,22 @@ int PReLU::load_model(const ModelBin& mb)
     return 0;
 }
 
+int PReLU::load_model(const ModelBin& mb, const Option& opt)
+{
+    slope_data = mb.load(num_slope, 1, opt.weight_allocator);
+    if (slope_data.empty())
+        return -100;
+
+    return 0;
+}
+
+int PReLU::release_model()
+{
+    if (!slope_data.empty())
+        slope_data.release();
+    return 0;
+}
+
 int PReLU::forward_inplace(Mat& bottom_top_blob, const Option& opt) const
 {
     int dims = bottom_top_blob.dims;
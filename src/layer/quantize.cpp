@@ -40,6 +40,22 @@ int Quantize::load_model(const ModelBin& mb)
     return 0;
 }
 
+int Quantize::load_model(const ModelBin& mb, const Option& opt)
+{
+    scale_data = mb.load(scale_data_size, 1, opt.weight_allocator);
+    if (scale_data.empty())
+        return -100;
+
+    return 0;
+}
+
+int Quantize::release_model()
+{
+    if (!scale_data.empty())
+        scale_data.release();
+    return 0;
+}
+
 static inline signed char float2int8(float v)
 {
     int int32 = static_cast<int>(round(v));
@@ -101,6 +101,37 @@ int Requantize::load_model(const ModelBin& mb)
     return 0;
 }
 
+int Requantize::load_model(const ModelBin& mb, const Option& opt)
+{
+    scale_in_data = mb.load(scale_in_data_size, 1, opt.weight_allocator);
+    if (scale_in_data.empty())
+        return -100;
+
+    scale_out_data = mb.load(scale_out_data_size, 1, opt.weight_allocator);
+    if (scale_out_data.empty())
+        return -100;
+
+    if (bias_data_size)
+    {
+        bias_data = mb.load(bias_data_size, 1, opt.weight_allocator);
+        if (bias_data.empty())
+            return -100;
+    }
+
+    return 0;
+}
+
+int Requantize::release_model()
+{
+    if (!scale_in_data.empty())
+        scale_in_data.release();
+    if (!scale_out_data.empty())
+        scale_out_data.release();
+    if (!bias_data.empty())
+        bias_data.release();
+    return 0;
+}
+
 int Requantize::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
 {
     int dims = bottom_blob.dims;
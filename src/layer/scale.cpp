@@ -52,6 +52,34 @@ int Scale::load_model(const ModelBin& mb)
     return 0;
 }
 
+int Scale::load_model(const ModelBin& mb, const Option& opt)
+{
+    if (scale_data_size == -233)
+        return 0;
+
+    scale_data = mb.load(scale_data_size, 1, opt.weight_allocator);
+    if (scale_data.empty())
+        return -100;
+
+    if (bias_term)
+    {
+        bias_data = mb.load(scale_data_size, 1, opt.weight_allocator);
+        if (bias_data.empty())
+            return -100;
+    }
+
+    return 0;
+}
+
+int Scale::release_model()
+{
+    if (!scale_data.empty())
+        scale_data.release();
+    if (!bias_data.empty())
+        bias_data.release();
+    return 0;
+}
+
 int Scale::forward_inplace(std::vector<Mat>& bottom_top_blobs, const Option& opt) const
 {
     Mat& bottom_top_blob = bottom_top_blobs[0];
@@ -0,0 +1,568 @@
+// kernels consuming the weights pretransformed by flexnnslice (weight_data_type 2-6)
+// the weights are read in place, only the input side is packed at run time.
+// generic layout (weight_layout 1): A tiles hold output channels in pairs, interleaved along k, then the odd one.
+
+// im2col of one tile into panels of X86_VECSIZE columns, panel = [kk][X86_VECSIZE], the last one may be narrower
+static void convolution_im2col_pack_B_tile_x86(const Mat& bottom_blob, float* pp, int outw, int j, int max_jj, int k, int max_kk, int kernel_w, int kernel_h, int dilation_w, int dilation_h, int stride_w, int stride_h)
+{
+    const int w = bottom_blob.w;
+    const int maxk = kernel_w * kernel_h;
+
+    int offsets[X86_VECSIZE];
+
+    for (int jj = 0; jj < max_jj; jj += X86_VECSIZE)
+    {
+        const int n = std::min(X86_VECSIZE, max_jj - jj);
+
+        for (int t = 0; t < n; t++)
+        {
+            const int dy = (j + jj + t) / outw;
+            const int dx = (j + jj + t) % outw;
+            offsets[t] = dy * stride_h * w + dx * stride_w;
+        }
+
+        for (int kk = 0; kk < max_kk; kk++)
+        {
+            const int p = (k + kk) / maxk;
+            const int uv = (k + kk) % maxk;
+            const int u = uv / kernel_w;
+            const int v = uv % kernel_w;
+
+            const float* sptr = (const float*)bottom_blob.channel(p) + u * dilation_h * w + v * dilation_w;
+
+            for (int t = 0; t < n; t++)
+            {
+                pp[t] = sptr[offsets[t]];
+            }
+
+            pp += n;
+        }
+    }
+}
+
+// outptr[ii * out_hstep + jj] (+)= sum(A[ii][kk] * B[kk][jj])
+// A is one generic packed tile, B is packed by the function above
+// on the first k tile the output is initialized from bias (may be null) instead of accumulated
+static void convolution_gemm_packed_tile_x86(const float* pA, const float* pB, float* outptr, int out_hstep, const float* bias, int max_ii, int max_jj, int max_kk, bool k_start)
+{
+    int ii = 0;
+    for (; ii + 1 < max_ii; ii += 2)
+    {
+        const float* pA0 = pA + ii * max_kk;
+        const float* pB0 = pB;
+
+        float* outptr0 = outptr + ii * out_hstep;
+        float* outptr1 = outptr0 + out_hstep;
+
+        const float bias0 = bias ? bias[ii] : 0.f;
+        const float bias1 = bias ? bias[ii + 1] : 0.f;
+
+        int jj = 0;
+        for (; jj + X86_VECSIZE * 4 - 1 < max_jj; jj += X86_VECSIZE * 4)
+        {
+            const float* pB1 = pB0 + X86_VECSIZE * max_kk;
+            const float* pB2 = pB1 + X86_VECSIZE * max_kk;
+            const float* pB3 = pB2 + X86_VECSIZE * max_kk;
+
+            x86_vec _sum00, _sum01, _sum02, _sum03;
+            x86_vec _sum10, _sum11, _sum12, _sum13;
+            if (k_start)
+            {
+                _sum00 = _sum01 = _sum02 = _sum03 = x86_vec_set1(bias0);
+                _sum10 = _sum11 = _sum12 = _sum13 = x86_vec_set1(bias1);
+            }
+            else
+            {
+                _sum00 = x86_vec_load(outptr0 + jj);
+                _sum01 = x86_vec_load(outptr0 + jj + X86_VECSIZE);
+                _sum02 = x86_vec_load(outptr0 + jj + X86_VECSIZE * 2);
+                _sum03 = x86_vec_load(outptr0 + jj + X86_VECSIZE * 3);
+                _sum10 = x86_vec_load(outptr1 + jj);
+                _sum11 = x86_vec_load(outptr1 + jj + X86_VECSIZE);
+                _sum12 = x86_vec_load(outptr1 + jj + X86_VECSIZE * 2);
+                _sum13 = x86_vec_load(outptr1 + jj + X86_VECSIZE * 3);
+            }
+
+            for (int kk = 0; kk < max_kk; kk++)
+            {
+                x86_vec _a0 = x86_vec_set1(pA0[kk * 2]);
+                x86_vec _a1 = x86_vec_set1(pA0[kk * 2 + 1]);
+                x86_vec _b0 = x86_vec_load(pB0 + kk * X86_VECSIZE);
+                x86_vec _b1 = x86_vec_load(pB1 + kk * X86_VECSIZE);
+                x86_vec _b2 = x86_vec_load(pB2 + kk * X86_VECSIZE);
+                x86_vec _b3 = x86_vec_load(pB3 + kk * X86_VECSIZE);
+                _sum00 = x86_vec_fmadd(_a0, _b0, _sum00);
+                _sum01 = x86_vec_fmadd(_a0, _b1, _sum01);
+                _sum02 = x86_vec_fmadd(_a0, _b2, _sum02);
+                _sum03 = x86_vec_fmadd(_a0, _b3, _sum03);
+                _sum10 = x86_vec_fmadd(_a1, _b0, _sum10);
+                _sum11 = x86_vec_fmadd(_a1, _b1, _sum11);
+                _sum12 = x86_vec_fmadd(_a1, _b2, _sum12);
+                _sum13 = x86_vec_fmadd(_a1, _b3, _sum13);
+            }
+
+            x86_vec_store(outptr0 + jj, _sum00);
+            x86_vec_store(outptr0 + jj + X86_VECSIZE, _sum01);
+            x86_vec_store(outptr0 + jj + X86_VECSIZE * 2, _sum02);
+            x86_vec_store(outptr0 + jj + X86_VECSIZE * 3, _sum03);
+            x86_vec_store(outptr1 + jj, _sum10);
+            x86_vec_store(outptr1 + jj + X86_VECSIZE, _sum11);
+            x86_vec_store(outptr1 + jj + X86_VECSIZE * 2, _sum12);
+            x86_vec_store(outptr1 + jj + X86_VECSIZE * 3, _sum13);
+
+            pB0 = pB3 + X86_VECSIZE * max_kk;
+        }
+        for (; jj + X86_VECSIZE - 1 < max_jj; jj += X86_VECSIZE)
+        {
+            x86_vec _sum0 = k_start ? x86_vec_set1(bias0) : x86_vec_load(outptr0 + jj);
+            x86_vec _sum1 = k_start ? x86_vec_set1(bias1) : x86_vec_load(outptr1 + jj);
+
+            for (int kk = 0; kk < max_kk; kk++)
+            {
+                x86_vec _b = x86_vec_load(pB0 + kk * X86_VECSIZE);
+                _sum0 = x86_vec_fmadd(x86_vec_set1(pA0[kk * 2]), _b, _sum0);
+                _sum1 = x86_vec_fmadd(x86_vec_set1(pA0[kk * 2 + 1]), _b, _sum1);
+            }
+
+            x86_vec_store(outptr0 + jj, _sum0);
+            x86_vec_store(outptr1 + jj, _sum1);
+
+            pB0 += X86_VECSIZE * max_kk;
+        }
+        if (jj < max_jj)
+        {
+            const int n = max_jj - jj;
+
+            for (int t = 0; t < n; t++)
+            {
+                float sum0 = k_start ? bias0 : outptr0[jj + t];
+                float sum1 = k_start ? bias1 : outptr1[jj + t];
+
+                for (int kk = 0; kk < max_kk; kk++)
+                {
+                    sum0 += pA0[kk * 2] * pB0[kk * n + t];
+                    sum1 += pA0[kk * 2 + 1] * pB0[kk * n + t];
+                }
+
+                outptr0[jj + t] = sum0;
+                outptr1[jj + t] = sum1;
+            }
+        }
+    }
+    for (; ii < max_ii; ii++)
+    {
+        const float* pA0 = pA + ii * max_kk;
+        const float* pB0 = pB;
+
+        float* outptr0 = outptr + ii * out_hstep;
+
+        const float bias0 = bias ? bias[ii] : 0.f;
+
+        int jj = 0;
+        for (; jj + X86_VECSIZE - 1 < max_jj; jj += X86_VECSIZE)
+        {
+            x86_vec _sum0 = k_start ? x86_vec_set1(bias0) : x86_vec_load(outptr0 + jj);
+
+            for (int kk = 0; kk < max_kk; kk++)
+            {
+                _sum0 = x86_vec_fmadd(x86_vec_set1(pA0[kk]), x86_vec_load(pB0 + kk * X86_VECSIZE), _sum0);
+            }
+
+            x86_vec_store(outptr0 + jj, _sum0);
+
+            pB0 += X86_VECSIZE * max_kk;
+        }
+        if (jj < max_jj)
+        {
+            const int n = max_jj - jj;
+
+            for (int t = 0; t < n; t++)
+            {
+                float sum0 = k_start ? bias0 : outptr0[jj + t];
+
+                for (int kk = 0; kk < max_kk; kk++)
+                {
+                    sum0 += pA0[kk] * pB0[kk * n + t];
+                }
+
+                outptr0[jj + t] = sum0;
+            }
+        }
+    }
+}
+
+static int convolution_im2col_gemm_x86(const Mat& bottom_blob, Mat& top_blob, const Mat& AT, const Mat& bias, int kernel_w, int kernel_h, int dilation_w, int dilation_h, int stride_w, int stride_h, int TILE_M, int TILE_K, const Option& opt)
+{
+    const int maxk = kernel_w * kernel_h;
+
+    const int M = top_blob.c;
+    const int N = top_blob.w * top_blob.h;
+    const int K = bottom_blob.c * maxk;
+
+    // TILE_M and TILE_K are fixed by the weight, only N is tiled here, from what is left of l2 by one A tile
+    const int l2_cache_size_fp32 = (int)(get_cpu_level2_cache_size() / sizeof(float));
+    int TILE_N = std::max(X86_VECSIZE * 4, (l2_cache_size_fp32 - TILE_M * TILE_K) / TILE_K / (X86_VECSIZE * 4) * (X86_VECSIZE * 4));
+    TILE_N = std::min(TILE_N, N);
+
+    const int nn_M = (M + TILE_M - 1) / TILE_M;
+    const int nn_K = (K + TILE_K - 1) / TILE_K;
+
+    Mat BT(TILE_K * TILE_N, nn_K, 4u, opt.workspace_allocator);
+    if (BT.empty())
+        return -100;
+
+    const float* biasptr = bias.empty() ? 0 : (const float*)bias;
+
+    for (int j = 0; j < N; j += TILE_N)
+    {
+        const int max_jj = std::min((N - j), TILE_N);
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int ppk = 0; ppk < nn_K; ppk++)
+        {
+            const int k = ppk * TILE_K;
+            const int max_kk = std::min((K - k), TILE_K);
+
+            convolution_im2col_pack_B_tile_x86(bottom_blob, BT.row(ppk), top_blob.w, j, max_jj, k, max_kk, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h);
+        }
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int ppi = 0; ppi < nn_M; ppi++)
+        {
+            const int i = ppi * TILE_M;
+            const int max_ii = std::min((M - i), TILE_M);
+
+            for (int ppk = 0; ppk < nn_K; ppk++)
+            {
+                const int k = ppk * TILE_K;
+                const int max_kk = std::min((K - k), TILE_K);
+
+                const float* pA = AT.channel(ppi).row(ppk);
+
+                convolution_gemm_packed_tile_x86(pA, BT.row(ppk), (float*)top_blob.channel(i) + j, (int)top_blob.cstep, biasptr ? biasptr + i : 0, max_ii, max_jj, max_kk, ppk == 0);
+            }
+        }
+    }
+
+    return 0;
+}
+
+typedef void (*conv3x3s1_winograd_transform_input_tile_func)(const Mat& bottom_blob, Mat& B, int j, int max_jj, int k, int max_kk, int nT);
+typedef void (*conv3x3s1_winograd_transform_output_tile_func)(const Mat& top_tile, Mat& top_blob, const Mat& bias, int i, int max_ii, int j, int max_jj);
+
+// repack one transformed input tile into per-batch panels for convolution_gemm_packed_tile_x86
+// the input transform stores k in pairs, element (b, jj) of the pair at kk is at kk * max_jj * batch + (b * max_jj + jj) * 2
+static void conv3x3s1_winograd_pack_B_tile_x86(const Mat& B, Mat& BT, int batch, int max_jj, int max_kk)
+{
+    const int kk_pairs = max_kk / 2 * 2;
+
+    for (int b = 0; b < batch; b++)
+    {
+        float* pp = BT.row(b);
+
+        for (int jj = 0; jj < max_jj; jj += X86_VECSIZE)
+        {
+            const int n = std::min(X86_VECSIZE, max_jj - jj);
+
+            int kk = 0;
+            for (; kk < kk_pairs; kk += 2)
+            {
+                const float* p0 = (const float*)B + kk * max_jj * batch + (b * max_jj + jj) * 2;
+
+                for (int t = 0; t < n; t++)
+                {
+                    pp[t] = p0[t * 2];
+                    pp[n + t] = p0[t * 2 + 1];
+                }
+
+                pp += n * 2;
+            }
+            for (; kk < max_kk; kk++)
+            {
+                const float* p0 = (const float*)B + kk * max_jj * batch + b * max_jj + jj;
+
+                for (int t = 0; t < n; t++)
+                {
+                    pp[t] = p0[t];
+                }
+
+                pp += n;
+            }
+        }
+    }
+}
+
+static int conv3x3s1_winograd_x86(const Mat& bottom_blob, Mat& top_blob, const Mat& AT, const Mat& bias, int tile_size, int TILE_M, int TILE_K, const Option& opt)
+{
+    conv3x3s1_winograd_transform_input_tile_func transform_input_tile = 0;
+    conv3x3s1_winograd_transform_output_tile_func transform_output_tile = 0;
+    if (tile_size == 6)
+    {
+        transform_input_tile = conv3x3s1_winograd63_transform_input_tile;
+        transform_output_tile = conv3x3s1_winograd63_transform_output_tile;
+    }
+    else if (tile_size == 4)
+    {
+        transform_input_tile = conv3x3s1_winograd43_transform_input_tile;
+        transform_output_tile = conv3x3s1_winograd43_transform_output_tile;
+    }
+    else
+    {
+        transform_input_tile = conv3x3s1_winograd23_transform_input_tile;
+        transform_output_tile = conv3x3s1_winograd23_transform_output_tile;
+    }
+
+    const int outw = top_blob.w;
+    const int outh = top_blob.h;
+
+    const int w_tiles = (outw + tile_size - 1) / tile_size;
+    const int h_tiles = (outh + tile_size - 1) / tile_size;
+
+    const int M = top_blob.c;
+    const int N = w_tiles * h_tiles;
+    const int K = bottom_blob.c;
+    const int B = (tile_size + 2) * (tile_size + 2);
+
+    // the transformed input of all k tiles is kept for one n tile, keep that within l2
+    const int l2_cache_size_fp32 = (int)(get_cpu_level2_cache_size() / sizeof(float));
+    int TILE_N = std::max(X86_VECSIZE, l2_cache_size_fp32 / (B * K) / X86_VECSIZE * X86_VECSIZE);
+    TILE_N = std::min(TILE_N, N);
+
+    const int nn_M = (M + TILE_M - 1) / TILE_M;
+    const int nn_K = (K + TILE_K - 1) / TILE_K;
+
+    const int nT = opt.num_threads;
+
+    Mat B_tileX(TILE_N * B * TILE_K, 1, nT, 4u, opt.workspace_allocator);
+    Mat BT(TILE_K * TILE_N, B, nn_K, 4u, opt.workspace_allocator);
+    Mat top_tileX(TILE_N * B * TILE_M, 1, nT, 4u, opt.workspace_allocator);
+    Mat sum_tileX(TILE_N * B * TILE_M, 1, nT, 4u, opt.workspace_allocator);
+    if (B_tileX.empty() || BT.empty() || top_tileX.empty() || sum_tileX.empty())
+        return -100;
+
+    for (int j = 0; j < N; j += TILE_N)
+    {
+        const int max_jj = std::min((N - j), TILE_N);
+
+        #pragma omp parallel for num_threads(nT)
+        for (int ppk = 0; ppk < nn_K; ppk++)
+        {
+            const int k = ppk * TILE_K;
+            const int max_kk = std::min((K - k), TILE_K);
+
+            Mat B_tile = B_tileX.channel(get_omp_thread_num());
+
+            transform_input_tile(bottom_blob, B_tile, j, max_jj, k, max_kk, 1);
+
+            Mat BT_tile = BT.channel(ppk);
+
+            conv3x3s1_winograd_pack_B_tile_x86(B_tile, BT_tile, B, max_jj, max_kk);
+        }
+
+        #pragma omp parallel for num_threads(nT)
+        for (int ppi = 0; ppi < nn_M; ppi++)
+        {
+            const int i = ppi * TILE_M;
+            const int max_ii = std::min((M - i), TILE_M);
+
+            // sum_tile is [ii][b][jj], the output transform wants ii in pairs interleaved along b and jj
+            float* sum_tile = sum_tileX.channel(get_omp_thread_num());
+            Mat top_tile = top_tileX.channel(get_omp_thread_num());
+
+            for (int ppk = 0; ppk < nn_K; ppk++)
+            {
+                const int k = ppk * TILE_K;
+                const int max_kk = std::min((K - k), TILE_K);
+
+                const Mat AT_tile = AT.channel(ppi).depth(ppk);
+                const Mat BT_tile = BT.channel(ppk);
+
+                for (int b = 0; b < B; b++)
+                {
+                    convolution_gemm_packed_tile_x86(AT_tile.row(b), BT_tile.row(b), sum_tile + b * max_jj, B * max_jj, 0, max_ii, max_jj, max_kk, ppk == 0);
+                }
+            }
+
+            const int size = B * max_jj;
+
+            int ii = 0;
+            for (; ii + 1 < max_ii; ii += 2)
+            {
+                const float* p0 = sum_tile + ii * size;
+                const float* p1 = p0 + size;
+                float* pp = (float*)top_tile + ii * size;
+
+                for (int t = 0; t < size; t++)
+                {
+                    pp[t * 2] = p0[t];
+                    pp[t * 2 + 1] = p1[t];
+                }
+            }
+            for (; ii < max_ii; ii++)
+            {
+                memcpy((float*)top_tile + ii * size, sum_tile + ii * size, size * sizeof(float));
+            }
+
+            transform_output_tile(top_tile, top_blob, bias, i, max_ii, j, max_jj);
+        }
+    }
+
+    return 0;
+}
+
+// weight is kernel_tm.channel(p / 8) = [inch][9][8] for every 8 output channels, then channel(p / 8 + p % 8) = [inch][9]
+static int conv3x3s2_packed_x86(const Mat& bottom_blob, Mat& top_blob, const Mat& kernel_tm, const Mat& bias, const Option& opt)
+{
+    const int w = bottom_blob.w;
+    const int inch = bottom_blob.c;
+
+    const int outw = top_blob.w;
+    const int outh = top_blob.h;
+    const int outch = top_blob.c;
+
+    const float* biasptr = bias.empty() ? 0 : (const float*)bias;
+
+    const int nn_outch = outch / 8;
+    const int remain_outch_start = nn_outch * 8;
+
+    // one output row of 8 channels interleaved, so that the 8 weights of a tap are one contiguous load
+    Mat sum_rowX(outw * 8, 1, opt.num_threads, 4u, opt.workspace_allocator);
+    if (sum_rowX.empty())
+        return -100;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int pp = 0; pp < nn_outch; pp++)
+    {
+        const int p = pp * 8;
+
+        float* sum_row = sum_rowX.channel(get_omp_thread_num());
+
+        for (int i = 0; i < outh; i++)
+        {
+            for (int j = 0; j < outw; j++)
+            {
+                for (int o = 0; o < 8; o++)
+                {
+                    sum_row[j * 8 + o] = biasptr ? biasptr[p + o] : 0.f;
+                }
+            }
+
+            const float* kptr = kernel_tm.channel(pp);
+
+            for (int q = 0; q < inch; q++)
+            {
+                const float* r0 = (const float*)bottom_blob.channel(q) + i * 2 * w;
+                const float* r1 = r0 + w;
+                const float* r2 = r1 + w;
+
+#if __AVX__
+                __m256 _k[9];
+                for (int t = 0; t < 9; t++)
+                {
+                    _k[t] = _mm256_loadu_ps(kptr + t * 8);
+                }
+
+                for (int j = 0; j < outw; j++)
+                {
+                    __m256 _sum = _mm256_loadu_ps(sum_row + j * 8);
+                    _sum = _mm256_comp_fmadd_ps(_mm256_set1_ps(r0[0]), _k[0], _sum);
+                    _sum = _mm256_comp_fmadd_ps(_mm256_set1_ps(r0[1]), _k[1], _sum);
+                    _sum = _mm256_comp_fmadd_ps(_mm256_set1_ps(r0[2]), _k[2], _sum);
+                    _sum = _mm256_comp_fmadd_ps(_mm256_set1_ps(r1[0]), _k[3], _sum);
+                    _sum = _mm256_comp_fmadd_ps(_mm256_set1_ps(r1[1]), _k[4], _sum);
+                    _sum = _mm256_comp_fmadd_ps(_mm256_set1_ps(r1[2]), _k[5], _sum);
+                    _sum = _mm256_comp_fmadd_ps(_mm256_set1_ps(r2[0]), _k[6], _sum);
+                    _sum = _mm256_comp_fmadd_ps(_mm256_set1_ps(r2[1]), _k[7], _sum);
+                    _sum = _mm256_comp_fmadd_ps(_mm256_set1_ps(r2[2]), _k[8], _sum);
+                    _mm256_storeu_ps(sum_row + j * 8, _sum);
+
+                    r0 += 2;
+                    r1 += 2;
+                    r2 += 2;
+                }
+#elif __SSE2__
+                for (int j = 0; j < outw; j++)
+                {
+                    __m128 _sum0 = _mm_loadu_ps(sum_row + j * 8);
+                    __m128 _sum1 = _mm_loadu_ps(sum_row + j * 8 + 4);
+
+                    const float* rows[3] = {r0, r1, r2};
+                    for (int t = 0; t < 9; t++)
+                    {
+                        __m128 _r = _mm_set1_ps(rows[t / 3][t % 3]);
+                        _sum0 = _mm_comp_fmadd_ps(_r, _mm_loadu_ps(kptr + t * 8), _sum0);
+                        _sum1 = _mm_comp_fmadd_ps(_r, _mm_loadu_ps(kptr + t * 8 + 4), _sum1);
+                    }
+
+                    _mm_storeu_ps(sum_row + j * 8, _sum0);
+                    _mm_storeu_ps(sum_row + j * 8 + 4, _sum1);
+
+                    r0 += 2;
+                    r1 += 2;
+                    r2 += 2;
+                }
+#else
+                for (int j = 0; j < outw; j++)
+                {
+                    const float* rows[3] = {r0, r1, r2};
+                    for (int t = 0; t < 9; t++)
+                    {
+                        const float r = rows[t / 3][t % 3];
+                        for (int o = 0; o < 8; o++)
+                        {
+                            sum_row[j * 8 + o] += r * kptr[t * 8 + o];
+                        }
+                    }
+
+                    r0 += 2;
+                    r1 += 2;
+                    r2 += 2;
+                }
+#endif // __AVX__
+
+                kptr += 72;
+            }
+
+            for (int o = 0; o < 8; o++)
+            {
+                float* outptr = top_blob.channel(p + o).row(i);
+
+                for (int j = 0; j < outw; j++)
+                {
+                    outptr[j] = sum_row[j * 8 + o];
+                }
+            }
+        }
+    }
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int p = remain_outch_start; p < outch; p++)
+    {
+        float* outptr = top_blob.channel(p);
+
+        const float bias0 = biasptr ? biasptr[p] : 0.f;
+
+        for (int i = 0; i < outh; i++)
+        {
+            x86_fill(outptr, bias0, outw);
+
+            const float* kptr = kernel_tm.channel(p / 8 + p % 8);
+
+            for (int q = 0; q < inch; q++)
+            {
+                const float* r0 = (const float*)bottom_blob.channel(q) + i * 2 * w;
+
+                for (int t = 0; t < 9; t++)
+                {
+                    x86_axpy_strided(outptr, r0 + (t / 3) * w + t % 3, kptr[t], outw, 2);
+                }
+
+                kptr += 9;
+            }
+
+            outptr += outw;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,282 @@
+#include "convolution_x86.h"
+
+#include "x86_usability.h"
+
+#include "cpu.h"
+#include "layer_type.h"
+
+#include "../fused_activation.h"
+#include "../blocksparse.h"
+
+#include <algorithm>
+#include <string.h>
+
+#include "../arm/arm_usability.h"
+
+namespace ncnn {
+
+// tile selection, input / output transforms of the generic (non-neon) paths,
+// the same code flexnnslice packs the weights with on the host
+#include "../arm/convolution_3x3_winograd.h"
+#include "../arm/convolution_im2col_gemm.h"
+
+#include "convolution_pretransformed.h"
+
+// one generic packed A tile from the origin [outch][inch * maxk] weight, in the layout convolution_gemm_packed_tile_x86 reads
+static void convolution_im2col_pack_A_tile_x86(const Mat& weight, float* pp, int K, int i, int max_ii, int k, int max_kk)
+{
+    const float* wptr = (const float*)weight + i * K + k;
+
+    int ii = 0;
+    for (; ii + 1 < max_ii; ii += 2)
+    {
+        const float* p0 = wptr + ii * K;
+        const float* p1 = p0 + K;
+
+        for (int kk = 0; kk < max_kk; kk++)
+        {
+            pp[0] = p0[kk];
+            pp[1] = p1[kk];
+            pp += 2;
+        }
+    }
+    for (; ii < max_ii; ii++)
+    {
+        const float* p0 = wptr + ii * K;
+
+        for (int kk = 0; kk < max_kk; kk++)
+        {
+            *pp++ = p0[kk];
+        }
+    }
+}
+
+// origin weights, A tiles are packed per thread at run time instead of once in create_pipeline
+// so the streamed layer keeps no transformed copy of the weight, the workspace is one A tile per thread
+static int convolution_im2col_gemm_origin_x86(const Mat& bottom_blob, Mat& top_blob, const Mat& weight, const Mat& bias, int kernel_w, int kernel_h, int dilation_w, int dilation_h, int stride_w, int stride_h, const Option& opt)
+{
+    const int maxk = kernel_w * kernel_h;
+
+    const int M = top_blob.c;
+    const int N = top_blob.w * top_blob.h;
+    const int K = bottom_blob.c * maxk;
+
+    int TILE_M, TILE_N, TILE_K;
+    convolution_im2col_gemm_get_optimal_tile_mnk(M, 0, K, TILE_M, TILE_N, TILE_K, opt.num_threads);
+
+    const int l2_cache_size_fp32 = (int)(get_cpu_level2_cache_size() / sizeof(float));
+    TILE_N = std::max(X86_VECSIZE * 4, (l2_cache_size_fp32 - TILE_M * TILE_K) / TILE_K / (X86_VECSIZE * 4) * (X86_VECSIZE * 4));
+    TILE_N = std::min(TILE_N, N);
+
+    const int nn_M = (M + TILE_M - 1) / TILE_M;
+    const int nn_K = (K + TILE_K - 1) / TILE_K;
+
+    Mat BT(TILE_K * TILE_N, nn_K, 4u, opt.workspace_allocator);
+    if (BT.empty())
+        return -100;
+
+    Mat AT(TILE_K * TILE_M, 1, opt.num_threads, 4u, opt.workspace_allocator);
+    if (AT.empty())
+        return -100;
+
+    const float* biasptr = bias.empty() ? 0 : (const float*)bias;
+
+    for (int j = 0; j < N; j += TILE_N)
+    {
+        const int max_jj = std::min((N - j), TILE_N);
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int ppk = 0; ppk < nn_K; ppk++)
+        {
+            const int k = ppk * TILE_K;
+            const int max_kk = std::min((K - k), TILE_K);
+
+            convolution_im2col_pack_B_tile_x86(bottom_blob, BT.row(ppk), top_blob.w, j, max_jj, k, max_kk, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h);
+        }
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int ppi = 0; ppi < nn_M; ppi++)
+        {
+            const int i = ppi * TILE_M;
+            const int max_ii = std::min((M - i), TILE_M);
+
+            float* pA = AT.channel(get_omp_thread_num());
+
+            for (int ppk = 0; ppk < nn_K; ppk++)
+            {
+                const int k = ppk * TILE_K;
+                const int max_kk = std::min((K - k), TILE_K);
+
+                convolution_im2col_pack_A_tile_x86(weight, pA, K, i, max_ii, k, max_kk);
+
+                convolution_gemm_packed_tile_x86(pA, BT.row(ppk), (float*)top_blob.channel(i) + j, (int)top_blob.cstep, biasptr ? biasptr + i : 0, max_ii, max_jj, max_kk, ppk == 0);
+            }
+        }
+    }
+
+    return 0;
+}
+
+Convolution_x86::Convolution_x86()
+{
+}
+
+int Convolution_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    // compiled per isa, so the sparse kernels vectorize to the widest vectors
+    if (sparse_block_count)
+        return convolution1x1_blocksparse(bottom_blob, top_blob, weight_sparse_bitmap, weight_data, bias_data, num_output, activation_type, activation_params, opt);
+
+    if (weight_data_type > 1)
+        return forward_pretransformed_x86(bottom_blob, top_blob, opt);
+
+    // int8 and the flattened innerproduct case stay on the reference path
+    // weight_data_type 1 is the origin layout with a chw shape, which is identical in memory to 0
+    if (weight_data.elemsize != 4u || bottom_blob.elemsize != 4u || bottom_blob.elempack != 1)
+        return Convolution::forward(bottom_blob, top_blob, opt);
+
+    if (bottom_blob.dims == 1 && kernel_w == 1 && kernel_h == 1)
+        return Convolution::forward(bottom_blob, top_blob, opt);
+
+    Mat bottom_blob_bordered;
+    make_padding(bottom_blob, bottom_blob_bordered, opt);
+    if (bottom_blob_bordered.empty())
+        return -100;
+
+    const int w = bottom_blob_bordered.w;
+    const int h = bottom_blob_bordered.h;
+    const size_t elemsize = bottom_blob_bordered.elemsize;
+
+    const int kernel_extent_w = dilation_w * (kernel_w - 1) + 1;
+    const int kernel_extent_h = dilation_h * (kernel_h - 1) + 1;
+
+    const int outw = (w - kernel_extent_w) / stride_w + 1;
+    const int outh = (h - kernel_extent_h) / stride_h + 1;
+
+    top_blob.create(outw, outh, num_output, elemsize, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    // weights are consumed in their stored layout, only a tile of them is packed at a time,
+    // so the layer can be loaded, run and released per inference without extra state
+    int ret = convolution_im2col_gemm_origin_x86(bottom_blob_bordered, top_blob, weight_data, bias_term ? bias_data : Mat(), kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, opt);
+    if (ret != 0)
+        return ret;
+
+    if (activation_type)
+    {
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int p = 0; p < num_output; p++)
+        {
+            float* outptr = top_blob.channel(p);
+
+            for (int i = 0; i < outw * outh; i++)
+            {
+                outptr[i] = activation_ss(outptr[i], activation_type, activation_params);
+            }
+        }
+    }
+
+    return 0;
+}
+
+int Convolution_x86::forward_pretransformed_x86(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    if (weight_data.elemsize != 4u || bottom_blob.elemsize != 4u || bottom_blob.elempack != 1)
+    {
+        NCNN_LOGE("pretransformed weight_data_type %d only supports fp32 elempack 1", weight_data_type);
+        return -1;
+    }
+
+    // 3x3s2 is packed the same way on every host, the others need the generic 2-row panels
+    if (weight_layout > 1 && weight_data_type != 6)
+    {
+        NCNN_LOGE("weight layout %d was packed for arm neon, re-run flexnnslice on an x86 host", weight_layout);
+        return -1;
+    }
+
+    Mat bottom_blob_bordered;
+    make_padding(bottom_blob, bottom_blob_bordered, opt);
+    if (bottom_blob_bordered.empty())
+        return -100;
+
+    const int w = bottom_blob_bordered.w;
+    const int h = bottom_blob_bordered.h;
+    const int inch = bottom_blob_bordered.c;
+    const size_t elemsize = bottom_blob_bordered.elemsize;
+
+    const int kernel_extent_w = dilation_w * (kernel_w - 1) + 1;
+    const int kernel_extent_h = dilation_h * (kernel_h - 1) + 1;
+
+    const int outw = (w - kernel_extent_w) / stride_w + 1;
+    const int outh = (h - kernel_extent_h) / stride_h + 1;
+
+    top_blob.create(outw, outh, num_output, elemsize, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    int ret = 0;
+    if (weight_data_type == 6)
+    {
+        ret = conv3x3s2_packed_x86(bottom_blob_bordered, top_blob, weight_data, bias_data, opt);
+    }
+    else
+    {
+        const int M = num_output;
+        const int K = weight_data_type == 2 ? inch * kernel_w * kernel_h : inch;
+        const int B = weight_data_type == 3 ? 64 : weight_data_type == 4 ? 36 : 16;
+
+        // untagged weights were packed with the tiles of this host, which do not depend on num_threads
+        int TILE_M = weight_tile_m;
+        int TILE_K = weight_tile_k;
+        if (weight_layout == 0)
+        {
+            int TILE_N;
+            if (weight_data_type == 2)
+                convolution_im2col_gemm_get_optimal_tile_mnk(M, 0, K, TILE_M, TILE_N, TILE_K, opt.num_threads);
+            else
+                conv3x3s1_winograd_get_optimal_tile_mnk(M, 0, K, B, TILE_M, TILE_N, TILE_K, opt.num_threads);
+        }
+
+        const int nn_M = (M + TILE_M - 1) / TILE_M;
+        const int nn_K = (K + TILE_K - 1) / TILE_K;
+        const int AT_d = weight_data.dims == 4 ? weight_data.d : 1;
+
+        bool tile_mismatch;
+        if (weight_data_type == 2)
+            tile_mismatch = weight_data.w != TILE_K * TILE_M || weight_data.h != nn_K || weight_data.c != nn_M;
+        else
+            tile_mismatch = weight_data.w != TILE_K * TILE_M || weight_data.h != B || AT_d != nn_K || weight_data.c != nn_M;
+
+        if (tile_mismatch)
+        {
+            NCNN_LOGE("pretransformed weight %d x %d x %d x %d does not match tile m %d k %d, re-run flexnnslice", weight_data.w, weight_data.h, AT_d, weight_data.c, TILE_M, TILE_K);
+            return -1;
+        }
+
+        if (weight_data_type == 2)
+            ret = convolution_im2col_gemm_x86(bottom_blob_bordered, top_blob, weight_data, bias_data, kernel_w, kernel_h, dilation_w, dilation_h, stride_w, stride_h, TILE_M, TILE_K, opt);
+        else
+            ret = conv3x3s1_winograd_x86(bottom_blob_bordered, top_blob, weight_data, bias_data, weight_data_type == 3 ? 6 : weight_data_type == 4 ? 4 : 2, TILE_M, TILE_K, opt);
+    }
+    if (ret != 0)
+        return ret;
+
+    if (activation_type)
+    {
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int p = 0; p < num_output; p++)
+        {
+            float* outptr = top_blob.channel(p);
+
+            for (int i = 0; i < outw * outh; i++)
+            {
+                outptr[i] = activation_ss(outptr[i], activation_type, activation_params);
+            }
+        }
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,22 @@
+#ifndef LAYER_CONVOLUTION_X86_H
+#define LAYER_CONVOLUTION_X86_H
+
+#include "convolution.h"
+
+namespace ncnn {
+
+class Convolution_x86 : virtual public Convolution
+{
+public:
+    Convolution_x86();
+
+    virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
+
+protected:
+    // weight_data_type 2-6, consumes the flexnnslice layouts in place
+    int forward_pretransformed_x86(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
+};
+
+} // namespace ncnn
+
+#endif // LAYER_CONVOLUTION_X86_H
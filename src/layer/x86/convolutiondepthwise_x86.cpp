@@ -0,0 +1,84 @@
+#include "convolutiondepthwise_x86.h"
+
+#include "x86_usability.h"
+
+#include "layer_type.h"
+
+#include "../fused_activation.h"
+
+namespace ncnn {
+
+ConvolutionDepthWise_x86::ConvolutionDepthWise_x86()
+{
+}
+
+int ConvolutionDepthWise_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    // only the pure depth-wise case, group convolution and int8 stay on the reference path
+    const int channels = bottom_blob.c * bottom_blob.elempack;
+    if (!(channels == group && group == num_output) || weight_data.elemsize != 4u || bottom_blob.elemsize != 4u || bottom_blob.elempack != 1)
+        return ConvolutionDepthWise::forward(bottom_blob, top_blob, opt);
+
+    Mat bottom_blob_bordered;
+    make_padding(bottom_blob, bottom_blob_bordered, opt);
+    if (bottom_blob_bordered.empty())
+        return -100;
+
+    const int w = bottom_blob_bordered.w;
+    const int h = bottom_blob_bordered.h;
+    const size_t elemsize = bottom_blob_bordered.elemsize;
+
+    const int kernel_extent_w = dilation_w * (kernel_w - 1) + 1;
+    const int kernel_extent_h = dilation_h * (kernel_h - 1) + 1;
+
+    const int outw = (w - kernel_extent_w) / stride_w + 1;
+    const int outh = (h - kernel_extent_h) / stride_h + 1;
+
+    top_blob.create(outw, outh, num_output, elemsize, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    const int maxk = kernel_w * kernel_h;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int g = 0; g < group; g++)
+    {
+        float* outptr = top_blob.channel(g);
+        const Mat m = bottom_blob_bordered.channel(g);
+
+        const float bias = bias_term ? bias_data[g] : 0.f;
+
+        for (int i = 0; i < outh; i++)
+        {
+            x86_fill(outptr, bias, outw);
+
+            const float* kptr = (const float*)weight_data + maxk * g;
+
+            for (int y = 0; y < kernel_h; y++)
+            {
+                const float* sptr = m.row(i * stride_h + y * dilation_h);
+
+                for (int x = 0; x < kernel_w; x++)
+                {
+                    x86_axpy_strided(outptr, sptr + x * dilation_w, kptr[x], outw, stride_w);
+                }
+
+                kptr += kernel_w;
+            }
+
+            if (activation_type)
+            {
+                for (int j = 0; j < outw; j++)
+                {
+                    outptr[j] = activation_ss(outptr[j], activation_type, activation_params);
+                }
+            }
+
+            outptr += outw;
+        }
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
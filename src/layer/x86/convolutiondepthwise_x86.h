@@ -0,0 +1,18 @@
+#ifndef LAYER_CONVOLUTIONDEPTHWISE_X86_H
+#define LAYER_CONVOLUTIONDEPTHWISE_X86_H
+
+#include "convolutiondepthwise.h"
+
+namespace ncnn {
+
+class ConvolutionDepthWise_x86 : virtual public ConvolutionDepthWise
+{
+public:
+    ConvolutionDepthWise_x86();
+
+    virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
+};
+
+} // namespace ncnn
+
+#endif // LAYER_CONVOLUTIONDEPTHWISE_X86_H
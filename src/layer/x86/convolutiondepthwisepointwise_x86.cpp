@@ -0,0 +1,117 @@
+#include "convolutiondepthwisepointwise_x86.h"
+
+#include "x86_usability.h"
+
+#include "../fused_activation.h"
+
+#include <algorithm>
+
+namespace ncnn {
+
+ConvolutionDepthWisePointWise_x86::ConvolutionDepthWisePointWise_x86()
+{
+}
+
+int ConvolutionDepthWisePointWise_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    if (bottom_blob.elemsize != 4u || bottom_blob.elempack != 1 || weight_data.elemsize != 4u)
+        return ConvolutionDepthWisePointWise::forward(bottom_blob, top_blob, opt);
+
+    const int w = bottom_blob.w;
+    const int h = bottom_blob.h;
+
+    const int kernel_extent_w = dilation_w * (kernel_w - 1) + 1;
+    const int kernel_extent_h = dilation_h * (kernel_h - 1) + 1;
+
+    const int outw = (w + pad_left + pad_right - kernel_extent_w) / stride_w + 1;
+    const int outh = (h + pad_top + pad_bottom - kernel_extent_h) / stride_h + 1;
+
+    top_blob.create(outw, outh, num_output, 4u, opt.blob_allocator);
+    if (top_blob.empty())
+        return -100;
+
+    const int maxk = kernel_w * kernel_h;
+
+    const int tile_rows = get_tile_rows(channels, outw, outh);
+
+    Mat dw_tile(outw * tile_rows, channels, 4u, opt.workspace_allocator);
+    if (dw_tile.empty())
+        return -100;
+
+    for (int y0 = 0; y0 < outh; y0 += tile_rows)
+    {
+        const int y1 = std::min(y0 + tile_rows, outh);
+        const int size = (y1 - y0) * outw;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int g = 0; g < channels; g++)
+        {
+            float* outptr = dw_tile.row(g);
+            const Mat m = bottom_blob.channel(g);
+            const float* kptr = (const float*)dw_weight_data + maxk * g;
+
+            const float bias = dw_bias_term ? dw_bias_data[g] : 0.f;
+
+            for (int i = y0; i < y1; i++)
+            {
+                x86_fill(outptr, bias, outw);
+
+                for (int y = 0; y < kernel_h; y++)
+                {
+                    const int sy = i * stride_h + y * dilation_h - pad_top;
+                    if (sy < 0 || sy >= h)
+                        continue;
+
+                    const float* sptr = m.row(sy);
+
+                    for (int x = 0; x < kernel_w; x++)
+                    {
+                        const int sx0 = x * dilation_w - pad_left;
+                        const int j0 = sx0 < 0 ? (-sx0 + stride_w - 1) / stride_w : 0;
+                        const int j1 = sx0 < w ? std::min((w - 1 - sx0) / stride_w + 1, outw) : 0;
+                        if (j1 <= j0)
+                            continue;
+
+                        x86_axpy_strided(outptr + j0, sptr + j0 * stride_w + sx0, kptr[y * kernel_w + x], j1 - j0, stride_w);
+                    }
+                }
+
+                if (dw_activation_type)
+                {
+                    for (int j = 0; j < outw; j++)
+                    {
+                        outptr[j] = activation_ss(outptr[j], dw_activation_type, dw_activation_params);
+                    }
+                }
+
+                outptr += outw;
+            }
+        }
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int p = 0; p < num_output; p++)
+        {
+            float* outptr = top_blob.channel(p).row(y0);
+            const float* kptr = (const float*)weight_data + channels * p;
+
+            x86_fill(outptr, bias_term ? bias_data[p] : 0.f, size);
+
+            for (int q = 0; q < channels; q++)
+            {
+                x86_axpy(outptr, dw_tile.row(q), kptr[q], size);
+            }
+
+            if (activation_type)
+            {
+                for (int j = 0; j < size; j++)
+                {
+                    outptr[j] = activation_ss(outptr[j], activation_type, activation_params);
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
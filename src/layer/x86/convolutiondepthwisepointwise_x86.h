@@ -0,0 +1,18 @@
+#ifndef LAYER_CONVOLUTIONDEPTHWISEPOINTWISE_X86_H
+#define LAYER_CONVOLUTIONDEPTHWISEPOINTWISE_X86_H
+
+#include "convolutiondepthwisepointwise.h"
+
+namespace ncnn {
+
+class ConvolutionDepthWisePointWise_x86 : virtual public ConvolutionDepthWisePointWise
+{
+public:
+    ConvolutionDepthWisePointWise_x86();
+
+    virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
+};
+
+} // namespace ncnn
+
+#endif // LAYER_CONVOLUTIONDEPTHWISEPOINTWISE_X86_H
@@ -0,0 +1,300 @@
+#include "gemm_x86.h"
+
+#include "x86_usability.h"
+
+#include "cpu.h"
+
+#include <algorithm>
+
+namespace ncnn {
+
+Gemm_x86::Gemm_x86()
+{
+    support_weight_chunks = true;
+}
+
+int Gemm_x86::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    const Mat& A0 = constantA ? A_data : bottom_blobs[0];
+    const Mat& B0 = constantB ? B_data : constantA ? bottom_blobs[0] : bottom_blobs[1];
+
+    const int chunk_count = weight_chunks.count();
+
+    if (A0.elemsize != 4u || A0.elempack != 1 || B0.elemsize != 4u || B0.elempack != 1)
+    {
+        if (weight_chunks.wait(chunk_count))
+            return -100;
+        return Gemm::forward(bottom_blobs, top_blobs, opt);
+    }
+
+    size_t elemsize = A0.elemsize;
+
+    Mat A;
+    if (transA == 0)
+    {
+        A = A0;
+    }
+    else
+    {
+        // transpose A to row-major
+        A.create((A0.dims == 3 ? A0.c : A0.h), A0.w, elemsize, opt.workspace_allocator);
+        if (A.empty())
+            return -100;
+
+        const int A0_hstep = A0.dims == 3 ? (int)A0.cstep : A0.w;
+
+        for (int i = 0; i < A.h; i++)
+        {
+            float* ptr = A.row(i);
+            for (int j = 0; j < A.w; j++)
+            {
+                ptr[j] = A0[j * A0_hstep + i];
+            }
+        }
+    }
+
+    // B is never transposed here
+    // transB == 0 accumulates rows of B into the output row, transB == 1 takes dot products with rows of B
+    const int B_hstep = B0.dims == 3 ? (int)B0.cstep : B0.w;
+
+    const int M = A.dims == 3 ? A.c : A.h;
+    const int K = A.w; // assert A.w == (transB ? B0.w : B0.h)
+    const int N = transB == 0 ? B0.w : (B0.dims == 3 ? B0.c : B0.h);
+
+    const float* ptrC = 0;
+    int broadcast_type_C = 0;
+    if (constantC)
+    {
+        ptrC = C_data;
+        broadcast_type_C = constant_broadcast_type_C;
+    }
+    else
+    {
+        if (constantA && constantB)
+        {
+            ptrC = bottom_blobs.size() == 1 ? bottom_blobs[0] : 0;
+        }
+        else if (constantA)
+        {
+            ptrC = bottom_blobs.size() == 2 ? bottom_blobs[1] : 0;
+        }
+        else if (constantB)
+        {
+            ptrC = bottom_blobs.size() == 2 ? bottom_blobs[1] : 0;
+        }
+        else
+        {
+            ptrC = bottom_blobs.size() == 3 ? bottom_blobs[2] : 0;
+        }
+
+        if (ptrC)
+        {
+            const Mat& C = bottom_blobs[bottom_blobs.size() - 1];
+
+            if (C.dims == 1 && C.w == 1)
+            {
+                // scalar
+                broadcast_type_C = 0;
+            }
+            if (C.dims == 1 && C.w == M)
+            {
+                // M
+                // auto broadcast from h to w is the ncnn-style convention
+                broadcast_type_C = 1;
+            }
+            if (C.dims == 1 && C.w == N)
+            {
+                // N
+                broadcast_type_C = 4;
+            }
+            if (C.dims == 2 && C.w == 1 && C.h == M)
+            {
+                // Mx1
+                broadcast_type_C = 2;
+            }
+            if (C.dims == 2 && C.w == N && C.h == M)
+            {
+                // MxN
+                broadcast_type_C = 3;
+            }
+            if (C.dims == 2 && C.w == N && C.h == 1)
+            {
+                // 1xN
+                broadcast_type_C = 4;
+            }
+        }
+    }
+
+    Mat& top_blob = top_blobs[0];
+    if (output_transpose)
+    {
+        if (output_N1M)
+            top_blob.create(M, 1, N, elemsize, opt.blob_allocator);
+        else
+            top_blob.create(M, N, elemsize, opt.blob_allocator);
+    }
+    else
+    {
+        if (output_N1M)
+            top_blob.create(N, 1, M, elemsize, opt.blob_allocator);
+        else
+            top_blob.create(N, M, elemsize, opt.blob_allocator);
+    }
+    if (top_blob.empty())
+        return -100;
+
+    const int out_hstep = top_blob.dims == 3 ? (int)top_blob.cstep : top_blob.w;
+    const int A_hstep = A.dims == 3 ? (int)A.cstep : A.w;
+
+    if (chunk_count > 0)
+    {
+        // B is loaded in chunks of rows, along K for transB == 0 and along N for transB == 1
+        // output is never transposed here
+        if (transB == 0)
+        {
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int i = 0; i < M; i++)
+            {
+                x86_fill((float*)top_blob + i * out_hstep, 0.f, N);
+            }
+        }
+
+        for (int c = 0; c < chunk_count; c++)
+        {
+            if (weight_chunks.wait(c))
+                return -100;
+
+            const int r0 = c * B_chunk_rows;
+            const int r1 = std::min(r0 + B_chunk_rows, transB == 0 ? K : N);
+
+            #pragma omp parallel for num_threads(opt.num_threads)
+            for (int i = 0; i < M; i++)
+            {
+                const float* ptrA = (const float*)A + i * A_hstep;
+                float* outptr = (float*)top_blob + i * out_hstep;
+
+                for (int r = r0; r < r1; r++)
+                {
+                    if (transB == 0)
+                        x86_axpy(outptr, (const float*)B0 + r * B_hstep, ptrA[r], N);
+                    else
+                        outptr[r] = x86_dot(ptrA, (const float*)B0 + r * B_hstep, K);
+                }
+            }
+        }
+
+        // constant C is in the tail
+        if (weight_chunks.wait(chunk_count))
+            return -100;
+        if (constantC)
+            ptrC = C_data;
+
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int i = 0; i < M; i++)
+        {
+            float* outptr = (float*)top_blob + i * out_hstep;
+
+            for (int j = 0; j < N; j++)
+            {
+                float sum = outptr[j];
+                if (ptrC)
+                {
+                    if (broadcast_type_C == 0)
+                        sum += ptrC[0] * beta;
+                    if (broadcast_type_C == 1 || broadcast_type_C == 2)
+                        sum += ptrC[i] * beta;
+                    if (broadcast_type_C == 3)
+                        sum += ptrC[i * N + j] * beta;
+                    if (broadcast_type_C == 4)
+                        sum += ptrC[j] * beta;
+                }
+
+                outptr[j] = sum * alpha;
+            }
+        }
+
+        return 0;
+    }
+
+    // transposed output is accumulated in a per-thread row and scattered afterwards
+    Mat out_rows;
+    if (output_transpose)
+    {
+        out_rows.create(N, opt.num_threads, 4u, opt.workspace_allocator);
+        if (out_rows.empty())
+            return -100;
+    }
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int i = 0; i < M; i++)
+    {
+        const float* ptrA = (const float*)A + i * A_hstep;
+
+        float* outptr = output_transpose ? out_rows.row(get_omp_thread_num()) : (float*)top_blob + i * out_hstep;
+
+        if (ptrC)
+        {
+            if (broadcast_type_C == 0)
+            {
+                x86_fill(outptr, ptrC[0] * beta, N);
+            }
+            if (broadcast_type_C == 1 || broadcast_type_C == 2)
+            {
+                x86_fill(outptr, ptrC[i] * beta, N);
+            }
+            if (broadcast_type_C == 3)
+            {
+                for (int j = 0; j < N; j++)
+                {
+                    outptr[j] = ptrC[i * N + j] * beta;
+                }
+            }
+            if (broadcast_type_C == 4)
+            {
+                for (int j = 0; j < N; j++)
+                {
+                    outptr[j] = ptrC[j] * beta;
+                }
+            }
+        }
+        else
+        {
+            x86_fill(outptr, 0.f, N);
+        }
+
+        if (transB == 0)
+        {
+            for (int k = 0; k < K; k++)
+            {
+                x86_axpy(outptr, (const float*)B0 + k * B_hstep, ptrA[k], N);
+            }
+        }
+        else
+        {
+            for (int j = 0; j < N; j++)
+            {
+                outptr[j] += x86_dot(ptrA, (const float*)B0 + j * B_hstep, K);
+            }
+        }
+
+        if (alpha != 1.f)
+        {
+            for (int j = 0; j < N; j++)
+            {
+                outptr[j] *= alpha;
+            }
+        }
+
+        if (output_transpose)
+        {
+            for (int j = 0; j < N; j++)
+            {
+                top_blob[j * out_hstep + i] = outptr[j];
+            }
+        }
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
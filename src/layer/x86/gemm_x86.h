@@ -0,0 +1,18 @@
+#ifndef LAYER_GEMM_X86_H
+#define LAYER_GEMM_X86_H
+
+#include "gemm.h"
+
+namespace ncnn {
+
+class Gemm_x86 : virtual public Gemm
+{
+public:
+    Gemm_x86();
+
+    virtual int forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const;
+};
+
+} // namespace ncnn
+
+#endif // LAYER_GEMM_X86_H
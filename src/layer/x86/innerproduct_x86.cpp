@@ -0,0 +1,135 @@
+#include "innerproduct_x86.h"
+
+#include "x86_usability.h"
+
+#include "layer_type.h"
+
+#include "../fused_activation.h"
+#include "../blocksparse.h"
+
+#include <algorithm>
+
+namespace ncnn {
+
+InnerProduct_x86::InnerProduct_x86()
+{
+    support_weight_chunks = true;
+}
+
+// output [p0, p1) without bias and activation
+static void innerproduct_rows_x86(const Mat& bottom_blob, const Mat& weight_data, Mat& top_blob, int p0, int p1, const Option& opt)
+{
+    const int w = bottom_blob.w;
+    const int h = bottom_blob.h;
+    const int channels = bottom_blob.c;
+    const int size = w * h;
+
+    if (top_blob.dims == 2)
+    {
+        // iterate rows innermost so that each weight row is streamed from memory once
+        #pragma omp parallel for num_threads(opt.num_threads)
+        for (int p = p0; p < p1; p++)
+        {
+            const float* kptr = (const float*)weight_data + w * p;
+
+            for (int j = 0; j < h; j++)
+            {
+                top_blob.row(j)[p] = x86_dot(bottom_blob.row(j), kptr, w);
+            }
+        }
+
+        return;
+    }
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int p = p0; p < p1; p++)
+    {
+        float sum = 0.f;
+
+        for (int q = 0; q < channels; q++)
+        {
+            const float* kptr = (const float*)weight_data + size * channels * p + size * q;
+
+            sum += x86_dot(bottom_blob.channel(q), kptr, size);
+        }
+
+        top_blob[p] = sum;
+    }
+}
+
+int InnerProduct_x86::forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const
+{
+    // compiled per isa, so the sparse kernels vectorize to the widest vectors
+    if (sparse_block_count)
+        return innerproduct_blocksparse(bottom_blob, top_blob, weight_sparse_bitmap, weight_data, bias_data, num_output, weight_data_size / num_output, activation_type, activation_params, opt);
+
+    const int chunk_count = weight_chunks.count();
+
+    if (weight_data.elemsize != 4u || bottom_blob.elemsize != 4u || bottom_blob.elempack != 1)
+    {
+        if (weight_chunks.wait(chunk_count))
+            return -100;
+        return InnerProduct::forward(bottom_blob, top_blob, opt);
+    }
+
+    const int num_input = weight_data_size / num_output;
+
+    const int w = bottom_blob.w;
+    const int h = bottom_blob.h;
+    const size_t elemsize = bottom_blob.elemsize;
+
+    if (bottom_blob.dims == 2 && w == num_input && h > 1)
+    {
+        // gemm
+        top_blob.create(num_output, h, elemsize, opt.blob_allocator);
+    }
+    else
+    {
+        top_blob.create(num_output, elemsize, opt.blob_allocator);
+    }
+    if (top_blob.empty())
+        return -100;
+
+    if (chunk_count > 0)
+    {
+        // consume the weight rows chunk by chunk as the loader publishes them
+        for (int i = 0; i < chunk_count; i++)
+        {
+            if (weight_chunks.wait(i))
+                return -100;
+
+            const int p0 = i * weight_chunk_rows;
+            const int p1 = std::min(p0 + weight_chunk_rows, num_output);
+            innerproduct_rows_x86(bottom_blob, weight_data, top_blob, p0, p1, opt);
+        }
+
+        // bias is in the tail
+        if (weight_chunks.wait(chunk_count))
+            return -100;
+    }
+    else
+    {
+        innerproduct_rows_x86(bottom_blob, weight_data, top_blob, 0, num_output, opt);
+    }
+
+    const int outh = top_blob.dims == 2 ? top_blob.h : 1;
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int j = 0; j < outh; j++)
+    {
+        float* outptr = top_blob.row(j);
+
+        for (int p = 0; p < num_output; p++)
+        {
+            float sum = outptr[p];
+            if (bias_term)
+                sum += bias_data[p];
+
+            outptr[p] = activation_ss(sum, activation_type, activation_params);
+        }
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
@@ -0,0 +1,18 @@
+#ifndef LAYER_INNERPRODUCT_X86_H
+#define LAYER_INNERPRODUCT_X86_H
+
+#include "innerproduct.h"
+
+namespace ncnn {
+
+class InnerProduct_x86 : virtual public InnerProduct
+{
+public:
+    InnerProduct_x86();
+
+    virtual int forward(const Mat& bottom_blob, Mat& top_blob, const Option& opt) const;
+};
+
+} // namespace ncnn
+
+#endif // LAYER_INNERPRODUCT_X86_H
@@ -0,0 +1,193 @@
+#include "multiheadattention_x86.h"
+
+#include "x86_usability.h"
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+namespace ncnn {
+
+MultiHeadAttention_x86::MultiHeadAttention_x86()
+{
+}
+
+int MultiHeadAttention_x86::forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const
+{
+    const Mat& q_blob = bottom_blobs[0];
+    const Mat& k_blob = bottom_blobs.size() == 1 ? q_blob : bottom_blobs[1];
+    const Mat& v_blob = bottom_blobs.size() == 1 ? q_blob : bottom_blobs.size() == 2 ? k_blob : bottom_blobs[2];
+
+    if (kv_cache || q_blob.elemsize != 4u || q_blob.elempack != 1 || q_weight_data.elemsize != 4u)
+        return MultiHeadAttention::forward(bottom_blobs, top_blobs, opt);
+
+    const int src_seqlen = q_blob.h;
+    const int dst_seqlen = k_blob.h;
+    const int embed_dim_per_head = embed_dim / num_head;
+
+    // assert k_blob.h == v_blob.h
+
+    Mat& top_blob = top_blobs[0];
+    top_blob.create(qdim, src_seqlen, 4u, opt.blob_allocator);
+    if (top_blob.empty())
+        return -1;
+
+    // same data flow as the reference implementation, every reduction is a contiguous dot product
+    // xv is stored transposed, one row per head dimension, so that xqk * xv also reduces along rows
+    Mat xq(embed_dim_per_head, src_seqlen, num_head, 4u, opt.workspace_allocator);
+    Mat xk(embed_dim_per_head, dst_seqlen, num_head, 4u, opt.workspace_allocator);
+    Mat xv(dst_seqlen, embed_dim_per_head, num_head, 4u, opt.workspace_allocator);
+
+    Mat xqk(dst_seqlen, src_seqlen, num_head, 4u, opt.workspace_allocator);
+
+    Mat xqkv(embed_dim_per_head, num_head, src_seqlen, 4u, opt.workspace_allocator);
+
+    if (xq.empty() || xk.empty() || xv.empty() || xqk.empty() || xqkv.empty())
+        return -100;
+
+    const float inv_sqrt_embed_dim_per_head = 1.f / sqrt(embed_dim_per_head);
+
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int q = 0; q < num_head; q++)
+    {
+        // xq = affine(q) * inv_sqrt_embed_dim_per_head
+        {
+            Mat outm = xq.channel(q);
+
+            for (int i = 0; i < src_seqlen; i++)
+            {
+                const float* ptr = q_blob.row(i);
+                float* outptr = outm.row(i);
+
+                for (int j = 0; j < embed_dim_per_head; j++)
+                {
+                    const float* kptr = (const float*)q_weight_data + qdim * (q * embed_dim_per_head + j);
+
+                    float sum = q_bias_data[q * embed_dim_per_head + j] + x86_dot(ptr, kptr, qdim);
+
+                    outptr[j] = sum * inv_sqrt_embed_dim_per_head;
+                }
+            }
+        }
+
+        // xk = affine(k)
+        {
+            Mat outm = xk.channel(q);
+
+            for (int i = 0; i < dst_seqlen; i++)
+            {
+                const float* ptr = k_blob.row(i);
+                float* outptr = outm.row(i);
+
+                for (int j = 0; j < embed_dim_per_head; j++)
+                {
+                    const float* kptr = (const float*)k_weight_data + kdim * (q * embed_dim_per_head + j);
+
+                    outptr[j] = k_bias_data[q * embed_dim_per_head + j] + x86_dot(ptr, kptr, kdim);
+                }
+            }
+        }
+
+        // xv = affine(v)
+        {
+            Mat outm = xv.channel(q);
+
+            for (int i = 0; i < embed_dim_per_head; i++)
+            {
+                const float* kptr = (const float*)v_weight_data + vdim * (q * embed_dim_per_head + i);
+                const float bias = v_bias_data[q * embed_dim_per_head + i];
+
+                float* outptr = outm.row(i);
+
+                for (int j = 0; j < dst_seqlen; j++)
+                {
+                    outptr[j] = bias + x86_dot(v_blob.row(j), kptr, vdim);
+                }
+            }
+        }
+
+        // xqk = xq * xk
+        {
+            const Mat xqm = xq.channel(q);
+            const Mat xkm = xk.channel(q);
+
+            Mat outm = xqk.channel(q);
+
+            for (int i = 0; i < src_seqlen; i++)
+            {
+                const float* qptr = xqm.row(i);
+                float* outptr = outm.row(i);
+
+                for (int j = 0; j < dst_seqlen; j++)
+                {
+                    outptr[j] = x86_dot(qptr, xkm.row(j), embed_dim_per_head);
+                }
+            }
+        }
+
+        // softmax(xqk)
+        {
+            Mat outm = xqk.channel(q);
+
+            for (int i = 0; i < src_seqlen; i++)
+            {
+                float* ptr = outm.row(i);
+
+                float max = -FLT_MAX;
+                for (int j = 0; j < dst_seqlen; j++)
+                {
+                    max = std::max(max, ptr[j]);
+                }
+
+                float sum = 0.f;
+                for (int j = 0; j < dst_seqlen; j++)
+                {
+                    ptr[j] = (float)(exp(ptr[j] - max));
+                    sum += ptr[j];
+                }
+
+                const float inv_sum = 1.f / sum;
+                for (int j = 0; j < dst_seqlen; j++)
+                {
+                    ptr[j] *= inv_sum;
+                }
+            }
+        }
+
+        // xqkv = xqk * xv
+        {
+            const Mat xqkm = xqk.channel(q);
+            const Mat xvm = xv.channel(q);
+
+            for (int i = 0; i < src_seqlen; i++)
+            {
+                const float* qkptr = xqkm.row(i);
+                float* outptr = xqkv.channel(i).row(q);
+
+                for (int j = 0; j < embed_dim_per_head; j++)
+                {
+                    outptr[j] = x86_dot(qkptr, xvm.row(j), dst_seqlen);
+                }
+            }
+        }
+    }
+
+    // out = affine(xqkv)
+    #pragma omp parallel for num_threads(opt.num_threads)
+    for (int i = 0; i < src_seqlen; i++)
+    {
+        const float* ptr = xqkv.channel(i);
+        float* outptr = top_blob.row(i);
+
+        for (int j = 0; j < qdim; j++)
+        {
+            const float* kptr = (const float*)out_weight_data + embed_dim * j;
+
+            outptr[j] = out_bias_data[j] + x86_dot(ptr, kptr, embed_dim);
+        }
+    }
+
+    return 0;
+}
+
+} // namespace ncnn
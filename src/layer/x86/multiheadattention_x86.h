@@ -0,0 +1,18 @@
+#ifndef LAYER_MULTIHEADATTENTION_X86_H
+#define LAYER_MULTIHEADATTENTION_X86_H
+
+#include "multiheadattention.h"
+
+namespace ncnn {
+
+class MultiHeadAttention_x86 : virtual public MultiHeadAttention
+{
+public:
+    MultiHeadAttention_x86();
+
+    virtual int forward(const std::vector<Mat>& bottom_blobs, std::vector<Mat>& top_blobs, const Option& opt) const;
+};
+
+} // namespace ncnn
+
+#endif // LAYER_MULTIHEADATTENTION_X86_H
@@ -0,0 +1,239 @@
+#ifndef X86_USABILITY_H
+#define X86_USABILITY_H
+
+#include "platform.h"
+
+#if __SSE2__
+#include <emmintrin.h>
+#if __AVX__
+#include <immintrin.h>
+#endif
+#endif // __SSE2__
+
+// all helpers are static so that the sse2 / avx / fma / avx512 translation units
+// of the same layer never share a symbol compiled for a different isa
+
+#if __SSE2__
+static NCNN_FORCEINLINE float _mm_reduce_add_ps(__m128 x128)
+{
+    const __m128 x64 = _mm_add_ps(x128, _mm_movehl_ps(x128, x128));
+    const __m128 x32 = _mm_add_ss(x64, _mm_shuffle_ps(x64, x64, 0x55));
+    return _mm_cvtss_f32(x32);
+}
+
+static NCNN_FORCEINLINE __m128 _mm_comp_fmadd_ps(const __m128& _a, const __m128& _b, const __m128& _c)
+{
+#if __FMA__
+    return _mm_fmadd_ps(_a, _b, _c);
+#else
+    return _mm_add_ps(_mm_mul_ps(_a, _b), _c);
+#endif
+}
+
+#if __AVX__
+static NCNN_FORCEINLINE float _mm256_reduce_add_ps(__m256 x)
+{
+    const __m128 x128 = _mm_add_ps(_mm256_extractf128_ps(x, 1), _mm256_castps256_ps128(x));
+    return _mm_reduce_add_ps(x128);
+}
+
+static NCNN_FORCEINLINE __m256 _mm256_comp_fmadd_ps(const __m256& _a, const __m256& _b, const __m256& _c)
+{
+#if __FMA__
+    return _mm256_fmadd_ps(_a, _b, _c);
+#else
+    return _mm256_add_ps(_mm256_mul_ps(_a, _b), _c);
+#endif
+}
+#endif // __AVX__
+#endif // __SSE2__
+
+// the widest float vector of the current isa, packed kernels are written once against it
+#if __AVX512F__
+#define X86_VECSIZE 16
+typedef __m512 x86_vec;
+static NCNN_FORCEINLINE x86_vec x86_vec_load(const float* p)
+{
+    return _mm512_loadu_ps(p);
+}
+static NCNN_FORCEINLINE void x86_vec_store(float* p, const x86_vec& v)
+{
+    _mm512_storeu_ps(p, v);
+}
+static NCNN_FORCEINLINE x86_vec x86_vec_set1(float v)
+{
+    return _mm512_set1_ps(v);
+}
+static NCNN_FORCEINLINE x86_vec x86_vec_fmadd(const x86_vec& a, const x86_vec& b, const x86_vec& c)
+{
+    return _mm512_fmadd_ps(a, b, c);
+}
+#elif __AVX__
+#define X86_VECSIZE 8
+typedef __m256 x86_vec;
+static NCNN_FORCEINLINE x86_vec x86_vec_load(const float* p)
+{
+    return _mm256_loadu_ps(p);
+}
+static NCNN_FORCEINLINE void x86_vec_store(float* p, const x86_vec& v)
+{
+    _mm256_storeu_ps(p, v);
+}
+static NCNN_FORCEINLINE x86_vec x86_vec_set1(float v)
+{
+    return _mm256_set1_ps(v);
+}
+static NCNN_FORCEINLINE x86_vec x86_vec_fmadd(const x86_vec& a, const x86_vec& b, const x86_vec& c)
+{
+    return _mm256_comp_fmadd_ps(a, b, c);
+}
+#elif __SSE2__
+#define X86_VECSIZE 4
+typedef __m128 x86_vec;
+static NCNN_FORCEINLINE x86_vec x86_vec_load(const float* p)
+{
+    return _mm_loadu_ps(p);
+}
+static NCNN_FORCEINLINE void x86_vec_store(float* p, const x86_vec& v)
+{
+    _mm_storeu_ps(p, v);
+}
+static NCNN_FORCEINLINE x86_vec x86_vec_set1(float v)
+{
+    return _mm_set1_ps(v);
+}
+static NCNN_FORCEINLINE x86_vec x86_vec_fmadd(const x86_vec& a, const x86_vec& b, const x86_vec& c)
+{
+    return _mm_comp_fmadd_ps(a, b, c);
+}
+#else
+#define X86_VECSIZE 1
+typedef float x86_vec;
+static NCNN_FORCEINLINE x86_vec x86_vec_load(const float* p)
+{
+    return p[0];
+}
+static NCNN_FORCEINLINE void x86_vec_store(float* p, const x86_vec& v)
+{
+    p[0] = v;
+}
+static NCNN_FORCEINLINE x86_vec x86_vec_set1(float v)
+{
+    return v;
+}
+static NCNN_FORCEINLINE x86_vec x86_vec_fmadd(const x86_vec& a, const x86_vec& b, const x86_vec& c)
+{
+    return a * b + c;
+}
+#endif
+
+// sum(a[i] * b[i]) for i in [0, n)
+static NCNN_FORCEINLINE float x86_dot(const float* a, const float* b, int n)
+{
+    int i = 0;
+    float sum = 0.f;
+#if __SSE2__
+#if __AVX__
+    __m256 _sum256 = _mm256_setzero_ps();
+#if __AVX512F__
+    __m512 _sum512 = _mm512_setzero_ps();
+    for (; i + 15 < n; i += 16)
+    {
+        _sum512 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), _sum512);
+    }
+    // fold the halves through memory, the lane reduce / extract intrinsics trip -Wmaybe-uninitialized on gcc
+    float tmp[16];
+    _mm512_storeu_ps(tmp, _sum512);
+    _sum256 = _mm256_add_ps(_mm256_loadu_ps(tmp), _mm256_loadu_ps(tmp + 8));
+#endif // __AVX512F__
+    for (; i + 7 < n; i += 8)
+    {
+        _sum256 = _mm256_comp_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), _sum256);
+    }
+    sum += _mm256_reduce_add_ps(_sum256);
+#endif // __AVX__
+    __m128 _sum = _mm_setzero_ps();
+    for (; i + 3 < n; i += 4)
+    {
+        _sum = _mm_comp_fmadd_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i), _sum);
+    }
+    sum += _mm_reduce_add_ps(_sum);
+#endif // __SSE2__
+    for (; i < n; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+// y[i] += a * x[i] for i in [0, n)
+static NCNN_FORCEINLINE void x86_axpy(float* y, const float* x, float a, int n)
+{
+    int i = 0;
+#if __SSE2__
+#if __AVX__
+#if __AVX512F__
+    __m512 _a512 = _mm512_set1_ps(a);
+    for (; i + 15 < n; i += 16)
+    {
+        _mm512_storeu_ps(y + i, _mm512_fmadd_ps(_mm512_loadu_ps(x + i), _a512, _mm512_loadu_ps(y + i)));
+    }
+#endif // __AVX512F__
+    __m256 _a256 = _mm256_set1_ps(a);
+    for (; i + 7 < n; i += 8)
+    {
+        _mm256_storeu_ps(y + i, _mm256_comp_fmadd_ps(_mm256_loadu_ps(x + i), _a256, _mm256_loadu_ps(y + i)));
+    }
+#endif // __AVX__
+    __m128 _a = _mm_set1_ps(a);
+    for (; i + 3 < n; i += 4)
+    {
+        _mm_storeu_ps(y + i, _mm_comp_fmadd_ps(_mm_loadu_ps(x + i), _a, _mm_loadu_ps(y + i)));
+    }
+#endif // __SSE2__
+    for (; i < n; i++)
+    {
+        y[i] += a * x[i];
+    }
+}
+
+// y[i] += a * x[i * stride] for i in [0, n)
+static NCNN_FORCEINLINE void x86_axpy_strided(float* y, const float* x, float a, int n, int stride)
+{
+    if (stride == 1)
+    {
+        x86_axpy(y, x, a, n);
+        return;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        y[i] += a * x[i * stride];
+    }
+}
+
+// y[i] = v for i in [0, n)
+static NCNN_FORCEINLINE void x86_fill(float* y, float v, int n)
+{
+    int i = 0;
+#if __SSE2__
+#if __AVX__
+    __m256 _v256 = _mm256_set1_ps(v);
+    for (; i + 7 < n; i += 8)
+    {
+        _mm256_storeu_ps(y + i, _v256);
+    }
+#endif // __AVX__
+    __m128 _v = _mm_set1_ps(v);
+    for (; i + 3 < n; i += 4)
+    {
+        _mm_storeu_ps(y + i, _v);
+    }
+#endif // __SSE2__
+    for (; i < n; i++)
+    {
+        y[i] = v;
+    }
+}
+
+#endif // X86_USABILITY_H
@@ -55,6 +55,22 @@ Mat ModelBin::load(int w, int h, int d, int c, int type, Allocator* allocator) c
     return m.reshape(w, h, d, c, allocator);
 }
 
+int ModelBin::locate(int /*w*/, int* /*fd*/, size_t* /*offset*/) const
+{
+    return -1;
+}
+
+int ModelBin::load_chunked_begin(int w, Mat& m, Allocator* allocator) const
+{
+    m = load(w, 0, allocator);
+    return m.empty() ? -1 : 0;
+}
+
+int ModelBin::load_chunk(void* /*ptr*/, size_t /*size*/) const
+{
+    return -1;
+}
+
 class ModelBinFromDataReaderPrivate
 {
 public:
@@ -85,209 +101,252 @@ ModelBinFromDataReader& ModelBinFromDataReader::operator=(const ModelBinFromData
     return *this;
 }
 
-Mat ModelBinFromDataReader::load(int w, int type, Allocator* allocator) const
+// the part of type 0 loading after the leading tag, shared by load and load_chunked_begin
+static Mat load_tagged_data(const DataReader& dr, unsigned int tag, int w, Allocator* allocator, flexnn::PlannedAllocator* planned_allocator)
 {
     Mat m;
-    flexnn::PlannedAllocator* planned_allocator = 0;
-    if (allocator && allocator->get_type() == 4)
+    size_t nread;
+
+    union
     {
-        flexnn::PlannedAllocatorInterface* interface = static_cast<flexnn::PlannedAllocatorInterface*>(allocator);
-        if (interface)
+        struct
         {
-            // NCNN_LOGE("cast allocator to interface success.");
-            planned_allocator = interface->get_allocator();
-        }
-        else
-        {
-            NCNN_LOGE("cast allocator to interface failed.");
-        }
-    }
+            unsigned char f0;
+            unsigned char f1;
+            unsigned char f2;
+            unsigned char f3;
+        };
+        unsigned int tag;
+    } flag_struct;
 
-    if (type == 0)
+    flag_struct.tag = tag;
+
+    unsigned int flag = flag_struct.f0 + flag_struct.f1 + flag_struct.f2 + flag_struct.f3;
+
+    if (flag_struct.tag == 0x01306B47)
     {
-        size_t nread;
+        // half-precision data
+        size_t align_data_size = alignSize(w * sizeof(unsigned short), 4);
 
-        union
+        // try reference data
+        const void* refbuf = 0;
+        nread = dr.reference(align_data_size, &refbuf);
+        if (nread == align_data_size)
         {
-            struct
+            m = Mat::from_float16((const unsigned short*)refbuf, w);
+        }
+        else
+        {
+            std::vector<unsigned short> float16_weights;
+            float16_weights.resize(align_data_size);
+            nread = dr.read(&float16_weights[0], align_data_size);
+            if (nread != align_data_size)
             {
-                unsigned char f0;
-                unsigned char f1;
-                unsigned char f2;
-                unsigned char f3;
-            };
-            unsigned int tag;
-        } flag_struct;
+                NCNN_LOGE("ModelBin read float16_weights failed %zd", nread);
+                return Mat();
+            }
 
-        nread = d->dr.read(&flag_struct, sizeof(flag_struct));
-        if (nread != sizeof(flag_struct))
-        {
-            NCNN_LOGE("ModelBin read flag_struct failed %zd", nread);
-            return Mat();
+            // fp16 is not handled by allocator!
+            m = Mat::from_float16(&float16_weights[0], w);
         }
 
-        unsigned int flag = flag_struct.f0 + flag_struct.f1 + flag_struct.f2 + flag_struct.f3;
+        return m;
+    }
+    else if (flag_struct.tag == 0x000D4B38)
+    {
+        // int8 data
+        size_t align_data_size = alignSize(w, 4);
 
-        if (flag_struct.tag == 0x01306B47)
+        // try reference data
+        const void* refbuf = 0;
+        nread = dr.reference(align_data_size, &refbuf);
+        if (nread == align_data_size)
+        {
+            m = Mat(w, (void*)refbuf, (size_t)1u);
+        }
+        else
         {
-            // half-precision data
-            size_t align_data_size = alignSize(w * sizeof(unsigned short), 4);
+            // read straight into the planned buffer, the padding is skipped
+            m.create(w, (size_t)1u, allocator);
+            if (m.empty())
+                return m;
 
-            // try reference data
-            const void* refbuf = 0;
-            nread = d->dr.reference(align_data_size, &refbuf);
-            if (nread == align_data_size)
-            {
-                m = Mat::from_float16((const unsigned short*)refbuf, w);
-            }
-            else
+            // skip loading if persistent
+            if (planned_allocator && planned_allocator->is_persistent(m.data))
             {
-                std::vector<unsigned short> float16_weights;
-                float16_weights.resize(align_data_size);
-                nread = d->dr.read(&float16_weights[0], align_data_size);
-                if (nread != align_data_size)
+                if (!dr.seek(align_data_size))
                 {
-                    NCNN_LOGE("ModelBin read float16_weights failed %zd", nread);
+                    NCNN_LOGE("ModelBin seek int8_weights failed");
                     return Mat();
                 }
-
-                // fp16 is not handled by allocator!
-                m = Mat::from_float16(&float16_weights[0], w);
+                return m;
             }
 
-            return m;
-        }
-        else if (flag_struct.tag == 0x000D4B38)
-        {
-            // int8 data
-            size_t align_data_size = alignSize(w, 4);
-
-            // try reference data
-            const void* refbuf = 0;
-            nread = d->dr.reference(align_data_size, &refbuf);
-            if (nread == align_data_size)
+            nread = dr.read(m.data, w);
+            if (nread != (size_t)w)
             {
-                m = Mat(w, (void*)refbuf, (size_t)1u);
+                NCNN_LOGE("ModelBin read int8_weights failed %zd", nread);
+                return Mat();
             }
-            else
-            {
-                std::vector<signed char> int8_weights;
-                int8_weights.resize(align_data_size);
-                nread = d->dr.read(&int8_weights[0], align_data_size);
-                if (nread != align_data_size)
-                {
-                    NCNN_LOGE("ModelBin read int8_weights failed %zd", nread);
-                    return Mat();
-                }
 
-                m.create(w, (size_t)1u, allocator);
-                if (m.empty())
-                    return m;
-
-                memcpy(m.data, &int8_weights[0], w);
+            if (align_data_size != (size_t)w && !dr.seek(align_data_size - w))
+            {
+                NCNN_LOGE("ModelBin seek int8_weights padding failed");
+                return Mat();
             }
+        }
 
-            return m;
+        return m;
+    }
+    else if (flag_struct.tag == 0x0002C056)
+    {
+        // try reference data
+        const void* refbuf = 0;
+        nread = dr.reference(w * sizeof(float), &refbuf);
+        if (nread == w * sizeof(float))
+        {
+            m = Mat(w, (void*)refbuf);
         }
-        else if (flag_struct.tag == 0x0002C056)
+        else
         {
-            // try reference data
-            const void* refbuf = 0;
-            nread = d->dr.reference(w * sizeof(float), &refbuf);
-            if (nread == w * sizeof(float))
+            m.create(w, (size_t)4u, allocator);
+            if (m.empty())
+                return m;
+
+            // raw data with extra scaling
+            nread = dr.read(m, w * sizeof(float));
+            if (nread != w * sizeof(float))
             {
-                m = Mat(w, (void*)refbuf);
+                NCNN_LOGE("ModelBin read weight_data failed %zd", nread);
+                return Mat();
             }
-            else
-            {
-                m.create(w, (size_t)4u, allocator);
-                if (m.empty())
-                    return m;
+        }
 
-                // raw data with extra scaling
-                nread = d->dr.read(m, w * sizeof(float));
-                if (nread != w * sizeof(float))
-                {
-                    NCNN_LOGE("ModelBin read weight_data failed %zd", nread);
-                    return Mat();
-                }
-            }
+        return m;
+    }
 
+    if (flag != 0)
+    {
+        m.create(w, (size_t)4u, allocator);
+        if (m.empty())
             return m;
+
+        // quantized data
+        float quantization_value[256];
+        nread = dr.read(quantization_value, 256 * sizeof(float));
+        if (nread != 256 * sizeof(float))
+        {
+            NCNN_LOGE("ModelBin read quantization_value failed %zd", nread);
+            return Mat();
         }
 
-        if (flag != 0)
+        size_t align_weight_data_size = alignSize(w * sizeof(unsigned char), 4);
+        std::vector<unsigned char> index_array;
+        index_array.resize(align_weight_data_size);
+        nread = dr.read(&index_array[0], align_weight_data_size);
+        if (nread != align_weight_data_size)
+        {
+            NCNN_LOGE("ModelBin read index_array failed %zd", nread);
+            return Mat();
+        }
+
+        float* ptr = m;
+        for (int i = 0; i < w; i++)
+        {
+            ptr[i] = quantization_value[index_array[i]];
+        }
+    }
+    else if (flag_struct.f0 == 0)
+    {
+        // try reference data
+        const void* refbuf = 0;
+        nread = dr.reference(w * sizeof(float), &refbuf);
+        if (nread == w * sizeof(float))
+        {
+            m = Mat(w, (void*)refbuf);
+        }
+        else
         {
             m.create(w, (size_t)4u, allocator);
             if (m.empty())
                 return m;
 
-            // quantized data
-            float quantization_value[256];
-            nread = d->dr.read(quantization_value, 256 * sizeof(float));
-            if (nread != 256 * sizeof(float))
+            // skip loading if persistent
+            if (planned_allocator)
             {
-                NCNN_LOGE("ModelBin read quantization_value failed %zd", nread);
-                return Mat();
+                if (planned_allocator->is_persistent(m.data))
+                {
+                    // still move stream forward
+                    if (!dr.seek(w * sizeof(float)))
+                    {
+                        NCNN_LOGE("ModelBin seek weight_data failed");
+                        return Mat();
+                    }
+                    return m;
+                }
             }
 
-            size_t align_weight_data_size = alignSize(w * sizeof(unsigned char), 4);
-            std::vector<unsigned char> index_array;
-            index_array.resize(align_weight_data_size);
-            nread = d->dr.read(&index_array[0], align_weight_data_size);
-            if (nread != align_weight_data_size)
+            // raw data
+            nread = dr.read(m, w * sizeof(float));
+            if (nread != w * sizeof(float))
             {
-                NCNN_LOGE("ModelBin read index_array failed %zd", nread);
+                NCNN_LOGE("ModelBin read weight_data failed %zd", nread);
                 return Mat();
             }
+        }
+    }
 
-            float* ptr = m;
-            for (int i = 0; i < w; i++)
-            {
-                ptr[i] = quantization_value[index_array[i]];
-            }
+    return m;
+}
+
+static flexnn::PlannedAllocator* get_planned_allocator(Allocator* allocator)
+{
+    flexnn::PlannedAllocator* planned_allocator = 0;
+    if (allocator && allocator->get_type() == 4)
+    {
+        flexnn::PlannedAllocatorInterface* interface = static_cast<flexnn::PlannedAllocatorInterface*>(allocator);
+        if (interface)
+        {
+            // NCNN_LOGE("cast allocator to interface success.");
+            planned_allocator = interface->get_allocator();
         }
-        else if (flag_struct.f0 == 0)
+        else
         {
-            // try reference data
-            const void* refbuf = 0;
-            nread = d->dr.reference(w * sizeof(float), &refbuf);
-            if (nread == w * sizeof(float))
-            {
-                m = Mat(w, (void*)refbuf);
-            }
-            else
-            {
-                m.create(w, (size_t)4u, allocator);
-                if (m.empty())
-                    return m;
+            NCNN_LOGE("cast allocator to interface failed.");
+        }
+    }
+    return planned_allocator;
+}
 
-                // skip loading if persistent
-                if (planned_allocator)
-                {
-                    if (planned_allocator->is_persistent(m.data))
-                    {
-                        // still move stream forward
-                        if (!d->dr.seek(w * sizeof(float)))
-                        {
-                            NCNN_LOGE("ModelBin seek weight_data failed");
-                            return Mat();
-                        }
-                        return m;
-                    }
-                }
+Mat ModelBinFromDataReader::load(int w, int type, Allocator* allocator) const
+{
+    Mat m;
+    flexnn::PlannedAllocator* planned_allocator = get_planned_allocator(allocator);
 
-                // raw data
-                nread = d->dr.read(m, w * sizeof(float));
-                if (nread != w * sizeof(float))
-                {
-                    NCNN_LOGE("ModelBin read weight_data failed %zd", nread);
-                    return Mat();
-                }
-            }
+    if (type == 0)
+    {
+        size_t nread;
+
+        union
+        {
+            struct
+            {
+                unsigned char f0;
+                unsigned char f1;
+                unsigned char f2;
+                unsigned char f3;
+            };
+            unsigned int tag;
+        } flag_struct;
+
+        nread = d->dr.read(&flag_struct, sizeof(flag_struct));
+        if (nread != sizeof(flag_struct))
+        {
+            NCNN_LOGE("ModelBin read flag_struct failed %zd", nread);
+            return Mat();
         }
 
-        return m;
+        return load_tagged_data(d->dr, flag_struct.tag, w, allocator, planned_allocator);
     }
     else if (type == 1)
     {
@@ -339,6 +398,80 @@ Mat ModelBinFromDataReader::load(int w, int type, Allocator* allocator) const
     return Mat();
 }
 
+int ModelBinFromDataReader::load_chunked_begin(int w, Mat& m, Allocator* allocator) const
+{
+    flexnn::PlannedAllocator* planned_allocator = get_planned_allocator(allocator);
+
+    unsigned int tag;
+    size_t nread = d->dr.read(&tag, sizeof(tag));
+    if (nread != sizeof(tag))
+    {
+        NCNN_LOGE("ModelBin read flag_struct failed %zd", nread);
+        return -1;
+    }
+
+    if (tag != 0 && tag != 0x0002C056)
+    {
+        // converted data is only usable as a whole
+        m = load_tagged_data(d->dr, tag, w, allocator, planned_allocator);
+        return m.empty() ? -1 : 0;
+    }
+
+    // try reference data
+    const void* refbuf = 0;
+    nread = d->dr.reference(w * sizeof(float), &refbuf);
+    if (nread == w * sizeof(float))
+    {
+        m = Mat(w, (void*)refbuf);
+        return 0;
+    }
+
+    m.create(w, (size_t)4u, allocator);
+    if (m.empty())
+        return -1;
+
+    // skip loading if persistent
+    if (planned_allocator && planned_allocator->is_persistent(m.data))
+    {
+        // still move stream forward
+        if (!d->dr.seek(w * sizeof(float)))
+        {
+            NCNN_LOGE("ModelBin seek weight_data failed");
+            return -1;
+        }
+        return 0;
+    }
+
+    return 1;
+}
+
+int ModelBinFromDataReader::load_chunk(void* ptr, size_t size) const
+{
+    size_t nread = d->dr.read(ptr, size);
+    if (nread != size)
+    {
+        NCNN_LOGE("ModelBin read weight_data chunk failed %zd", nread);
+        return -1;
+    }
+
+    return 0;
+}
+
+int ModelBinFromDataReader::locate(int w, int* fd, size_t* offset) const
+{
+    if (!d->dr.tell(fd, offset))
+        return -1;
+
+    // still move stream forward
+    if (!d->dr.seek(w * sizeof(float)))
+    {
+        NCNN_LOGE("ModelBin seek weight_data failed");
+        return -1;
+    }
+
+    return 0;
+}
+
 Mat ModelBinFromDataReader::load_no_reshape(int w, int h, int c, int type, Allocator* allocator) const
 {
     Mat m;
@@ -384,7 +517,6 @@ Mat ModelBinFromDataReader::load_no_reshape(int w, int h, int c, int type, Alloc
 
         // unsigned int flag = flag_struct.f0 + flag_struct.f1 + flag_struct.f2 + flag_struct.f3;
 
-        // TODO: other precisions.
         if (flag_struct.tag == 0x0002C056 || flag_struct.f0 == 0)
         {
             m.create(w, h, c, (size_t)4u, allocator);
@@ -416,6 +548,86 @@ Mat ModelBinFromDataReader::load_no_reshape(int w, int h, int c, int type, Alloc
 
             return m;
         }
+        else if (flag_struct.tag == 0x01306B47)
+        {
+            // half-precision data, written with the cstep padding of the elemsize 4 mat, widened on load
+            m.create(w, h, c, (size_t)4u, allocator);
+            if (m.empty())
+                return m;
+
+            const size_t align_data_size = alignSize(m.total() * sizeof(unsigned short), 4);
+
+            // skip loading if persistent
+            if (planned_allocator)
+            {
+                if (planned_allocator->is_persistent(m.data))
+                {
+                    // still move stream forward
+                    if (!d->dr.seek(align_data_size))
+                    {
+                        NCNN_LOGE("ModelBin seek weight_data failed");
+                        return Mat();
+                    }
+                    return m;
+                }
+            }
+
+            std::vector<unsigned short> float16_weights;
+            float16_weights.resize(align_data_size / sizeof(unsigned short));
+            nread = d->dr.read(&float16_weights[0], align_data_size);
+            if (nread != align_data_size)
+            {
+                NCNN_LOGE("ModelBin read float16_weights failed %zd", nread);
+                return Mat();
+            }
+
+            float* ptr = m;
+            for (size_t i = 0; i < m.total(); i++)
+            {
+                ptr[i] = float16_to_float32(float16_weights[i]);
+            }
+
+            return m;
+        }
+        else if (flag_struct.tag == 0x000D4B38)
+        {
+            // int8 data, written with the cstep padding of the elemsize 1 mat
+            m.create(w, h, c, (size_t)1u, allocator);
+            if (m.empty())
+                return m;
+
+            const size_t align_data_size = alignSize(m.total(), 4);
+
+            // skip loading if persistent
+            if (planned_allocator)
+            {
+                if (planned_allocator->is_persistent(m.data))
+                {
+                    // still move stream forward
+                    if (!d->dr.seek(align_data_size))
+                    {
+                        NCNN_LOGE("ModelBin seek weight_data failed");
+                        return Mat();
+                    }
+                    return m;
+                }
+            }
+
+            nread = d->dr.read(m, m.total());
+            if (nread != m.total())
+            {
+                NCNN_LOGE("ModelBin read weight_data failed %zd", nread);
+                return Mat();
+            }
+
+            if (align_data_size != m.total() && !d->dr.seek(align_data_size - m.total()))
+            {
+                NCNN_LOGE("ModelBin seek weight_data padding failed");
+                return Mat();
+            }
+
+            return m;
+        }
         else
         {
             NCNN_LOGE("ModelBin load_no_reshape type %d not implemented", flag_struct.tag);
@@ -39,6 +39,15 @@ public:
     virtual Mat load(int w, int h, int c, int type, Allocator* allocator = 0) const;
     // load cube
     virtual Mat load(int w, int h, int d, int c, int type, Allocator* allocator = 0) const;
+    // locate w float32 elements in the model file and skip over them
+    // return 0 if success, -1 if not backed by a file
+    virtual int locate(int w, int* fd, size_t* offset) const;
+    // begin loading w float32 elements piece by piece with load_chunk
+    // return 1 if m is allocated and the raw data still has to be read in order,
+    // 0 if m is already complete, -1 on error
+    virtual int load_chunked_begin(int w, Mat& m, Allocator* allocator = 0) const;
+    // read the next size bytes of the data begun by load_chunked_begin
+    virtual int load_chunk(void* ptr, size_t size) const;
 };
 
 class ModelBinFromDataReaderPrivate;
@@ -50,6 +59,11 @@ public:
 
     virtual Mat load(int w, int type, Allocator* allocator = 0) const;
 
+    virtual int locate(int w, int* fd, size_t* offset) const;
+
+    virtual int load_chunked_begin(int w, Mat& m, Allocator* allocator = 0) const;
+    virtual int load_chunk(void* ptr, size_t size) const;
+
     // support loading 3d mats directly without reshaping
     Mat load_no_reshape(int w, int h, int c, int type, Allocator* allocator = 0) const;
 
@@ -109,7 +109,7 @@ class ForwardParallelContext
 {
 public:
     ForwardParallelContext(std::vector<Mat>& _blob_mats, FILE* _fp, NetPrivate* _netp, const Option& _opt, int _load_cpu, int _comp_cpu, bool _should_terminate = false)
-        : blob_mats(_blob_mats), fp(_fp), netp(_netp), opt(_opt), loading_cpu_index(_load_cpu), computing_cpu_index(_comp_cpu), is_loading_completed(false), is_computing_completed(false), should_ternimate(_should_terminate)
+        : blob_mats(_blob_mats), fp(_fp), netp(_netp), opt(_opt), loading_cpu_index(_load_cpu), computing_cpu_index(_comp_cpu), is_loading_completed(false), is_computing_completed(false), should_ternimate(_should_terminate), input_layer_count(0), ret(0)
     {
     }
     ~ForwardParallelContext()
@@ -143,6 +143,23 @@ public:
     std::vector<int> loading_dependencies; // load [v[i-1],v[i]) after i computed
     bool should_ternimate;
     int input_layer_count;
+
+    // first error of this forward, the remaining layers are counted through without work
+    int ret;
+    void set_ret(int _ret)
+    {
+        task_lock.lock();
+        if (ret == 0)
+            ret = _ret;
+        task_lock.unlock();
+    }
+    int get_ret()
+    {
+        task_lock.lock();
+        int _ret = ret;
+        task_lock.unlock();
+        return _ret;
+    }
 };
 
 class NetPrivate
@@ -175,6 +192,7 @@ public:
 #endif // NCNN_VULKAN
 
     int convert_layout(Mat& bottom_blob, const Layer* layer, const Option& opt) const;
+    int convert_layout(flexnn::DummyMat& bottom_blob, const Layer* layer, const Option& opt) const;
 
     int do_forward_layer(const Layer* layer, std::vector<Mat>& blob_mats, const Option& opt) const;
 
@@ -192,6 +210,9 @@ public:
     std::vector<Blob> blobs;
     std::vector<Layer*> layers;
 
+    // MultiHeadAttention layers with the kv_cache param
+    std::vector<int> kv_cache_layer_indexes;
+
     std::vector<int> input_blob_indexes;
     std::vector<int> output_blob_indexes;
 #if NCNN_STRING
@@ -479,6 +500,7 @@ int NetPrivate::forward_layer_ondemand(int layer_index, std::vector<Mat>& blob_m
 
         if (opt.time_profiler)
         {
+            opt.time_profiler->layer_computing_isa(lid, get_layer_isa(layer, layer->featmask ? get_masked_option(opt, layer->featmask) : opt));
             opt.time_profiler->layer_computing_begin(lid);
         }
         int ret = 0;
@@ -564,12 +586,14 @@ int NetPrivate::forward_layer_parallel(int /*layer_index*/, std::vector<Mat>& bl
         ctx.loading_dependencies = *opt.layer_dependencies;
     }
 
+    // workers read input_layer_count as soon as they pop ctx
+    ctx.input_layer_count = input_layers_count;
+
     loading_contex_queue.push(&ctx);
     computing_contex_queue.push(&ctx);
 
     ctx.loading_lock.lock();
     ctx.loading_tasks.push(input_layers_count); // skip input layer
-    ctx.input_layer_count = input_layers_count;
     ctx.loading_cond.signal();
     ctx.loading_lock.unlock();
 
@@ -581,7 +605,7 @@ int NetPrivate::forward_layer_parallel(int /*layer_index*/, std::vector<Mat>& bl
     ctx.task_lock.unlock();
 
     // end of ctx lifetime
-    return 0;
+    return ctx.ret;
 }
 
 int NetPrivate::forward_layer(int layer_index, std::vector<flexnn::DummyMat>& blob_dummy_mats, const Option& opt) const
@@ -1347,6 +1371,61 @@ int NetPrivate::convert_layout(Mat& bottom_blob, const Layer* layer, const Optio
     return 0;
 }
 
+int NetPrivate::convert_layout(flexnn::DummyMat& bottom_blob, const Layer* layer, const Option& opt) const
+{
+    // same storage type decisions as the Mat version, dummy mats carry no elempack
+    int half_storage_type = 0; // 1 = fp16, 2 = bf16
+
+    // clang-format off
+    // *INDENT-OFF*
+#if NCNN_ARM82
+    if (opt.use_fp16_storage && cpu_support_arm_asimdhp())
+    {
+        half_storage_type = 1;
+    }
+    else
+#endif // NCNN_ARM82
+#if NCNN_RVV
+    if (opt.use_fp16_storage && cpu_support_riscv_v() && cpu_support_riscv_zfh())
+    {
+        half_storage_type = 1;
+    }
+    else
+#endif // NCNN_RVV
+#if NCNN_BF16
+    if (opt.use_bf16_storage)
+    {
+        half_storage_type = 2;
+    }
+    else
+#endif // NCNN_BF16
+    {
+        // no type conversion
+    }
+    // *INDENT-ON*
+    // clang-format on
+
+    if (half_storage_type == 0)
+        return 0;
+
+    const bool support_half_storage = half_storage_type == 1 ? layer->support_fp16_storage : layer->support_bf16_storage;
+
+    if (bottom_blob.elemsize == 4u && support_half_storage)
+    {
+        flexnn::DummyMat bottom_blob_half;
+        flexnn::cast_storage(bottom_blob, bottom_blob_half, 2u, opt);
+        bottom_blob = bottom_blob_half;
+    }
+    if (bottom_blob.elemsize == 2u && !support_half_storage)
+    {
+        flexnn::DummyMat bottom_blob_fp32;
+        flexnn::cast_storage(bottom_blob, bottom_blob_fp32, 4u, opt);
+        bottom_blob = bottom_blob_fp32;
+    }
+
+    return 0;
+}
+
 int NetPrivate::do_forward_layer(const Layer* layer, std::vector<Mat>& blob_mats, const Option& opt) const
 {
     if (layer->one_blob_only)
@@ -1496,7 +1575,7 @@ int NetPrivate::do_forward_layer(const Layer* layer, std::vector<flexnn::DummyMa
             bottom_blob = bottom_blob_ref;
         }
 
-        // convert_layout(bottom_blob, layer, opt);
+        convert_layout(bottom_blob, layer, opt);
 
         // forward
         if (opt.lightmode && layer->support_inplace)
@@ -1549,7 +1628,7 @@ int NetPrivate::do_forward_layer(const Layer* layer, std::vector<flexnn::DummyMa
                 bottom_blobs[i] = bottom_blob_ref;
             }
 
-            // convert_layout(bottom_blobs[i], layer, opt);
+            convert_layout(bottom_blobs[i], layer, opt);
         }
 
         // forward
@@ -2021,6 +2100,7 @@ int Net::load_param(const DataReader& dr)
 
     d->layers.resize((size_t)layer_count);
     d->blobs.resize((size_t)blob_count);
+    d->kv_cache_layer_indexes.clear();
 
 #if NCNN_VULKAN
     // TODO enable gpu when bf16 conversion implemented
@@ -2194,6 +2274,9 @@ int Net::load_param(const DataReader& dr)
         // pull out layer specific feature disabled set
         layer->featmask = pd.get(31, 0);
 
+        if (layer->typeindex == LayerType::MultiHeadAttention && pd.get(7, 0))
+            d->kv_cache_layer_indexes.push_back(i);
+
         int lr = layer->load_param(pd);
         if (lr != 0)
         {
@@ -2241,6 +2324,7 @@ int Net::load_param_dummy(const DataReader& dr)
 
     d->layers.resize((size_t)layer_count);
     d->blobs.resize((size_t)blob_count);
+    d->kv_cache_layer_indexes.clear();
 
 #if NCNN_VULKAN
     // TODO enable gpu when bf16 conversion implemented
@@ -2383,15 +2467,15 @@ int Net::load_param_dummy(const DataReader& dr)
                 int dims = psh[0];
                 if (dims == 1)
                 {
-                    blob.dummy_shape = flexnn::DummyMat(psh[1], 4u, 1);
+                    blob.dummy_shape = flexnn::DummyMat(psh[1], (size_t)4u);
                 }
                 if (dims == 2)
                 {
-                    blob.dummy_shape = flexnn::DummyMat(psh[1], psh[2], 4u, 1);
+                    blob.dummy_shape = flexnn::DummyMat(psh[1], psh[2], (size_t)4u);
                 }
                 if (dims == 3)
                 {
-                    blob.dummy_shape = flexnn::DummyMat(psh[1], psh[2], psh[3], 4u, 1);
+                    blob.dummy_shape = flexnn::DummyMat(psh[1], psh[2], psh[3], (size_t)4u);
                 }
 
                 psh += 4;
@@ -2414,6 +2498,9 @@ int Net::load_param_dummy(const DataReader& dr)
         // pull out layer specific feature disabled set
         layer->featmask = pd.get(31, 0);
 
+        if (layer->typeindex == LayerType::MultiHeadAttention && pd.get(7, 0))
+            d->kv_cache_layer_indexes.push_back(i);
+
         int lr = layer->load_param(pd);
         if (lr != 0)
         {
@@ -2461,6 +2548,7 @@ int Net::load_param_bin(const DataReader& dr)
 
     d->layers.resize(layer_count);
     d->blobs.resize(blob_count);
+    d->kv_cache_layer_indexes.clear();
 
 #if NCNN_VULKAN
     // TODO enable gpu when bf16 conversion implemented
@@ -2620,6 +2708,9 @@ int Net::load_param_bin(const DataReader& dr)
         // pull out layer specific feature disabled set
         layer->featmask = pd.get(31, 0);
 
+        if (layer->typeindex == LayerType::MultiHeadAttention && pd.get(7, 0))
+            d->kv_cache_layer_indexes.push_back(i);
+
         int lr = layer->load_param(pd);
         if (lr != 0)
         {
@@ -3026,9 +3117,72 @@ void* loading_thread_worker(void* args)
                 {
                     ctx->opt.time_profiler->layer_loading_begin(layer_index);
                 }
-                layer->load_model(mb, ctx->opt);
+                const bool skip = ctx->get_ret() != 0;
+                int ret = 0;
+                if (!skip && ctx->opt.use_weight_chunk_pipeline && layer->support_weight_chunks)
+                {
+                    int chunk_count = layer->load_model_chunked_begin(mb, ctx->opt);
+                    if (chunk_count < 0)
+                    {
+                        NCNN_LOGE("load_model_chunked_begin of layer %d failed %d", layer_index, chunk_count);
+                        ret = chunk_count;
+                    }
+                    else if (chunk_count > 0)
+                    {
+                        layer->weight_chunks.begin(chunk_count);
+                        ret = layer->create_pipeline(ctx->opt);
+                        if (ret != 0)
+                        {
+                            NCNN_LOGE("create_pipeline of layer %d failed %d", layer_index, ret);
+                            ctx->set_ret(ret);
+                            layer->weight_chunks.fail();
+                        }
+
+                        // computing starts now and waits on each chunk as it lands
+                        ctx->computing_lock.lock();
+                        ctx->computing_tasks.push(layer_index);
+                        ctx->computing_cond.signal();
+                        ctx->computing_lock.unlock();
+
+                        for (int i = 0; i <= chunk_count && ret == 0; i++)
+                        {
+                            // a failed layer before this one skips the forward, stop streaming so it can release
+                            if (ctx->get_ret() != 0)
+                            {
+                                layer->weight_chunks.fail();
+                                break;
+                            }
+                            if (layer->load_model_chunk(mb, i, ctx->opt) != 0)
+                            {
+                                // the computing thread is already waiting on this layer
+                                NCNN_LOGE("load_model_chunk %d of layer %d failed", i, layer_index);
+                                ctx->set_ret(-100);
+                                layer->weight_chunks.fail();
+                                break;
+                            }
+                            layer->weight_chunks.publish(i + 1);
+                        }
+
+                        task_count++;
+                        if (ctx->opt.time_profiler)
+                        {
+                            ctx->opt.time_profiler->layer_loading_end(layer_index);
+                        }
+                        continue;
+                    }
+                }
+                else if (!skip)
+                {
+                    ret = layer->load_model(mb, ctx->opt);
+                }
                 // fprintf(stderr, "begin create pipeline layer %d %s.\n", layer_index, layer->name.c_str());
-                layer->create_pipeline(ctx->opt);
+                if (!skip && ret == 0)
+                    ret = layer->create_pipeline(ctx->opt);
+                if (ret != 0)
+                {
+                    NCNN_LOGE("load layer %d failed %d", layer_index, ret);
+                    ctx->set_ret(ret);
+                }
                 task_count++;
                 if (ctx->opt.time_profiler)
                 {
@@ -3115,13 +3269,27 @@ void* computing_thread_worker(void* args)
                 // computing and releasing
                 Layer* layer = ctx->netp->layers[layer_index];
                 // fprintf(stderr, "begin computing layer %d %s.\n", layer_index, layer->name.c_str());
+                const Option layer_opt = layer->featmask ? get_masked_option(ctx->opt, layer->featmask) : ctx->opt;
                 if (ctx->opt.time_profiler)
                 {
+                    ctx->opt.time_profiler->layer_computing_isa(layer_index, get_layer_isa(layer, layer_opt));
                     ctx->opt.time_profiler->layer_computing_begin(layer_index);
                 }
-                ctx->netp->do_forward_layer(layer, ctx->blob_mats, ctx->opt);
+                if (ctx->get_ret() == 0)
+                {
+                    int ret = ctx->netp->do_forward_layer(layer, ctx->blob_mats, layer_opt);
+                    if (ret != 0)
+                    {
+                        NCNN_LOGE("forward layer %d failed %d", layer_index, ret);
+                        ctx->set_ret(ret);
+                    }
+                }
+                // a skipped or early returning forward leaves the loader writing the remaining chunks
+                if (layer->weight_chunks.count() > 0)
+                    layer->weight_chunks.wait(layer->weight_chunks.count());
                 layer->destroy_pipeline(ctx->opt);
                 layer->release_model();
+                layer->weight_chunks.reset();
                 task_count++;
                 if (ctx->opt.time_profiler)
                 {
@@ -3288,6 +3456,7 @@ void Net::clear()
         }
     }
     d->layers.clear();
+    d->kv_cache_layer_indexes.clear();
 
     if (d->local_blob_allocator)
     {
@@ -3980,6 +4149,71 @@ int Extractor::extract_parallel(int blob_index, Mat& feat)
     return ret;
 }
 
+// past key / value bottoms and present key / value tops of the MultiHeadAttention layers with kv_cache
+static void get_kv_cache_blobs(const std::vector<Layer*>& layers, const std::vector<int>& kv_cache_layer_indexes, std::vector<int>& past_blobs, std::vector<int>& present_blobs)
+{
+    for (size_t i = 0; i < kv_cache_layer_indexes.size(); i++)
+    {
+        const Layer* layer = layers[kv_cache_layer_indexes[i]];
+        if (layer->bottoms.size() < 2 || layer->tops.size() != 3)
+        {
+            NCNN_LOGE("kv_cache layer %d expects past key / value bottoms and 3 tops", kv_cache_layer_indexes[i]);
+            continue;
+        }
+
+        const size_t bottom_count = layer->bottoms.size();
+        past_blobs.push_back(layer->bottoms[bottom_count - 2]);
+        past_blobs.push_back(layer->bottoms[bottom_count - 1]);
+        present_blobs.push_back(layer->tops[1]);
+        present_blobs.push_back(layer->tops[2]);
+    }
+}
+
+int Extractor::input_kv_cache(const std::vector<Mat>& cache)
+{
+    std::vector<int> past_blobs;
+    std::vector<int> present_blobs;
+    get_kv_cache_blobs(d->net->layers(), d->net->d->kv_cache_layer_indexes, past_blobs, present_blobs);
+
+    if (!cache.empty() && cache.size() != past_blobs.size())
+    {
+        NCNN_LOGE("kv cache size %d does not match %d kv_cache blobs", (int)cache.size(), (int)past_blobs.size());
+        return -1;
+    }
+
+    for (size_t i = 0; i < past_blobs.size(); i++)
+    {
+        // zero length past, still a valid blob so that the layer runs
+        Mat past = cache.empty() ? Mat(0, 0, (size_t)4u) : cache[i];
+
+        int ret = input(past_blobs[i], past);
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+int Extractor::extract_kv_cache(std::vector<Mat>& cache, Allocator* allocator)
+{
+    std::vector<int> past_blobs;
+    std::vector<int> present_blobs;
+    get_kv_cache_blobs(d->net->layers(), d->net->d->kv_cache_layer_indexes, past_blobs, present_blobs);
+
+    cache.resize(present_blobs.size());
+    for (size_t i = 0; i < present_blobs.size(); i++)
+    {
+        Mat present;
+        int ret = extract(present_blobs[i], present);
+        if (ret != 0)
+            return ret;
+
+        cache[i] = present.clone(allocator);
+    }
+
+    return 0;
+}
+
 #if NCNN_STRING
 int Extractor::input(const char* blob_name, const flexnn::DummyMat& in)
 {
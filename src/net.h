@@ -265,6 +265,18 @@ public:
     // return 0 if success
     int extract_parallel(int blob_index, Mat& feat);
 
+    // incremental decoding with MultiHeadAttention kv_cache
+    // feed the past key / value of every kv_cache layer from cache, in layer order as k0 v0 k1 v1 ...
+    // an empty cache starts a new sequence
+    // return 0 if success
+    int input_kv_cache(const std::vector<Mat>& cache);
+
+    // keep the present key / value of every kv_cache layer in cache for the next step
+    // the mats are cloned with allocator so that they outlive the blob allocator of this extraction
+    // the cache grows every step, so it is not part of a PlannedAllocator plan
+    // return 0 if success
+    int extract_kv_cache(std::vector<Mat>& cache, Allocator* allocator = 0);
+
     // shape inference
 #if NCNN_STRING
     // set input by blob name
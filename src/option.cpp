@@ -84,6 +84,9 @@ Option::Option()
     use_parallel_preloading = false;
 
     use_pretransform = false;
+
+    use_weight_chunk_pipeline = false;
+    weight_chunk_size = 1024 * 1024;
 }
 
 } // namespace ncnn
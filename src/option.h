@@ -170,6 +170,12 @@ public:
 
     // pre-transform model weights to save preprocessing time, and load weights without reshaping
     bool use_pretransform;
+
+    // start computing a layer while its weights are still loaded in chunks, with parallel pre-loading, default false
+    bool use_weight_chunk_pipeline;
+
+    // approximate bytes per weight chunk, default 1MB
+    int weight_chunk_size;
 };
 
 } // namespace ncnn
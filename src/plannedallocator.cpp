@@ -1,4 +1,6 @@
 #include "plannedallocator.h"
+#include "cpu.h"
+#include <string.h>
 #include <set>
 
 namespace flexnn {
@@ -135,6 +137,7 @@ void* PlannedAllocator::fastMalloc(int memory_type, size_t size)
     if (d->counters[memory_type] >= (int)d->allocations[memory_type].size())
     {
         NCNN_LOGE("PlannedAllocator::fastMalloc() failed to allocate %d bytes from memory type %d", (int)size, memory_type);
+        d->lock.unlock();
         return 0;
     }
     void* ptr = d->allocations[memory_type][d->counters[memory_type]];
@@ -188,6 +191,16 @@ void PlannedAllocator::load_malloc_plan(const char* path)
     int line_count = 0;
     while (fgets(line, 256, fp))
     {
+        if (strncmp(line, "# cpu_isa=", 10) == 0)
+        {
+            // layer timings and workspace sizes depend on the isa variants, the plan may not fit this cpu
+            line[strcspn(line, "\r\n")] = '\0';
+            if (strcmp(line + 10, ncnn::get_cpu_isa_signature()) != 0)
+            {
+                NCNN_LOGE("PlannedAllocator::load_malloc_plan() plan is stale, scheduled on cpu_isa=%s but running on cpu_isa=%s", line + 10, ncnn::get_cpu_isa_signature());
+            }
+            continue;
+        }
         if (line[0] == '#')
         {
             continue;
@@ -303,4 +316,14 @@ void PlannedAllocator::release_buffer()
     }
 }
 
+const void* PlannedAllocator::get_buffer() const
+{
+    return d->buffer;
+}
+
+size_t PlannedAllocator::get_buffer_size() const
+{
+    return d->buffer ? d->buffer_size : 0;
+}
+
 } // namespace flexnn
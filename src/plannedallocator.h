@@ -55,6 +55,10 @@ public:
 
     void release_buffer();
 
+    // the unified buffer, 0 if not initialized
+    const void* get_buffer() const;
+    size_t get_buffer_size() const;
+
     void load_malloc_plan(const char* path);
 
     void set_malloc_plan(const std::vector<std::vector<int> >& malloc_offsets, const std::vector<int>& persistent_offsets);
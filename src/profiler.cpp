@@ -1,6 +1,18 @@
 
 #include "profiler.h"
 #include "platform.h"
+#include "cpu.h"
+
+#include <algorithm>
+#include <stdint.h>
+
+#if defined __linux__
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 namespace flexnn {
 class MemoryProfilerInterfacePrivate
@@ -246,6 +258,12 @@ void UnlockedTimeProfiler::layer_computing_end(int layer_index)
     }
 }
 
+void UnlockedTimeProfiler::layer_computing_isa(int layer_index, const char* isa)
+{
+    d->profiles[layer_index].layer_index = layer_index;
+    d->profiles[layer_index].isa = isa;
+}
+
 void UnlockedTimeProfiler::clear()
 {
     d->profiles.clear();
@@ -266,13 +284,14 @@ void UnlockedTimeProfiler::save(const char* csv_file)
         return;
     }
 
-    fprintf(fp, "layer_index,loading_begin,loading_end,loading_duration,computing_begin,computing_end,computing_duration\n");
+    fprintf(fp, "# cpu_isa=%s\n", ncnn::get_cpu_isa_signature());
+    fprintf(fp, "layer_index,loading_begin,loading_end,loading_duration,computing_begin,computing_end,computing_duration,isa\n");
 
     for (std::map<int, LayerTimeProfile>::iterator it = d->profiles.begin(); it != d->profiles.end(); it++)
     {
         const LayerTimeProfile& profile = it->second;
 
-        fprintf(fp, "%d,%f,%f,%f,%f,%f,%f\n", profile.layer_index, profile.loading_begin, profile.loading_end, profile.loading_duration, profile.computing_begin, profile.computing_end, profile.computing_duration);
+        fprintf(fp, "%d,%f,%f,%f,%f,%f,%f,%s\n", profile.layer_index, profile.loading_begin, profile.loading_end, profile.loading_duration, profile.computing_begin, profile.computing_end, profile.computing_duration, profile.isa);
     }
 
     fclose(fp);
@@ -364,6 +383,14 @@ void LockedTimeProfiler::layer_computing_end(int layer_index)
     d->lock.unlock();
 }
 
+void LockedTimeProfiler::layer_computing_isa(int layer_index, const char* isa)
+{
+    d->lock.lock();
+    d->profiles[layer_index].layer_index = layer_index;
+    d->profiles[layer_index].isa = isa;
+    d->lock.unlock();
+}
+
 void LockedTimeProfiler::clear()
 {
     d->lock.lock();
@@ -386,20 +413,754 @@ void LockedTimeProfiler::save(const char* csv_file)
         return;
     }
 
-    fprintf(fp, "layer_index,loading_begin,loading_end,loading_duration,computing_begin,computing_end,computing_duration\n");
+    fprintf(fp, "# cpu_isa=%s\n", ncnn::get_cpu_isa_signature());
+    fprintf(fp, "layer_index,loading_begin,loading_end,loading_duration,computing_begin,computing_end,computing_duration,isa\n");
 
     d->lock.lock();
     for (std::map<int, LayerTimeProfile>::iterator it = d->profiles.begin(); it != d->profiles.end(); it++)
     {
         const LayerTimeProfile& profile = it->second;
 
-        fprintf(fp, "%d,%f,%f,%f,%f,%f,%f\n", profile.layer_index, profile.loading_begin, profile.loading_end, profile.loading_duration, profile.computing_begin, profile.computing_end, profile.computing_duration);
+        fprintf(fp, "%d,%f,%f,%f,%f,%f,%f,%s\n", profile.layer_index, profile.loading_begin, profile.loading_end, profile.loading_duration, profile.computing_begin, profile.computing_end, profile.computing_duration, profile.isa);
+    }
+    d->lock.unlock();
+
+    fclose(fp);
+    fprintf(stderr, "Saving profiling results success.\n");
+}
+
+void LockedTimeProfiler::save(std::vector<LayerTimeProfile>& profiles)
+{
+    profiles.clear();
+    d->lock.lock();
+    for (std::map<int, LayerTimeProfile>::iterator it = d->profiles.begin(); it != d->profiles.end(); it++)
+    {
+        profiles.push_back(it->second);
+    }
+    d->lock.unlock();
+}
+
+class BufferedTimeProfilerEvent
+{
+public:
+    int layer_index;
+    int event_type; // 0 loading begin, 1 loading end, 2 computing begin, 3 computing end, 4 isa
+    double time;
+    const char* isa;
+};
+
+class BufferedTimeProfilerBuffer
+{
+public:
+    std::vector<BufferedTimeProfilerEvent> events; // ring, allocated once by the owning thread
+    int count;                                     // events ever written since clear
+};
+
+class BufferedTimeProfilerPrivate
+{
+public:
+    void record(int layer_index, int event_type, const char* isa);
+    void merge(std::map<int, LayerTimeProfile>& merged);
+
+    int max_threads;
+    int capacity;
+
+    // the thread local holds generation << 16 | (slot + 1), so that a clear makes every thread claim a new slot
+    ncnn::ThreadLocalStorage tls;
+    int generation;
+    int slot_count;
+    int dropped;
+    std::vector<BufferedTimeProfilerBuffer> buffers;
+
+    std::map<int, LayerTimeProfile> inserted;
+    ncnn::Mutex lock;
+};
+
+void BufferedTimeProfilerPrivate::record(int layer_index, int event_type, const char* isa)
+{
+    const double time = get_current_time();
+
+    intptr_t key = (intptr_t)tls.get();
+    if (key == 0 || (int)(key >> 16) != generation)
+    {
+        const int slot = std::min(NCNN_XADD(&slot_count, 1), max_threads);
+        key = ((intptr_t)generation << 16) | (slot + 1);
+        tls.set((void*)key);
+    }
+
+    const int slot = (int)(key & 0xffff) - 1;
+    if (slot >= max_threads)
+    {
+        NCNN_XADD(&dropped, 1);
+        return;
     }
+
+    BufferedTimeProfilerBuffer& buffer = buffers[slot];
+    if (buffer.events.empty())
+        buffer.events.resize(capacity);
+
+    BufferedTimeProfilerEvent& event = buffer.events[buffer.count % capacity];
+    event.layer_index = layer_index;
+    event.event_type = event_type;
+    event.time = time;
+    event.isa = isa;
+    buffer.count++;
+}
+
+static bool buffered_event_time_less(const BufferedTimeProfilerEvent& a, const BufferedTimeProfilerEvent& b)
+{
+    return a.time < b.time;
+}
+
+void BufferedTimeProfilerPrivate::merge(std::map<int, LayerTimeProfile>& merged)
+{
+    merged = inserted;
+
+    std::vector<BufferedTimeProfilerEvent> events;
+    const int slots = std::min(slot_count, max_threads);
+    for (int i = 0; i < slots; i++)
+    {
+        const BufferedTimeProfilerBuffer& buffer = buffers[i];
+        const int n = std::min(buffer.count, capacity);
+        for (int j = buffer.count - n; j < buffer.count; j++)
+        {
+            events.push_back(buffer.events[j % capacity]);
+        }
+    }
+
+    // replay in time order, later runs of a layer overwrite earlier ones as in the locked profiler
+    std::stable_sort(events.begin(), events.end(), buffered_event_time_less);
+
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        const BufferedTimeProfilerEvent& event = events[i];
+        LayerTimeProfile& profile = merged[event.layer_index];
+        profile.layer_index = event.layer_index;
+
+        if (event.event_type == 0)
+        {
+            profile.loading_begin = event.time;
+        }
+        else if (event.event_type == 1)
+        {
+            profile.loading_end = event.time;
+            if (profile.loading_begin > 0)
+            {
+                profile.loading_duration = profile.loading_end - profile.loading_begin;
+            }
+        }
+        else if (event.event_type == 2)
+        {
+            profile.computing_begin = event.time;
+        }
+        else if (event.event_type == 3)
+        {
+            profile.computing_end = event.time;
+            if (profile.computing_begin > 0)
+            {
+                profile.computing_duration = profile.computing_end - profile.computing_begin;
+            }
+        }
+        else
+        {
+            profile.isa = event.isa;
+        }
+    }
+
+    if (dropped > 0)
+    {
+        NCNN_LOGE("BufferedTimeProfiler dropped %d events of threads beyond max_threads %d", dropped, max_threads);
+    }
+    for (int i = 0; i < slots; i++)
+    {
+        if (buffers[i].count > capacity)
+        {
+            NCNN_LOGE("BufferedTimeProfiler thread %d overwrote %d oldest events, capacity %d", i, buffers[i].count - capacity, capacity);
+        }
+    }
+}
+
+BufferedTimeProfiler::BufferedTimeProfiler(int max_threads, int capacity)
+    : d(new BufferedTimeProfilerPrivate)
+{
+    d->max_threads = std::min(std::max(max_threads, 1), 0xfffe);
+    d->capacity = std::max(capacity, 1);
+    d->generation = 1;
+    d->slot_count = 0;
+    d->dropped = 0;
+    d->buffers.resize(d->max_threads);
+    for (int i = 0; i < d->max_threads; i++)
+    {
+        d->buffers[i].count = 0;
+    }
+}
+
+BufferedTimeProfiler::~BufferedTimeProfiler()
+{
+    delete d;
+}
+
+BufferedTimeProfiler::BufferedTimeProfiler(const BufferedTimeProfiler&)
+    : d(0)
+{
+}
+
+BufferedTimeProfiler& BufferedTimeProfiler::operator=(const BufferedTimeProfiler&)
+{
+    return *this;
+}
+
+void BufferedTimeProfiler::insert(const LayerTimeProfile& profile)
+{
+    d->lock.lock();
+    d->inserted.insert(std::pair<int, LayerTimeProfile>(profile.layer_index, profile));
     d->lock.unlock();
+}
+
+void BufferedTimeProfiler::layer_loading_begin(int layer_index)
+{
+    d->record(layer_index, 0, 0);
+}
+
+void BufferedTimeProfiler::layer_loading_end(int layer_index)
+{
+    d->record(layer_index, 1, 0);
+}
+
+void BufferedTimeProfiler::layer_computing_begin(int layer_index)
+{
+    d->record(layer_index, 2, 0);
+}
+
+void BufferedTimeProfiler::layer_computing_end(int layer_index)
+{
+    d->record(layer_index, 3, 0);
+}
+
+void BufferedTimeProfiler::layer_computing_isa(int layer_index, const char* isa)
+{
+    d->record(layer_index, 4, isa);
+}
+
+void BufferedTimeProfiler::clear()
+{
+    d->lock.lock();
+    d->inserted.clear();
+    d->lock.unlock();
+
+    // 15 bits of generation are kept in the thread local key
+    d->generation = d->generation % 0x7fff + 1;
+    d->slot_count = 0;
+    d->dropped = 0;
+    for (int i = 0; i < d->max_threads; i++)
+    {
+        d->buffers[i].count = 0;
+    }
+}
+
+void BufferedTimeProfiler::print()
+{
+    // TODO
+    return;
+}
+
+void BufferedTimeProfiler::save(const char* csv_file)
+{
+    FILE* fp = fopen(csv_file, "w");
+    if (!fp)
+    {
+        NCNN_LOGE("BufferedTimeProfiler save %s failed", csv_file);
+        return;
+    }
+
+    std::map<int, LayerTimeProfile> profiles;
+    d->merge(profiles);
+
+    fprintf(fp, "# cpu_isa=%s\n", ncnn::get_cpu_isa_signature());
+    fprintf(fp, "layer_index,loading_begin,loading_end,loading_duration,computing_begin,computing_end,computing_duration,isa\n");
+
+    for (std::map<int, LayerTimeProfile>::iterator it = profiles.begin(); it != profiles.end(); it++)
+    {
+        const LayerTimeProfile& profile = it->second;
+
+        fprintf(fp, "%d,%f,%f,%f,%f,%f,%f,%s\n", profile.layer_index, profile.loading_begin, profile.loading_end, profile.loading_duration, profile.computing_begin, profile.computing_end, profile.computing_duration, profile.isa);
+    }
 
     fclose(fp);
     fprintf(stderr, "Saving profiling results success.\n");
 }
 
+void BufferedTimeProfiler::save(std::vector<LayerTimeProfile>& profiles)
+{
+    std::map<int, LayerTimeProfile> merged;
+    d->merge(merged);
+
+    profiles.clear();
+    for (std::map<int, LayerTimeProfile>::iterator it = merged.begin(); it != merged.end(); it++)
+    {
+        profiles.push_back(it->second);
+    }
+}
+
+static const char* perf_counter_names[5] = {"cycles", "instructions", "llc_misses", "page_faults", "context_switches"};
+
+class PerfCounterThread
+{
+public:
+    int fds[5];
+    long long begin[5];
+};
+
+class PerfCounterProfilerPrivate
+{
+public:
+    PerfCounterThread* get_thread();
+    void read_counters(const PerfCounterThread* thread, long long* values) const;
+    void end(int layer_index, bool loading);
+
+    TimeProfiler* time_profiler;
+
+    ncnn::ThreadLocalStorage tls;
+    std::vector<PerfCounterThread*> threads;
+    bool reported;
+
+    std::map<int, LayerPerfCounters> counters;
+    ncnn::Mutex lock;
+};
+
+#if defined __linux__
+static int open_perf_counter(int index, bool* user_only_fallback)
+{
+    static const unsigned int types[5] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_SOFTWARE, PERF_TYPE_SOFTWARE};
+    static const unsigned long long configs[5] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_SW_PAGE_FAULTS, PERF_COUNT_SW_CONTEXT_SWITCHES};
+
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = types[index];
+    attr.config = configs[index];
+    // page faults and context switches are counted in the kernel, keep it for the software events
+    attr.exclude_kernel = types[index] == PERF_TYPE_SOFTWARE ? 0 : 1;
+    attr.exclude_hv = 1;
+
+    // calling thread, any cpu
+    int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    *user_only_fallback = false;
+    if (fd < 0 && !attr.exclude_kernel && (errno == EACCES || errno == EPERM))
+    {
+        // perf_event_paranoid >= 2 rejects kernel counting, fall back to user space only
+        attr.exclude_kernel = 1;
+        fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        *user_only_fallback = true;
+    }
+
+    return fd;
+}
+#endif
+
+PerfCounterThread* PerfCounterProfilerPrivate::get_thread()
+{
+    PerfCounterThread* thread = (PerfCounterThread*)tls.get();
+    if (thread)
+        return thread;
+
+    // first hook on this thread
+    thread = new PerfCounterThread;
+    int errs[5];
+    bool user_only_fallback[5];
+    for (int i = 0; i < 5; i++)
+    {
+#if defined __linux__
+        thread->fds[i] = open_perf_counter(i, &user_only_fallback[i]);
+        errs[i] = errno;
+#else
+        thread->fds[i] = -1;
+        errs[i] = 0;
+        user_only_fallback[i] = false;
+#endif
+        thread->begin[i] = -1;
+    }
+    tls.set(thread);
+
+    lock.lock();
+    threads.push_back(thread);
+    if (!reported)
+    {
+        reported = true;
+        for (int i = 0; i < 5; i++)
+        {
+            if (thread->fds[i] < 0)
+            {
+#if defined __linux__
+                NCNN_LOGE("PerfCounterProfiler %s unavailable, %s", perf_counter_names[i], strerror(errs[i]));
+#else
+                (void)errs;
+                NCNN_LOGE("PerfCounterProfiler %s unavailable, perf_event_open is linux only", perf_counter_names[i]);
+#endif
+            }
+            else if (user_only_fallback[i])
+            {
+                NCNN_LOGE("PerfCounterProfiler %s counts user space only, lower perf_event_paranoid to count the kernel", perf_counter_names[i]);
+            }
+        }
+    }
+    lock.unlock();
+
+    return thread;
+}
+
+void PerfCounterProfilerPrivate::read_counters(const PerfCounterThread* thread, long long* values) const
+{
+    for (int i = 0; i < 5; i++)
+    {
+        values[i] = -1;
+#if defined __linux__
+        unsigned long long value = 0;
+        if (thread->fds[i] >= 0 && read(thread->fds[i], &value, sizeof(value)) == (ssize_t)sizeof(value))
+            values[i] = (long long)value;
+#endif
+    }
+}
+
+void PerfCounterProfilerPrivate::end(int layer_index, bool loading)
+{
+    PerfCounterThread* thread = get_thread();
+
+    long long values[5];
+    read_counters(thread, values);
+
+    lock.lock();
+    LayerPerfCounters& layer = counters[layer_index];
+    layer.layer_index = layer_index;
+    for (int i = 0; i < 5; i++)
+    {
+        long long delta = values[i] >= 0 && thread->begin[i] >= 0 ? values[i] - thread->begin[i] : -1;
+        if (loading)
+            layer.loading[i] = delta;
+        else
+            layer.computing[i] = delta;
+    }
+    lock.unlock();
+}
+
+PerfCounterProfiler::PerfCounterProfiler(TimeProfiler* time_profiler)
+    : d(new PerfCounterProfilerPrivate)
+{
+    d->time_profiler = time_profiler;
+    d->reported = false;
+}
+
+PerfCounterProfiler::~PerfCounterProfiler()
+{
+    for (size_t i = 0; i < d->threads.size(); i++)
+    {
+#if defined __linux__
+        for (int j = 0; j < 5; j++)
+        {
+            if (d->threads[i]->fds[j] >= 0)
+                close(d->threads[i]->fds[j]);
+        }
+#endif
+        delete d->threads[i];
+    }
+
+    delete d;
+}
+
+PerfCounterProfiler::PerfCounterProfiler(const PerfCounterProfiler&)
+    : d(0)
+{
+}
+
+PerfCounterProfiler& PerfCounterProfiler::operator=(const PerfCounterProfiler&)
+{
+    return *this;
+}
+
+void PerfCounterProfiler::insert(const LayerTimeProfile& profile)
+{
+    if (d->time_profiler)
+        d->time_profiler->insert(profile);
+}
+
+void PerfCounterProfiler::layer_loading_begin(int layer_index)
+{
+    if (d->time_profiler)
+        d->time_profiler->layer_loading_begin(layer_index);
+
+    // read last, so that the wrapped profiler is not counted
+    PerfCounterThread* thread = d->get_thread();
+    d->read_counters(thread, thread->begin);
+}
+
+void PerfCounterProfiler::layer_loading_end(int layer_index)
+{
+    d->end(layer_index, true);
+
+    if (d->time_profiler)
+        d->time_profiler->layer_loading_end(layer_index);
+}
+
+void PerfCounterProfiler::layer_computing_begin(int layer_index)
+{
+    if (d->time_profiler)
+        d->time_profiler->layer_computing_begin(layer_index);
+
+    PerfCounterThread* thread = d->get_thread();
+    d->read_counters(thread, thread->begin);
+}
+
+void PerfCounterProfiler::layer_computing_end(int layer_index)
+{
+    d->end(layer_index, false);
+
+    if (d->time_profiler)
+        d->time_profiler->layer_computing_end(layer_index);
+}
+
+void PerfCounterProfiler::layer_computing_isa(int layer_index, const char* isa)
+{
+    if (d->time_profiler)
+        d->time_profiler->layer_computing_isa(layer_index, isa);
+}
+
+void PerfCounterProfiler::clear()
+{
+    d->lock.lock();
+    d->counters.clear();
+    d->lock.unlock();
+
+    if (d->time_profiler)
+        d->time_profiler->clear();
+}
+
+void PerfCounterProfiler::print()
+{
+    // TODO
+    return;
+}
+
+void PerfCounterProfiler::save(const char* csv_file)
+{
+    FILE* fp = fopen(csv_file, "w");
+    if (!fp)
+    {
+        NCNN_LOGE("PerfCounterProfiler save %s failed", csv_file);
+        return;
+    }
+
+    fprintf(fp, "# cpu_isa=%s\n", ncnn::get_cpu_isa_signature());
+    fprintf(fp, "layer_index");
+    for (int i = 0; i < 5; i++)
+    {
+        fprintf(fp, ",loading_%s", perf_counter_names[i]);
+    }
+    for (int i = 0; i < 5; i++)
+    {
+        fprintf(fp, ",computing_%s", perf_counter_names[i]);
+    }
+    fprintf(fp, "\n");
+
+    d->lock.lock();
+    for (std::map<int, LayerPerfCounters>::iterator it = d->counters.begin(); it != d->counters.end(); it++)
+    {
+        const LayerPerfCounters& layer = it->second;
+
+        fprintf(fp, "%d", layer.layer_index);
+        for (int i = 0; i < 5; i++)
+        {
+            fprintf(fp, ",%lld", layer.loading[i]);
+        }
+        for (int i = 0; i < 5; i++)
+        {
+            fprintf(fp, ",%lld", layer.computing[i]);
+        }
+        fprintf(fp, "\n");
+    }
+    d->lock.unlock();
+
+    fclose(fp);
+    fprintf(stderr, "Saving profiling results success.\n");
+}
+
+void PerfCounterProfiler::save(std::vector<LayerPerfCounters>& counters)
+{
+    counters.clear();
+    d->lock.lock();
+    for (std::map<int, LayerPerfCounters>::iterator it = d->counters.begin(); it != d->counters.end(); it++)
+    {
+        counters.push_back(it->second);
+    }
+    d->lock.unlock();
+}
+
+class TraceExporterPrivate
+{
+public:
+    std::vector<LayerTimeProfile> profiles;
+    std::vector<MemoryProfilerEvent> events;
+    std::vector<std::string> layer_names;
+    std::vector<std::vector<int> > malloc_offsets;
+};
+
+TraceExporter::TraceExporter()
+    : d(new TraceExporterPrivate)
+{
+}
+
+TraceExporter::~TraceExporter()
+{
+    delete d;
+}
+
+TraceExporter::TraceExporter(const TraceExporter&)
+    : d(0)
+{
+}
+
+TraceExporter& TraceExporter::operator=(const TraceExporter&)
+{
+    return *this;
+}
+
+void TraceExporter::set_time_profiles(const std::vector<LayerTimeProfile>& profiles)
+{
+    d->profiles = profiles;
+}
+
+void TraceExporter::set_memory_events(const std::vector<MemoryProfilerEvent>& events)
+{
+    d->events = events;
+}
+
+void TraceExporter::set_layer_names(const std::vector<std::string>& names)
+{
+    d->layer_names = names;
+}
+
+void TraceExporter::set_malloc_plan(const std::vector<std::vector<int> >& malloc_offsets)
+{
+    d->malloc_offsets = malloc_offsets;
+}
+
+static void fprint_json_string(FILE* fp, const char* str)
+{
+    fputc('"', fp);
+    for (const char* p = str; *p; p++)
+    {
+        const unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\')
+            fprintf(fp, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(fp, "\\u%04x", c);
+        else
+            fputc(c, fp);
+    }
+    fputc('"', fp);
+}
+
+void TraceExporter::save(const char* json_file)
+{
+    FILE* fp = fopen(json_file, "w");
+    if (!fp)
+    {
+        NCNN_LOGE("TraceExporter save %s failed", json_file);
+        return;
+    }
+
+    static const char* memory_type_names[3] = {"weight", "blob", "intermediate"};
+
+    // trace timestamps are in us from the first recorded event, profiles are in ms
+    double time_base = -1;
+    for (size_t i = 0; i < d->profiles.size(); i++)
+    {
+        const LayerTimeProfile& profile = d->profiles[i];
+        if (profile.loading_begin > 0 && (time_base < 0 || profile.loading_begin < time_base))
+            time_base = profile.loading_begin;
+        if (profile.computing_begin > 0 && (time_base < 0 || profile.computing_begin < time_base))
+            time_base = profile.computing_begin;
+    }
+    for (size_t i = 0; i < d->events.size(); i++)
+    {
+        if (time_base < 0 || d->events[i].time < time_base)
+            time_base = d->events[i].time;
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"cpu_isa\":\"%s\"},\"traceEvents\":[\n", ncnn::get_cpu_isa_signature());
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"flexnn\"}},\n");
+    fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"computing\"}},\n");
+    fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"loading\"}},\n");
+    fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":2,\"args\":{\"name\":\"allocator\"}}");
+
+    for (size_t i = 0; i < d->profiles.size(); i++)
+    {
+        const LayerTimeProfile& profile = d->profiles[i];
+
+        char default_name[32];
+        sprintf(default_name, "layer %d", profile.layer_index);
+        const char* name = profile.layer_index >= 0 && profile.layer_index < (int)d->layer_names.size() ? d->layer_names[profile.layer_index].c_str() : default_name;
+
+        if (profile.loading_begin > 0 && profile.loading_end >= profile.loading_begin)
+        {
+            fprintf(fp, ",\n{\"name\":");
+            fprint_json_string(fp, name);
+            fprintf(fp, ",\"cat\":\"loading\",\"ph\":\"X\",\"pid\":0,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"layer_index\":%d}}", (profile.loading_begin - time_base) * 1000, (profile.loading_end - profile.loading_begin) * 1000, profile.layer_index);
+        }
+
+        if (profile.computing_begin > 0 && profile.computing_end >= profile.computing_begin)
+        {
+            fprintf(fp, ",\n{\"name\":");
+            fprint_json_string(fp, name);
+            fprintf(fp, ",\"cat\":\"computing\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"layer_index\":%d,\"isa\":", (profile.computing_begin - time_base) * 1000, (profile.computing_end - profile.computing_begin) * 1000, profile.layer_index);
+            fprint_json_string(fp, profile.isa ? profile.isa : "");
+            fprintf(fp, "}}");
+        }
+    }
+
+    // free events carry no size, bytes in use follow the size of the matching malloc
+    std::map<void*, std::pair<int, size_t> > live;
+    size_t in_use[3] = {0, 0, 0};
+    int malloc_count[3] = {0, 0, 0};
+    for (size_t i = 0; i < d->events.size(); i++)
+    {
+        const MemoryProfilerEvent& event = d->events[i];
+        if (event.memory_type < 0 || event.memory_type > 2)
+            continue;
+
+        const double ts = (event.time - time_base) * 1000;
+
+        if (event.event_type == 1)
+        {
+            live[event.ptr] = std::pair<int, size_t>(event.memory_type, event.size);
+            in_use[event.memory_type] += event.size;
+
+            const int n = malloc_count[event.memory_type]++;
+
+            fprintf(fp, ",\n{\"name\":\"malloc %s\",\"cat\":\"memory\",\"ph\":\"i\",\"s\":\"t\",\"pid\":0,\"tid\":2,\"ts\":%.3f,\"args\":{\"layer_index\":%d,\"size\":%zu,\"malloc_index\":%d", memory_type_names[event.memory_type], ts, event.layer_index, event.size, n);
+            if (event.memory_type < (int)d->malloc_offsets.size() && n < (int)d->malloc_offsets[event.memory_type].size())
+            {
+                fprintf(fp, ",\"plan_offset\":%d", d->malloc_offsets[event.memory_type][n]);
+            }
+            fprintf(fp, "}}");
+        }
+        else
+        {
+            std::map<void*, std::pair<int, size_t> >::iterator it = live.find(event.ptr);
+            if (it == live.end())
+                continue;
+
+            in_use[it->second.first] -= it->second.second;
+            live.erase(it);
+        }
+
+        fprintf(fp, ",\n{\"name\":\"bytes in use\",\"ph\":\"C\",\"pid\":0,\"ts\":%.3f,\"args\":{\"weight\":%zu,\"blob\":%zu,\"intermediate\":%zu}}", ts, in_use[0], in_use[1], in_use[2]);
+    }
+
+    fprintf(fp, "\n]}\n");
+
+    fclose(fp);
+    fprintf(stderr, "Saving trace success.\n");
+}
+
 // --
 } // namespace flexnn
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "allocator.h"
 #include "flexnn_utils.h"
 #include <map>
+#include <string>
 
 namespace flexnn {
 //                      (Unified Records)
@@ -110,10 +111,10 @@ class LayerTimeProfile
 {
 public:
     LayerTimeProfile()
-        : layer_index(0), loading_begin(0), loading_end(0), loading_duration(0), computing_begin(0), computing_end(0), computing_duration(0) {};
+        : layer_index(0), loading_begin(0), loading_end(0), loading_duration(0), computing_begin(0), computing_end(0), computing_duration(0), isa("") {};
 
     LayerTimeProfile(int _layer_index, double _loading_begin, double _loading_end, double _computing_begin, double _computing_end)
-        : layer_index(_layer_index), loading_begin(_loading_begin), loading_end(_loading_end), loading_duration(_loading_end - _loading_begin), computing_begin(_computing_begin), computing_end(_computing_end), computing_duration(_computing_end - _computing_begin) {};
+        : layer_index(_layer_index), loading_begin(_loading_begin), loading_end(_loading_end), loading_duration(_loading_end - _loading_begin), computing_begin(_computing_begin), computing_end(_computing_end), computing_duration(_computing_end - _computing_begin), isa("") {};
 
 public:
     int layer_index;
@@ -123,6 +124,7 @@ public:
     double computing_begin;
     double computing_end;
     double computing_duration;
+    const char* isa; // isa variant the layer was computed with, static string from ncnn::get_layer_isa
 };
 
 class TimeProfiler
@@ -134,6 +136,7 @@ public:
     virtual void layer_loading_end(int layer_index) = 0;
     virtual void layer_computing_begin(int layer_index) = 0;
     virtual void layer_computing_end(int layer_index) = 0;
+    virtual void layer_computing_isa(int layer_index, const char* isa) = 0;
 
     virtual void clear() = 0;
 };
@@ -151,6 +154,7 @@ public:
     void layer_loading_end(int layer_index);
     void layer_computing_begin(int layer_index);
     void layer_computing_end(int layer_index);
+    void layer_computing_isa(int layer_index, const char* isa);
 
     void clear();
 
@@ -182,6 +186,7 @@ public:
     void layer_loading_end(int layer_index);
     void layer_computing_begin(int layer_index);
     void layer_computing_end(int layer_index);
+    void layer_computing_isa(int layer_index, const char* isa);
 
     void clear();
 
@@ -189,6 +194,8 @@ public:
 
     void save(const char* csv_file);
 
+    void save(std::vector<LayerTimeProfile>& profiles);
+
 private:
     LockedTimeProfiler(const LockedTimeProfiler&);
     LockedTimeProfiler& operator=(const LockedTimeProfiler&);
@@ -197,6 +204,130 @@ private:
     LockedTimeProfilerPrivate* const d;
 };
 
+// lock-free time profiler for parallel run, cheap enough to stay on
+// every recording thread appends to its own ring buffer, the buffers are merged into profiles in save().
+// the rings keep the latest events, capacity should hold one run of a thread, 3 events per computed layer
+class BufferedTimeProfilerPrivate;
+class BufferedTimeProfiler : public TimeProfiler
+{
+public:
+    // events of threads beyond max_threads are dropped and reported in save()
+    BufferedTimeProfiler(int max_threads = 64, int capacity = 4096);
+    ~BufferedTimeProfiler();
+
+    // not on the hot path, takes a lock
+    void insert(const LayerTimeProfile& profile);
+
+    void layer_loading_begin(int layer_index);
+    void layer_loading_end(int layer_index);
+    void layer_computing_begin(int layer_index);
+    void layer_computing_end(int layer_index);
+    void layer_computing_isa(int layer_index, const char* isa);
+
+    // must not race with recording threads, call it between runs
+    void clear();
+
+    void print();
+
+    void save(const char* csv_file);
+
+    void save(std::vector<LayerTimeProfile>& profiles);
+
+private:
+    BufferedTimeProfiler(const BufferedTimeProfiler&);
+    BufferedTimeProfiler& operator=(const BufferedTimeProfiler&);
+
+private:
+    BufferedTimeProfilerPrivate* const d;
+};
+
+class LayerPerfCounters
+{
+public:
+    LayerPerfCounters()
+        : layer_index(0)
+    {
+        for (int i = 0; i < 5; i++)
+        {
+            loading[i] = -1;
+            computing[i] = -1;
+        }
+    }
+
+public:
+    int layer_index;
+    // cycles, instructions, llc misses, page faults, context switches, -1 if unavailable
+    long long loading[5];
+    long long computing[5];
+};
+
+// per-layer hardware and software counters through linux perf_event_open, around the TimeProfiler hooks
+// it forwards every hook to the wrapped time profiler, so it can replace it in Option::time_profiler.
+// counts the calling thread only, the loading thread for loading and the computing thread for computing, not omp workers.
+// counters that can not be opened, e.g. in a container without perf access or on other systems, read -1
+class PerfCounterProfilerPrivate;
+class NCNN_EXPORT PerfCounterProfiler : public TimeProfiler
+{
+public:
+    PerfCounterProfiler(TimeProfiler* time_profiler = 0);
+    ~PerfCounterProfiler();
+
+    void insert(const LayerTimeProfile& profile);
+
+    void layer_loading_begin(int layer_index);
+    void layer_loading_end(int layer_index);
+    void layer_computing_begin(int layer_index);
+    void layer_computing_end(int layer_index);
+    void layer_computing_isa(int layer_index, const char* isa);
+
+    // clears the wrapped time profiler too
+    void clear();
+
+    void print();
+
+    // counters of the latest run of each layer
+    void save(const char* csv_file);
+
+    void save(std::vector<LayerPerfCounters>& counters);
+
+private:
+    PerfCounterProfiler(const PerfCounterProfiler&);
+    PerfCounterProfiler& operator=(const PerfCounterProfiler&);
+
+private:
+    PerfCounterProfilerPrivate* const d;
+};
+
+// Chrome Trace Event json of a profiled run, open it in chrome://tracing or ui.perfetto.dev
+// one track for computing and one for loading, bytes in use per memory type as counters,
+// and malloc markers annotated with their slot in the malloc plan if one is given.
+// The trace is built from the saved profiles after the run, so the profiled run itself pays nothing for it.
+class TraceExporterPrivate;
+class NCNN_EXPORT TraceExporter
+{
+public:
+    TraceExporter();
+    ~TraceExporter();
+
+    void set_time_profiles(const std::vector<LayerTimeProfile>& profiles);
+    void set_memory_events(const std::vector<MemoryProfilerEvent>& events);
+
+    // layer names by layer index, "layer <index>" if not set
+    void set_layer_names(const std::vector<std::string>& names);
+
+    // malloc_offsets[memory_type][n] is the offset of the n-th malloc of that type, as in PlannedAllocator
+    void set_malloc_plan(const std::vector<std::vector<int> >& malloc_offsets);
+
+    void save(const char* json_file);
+
+private:
+    TraceExporter(const TraceExporter&);
+    TraceExporter& operator=(const TraceExporter&);
+
+private:
+    TraceExporterPrivate* const d;
+};
+
 } // namespace flexnn
 
 #endif // PROFILER_H
\ No newline at end of file